@@ -0,0 +1,95 @@
+//---------------------------------------------------------------------------------------------
+// adcsim.cpp
+//
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "pico/stdlib.h"
+
+#include "hardware/adc.h"
+
+
+//---------------------------------------------------------------------------------------------
+// globals
+//
+
+static AdcSource source = 0;
+static uint selected = 0;
+static uint roundRobin = 0;
+static uint32_t reads[4];
+
+
+//---------------------------------------------------------------------------------------------
+// the sdk's calls
+//
+
+void adc_init (void)
+{
+	selected = 0;
+	roundRobin = 0;
+}
+
+
+void adc_gpio_init (uint gpio)
+{
+	(void) gpio;
+}
+
+
+void adc_select_input (uint input)
+{
+	selected = input & 3;
+}
+
+
+void adc_set_round_robin (uint mask)
+{
+	roundRobin = mask & 0xf;
+}
+
+
+//---------------------------------------------------------------------------------------------
+// adc_read -- one conversion of the selected input, then on to the next input in the round
+//             robin mask, wrapping from 3 to 0
+//
+
+uint16_t adc_read (void)
+{
+	uint input = selected;
+	uint16_t value = source ? source (input) : 0;
+
+	reads[input]++;
+
+	if (roundRobin) {
+		do {
+			selected = (selected + 1) & 3;
+		} while (!(roundRobin & (1 << selected)));
+	}
+
+	return value;
+}
+
+
+//---------------------------------------------------------------------------------------------
+// host only
+//
+
+void AdcSimSource (AdcSource s)
+{
+	source = s;
+}
+
+
+uint32_t AdcSimReads (uint input)
+{
+	return reads[input & 3];
+}
+
+
+void AdcSimClear (void)
+{
+	for (int i = 0; i < 4; i++) {
+		reads[i] = 0;
+	}
+}
@@ -0,0 +1,307 @@
+//---------------------------------------------------------------------------------------------
+// notes
+//
+// estsim -- fuel747's position estimator against the boxcar average it replaced, on the host
+//
+// usage:
+//    estsim [-s sigma_read] [-a amplitude] [-w sigma_w] [-v sigma_v]
+//
+// the pot is read by an adc with gaussian noise of sigma_read counts rms per read,
+// ADC_SIGMA_READ by default, quantized to 12 bits. the needle sits at mid scale and swings
+// by a sine of amplitude counts, 200 by default, at 0.25, 0.5, 1, 2 and 4 Hz, and holds
+// still for the noise figures. every 10 ms tick takes 512 reads 2 us apart, ADC_CONV_NS,
+// and each way of turning them into a position gets the same reads:
+//
+//    boxcar 512       the average of all 512, as main.cpp did before the estimator
+//    boxcar + biquad  that through main.cpp's FilterPosition, the 10 Hz butterworth it had
+//                     commented out
+//    average 16       the average of the first POSITION_SAMPLES, no filtering
+//    alpha-beta 16    that through estimator.cpp tuned from sigma_w and sigma_v,
+//                     EST_SIGMA_W and EST_SIGMA_V by default, as gauges.cpp runs it
+//
+// the velocity for the d term is the estimator's v for alpha-beta and the delta of the
+// position smoothed as gauges.cpp does with D_FROM_VELOCITY 0 for the others.
+//
+// for each it prints the adc time per tick, the offset and noise on position and the
+// noise on velocity while the needle holds still, and the lag behind the needle at each frequency, from the
+// phase of the fundamental over 16 s. lag is measured from the last read of the tick,
+// when the pid can first use the position, so the boxcar's own 1 ms of reading counts
+// against it.
+//
+// the estimator is there for lag and adc time, not noise. it reads a 32nd of what the
+// boxcar did and ends up with about 4 times its position noise and 30 times its velocity
+// noise, where the biquad that would have quietened the boxcar lags 22 ms. so the checks
+// are on alpha-beta 16 alone:
+//    lag          under LAG_LIMIT_MS at every frequency
+//    gain         within GAIN_LIMIT of 1 at every frequency
+//    noise        less than average 16's, the same reads unfiltered
+//    v noise      less than sigma_read / sqrt (POSITION_SAMPLES) per tick, 200 counts/s
+//                 at the defaults, under the 283 of a bare one tick difference
+//    both         within NOISE_LIMIT of the steady state alpha-beta figures for its g and
+//                 h, so the estimator does what its tuning says
+// the exit status is 1 if one fails.
+//
+
+//---------------------------------------------------------------------------------------------
+// includes
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+
+#include <random>
+
+#include "pico/stdlib.h"
+
+#include "gauges.h"
+
+
+//---------------------------------------------------------------------------------------------
+// defines
+//
+
+#define MID          2048.0
+#define BOXCAR_READS 512
+#define SETTLE_S     2.0
+#define MEASURE_S    16.0
+
+// alpha-beta 16's pass limits
+#define LAG_LIMIT_MS 1.0
+#define GAIN_LIMIT   0.05
+#define NOISE_LIMIT  0.15
+
+// smoothing for the delta position velocity, as gauges.cpp
+#define alpha (0.9)
+
+enum { BOXCAR, BIQUAD, AVERAGE, ESTIMATOR, METHODS };
+
+
+//---------------------------------------------------------------------------------------------
+// typedefs
+//
+
+typedef struct {
+	// filter state
+	AlphaBeta ab;
+	float     x1, x2, y1, y2;
+
+	// outputs this tick
+	float     position[METHODS];
+	float     velocity[METHODS];
+	float     last[METHODS];
+	float     smooth[METHODS];
+} Paths;
+
+
+//---------------------------------------------------------------------------------------------
+// globals
+//
+
+static const char *names[METHODS] = { "boxcar 512", "boxcar + biquad", "average 16", "alpha-beta 16" };
+static const int reads[METHODS] = { BOXCAR_READS, BOXCAR_READS, POSITION_SAMPLES, POSITION_SAMPLES };
+static const double freqs[] = { 0.25, 0.5, 1.0, 2.0, 4.0 };
+#define FREQS (int)(sizeof (freqs) / sizeof (freqs[0]))
+
+static double sigmaRead = ADC_SIGMA_READ;
+static double amplitude = 200.0;
+static double sigmaW = EST_SIGMA_W;
+static double sigmaV = EST_SIGMA_V;
+
+
+//---------------------------------------------------------------------------------------------
+// Biquad -- main.cpp's FilterPosition, [b,a]=butter_synth(2,10,100)
+//
+
+static int16_t Biquad (Paths *p, int16_t x0)
+{
+	const float b0 = 0.067455, b1 = 0.134911, b2 = 0.067455;
+	const float a1 = -1.14298, a2 = 0.41280;
+	int16_t y0;
+
+	y0 = b0*x0 + b1*p->x1 + b2*p->x2 - a1*p->y1 - a2*p->y2;
+
+	p->x2 = p->x1;
+	p->x1 = x0;
+	p->y2 = p->y1;
+	p->y1 = y0;
+
+	return y0;
+}
+
+
+//---------------------------------------------------------------------------------------------
+// Init -- start every path at the needle's rest
+//
+
+static void Init (Paths *p)
+{
+	AlphaBetaInit (&p->ab, Ts, 1.0, 0.0);
+	AlphaBetaTune (&p->ab, sigmaW, sigmaV);
+	p->x1 = p->x2 = p->y1 = p->y2 = MID;
+	for (int m = 0; m < METHODS; m++) {
+		p->last[m] = MID;
+		p->smooth[m] = 0;
+	}
+}
+
+
+//---------------------------------------------------------------------------------------------
+// Tick -- one 10 ms tick starting at t seconds
+//
+
+static void Tick (Paths *p, double t, double hz, std::mt19937 &rng)
+{
+	std::normal_distribution<double> noise (0.0, sigmaRead);
+	int32_t sum = 0, sum16 = 0;
+
+	for (int i = 0; i < BOXCAR_READS; i++) {
+		double x = MID + amplitude * sin (2.0 * M_PI * hz * (t + i * ADC_CONV_NS * 1e-9));
+		long z = lround (x + noise (rng));
+		z = (z < 0) ? 0 : (z > 4095) ? 4095 : z;
+		sum += z;
+		if (i < POSITION_SAMPLES) {
+			sum16 += z;
+		}
+	}
+
+	p->position[BOXCAR] = round (sum / (double)BOXCAR_READS);
+	p->position[BIQUAD] = Biquad (p, p->position[BOXCAR]);
+	p->position[AVERAGE] = round (sum16 / (double)POSITION_SAMPLES);
+	AlphaBetaUpdate (&p->ab, (float)sum16 / POSITION_SAMPLES);
+	p->position[ESTIMATOR] = round (p->ab.x);
+
+	for (int m = 0; m < METHODS; m++) {
+		if (m == ESTIMATOR) {
+			p->velocity[m] = p->ab.v;
+		} else {
+			p->smooth[m] = alpha * p->smooth[m] + (1 - alpha) * (p->position[m] - p->last[m]);
+			p->velocity[m] = p->smooth[m] / Ts;
+		}
+		p->last[m] = p->position[m];
+	}
+}
+
+
+//---------------------------------------------------------------------------------------------
+// main
+//
+
+int main (int argc, char *argv[])
+{
+	bool usage = false;
+
+	for (int i = 1; i < argc; i++) {
+		if (!strcmp (argv[i], "-s") && (i + 1 < argc)) {
+			sigmaRead = atof (argv[++i]);
+		} else if (!strcmp (argv[i], "-a") && (i + 1 < argc)) {
+			amplitude = atof (argv[++i]);
+		} else if (!strcmp (argv[i], "-w") && (i + 1 < argc)) {
+			sigmaW = atof (argv[++i]);
+		} else if (!strcmp (argv[i], "-v") && (i + 1 < argc)) {
+			sigmaV = atof (argv[++i]);
+		} else {
+			usage = true;
+			break;
+		}
+	}
+	if (usage || (sigmaRead < 0) || (amplitude <= 0) || (amplitude > 2000) || (sigmaW <= 0) || (sigmaV < 0)) {
+		fprintf (stderr, "usage: estsim [-s sigma_read] [-a amplitude] [-w sigma_w] [-v sigma_v]\n");
+		return 2;
+	}
+
+	Paths p;
+	Init (&p);
+	printf ("read noise %.1f counts rms, sine %.0f counts, estimator g %.4f h %.4f\n\n",
+		sigmaRead, amplitude, p.ab.g, p.ab.h);
+
+	int settle = (int)(SETTLE_S / Ts), measure = (int)(MEASURE_S / Ts);
+	std::mt19937 rng (1);
+
+	// noise while the needle holds still
+	double xMean[METHODS] = { 0 }, xSum[METHODS] = { 0 }, vSum[METHODS] = { 0 };
+	Init (&p);
+	for (int n = 0; n < settle + measure; n++) {
+		Tick (&p, n * Ts, 0.0, rng);
+		if (n >= settle) {
+			for (int m = 0; m < METHODS; m++) {
+				xMean[m] += p.position[m] - MID;
+				xSum[m] += (p.position[m] - MID) * (p.position[m] - MID);
+				vSum[m] += p.velocity[m] * p.velocity[m];
+			}
+		}
+	}
+
+	// lag and gain from the fundamental, times are the last read of each method
+	double lag[METHODS][FREQS], gain[METHODS][FREQS];
+	for (int f = 0; f < FREQS; f++) {
+		double w = 2.0 * M_PI * freqs[f];
+		double I[METHODS] = { 0 }, Q[METHODS] = { 0 };
+		Init (&p);
+		for (int n = 0; n < settle + measure; n++) {
+			Tick (&p, n * Ts, freqs[f], rng);
+			if (n < settle) {
+				continue;
+			}
+			for (int m = 0; m < METHODS; m++) {
+				double t = n * Ts + (reads[m] - 1) * ADC_CONV_NS * 1e-9;
+				I[m] += (p.position[m] - MID) * sin (w * t);
+				Q[m] += (p.position[m] - MID) * cos (w * t);
+			}
+		}
+		for (int m = 0; m < METHODS; m++) {
+			lag[m][f] = atan2 (-Q[m], I[m]) / w * 1000.0;
+			gain[m][f] = 2.0 * sqrt (I[m] * I[m] + Q[m] * Q[m]) / measure / amplitude;
+		}
+	}
+
+	printf ("                  adc ms  offset   noise  v noise    lag ms at");
+	for (int f = 0; f < FREQS; f++) {
+		printf (" %5.2f", freqs[f]);
+	}
+	printf (" Hz   gain at %.0f Hz\n", freqs[FREQS - 1]);
+	for (int m = 0; m < METHODS; m++) {
+		double offset = xMean[m] / measure;
+		printf ("%-16s %7.3f %7.2f %7.2f %8.1f             ", names[m], reads[m] * ADC_CONV_NS * 1e-6, offset,
+			sqrt (xSum[m] / measure - offset * offset), sqrt (vSum[m] / measure));
+		for (int f = 0; f < FREQS; f++) {
+			printf (" %5.2f", lag[m][f]);
+		}
+		printf ("       %5.3f\n", gain[m][FREQS - 1]);
+	}
+	printf ("\noffset in counts, noise in counts rms and counts/s rms, adc ms per gauge per tick\n\n");
+
+	// steady state alpha-beta noise for white measurement noise, Kalata's variance ratios
+	double g = p.ab.g, h = p.ab.h;
+	double sigmaMeas = sigmaRead / sqrt (POSITION_SAMPLES);
+	double xModel = sigmaMeas * sqrt ((2*g*g + 2*h - 3*g*h) / (g * (4 - 2*g - h)));
+	double vModel = sigmaMeas / Ts * sqrt (2*h*h / (g * (4 - 2*g - h)));
+
+	double x[METHODS], v[METHODS];
+	for (int m = 0; m < METHODS; m++) {
+		double offset = xMean[m] / measure;
+		x[m] = sqrt (xSum[m] / measure - offset * offset);
+		v[m] = sqrt (vSum[m] / measure);
+	}
+	double lagMax = 0, gainMax = 0;
+	for (int f = 0; f < FREQS; f++) {
+		lagMax = (fabs (lag[ESTIMATOR][f]) > lagMax) ? fabs (lag[ESTIMATOR][f]) : lagMax;
+		gainMax = (fabs (gain[ESTIMATOR][f] - 1) > gainMax) ? fabs (gain[ESTIMATOR][f] - 1) : gainMax;
+	}
+
+	bool pass = (lagMax <= LAG_LIMIT_MS) && (gainMax <= GAIN_LIMIT) && (x[ESTIMATOR] < x[AVERAGE]) &&
+		(v[ESTIMATOR] < sigmaMeas / Ts) && (fabs (x[ESTIMATOR] / xModel - 1) <= NOISE_LIMIT) && (fabs (v[ESTIMATOR] / vModel - 1) <= NOISE_LIMIT);
+
+	printf ("%s: lag %.2f ms worst, limit %.2f, gain off by %.3f worst, limit %.3f\n", names[ESTIMATOR],
+		lagMax, LAG_LIMIT_MS, gainMax, GAIN_LIMIT);
+	printf ("%s: noise %.2f counts against %.2f for average 16 and %.2f steady state\n", names[ESTIMATOR],
+		x[ESTIMATOR], x[AVERAGE], xModel);
+	printf ("%s: v noise %.1f counts/s against %.1f steady state, limit %.1f\n", names[ESTIMATOR],
+		v[ESTIMATOR], vModel, sigmaMeas / Ts);
+	printf ("%s\n", pass ? "pass" : "FAIL");
+
+	return pass ? 0 : 1;
+}
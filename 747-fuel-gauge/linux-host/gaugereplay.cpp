@@ -0,0 +1,355 @@
+//---------------------------------------------------------------------------------------------
+// notes
+//
+// gaugereplay -- feeds a recorded pot capture through fuel747's gauge loop and checks the
+//                result against a golden file
+//
+// usage:
+//    gaugereplay [-d decimate] [-q 0|1] [-w golden.txt | -g golden.txt [-v vel_tol]
+//                [-u drive_tol]] script.txt capture.cap
+//
+// the capture is gauge 0's feedback pot, see lib/capture/capture.h, a channel called Pot in
+// volts at a whole number of sets per 10 ms tick. pidsim -c writes one from its needle, a
+// recorder on the wiper of a real gauge does as well. volts are turned into adc counts,
+// 3.3 V being 4096.
+//
+// the loop is the firmware's own, gauges.cpp's GaugesSample and GaugesUpdate every 10 ms
+// with estimator.cpp and pid.cpp under them, as main.cpp runs them. the n-th read of gauge
+// 0's input in a tick is the n-th set of the tick's part of the capture, reads past the end
+// of it get its last set, so a capture at 100 * POSITION_SAMPLES sets per second gives
+// every running read a sample of its own. gauge 1 sits on target at rest.
+//
+// the script is the targets the capture was recorded with, "seconds target_counts" lines
+// as pidsim takes them. the replay is open loop, the drive it works out doesn't move the
+// recorded needle, so it shows what the estimator and pid make of the same pot trace.
+// -q 0 turns quiescent mode off.
+//
+// every decimate ticks, 1 by default, it gives a record
+//    tick   target   position   velocity   drive   holding
+// of gauge 0 in counts, counts per second, -1 to +1 and 0 or 1.
+//
+//    -w   write the records to golden.txt, with the settings in a comment line
+//    -g   compare the records with golden.txt. velocities have to match to within vel_tol
+//         counts/s (0.5), drives to within drive_tol (0.0001), the rest exactly. the exit
+//         status is 1 on any mismatch.
+//
+// testdata/move.cap, script.txt and move.txt are that for the ctest, see CMakeLists.txt.
+//
+
+//---------------------------------------------------------------------------------------------
+// includes
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+
+#include <vector>
+
+#include "pico/stdlib.h"
+
+#include "hardware/adc.h"
+
+#include "capture/capture.h"
+#include "gauges.h"
+
+
+//---------------------------------------------------------------------------------------------
+// defines
+//
+
+#define ADC_VREF 3.3
+#define REST     2048                   // gauge 1's pot and target
+
+
+//---------------------------------------------------------------------------------------------
+// typedefs
+//
+
+typedef struct {
+	double seconds;
+	int16_t target;
+} Move;
+
+typedef struct {
+	uint32_t tick;
+	int      target;
+	int      position;
+	float    velocity;
+	float    drive;
+	int      holding;
+} Record;
+
+
+//---------------------------------------------------------------------------------------------
+// globals
+//
+
+const GaugeMap gaugeMap[MAX_GAUGES] = {
+	{ 2, 11 },
+	{ 1, 10 }
+};
+
+static int decimate = 1;
+static double velTol = 0.5;
+static double driveTol = 0.0001;
+
+// gauge 0's part of the capture for this tick, in adc counts, and the reads taken of it
+static std::vector<uint16_t> tickSets;
+static size_t tickReads = 0;
+
+
+//---------------------------------------------------------------------------------------------
+// Pot -- the adc source, gauge 0's input from the capture, the rest at rest
+//
+
+static uint16_t Pot (uint input)
+{
+	if (input != gaugeMap[0].adcInput) {
+		return REST;
+	}
+	size_t n = (tickReads < tickSets.size ()) ? tickReads : tickSets.size () - 1;
+	tickReads++;
+
+	return tickSets[n];
+}
+
+
+//---------------------------------------------------------------------------------------------
+// ToCounts -- capture sample to a 12 bit adc read
+//
+
+static uint16_t ToCounts (const capture::Channel &c, int16_t sample)
+{
+	long z = lround ((sample * c.scale + c.offset) / ADC_VREF * 4096);
+	return (z < 0) ? 0 : (z > 4095) ? 4095 : (uint16_t)z;
+}
+
+
+//---------------------------------------------------------------------------------------------
+// ReadScript
+//
+
+static bool ReadScript (const char *name, std::vector<Move> &moves)
+{
+	FILE *f = fopen (name, "r");
+	char line[128];
+
+	if (!f) {
+		perror (name);
+		return false;
+	}
+	while (fgets (line, sizeof (line), f)) {
+		char *hash = strchr (line, '#');
+		Move m;
+		int target;
+		if (hash) {
+			*hash = 0;
+		}
+		if (sscanf (line, "%lf %d", &m.seconds, &target) == 2) {
+			m.target = (target < 0) ? 0 : (target > 4095) ? 4095 : target;
+			moves.push_back (m);
+		}
+	}
+	fclose (f);
+
+	return true;
+}
+
+
+//---------------------------------------------------------------------------------------------
+// ReadGolden
+//
+
+static bool ReadGolden (const char *path, std::vector<Record> &golden)
+{
+	FILE *f = fopen (path, "r");
+	char line[256];
+
+	if (!f) {
+		perror (path);
+		return false;
+	}
+	while (fgets (line, sizeof (line), f)) {
+		Record r;
+		if (line[0] == '#') {
+			continue;
+		}
+		if (sscanf (line, "%u %d %d %f %f %d", &r.tick, &r.target, &r.position, &r.velocity, &r.drive, &r.holding) == 6) {
+			golden.push_back (r);
+		}
+	}
+	fclose (f);
+
+	return true;
+}
+
+
+//---------------------------------------------------------------------------------------------
+// Compare -- prints the first few mismatches and the largest differences, true if all match
+//
+
+static bool Compare (const std::vector<Record> &golden, const std::vector<Record> &records)
+{
+	double maxVel = 0, maxDrive = 0;
+	size_t bad = 0;
+
+	if (golden.size () != records.size ()) {
+		printf ("golden has %zu records, replay has %zu\n", golden.size (), records.size ());
+	}
+
+	size_t n = (golden.size () < records.size ()) ? golden.size () : records.size ();
+	for (size_t i = 0; i < n; i++) {
+		const Record &g = golden[i], &r = records[i];
+		double dv = fabs (r.velocity - g.velocity);
+		double dd = fabs (r.drive - g.drive);
+
+		maxVel = (dv > maxVel) ? dv : maxVel;
+		maxDrive = (dd > maxDrive) ? dd : maxDrive;
+
+		if ((g.tick != r.tick) || (g.target != r.target) || (g.position != r.position) || (dv > velTol) ||
+				(dd > driveTol) || (g.holding != r.holding)) {
+			if (bad++ < 10) {
+				printf ("tick %u: golden %d %d %8.1f %7.4f %d replay %d %d %8.1f %7.4f %d\n", r.tick,
+					g.target, g.position, g.velocity, g.drive, g.holding,
+					r.target, r.position, r.velocity, r.drive, r.holding);
+			}
+		}
+	}
+
+	printf ("%zu records compared, %zu mismatched\n", n, bad);
+	printf ("largest differences: velocity %.3f drive %.5f\n", maxVel, maxDrive);
+
+	return (bad == 0) && (golden.size () == records.size ());
+}
+
+
+//---------------------------------------------------------------------------------------------
+// main
+//
+
+int main (int argc, char *argv[])
+{
+	const char *scriptName = NULL, *capName = NULL, *writeName = NULL, *goldenName = NULL;
+	bool quiescent = true;
+	bool usage = false;
+
+	for (int i = 1; i < argc; i++) {
+		if (!strcmp (argv[i], "-d") && (i + 1 < argc)) {
+			decimate = atoi (argv[++i]);
+		} else if (!strcmp (argv[i], "-q") && (i + 1 < argc)) {
+			quiescent = atoi (argv[++i]) != 0;
+		} else if (!strcmp (argv[i], "-w") && (i + 1 < argc)) {
+			writeName = argv[++i];
+		} else if (!strcmp (argv[i], "-g") && (i + 1 < argc)) {
+			goldenName = argv[++i];
+		} else if (!strcmp (argv[i], "-v") && (i + 1 < argc)) {
+			velTol = atof (argv[++i]);
+		} else if (!strcmp (argv[i], "-u") && (i + 1 < argc)) {
+			driveTol = atof (argv[++i]);
+		} else if (!scriptName && (argv[i][0] != '-')) {
+			scriptName = argv[i];
+		} else if (!capName && (argv[i][0] != '-')) {
+			capName = argv[i];
+		} else {
+			usage = true;
+			break;
+		}
+	}
+	if (usage || !capName || (decimate < 1) || (writeName && goldenName)) {
+		fprintf (stderr, "usage: gaugereplay [-d decimate] [-q 0|1] [-w golden.txt | -g golden.txt [-v vel_tol]\n"
+			"                   [-u drive_tol]] script.txt capture.cap\n");
+		return 2;
+	}
+
+	std::vector<Move> moves;
+	if (!ReadScript (scriptName, moves)) {
+		return 2;
+	}
+
+	capture::Reader cap;
+	if (!cap.Open (capName)) {
+		fprintf (stderr, "%s: not a capture\n", capName);
+		return 2;
+	}
+	int pot = cap.Find ("Pot");
+	if (pot < 0) {
+		fprintf (stderr, "%s: needs a channel called Pot\n", capName);
+		return 2;
+	}
+	const capture::Header &info = cap.Info ();
+	uint32_t setsPerTick = (uint32_t)lround (info.sampleHz * Ts);
+	if ((setsPerTick == 0) || (fabs (setsPerTick / Ts - info.sampleHz) > 0.5)) {
+		fprintf (stderr, "%s: %u sets per second is not a whole number per %.0f ms tick\n", capName,
+			info.sampleHz, Ts * 1000);
+		return 2;
+	}
+
+	// the firmware's gauge loop, as main.cpp sets it up
+	static GaugeEngine e;
+	AdcSimSource (Pot);
+	adc_init ();
+	GaugesInit (&e);
+	e.target[1] = REST;
+	e.holdEnable = quiescent;
+
+	// replay
+	std::vector<int16_t> buf (setsPerTick * cap.Channels ());
+	std::vector<Record> records;
+	size_t next = 0;
+	uint32_t tick = 0;
+
+	tickSets.resize (setsPerTick);
+	while (cap.Read (buf.data (), setsPerTick) == setsPerTick) {
+		double t = tick * Ts;
+
+		while ((next < moves.size ()) && (moves[next].seconds <= t)) {
+			e.target[0] = moves[next++].target;
+		}
+		for (uint32_t i = 0; i < setsPerTick; i++) {
+			tickSets[i] = ToCounts (cap.Chan (pot), buf[i * cap.Channels () + pot]);
+		}
+		tickReads = 0;
+
+		GaugesSample (&e);
+		GaugesUpdate (&e);
+
+		if ((tick % decimate) == 0) {
+			records.push_back ({ tick, e.target[0], e.position[0], e.velocity[0], e.scale[0], e.holding[0] });
+		}
+		tick++;
+	}
+
+	printf ("%u ticks, %.2f s of capture at %u Hz\n", tick, tick * Ts, info.sampleHz);
+
+	// golden file
+	if (writeName) {
+		FILE *f = fopen (writeName, "w");
+		if (!f) {
+			perror (writeName);
+			return 2;
+		}
+		fprintf (f, "# gaugereplay %s %s decimate %d quiescent %d\n", scriptName, capName, decimate, quiescent);
+		fprintf (f, "# tick target position velocity drive holding\n");
+		for (const Record &r : records) {
+			fprintf (f, "%u %d %d %.2f %.5f %d\n", r.tick, r.target, r.position, r.velocity, r.drive, r.holding);
+		}
+		fclose (f);
+		printf ("%zu records written to %s\n", records.size (), writeName);
+	}
+
+	if (goldenName) {
+		std::vector<Record> golden;
+		if (!ReadGolden (goldenName, golden)) {
+			return 2;
+		}
+		bool ok = Compare (golden, records);
+		printf ("%s\n", ok ? "match" : "MISMATCH");
+		return ok ? 0 : 1;
+	}
+
+	return 0;
+}
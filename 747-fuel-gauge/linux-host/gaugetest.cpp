@@ -0,0 +1,354 @@
+//---------------------------------------------------------------------------------------------
+// notes
+//
+// gaugetest -- quiescent mode of fuel747's gauge engine, on the host
+//
+// usage:
+//    gaugetest
+//
+// steps gauges.cpp, with its estimators and pids, through entering, holding and leaving
+// the holding state. the pots are adcsim.cpp inputs that read back a set value with no
+// noise, so every tick is repeatable:
+//
+//    entry      a gauge HOLD_ENTER_BAND counts off target holds after HOLD_ENTER_TICKS
+//               ticks and not one tick sooner, one count further off never holds
+//    flags      the pid's saturation flags are cleared on entry
+//    reads      a holding gauge takes HOLD_CHECK_SAMPLES reads a tick and HOLD_SAMPLES
+//               every HOLD_DIVIDER ticks, the other gauge keeps POSITION_SAMPLES
+//    hold       pushed to HOLD_EXIT_BAND counts off target it stays holding, its
+//               position only moves on the refresh reads
+//    exit       pushed one count past HOLD_EXIT_BAND it leaves on the next tick, whatever
+//               the tick within the divider
+//    target     a target change leaves holding on the next tick with the pot on target
+//    disabled   with holdEnable false nothing holds
+//
+// it prints each check that fails and the exit status is the number of failures.
+//
+
+//---------------------------------------------------------------------------------------------
+// includes
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+
+#include "pico/stdlib.h"
+
+#include "hardware/adc.h"
+
+#include "gauges.h"
+
+
+//---------------------------------------------------------------------------------------------
+// defines
+//
+
+#define TARGET 2000
+
+#define CHECK(cond) Check ((cond), #cond, __LINE__)
+
+
+//---------------------------------------------------------------------------------------------
+// globals
+//
+
+const GaugeMap gaugeMap[MAX_GAUGES] = {
+	{ 2, 11 },
+	{ 1, 10 }
+};
+
+static int pot[4];
+static int failures = 0;
+static const char *test = "";
+
+
+//---------------------------------------------------------------------------------------------
+// Pot -- the adc source, whatever the test set each input to
+//
+
+static uint16_t Pot (uint input)
+{
+	return pot[input];
+}
+
+
+//---------------------------------------------------------------------------------------------
+// Check
+//
+
+static void Check (bool cond, const char *text, int line)
+{
+	if (!cond) {
+		printf ("%s: line %d: %s\n", test, line, text);
+		failures++;
+	}
+}
+
+
+//---------------------------------------------------------------------------------------------
+// Start -- a fresh engine with both gauges on target at rest
+//
+
+static void Start (GaugeEngine *e, const char *name)
+{
+	test = name;
+	AdcSimSource (Pot);
+	adc_init ();
+	GaugesInit (e);
+	for (int g = 0; g < NUM_GAUGES; g++) {
+		e->target[g] = TARGET;
+		e->holdTarget[g] = TARGET;
+		pot[gaugeMap[g].adcInput] = TARGET;
+	}
+}
+
+
+//---------------------------------------------------------------------------------------------
+// Tick -- one 10 ms tick as main.cpp runs it
+//
+
+static void Tick (GaugeEngine *e)
+{
+	GaugesSample (e);
+	GaugesUpdate (e);
+}
+
+
+//---------------------------------------------------------------------------------------------
+// Hold -- run gauge 0 into holding, returns the ticks it took or -1
+//
+
+static int Hold (GaugeEngine *e, int limit)
+{
+	for (int n = 1; n <= limit; n++) {
+		Tick (e);
+		if (e->holding[0]) {
+			return n;
+		}
+	}
+
+	return -1;
+}
+
+
+//---------------------------------------------------------------------------------------------
+// TestEntry
+//
+
+static void TestEntry (void)
+{
+	static GaugeEngine e;
+
+	// HOLD_ENTER_BAND off target, held only once the count is up
+	Start (&e, "entry");
+	pot[gaugeMap[0].adcInput] = TARGET + HOLD_ENTER_BAND;
+	CHECK (Hold (&e, HOLD_ENTER_TICKS - 1) == -1);
+	Tick (&e);
+	CHECK (e.holding[0]);
+	CHECK (e.scale[0] == 0);
+	CHECK (e.velocity[0] == 0);
+
+	// one count more never holds
+	Start (&e, "entry");
+	pot[gaugeMap[0].adcInput] = TARGET - HOLD_ENTER_BAND - 1;
+	CHECK (Hold (&e, 10 * HOLD_ENTER_TICKS) == -1);
+
+	// wandering out of the band starts the count again
+	Start (&e, "entry");
+	CHECK (Hold (&e, HOLD_ENTER_TICKS - 1) == -1);
+	pot[gaugeMap[0].adcInput] = TARGET + HOLD_EXIT_BAND;
+	for (int n = 0; n < 5; n++) {
+		Tick (&e);
+	}
+	pot[gaugeMap[0].adcInput] = TARGET;
+	CHECK (!e.holding[0]);
+	CHECK (Hold (&e, 10 * HOLD_ENTER_TICKS) > HOLD_ENTER_TICKS / 2);
+}
+
+
+//---------------------------------------------------------------------------------------------
+// TestFlags
+//
+
+static void TestFlags (void)
+{
+	static GaugeEngine e;
+
+	// a tiny output limit keeps the pid saturated right up to the hold
+	Start (&e, "flags");
+	e.pid[0].outMax = 0.001;
+	pot[gaugeMap[0].adcInput] = TARGET + HOLD_ENTER_BAND;
+	CHECK (Hold (&e, HOLD_ENTER_TICKS - 1) == -1);
+	CHECK (e.pid[0].saturated);
+	CHECK (e.pid[0].iSaturated);
+	Tick (&e);
+	CHECK (e.holding[0]);
+	CHECK (!e.pid[0].saturated);
+	CHECK (!e.pid[0].iHeld);
+	CHECK (!e.pid[0].iSaturated);
+}
+
+
+//---------------------------------------------------------------------------------------------
+// TestReads
+//
+
+static void TestReads (void)
+{
+	static GaugeEngine e;
+	uint in0 = gaugeMap[0].adcInput, in1 = gaugeMap[1].adcInput;
+
+	// gauge 1 kept off target so only gauge 0 holds
+	Start (&e, "reads");
+	pot[in1] = TARGET + 100;
+	CHECK (Hold (&e, 2 * HOLD_ENTER_TICKS) > 0);
+	CHECK (!e.holding[1]);
+
+	uint32_t checks = 0, refreshes = 0;
+	for (int n = 0; n < 3 * HOLD_DIVIDER; n++) {
+		AdcSimClear ();
+		Tick (&e);
+		CHECK (AdcSimReads (in1) == POSITION_SAMPLES);
+		if (AdcSimReads (in0) == HOLD_SAMPLES) {
+			refreshes++;
+		} else {
+			CHECK (AdcSimReads (in0) == HOLD_CHECK_SAMPLES);
+			checks++;
+		}
+	}
+	CHECK (refreshes == 3);
+	CHECK (checks == 3 * (HOLD_DIVIDER - 1));
+
+	// the round robin kept the two pots apart
+	CHECK (abs (e.position[1] - (TARGET + 100)) <= 1);
+	CHECK (e.position[0] == TARGET);
+}
+
+
+//---------------------------------------------------------------------------------------------
+// TestHold
+//
+
+static void TestHold (void)
+{
+	static GaugeEngine e;
+	uint in0 = gaugeMap[0].adcInput;
+
+	Start (&e, "hold");
+	CHECK (Hold (&e, 2 * HOLD_ENTER_TICKS) > 0);
+
+	// to the edge of the exit band, still holding, position only on the refresh
+	pot[in0] = TARGET + HOLD_EXIT_BAND;
+	for (int n = 0; n < 2 * HOLD_DIVIDER; n++) {
+		AdcSimClear ();
+		Tick (&e);
+		CHECK (e.holding[0]);
+		CHECK (e.scale[0] == 0);
+		if (AdcSimReads (in0) == HOLD_SAMPLES) {
+			CHECK (e.position[0] == TARGET + HOLD_EXIT_BAND);
+		}
+	}
+	CHECK (e.position[0] == TARGET + HOLD_EXIT_BAND);
+
+	// and back, between the two bands holding doesn't care
+	pot[in0] = TARGET - HOLD_EXIT_BAND;
+	for (int n = 0; n < 2 * HOLD_DIVIDER; n++) {
+		Tick (&e);
+		CHECK (e.holding[0]);
+	}
+}
+
+
+//---------------------------------------------------------------------------------------------
+// TestExit
+//
+
+static void TestExit (void)
+{
+	static GaugeEngine e;
+
+	// past the exit band at every tick of the divider, out on that tick
+	for (int phase = 0; phase < HOLD_DIVIDER; phase++) {
+		Start (&e, "exit");
+		CHECK (Hold (&e, 2 * HOLD_ENTER_TICKS) > 0);
+		for (int n = 0; n < phase; n++) {
+			Tick (&e);
+		}
+		CHECK (e.holding[0]);
+		pot[gaugeMap[0].adcInput] = TARGET - HOLD_EXIT_BAND - 1;
+		Tick (&e);
+		CHECK (!e.holding[0]);
+		CHECK (e.holdCount[0] == 0);
+		CHECK (e.position[0] == TARGET - HOLD_EXIT_BAND - 1);
+	}
+
+	// running again, the drive pushes back toward the target
+	CHECK (e.scale[0] > 0);
+}
+
+
+//---------------------------------------------------------------------------------------------
+// TestTarget
+//
+
+static void TestTarget (void)
+{
+	static GaugeEngine e;
+
+	for (int phase = 0; phase < HOLD_DIVIDER; phase++) {
+		Start (&e, "target");
+		CHECK (Hold (&e, 2 * HOLD_ENTER_TICKS) > 0);
+		for (int n = 0; n < phase; n++) {
+			Tick (&e);
+		}
+		e.target[0] = TARGET + 1;
+		Tick (&e);
+		CHECK (!e.holding[0]);
+	}
+}
+
+
+//---------------------------------------------------------------------------------------------
+// TestDisabled
+//
+
+static void TestDisabled (void)
+{
+	static GaugeEngine e;
+
+	Start (&e, "disabled");
+	e.holdEnable = false;
+	CHECK (Hold (&e, 10 * HOLD_ENTER_TICKS) == -1);
+	CHECK (!GaugesAllHolding (&e));
+}
+
+
+//---------------------------------------------------------------------------------------------
+// main
+//
+
+int main (int argc, char *argv[])
+{
+	(void) argv;
+
+	if (argc > 1) {
+		fprintf (stderr, "usage: gaugetest\n");
+		return 2;
+	}
+
+	TestEntry ();
+	TestFlags ();
+	TestReads ();
+	TestHold ();
+	TestExit ();
+	TestTarget ();
+	TestDisabled ();
+
+	printf ("%s, %d failed\n", failures ? "FAIL" : "pass", failures);
+
+	return failures;
+}
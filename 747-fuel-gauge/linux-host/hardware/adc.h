@@ -0,0 +1,27 @@
+//---------------------------------------------------------------------------------------------
+// hardware/adc.h
+//
+// host stand in for the pico sdk's adc, just the calls gauges.cpp makes. adcsim.cpp
+// steps the round robin the way the rp2040 does and gets each conversion from a source
+// the host tool sets, which is where its model of the pots goes.
+//
+
+#ifndef _HARDWARE_ADC_H_
+#define _HARDWARE_ADC_H_
+
+#include "pico/stdlib.h"
+
+void     adc_init            (void);
+void     adc_gpio_init       (uint gpio);
+void     adc_select_input    (uint input);
+void     adc_set_round_robin (uint mask);
+uint16_t adc_read            (void);
+
+// host only, the source of every conversion and the conversions taken of each input
+typedef uint16_t (*AdcSource) (uint input);
+
+void     AdcSimSource (AdcSource source);
+uint32_t AdcSimReads  (uint input);
+void     AdcSimClear  (void);
+
+#endif
@@ -0,0 +1,16 @@
+//---------------------------------------------------------------------------------------------
+// pico/stdlib.h
+//
+// host stand in for the pico sdk header, just the types the fuel747 modules use so
+// gauges.h and friends build into the host tools
+//
+
+#ifndef _PICO_STDLIB_H_
+#define _PICO_STDLIB_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef unsigned int uint;
+
+#endif
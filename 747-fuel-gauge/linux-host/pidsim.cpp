@@ -0,0 +1,402 @@
+//---------------------------------------------------------------------------------------------
+// notes
+//
+// pidsim -- fuel747's gauge loop against a model of the needle, on the host
+//
+// usage:
+//    pidsim [-p kp] [-i ki] [-d kd] [-b weight] [-t tau_ref] [-l slew] [-I iband]
+//           [-w sigma_w] [-n sigma_read] [-V vmax] [-M tau_m] [-F friction] [-q 0|1]
+//           [-s script.txt] [-o trace.txt] [-c capture.cap]
+//
+// the loop is the firmware's own, gauges.cpp's GaugesSample and GaugesUpdate every 10 ms
+// with estimator.cpp and pid.cpp under them and metrics.cpp's MetricsTick after, as
+// main.cpp runs them. the pid starts from gauges.h's KP, KI, KD, PID_B, PID_TAU_REF,
+// PID_SLEW_REF and PID_I_BAND and the estimator from EST_SIGMA_W, the options change
+// them. -q 0 turns quiescent mode off.
+//
+// the needle is a motor with a first order lag from drive to speed: full drive runs it
+// at vmax counts/s, 1000 by default, with a time constant of tau_m s, 0.05 by default.
+// friction is a fraction of full drive, 0.03 by default, that the drive has to
+// overcome before the needle moves at all and that slows it when it does. the pot reads
+// the needle with gaussian noise of sigma_read counts rms per read, ADC_SIGMA_READ by
+// default, through adcsim.cpp. these are estimates for a panel gauge, not measured, so
+// the figures compare tunings with each other rather than promise a settling time.
+//
+// the script is a list of "seconds target_counts" lines, a new target for gauge 0 at each
+// time, '#' starts a comment. the run ends 5 s after the last. without -s it is moves
+// of 1850, 200, -50, 1800, -3000, 20 and -850 counts from the needle at rest at 149,
+// 5 s apart. gauge 1 sits at rest throughout.
+//
+// it prints the metrics ring as the m command does and the worst overshoot and settling
+// time. a move can't be quicker than the needle's travel at full drive, its size over
+// vmax * (1 - friction), so each is held to that:
+//    settle       within SETTLE_MARGIN_MS of the travel time
+//    int sat time within SAT_MARGIN_MS of it, the pid holds the drive at full only as
+//                 long as the needle needs, not winding on after it
+// the exit status is 1 if a move doesn't settle, misses either, or overshoots more than
+// METRICS_SETTLE_BAND.
+//
+// -o writes seconds, target, the pid's filtered reference, the needle, the estimated
+// position and velocity, the drive and the holding flag once per tick.
+//
+// -c writes gauge 0's pot as a capture for gaugereplay, see lib/capture/capture.h. each
+// tick it has POSITION_SAMPLES reads of the needle, taken before the tick's drive as the
+// firmware's are, with their own noise, so 100 * POSITION_SAMPLES sets per second of adc
+// counts, ADC_VREF / 4096 volts per count.
+//
+
+//---------------------------------------------------------------------------------------------
+// includes
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+
+#include <random>
+#include <vector>
+
+#include "pico/stdlib.h"
+
+#include "hardware/adc.h"
+
+#include "capture/capture.h"
+#include "gauges.h"
+#include "metrics.h"
+
+
+//---------------------------------------------------------------------------------------------
+// defines
+//
+
+#define STEPS   100                     // plant steps per tick
+#define REST    149
+#define TAIL_S  5.0
+#define ADC_VREF 3.3
+
+// pass limits over the travel time at full drive
+#define SETTLE_MARGIN_MS 250
+#define SAT_MARGIN_MS    100
+
+
+//---------------------------------------------------------------------------------------------
+// typedefs
+//
+
+typedef struct {
+	double seconds;
+	int16_t target;
+} Move;
+
+typedef struct {
+	double x;                           // counts
+	double v;                           // counts/s
+} Needle;
+
+
+//---------------------------------------------------------------------------------------------
+// globals
+//
+
+const GaugeMap gaugeMap[MAX_GAUGES] = {
+	{ 2, 11 },
+	{ 1, 10 }
+};
+
+static double vmax = 1000.0;
+static double tauM = 0.05;
+static double friction = 0.03;
+static double sigmaRead = ADC_SIGMA_READ;
+
+static Needle needle[NUM_GAUGES];
+static std::mt19937 rng (1);
+static std::mt19937 capRng (2);         // the capture's reads, so -c leaves the run alone
+
+
+//---------------------------------------------------------------------------------------------
+// Pot -- the adc source, a noisy 12 bit read of the needle on input
+//
+
+static uint16_t Pot (uint input)
+{
+	std::normal_distribution<double> noise (0.0, sigmaRead);
+
+	for (int g = 0; g < NUM_GAUGES; g++) {
+		if (gaugeMap[g].adcInput == input) {
+			long z = lround (needle[g].x + noise (rng));
+			return (z < 0) ? 0 : (z > 4095) ? 4095 : z;
+		}
+	}
+
+	return 0;
+}
+
+
+//---------------------------------------------------------------------------------------------
+// Step -- move the needle dt seconds under drive u, -1 to +1
+//
+
+static void Step (Needle *n, double u, double dt)
+{
+	double net;
+
+	if (n->v == 0) {
+		if (fabs (u) <= friction) {
+			return;
+		}
+		net = u - ((u > 0) ? friction : -friction);
+	} else {
+		net = u - ((n->v > 0) ? friction : -friction);
+	}
+
+	double v = n->v + (vmax * net - n->v) * dt / tauM;
+
+	// friction stops the needle, it doesn't turn it round
+	if ((n->v != 0) && ((v > 0) != (n->v > 0)) && (fabs (u) <= friction)) {
+		v = 0;
+	}
+	n->v = v;
+	n->x += v * dt;
+
+	// end stops
+	if (n->x < 0) {
+		n->x = 0;
+		n->v = 0;
+	} else if (n->x > 4095) {
+		n->x = 4095;
+		n->v = 0;
+	}
+}
+
+
+//---------------------------------------------------------------------------------------------
+// ReadScript
+//
+
+static bool ReadScript (const char *name, std::vector<Move> &moves)
+{
+	FILE *f = fopen (name, "r");
+	char line[128];
+
+	if (!f) {
+		perror (name);
+		return false;
+	}
+	while (fgets (line, sizeof (line), f)) {
+		char *hash = strchr (line, '#');
+		Move m;
+		int target;
+		if (hash) {
+			*hash = 0;
+		}
+		if (sscanf (line, "%lf %d", &m.seconds, &target) == 2) {
+			m.target = (target < 0) ? 0 : (target > 4095) ? 4095 : target;
+			moves.push_back (m);
+		}
+	}
+	fclose (f);
+
+	return true;
+}
+
+
+//---------------------------------------------------------------------------------------------
+// main
+//
+
+int main (int argc, char *argv[])
+{
+	const char *scriptName = NULL, *traceName = NULL, *capName = NULL;
+	float kp = KP, ki = KI, kd = KD, b = PID_B, tauRef = PID_TAU_REF, slewRef = PID_SLEW_REF;
+	float iBand = PID_I_BAND, sigmaW = EST_SIGMA_W;
+	bool quiescent = true;
+	bool usage = false;
+
+	for (int i = 1; i < argc; i++) {
+		if (!strcmp (argv[i], "-p") && (i + 1 < argc)) {
+			kp = atof (argv[++i]);
+		} else if (!strcmp (argv[i], "-i") && (i + 1 < argc)) {
+			ki = atof (argv[++i]);
+		} else if (!strcmp (argv[i], "-d") && (i + 1 < argc)) {
+			kd = atof (argv[++i]);
+		} else if (!strcmp (argv[i], "-b") && (i + 1 < argc)) {
+			b = atof (argv[++i]);
+		} else if (!strcmp (argv[i], "-t") && (i + 1 < argc)) {
+			tauRef = atof (argv[++i]);
+		} else if (!strcmp (argv[i], "-l") && (i + 1 < argc)) {
+			slewRef = atof (argv[++i]);
+		} else if (!strcmp (argv[i], "-I") && (i + 1 < argc)) {
+			iBand = atof (argv[++i]);
+		} else if (!strcmp (argv[i], "-w") && (i + 1 < argc)) {
+			sigmaW = atof (argv[++i]);
+		} else if (!strcmp (argv[i], "-n") && (i + 1 < argc)) {
+			sigmaRead = atof (argv[++i]);
+		} else if (!strcmp (argv[i], "-V") && (i + 1 < argc)) {
+			vmax = atof (argv[++i]);
+		} else if (!strcmp (argv[i], "-M") && (i + 1 < argc)) {
+			tauM = atof (argv[++i]);
+		} else if (!strcmp (argv[i], "-F") && (i + 1 < argc)) {
+			friction = atof (argv[++i]);
+		} else if (!strcmp (argv[i], "-q") && (i + 1 < argc)) {
+			quiescent = atoi (argv[++i]) != 0;
+		} else if (!strcmp (argv[i], "-s") && (i + 1 < argc)) {
+			scriptName = argv[++i];
+		} else if (!strcmp (argv[i], "-o") && (i + 1 < argc)) {
+			traceName = argv[++i];
+		} else if (!strcmp (argv[i], "-c") && (i + 1 < argc)) {
+			capName = argv[++i];
+		} else {
+			usage = true;
+			break;
+		}
+	}
+	if (usage || (kp < 0) || (ki < 0) || (kd < 0) || (b < 0) || (b > 1) || (tauRef < 0) || (slewRef < 0) ||
+			(iBand < 0) || (sigmaW <= 0) || (sigmaRead < 0) || (vmax <= 0) || (tauM <= 0) || (friction < 0) ||
+			(friction >= 1)) {
+		fprintf (stderr, "usage: pidsim [-p kp] [-i ki] [-d kd] [-b weight] [-t tau_ref] [-l slew] [-I iband]\n"
+			"              [-w sigma_w] [-n sigma_read] [-V vmax] [-M tau_m] [-F friction] [-q 0|1]\n"
+			"              [-s script.txt] [-o trace.txt] [-c capture.cap]\n");
+		return 2;
+	}
+
+	std::vector<Move> moves;
+	if (scriptName) {
+		if (!ReadScript (scriptName, moves)) {
+			return 2;
+		}
+	} else {
+		const int16_t targets[] = { 1999, 2199, 2149, 3949, 949, 969, 119 };
+		for (int i = 0; i < (int)(sizeof (targets) / sizeof (targets[0])); i++) {
+			moves.push_back ({ 1.0 + 5.0 * i, targets[i] });
+		}
+	}
+	if (moves.empty ()) {
+		fprintf (stderr, "%s: no moves\n", scriptName);
+		return 2;
+	}
+
+	FILE *trace = NULL;
+	if (traceName) {
+		trace = fopen (traceName, "w");
+		if (!trace) {
+			perror (traceName);
+			return 2;
+		}
+		fprintf (trace, "# seconds target ref needle position velocity scale holding\n");
+	}
+
+	capture::Writer cap;
+	if (capName && !cap.Open (capName, (uint32_t)lround (POSITION_SAMPLES / Ts),
+			{ capture::MakeChannel ("Pot", ADC_VREF / 4096) })) {
+		perror (capName);
+		return 2;
+	}
+
+	static GaugeEngine e;
+	static Metrics m;
+
+	for (int g = 0; g < NUM_GAUGES; g++) {
+		needle[g].x = REST;
+		needle[g].v = 0;
+	}
+	AdcSimSource (Pot);
+	adc_init ();
+	GaugesInit (&e);
+	for (int g = 0; g < NUM_GAUGES; g++) {
+		e.target[g] = REST;
+		e.pid[g].kp = kp;
+		e.pid[g].ki = ki;
+		e.pid[g].kd = kd;
+		e.pid[g].b = b;
+		e.pid[g].tauRef = tauRef;
+		e.pid[g].slewRef = slewRef;
+		e.pid[g].iBand = iBand;
+		AlphaBetaTune (&e.estimator[g], sigmaW, EST_SIGMA_V * sigmaRead / ADC_SIGMA_READ);
+	}
+	e.holdEnable = quiescent;
+	MetricsInit (&m, &e);
+
+	printf ("kp %.5f ki %.5f kd %.5f b %.2f tau %.3f slew %.0f iband %.0f, estimator g %.4f h %.4f\n"
+		"needle %.0f counts/s %.3f s friction %.3f, read noise %.1f counts\n\n",
+		kp, ki, kd, b, tauRef, slewRef, iBand, e.estimator[0].g, e.estimator[0].h,
+		vmax, tauM, friction, sigmaRead);
+
+	double end = moves.back ().seconds + TAIL_S;
+	size_t next = 0;
+	int ticks = (int)(end / Ts);
+
+	for (int n = 0; n < ticks; n++) {
+		double t = n * Ts;
+
+		while ((next < moves.size ()) && (moves[next].seconds <= t)) {
+			e.target[0] = moves[next++].target;
+		}
+
+		if (capName) {
+			std::normal_distribution<double> noise (0.0, sigmaRead);
+			int16_t reads[POSITION_SAMPLES];
+			for (int k = 0; k < POSITION_SAMPLES; k++) {
+				long z = lround (needle[0].x + noise (capRng));
+				reads[k] = (z < 0) ? 0 : (z > 4095) ? 4095 : z;
+			}
+			cap.Write (reads, POSITION_SAMPLES);
+		}
+
+		GaugesSample (&e);
+		GaugesUpdate (&e);
+		MetricsTick (&m, &e);
+
+		if (trace) {
+			fprintf (trace, "%.2f %d %.1f %.1f %d %.1f %.4f %d\n", t, e.target[0], e.pid[0].ref, needle[0].x,
+				e.position[0], e.velocity[0], e.scale[0], e.holding[0]);
+		}
+
+		// the drive holds until the next tick, gated off while holding
+		for (int s = 0; s < STEPS; s++) {
+			for (int g = 0; g < NUM_GAUGES; g++) {
+				Step (&needle[g], e.holding[g] ? 0.0 : e.scale[g], Ts / STEPS);
+			}
+		}
+	}
+
+	if (trace) {
+		fclose (trace);
+	}
+	if (capName && !cap.Close ()) {
+		perror (capName);
+		return 2;
+	}
+
+	MetricsPrint (&m);
+
+	int over = 0, settle = 0, unsettled = 0, slow = 0, wound = 0;
+	double settleOver = -1e9, satOver = -1e9;
+	for (int i = 0; i < m.count; i++) {
+		const MoveRecord *r = &m.history[(m.head + METRICS_HISTORY - m.count + i) % METRICS_HISTORY];
+		double travelMs = abs (r->to - r->from) / (vmax * (1.0 - friction)) * 1000.0;
+
+		over = (r->overshoot > over) ? r->overshoot : over;
+		if (r->settleMs == METRICS_NOT_SETTLED) {
+			unsettled++;
+		} else {
+			settle = (r->settleMs > settle) ? r->settleMs : settle;
+			settleOver = (r->settleMs - travelMs > settleOver) ? r->settleMs - travelMs : settleOver;
+			slow += (r->settleMs > travelMs + SETTLE_MARGIN_MS);
+		}
+		satOver = (r->intSatMs - travelMs > satOver) ? r->intSatMs - travelMs : satOver;
+		wound += (r->intSatMs > travelMs + SAT_MARGIN_MS);
+	}
+	printf ("\nworst overshoot %d counts, worst settling %d ms, %d of %d moves not settled\n",
+		over, settle, unsettled, m.count);
+	printf ("over the travel at full drive: settling %.0f ms worst, limit %d, int sat %.0f ms worst, limit %d\n",
+		settleOver, SETTLE_MARGIN_MS, satOver, SAT_MARGIN_MS);
+
+	bool pass = (m.count == (int)moves.size ()) && (unsettled == 0) && (over <= METRICS_SETTLE_BAND) &&
+		(slow == 0) && (wound == 0);
+	printf ("%s\n", pass ? "pass" : "FAIL");
+
+	return pass ? 0 : 1;
+}
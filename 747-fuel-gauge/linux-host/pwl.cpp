@@ -0,0 +1,19 @@
+//---------------------------------------------------------------------------------------------
+// pwl.cpp
+//
+// host stand in for the firmware's pwl_interp, whose table isn't in the tree. a straight
+// line from the SCALING_ comments in main.cpp, 0 to 34.1 on the dial to 149 to 4089 adc
+// counts, which is all the host tools need of it.
+//
+
+#include "pwl.h"
+
+
+//---------------------------------------------------------------------------------------------
+// pwl_interp
+//
+
+float pwl_interp (float in)
+{
+	return 149.0f + in * (4089.0f - 149.0f) / 34.10f;
+}
@@ -0,0 +1,75 @@
+//---------------------------------------------------------------------------------------------
+// estimator.cpp
+//
+
+#include <stdbool.h>
+#include <math.h>
+
+#include "estimator.h"
+
+
+//---------------------------------------------------------------------------------------------
+// AlphaBetaInit
+//
+
+void AlphaBetaInit (AlphaBeta *ab, float Ts, float g, float h)
+{
+	ab->Ts = Ts;
+	ab->g = g;
+	ab->h = h;
+	ab->x = 0;
+	ab->v = 0;
+	ab->primed = false;
+}
+
+
+//---------------------------------------------------------------------------------------------
+// AlphaBetaTune
+//
+// set g and h from the kalata tracking index lambda = sigma_w * Ts^2 / sigma_v.
+// a small lambda (quiet pot, lazy needle) gives small gains and heavy smoothing, a large
+// lambda gives gains close to one and very little lag.
+//
+
+void AlphaBetaTune (AlphaBeta *ab, float sigmaProcess, float sigmaMeasure)
+{
+	float lambda, r;
+
+	if (sigmaMeasure <= 0) {
+		ab->g = 1.0;
+		ab->h = 1.0;
+		return;
+	}
+
+	lambda = sigmaProcess * ab->Ts * ab->Ts / sigmaMeasure;
+	r = (4 + lambda - sqrtf (8*lambda + lambda*lambda)) / 4;
+
+	ab->g = 1 - r*r;
+	ab->h = 2*(2 - ab->g) - 4*sqrtf (1 - ab->g);
+}
+
+
+//---------------------------------------------------------------------------------------------
+// AlphaBetaUpdate
+//
+
+void AlphaBetaUpdate (AlphaBeta *ab, float z)
+{
+	float r;
+
+	// snap to the first measurement instead of slewing up from zero
+	if (!ab->primed) {
+		ab->x = z;
+		ab->v = 0;
+		ab->primed = true;
+		return;
+	}
+
+	// predict
+	ab->x += ab->v * ab->Ts;
+
+	// correct
+	r = z - ab->x;
+	ab->x += ab->g * r;
+	ab->v += (ab->h / ab->Ts) * r;
+}
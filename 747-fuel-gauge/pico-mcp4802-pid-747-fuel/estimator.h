@@ -0,0 +1,40 @@
+//---------------------------------------------------------------------------------------------
+// estimator.h
+//
+// alpha-beta position / velocity estimator for the gauge feedback pot
+//
+// each tick the estimator predicts the new position from the last position and
+// velocity, then corrects both by a fraction of the measurement residual:
+//
+//    x = x + v*Ts
+//    r = z - x
+//    x = x + g*r
+//    v = v + (h/Ts)*r
+//
+// g and h (alpha and beta in most texts) can be set directly or derived from the
+// process noise (how hard the needle can accelerate, counts/s^2) and the measurement
+// noise (counts rms).
+// this is the steady state of a two state constant velocity kalman filter.
+//
+// the measurement noise is per call to AlphaBetaUpdate and assumed white, a measurement
+// that is itself an average of several reads has the noise of the average, not of a
+// read, see POSITION_SAMPLES in gauges.h.
+//
+
+#ifndef _ESTIMATOR_H_
+#define _ESTIMATOR_H_
+
+typedef struct {
+	float Ts;       // update period in seconds
+	float g;        // position correction gain (alpha)
+	float h;        // velocity correction gain (beta)
+	float x;        // position estimate, adc counts
+	float v;        // velocity estimate, adc counts / second
+	bool  primed;   // false until the first measurement has been seen
+} AlphaBeta;
+
+void  AlphaBetaInit   (AlphaBeta *ab, float Ts, float g, float h);
+void  AlphaBetaTune   (AlphaBeta *ab, float sigmaProcess, float sigmaMeasure);
+void  AlphaBetaUpdate (AlphaBeta *ab, float z);
+
+#endif
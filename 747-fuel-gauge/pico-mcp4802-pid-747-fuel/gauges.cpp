@@ -0,0 +1,241 @@
+//---------------------------------------------------------------------------------------------
+// gauges.cpp
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <math.h>
+
+#include "pico/stdlib.h"
+
+#include "hardware/adc.h"
+
+#include "pwl.h"
+#include "gauges.h"
+
+
+//---------------------------------------------------------------------------------------------
+// defines
+//
+
+// smoothing for the delta position d term, only used when D_FROM_VELOCITY is 0
+#define alpha (0.9)
+
+
+//---------------------------------------------------------------------------------------------
+// prototypes
+//
+
+static void SampleInputs (uint mask, int passes, int32_t *sum);
+
+
+//---------------------------------------------------------------------------------------------
+// GaugesInit
+//
+
+void GaugesInit (GaugeEngine *e)
+{
+	for (int g = 0; g < NUM_GAUGES; g++) {
+		e->target[g] = pwl_interp (0.0);
+		e->position[g] = 0;
+		e->velocity[g] = 0;
+		e->scale[g] = 0;
+		e->adcSum[g] = 0;
+		e->adcCount[g] = 0;
+		e->holding[g] = false;
+		e->holdCount[g] = 0;
+		e->holdTarget[g] = e->target[g];
+		e->lastPosition[g] = 0;
+		e->filterEstimate[g] = 0;
+
+		// initialize position estimator
+		AlphaBetaInit (&e->estimator[g], Ts, 1.0, 0.0);
+		AlphaBetaTune (&e->estimator[g], EST_SIGMA_W, EST_SIGMA_V);
+
+		// initialize pid
+		PidInit (&e->pid[g], Ts, KP, KI, KD);
+		e->pid[g].b = PID_B;
+		e->pid[g].tauRef = PID_TAU_REF;
+		e->pid[g].slewRef = PID_SLEW_REF;
+		e->pid[g].iBand = PID_I_BAND;
+
+		adc_gpio_init (26 + gaugeMap[g].adcInput);
+	}
+
+	e->holdEnable = true;
+	e->tick = 0;
+}
+
+
+//---------------------------------------------------------------------------------------------
+// GaugesSample
+//
+// take POSITION_SAMPLES readings of every running gauge, HOLD_SAMPLES readings of every
+// holding gauge that is due a refresh and HOLD_CHECK_SAMPLES readings of the other
+// holding gauges. holding gauges whose target just changed get the fuller read.
+//
+
+void GaugesSample (GaugeEngine *e)
+{
+	uint runMask = 0, holdMask = 0, checkMask = 0;
+	int32_t runSum[4] = { 0, 0, 0, 0 };
+	int32_t holdSum[4] = { 0, 0, 0, 0 };
+	int32_t checkSum[4] = { 0, 0, 0, 0 };
+	bool holdDue = (e->tick % HOLD_DIVIDER) == 0;
+
+	e->tick++;
+
+	for (int g = 0; g < NUM_GAUGES; g++) {
+		if (!e->holding[g]) {
+			runMask |= 1 << gaugeMap[g].adcInput;
+		} else if (holdDue || (e->target[g] != e->holdTarget[g])) {
+			holdMask |= 1 << gaugeMap[g].adcInput;
+		} else {
+			checkMask |= 1 << gaugeMap[g].adcInput;
+		}
+	}
+
+	SampleInputs (runMask, POSITION_SAMPLES, runSum);
+	SampleInputs (holdMask, HOLD_SAMPLES, holdSum);
+	SampleInputs (checkMask, HOLD_CHECK_SAMPLES, checkSum);
+
+	for (int g = 0; g < NUM_GAUGES; g++) {
+		uint input = gaugeMap[g].adcInput;
+		if (runMask & (1 << input)) {
+			e->adcSum[g] = runSum[input];
+			e->adcCount[g] = POSITION_SAMPLES;
+		} else if (holdMask & (1 << input)) {
+			e->adcSum[g] = holdSum[input];
+			e->adcCount[g] = HOLD_SAMPLES;
+		} else {
+			e->adcSum[g] = checkSum[input];
+			e->adcCount[g] = HOLD_CHECK_SAMPLES;
+		}
+	}
+}
+
+
+//---------------------------------------------------------------------------------------------
+// SampleInputs
+//
+// read every input in mask passes times with the adc in round robin mode. the adc steps
+// to the next enabled input after each conversion, starting from the lowest.
+//
+
+static void SampleInputs (uint mask, int passes, int32_t *sum)
+{
+	int i, n;
+
+	if (mask == 0) {
+		return;
+	}
+
+	for (i = 0; i < 4; i++) {
+		if (mask & (1 << i)) {
+			adc_select_input (i);
+			break;
+		}
+	}
+	adc_set_round_robin (mask);
+
+	// each pass of the round robin visits every enabled input once in ascending order
+	for (n = 0; n < passes; n++) {
+		for (i = 0; i < 4; i++) {
+			if (mask & (1 << i)) {
+				sum[i] += adc_read ();
+			}
+		}
+	}
+
+	adc_set_round_robin (0);
+}
+
+
+//---------------------------------------------------------------------------------------------
+// GaugesUpdate -- run the estimator and pid of every gauge on the last samples
+//
+
+void GaugesUpdate (GaugeEngine *e)
+{
+	for (int g = 0; g < NUM_GAUGES; g++) {
+		float z;
+
+		if (e->adcCount[g] == 0) {
+			continue;
+		}
+		z = (float)e->adcSum[g] / e->adcCount[g];
+
+		// a holding gauge wakes up on a target change or when it has been pushed off
+		// target, checked every tick, otherwise its drive stays gated off. only the
+		// fuller refresh reads move its position
+		if (e->holding[g]) {
+			if ((e->target[g] == e->holdTarget[g]) && (fabsf (e->target[g] - z) <= HOLD_EXIT_BAND)) {
+				if (e->adcCount[g] == HOLD_SAMPLES) {
+					e->position[g] = round (z);
+				}
+				e->scale[g] = 0;
+				continue;
+			}
+			e->holding[g] = false;
+			e->holdCount[g] = 0;
+			e->estimator[g].primed = false;
+			AlphaBetaUpdate (&e->estimator[g], z);
+			PidReset (&e->pid[g], z);
+			e->filterEstimate[g] = 0;
+			e->lastPosition[g] = round (z);
+		} else {
+			AlphaBetaUpdate (&e->estimator[g], z);
+		}
+		e->position[g] = round (e->estimator[g].x);
+
+		// get velocity for the D term
+#if D_FROM_VELOCITY
+		e->velocity[g] = e->estimator[g].v;
+#else
+		e->filterEstimate[g] = (alpha*e->filterEstimate[g]) + (1-alpha)*(e->position[g] - e->lastPosition[g]);
+		e->velocity[g] = e->filterEstimate[g] / Ts;
+#endif
+		e->lastPosition[g] = e->position[g];
+
+		// run two degree of freedom pid, output is saturated to +/- 1
+		e->scale[g] = PidUpdate (&e->pid[g], e->target[g], e->position[g], e->velocity[g]);
+
+		// go into holding once on target and still for long enough
+		if (e->holdEnable && 
+			(abs (e->target[g] - e->position[g]) <= HOLD_ENTER_BAND) && 
+			(fabsf (e->velocity[g]) <= HOLD_ENTER_VEL)) {
+			if (++e->holdCount[g] >= HOLD_ENTER_TICKS) {
+				e->holding[g] = true;
+				e->holdTarget[g] = e->target[g];
+				e->velocity[g] = 0;
+				e->scale[g] = 0;
+
+				// the pid doesn't run while holding, don't leave its last flags for the
+				// metrics and the cli to read
+				e->pid[g].saturated = false;
+				e->pid[g].iHeld = false;
+				e->pid[g].iSaturated = false;
+			}
+		} else {
+			e->holdCount[g] = 0;
+		}
+	}
+}
+
+
+//---------------------------------------------------------------------------------------------
+// GaugesAllHolding
+//
+
+bool GaugesAllHolding (const GaugeEngine *e)
+{
+	for (int g = 0; g < NUM_GAUGES; g++) {
+		if (!e->holding[g]) {
+			return false;
+		}
+	}
+
+	return true;
+}
@@ -0,0 +1,144 @@
+//---------------------------------------------------------------------------------------------
+// gauges.h
+//
+// multi-gauge control engine
+//
+// every gauge has its own feedback pot on an adc input, its own mcp4802 with the drive
+// signal on channel B and its own estimator and pid. the reference winding drive on
+// DAC 0 B is shared. state is held as one array per quantity, indexed by gauge.
+//
+
+#ifndef _GAUGES_H_
+#define _GAUGES_H_
+
+#include "estimator.h"
+#include "pid.h"
+
+
+//---------------------------------------------------------------------------------------------
+// defines
+//
+
+// number of gauges driven, at most one per row of gaugeMap
+#ifndef NUM_GAUGES
+#define NUM_GAUGES 1
+#endif
+#define MAX_GAUGES 2
+
+#define Ts (1.0/100.0)
+
+// gains, from a sweep on pidsim's model of the needle. kd and ki are well down on the
+// old 1/96 and 1/32, the estimator's velocity is noisier than the 512 read average was
+// and the motor needs next to no drive to hold, so a large ki only winds up on the way in
+// they are only as good as that model, vmax, tau_m and friction are estimates. large moves
+// are slew limited there, the drive sits at full for most of the move, so a faster or
+// stiffer real needle wants them swept again on its own numbers
+#define KP (1.0/  48.0) // (1.0/ 64.0)
+#define KD (1.0/2000.0) // (1.0/ 96.0)
+#define KI (1.0/ 512.0) // (1.0/ 32.0)
+
+// proportional setpoint weight and reference prefilter, see pid.h
+#define PID_B        (1.0)
+#define PID_TAU_REF  (0.08)
+#define PID_SLEW_REF (0.0)
+
+// integrate only within this many counts of the reference, see pid.h
+#define PID_I_BAND   (100.0)
+
+// number of fresh adc reads per gauge averaged into each estimator measurement. the
+// estimator gets one measurement per tick and AlphaBetaTune assumes its noise is white
+// with EST_SIGMA_V rms. the reads of one tick are 2 us apart, so the pot and adc noise
+// on them is close to independent and averaging divides it by sqrt(POSITION_SAMPLES),
+// 16 reads take the 8 counts of a single read down to 2 in 32 us of adc time per gauge.
+// one read per tick would need gains four times smaller for the same position noise,
+// with the lag that brings, 512 reads cost 1 ms per gauge and don't fit ADC_BUDGET_NS.
+// pickup that is steady over the 32 us, the 400 Hz drive, is not averaged out and is
+// not in the model. change POSITION_SAMPLES and EST_SIGMA_V follows, see estsim.
+#define POSITION_SAMPLES 16
+
+// estimator noise model, process noise in counts/s^2, adc noise in counts rms per read
+// and the measurement noise that leaves after averaging POSITION_SAMPLES reads, see
+// AlphaBetaTune
+#define EST_SIGMA_W    (20000.0)
+#define ADC_SIGMA_READ (    8.0)
+#define EST_SIGMA_V    (ADC_SIGMA_READ / sqrt (POSITION_SAMPLES))
+
+// 1 to take derivative action from the estimator velocity, 0 for filtered delta position
+#define D_FROM_VELOCITY 1
+
+// quiescent mode. a gauge that has been within HOLD_ENTER_BAND counts of its target and
+// slower than HOLD_ENTER_VEL counts/s for HOLD_ENTER_TICKS ticks goes into holding.
+// a holding gauge has its drive gated to zero and skips the estimator and pid. every
+// tick it takes HOLD_CHECK_SAMPLES reads, enough to tell a push past the exit band from
+// noise, and every HOLD_DIVIDER ticks HOLD_SAMPLES reads to refresh its position. a
+// target change or a reading more than HOLD_EXIT_BAND counts off target on any tick puts
+// it straight back to full rate.
+#define HOLD_ENTER_BAND    8
+#define HOLD_ENTER_VEL     20.0
+#define HOLD_ENTER_TICKS   50
+#define HOLD_EXIT_BAND     30
+#define HOLD_DIVIDER       10
+#define HOLD_SAMPLES       8
+#define HOLD_CHECK_SAMPLES 2
+
+static_assert (HOLD_CHECK_SAMPLES < HOLD_SAMPLES, "hold refresh reads must outnumber check reads");
+
+// timing budget. the core 1 isr writes the reference dac plus one dac per gauge at 8 MHz,
+// 2 us of shifting per 16 bit word plus chip select and scaling. keep the isr under
+// half its period so the alarm pool and core 1 stay responsive. the 100 Hz loop does
+// POSITION_SAMPLES conversions of 2 us each per gauge and should stay well under Ts.
+#define ISR_PERIOD_US    25
+#define ISR_FIXED_NS     2000
+#define ISR_GAUGE_NS     3000
+#define ISR_BUDGET_NS    (ISR_PERIOD_US * 1000 / 2)
+#define ADC_CONV_NS      2000
+#define ADC_BUDGET_NS    (1000000 / 4)
+
+#define ISR_MAX_GAUGES   ((ISR_BUDGET_NS - ISR_FIXED_NS) / ISR_GAUGE_NS - 1)
+#define ADC_MAX_GAUGES   (ADC_BUDGET_NS / (POSITION_SAMPLES * ADC_CONV_NS))
+
+static_assert (NUM_GAUGES <= MAX_GAUGES, "not enough rows in gaugeMap");
+static_assert (NUM_GAUGES <= ISR_MAX_GAUGES, "too many gauges for the 40 kHz isr");
+static_assert (NUM_GAUGES <= ADC_MAX_GAUGES, "too many gauges for the 100 Hz adc budget");
+
+
+//---------------------------------------------------------------------------------------------
+// typedefs
+//
+
+typedef struct {
+	uint adcInput;      // adc input, 0 to 3 for gpio 26 to 29
+	uint csPin;         // chip select of the mcp4802 driving this gauge on channel B
+} GaugeMap;
+
+typedef struct {
+	int16_t   target[NUM_GAUGES];           // adc counts
+	int16_t   position[NUM_GAUGES];         // adc counts
+	float     velocity[NUM_GAUGES];         // adc counts / second
+	float     scale[NUM_GAUGES];            // drive amplitude, -1 to +1
+	int32_t   adcSum[NUM_GAUGES];
+	uint8_t   adcCount[NUM_GAUGES];         // reads in adcSum, 0 until the first sample
+	int16_t   lastPosition[NUM_GAUGES];
+	float     filterEstimate[NUM_GAUGES];
+	AlphaBeta estimator[NUM_GAUGES];
+	Pid       pid[NUM_GAUGES];
+	bool      holding[NUM_GAUGES];
+	uint16_t  holdCount[NUM_GAUGES];
+	int16_t   holdTarget[NUM_GAUGES];
+	bool      holdEnable;
+	uint32_t  tick;
+} GaugeEngine;
+
+
+//---------------------------------------------------------------------------------------------
+// prototypes
+//
+
+extern const GaugeMap gaugeMap[MAX_GAUGES];
+
+void GaugesInit   (GaugeEngine *e);
+void GaugesSample (GaugeEngine *e);
+void GaugesUpdate (GaugeEngine *e);
+bool GaugesAllHolding (const GaugeEngine *e);
+
+#endif
@@ -22,7 +22,11 @@
 #include "hardware/spi.h"
 #include "hardware/adc.h"
 
+#include "dac/dac_pico.h"
+
 #include "pwl.h"
+#include "gauges.h"
+#include "metrics.h"
 
 
 //---------------------------------------------------------------------------------------------
@@ -36,15 +40,6 @@
 // #define SCALING_ADC_MIN   (  149)
 // #define SCALING_ADC_MAX   ( 4089)
 
-#define Ts (1.0/100.0)
-
-#define KP (1.0/ 48.0) // (1.0/ 64.0)
-#define KD (1.0/ 96.0) // (1.0/256.0)
-#define KI (1.0/ 32.0) // (1.0/ 64.0)
-
-#define Imax (128.0)
-#define alpha (0.9)
-
 
 //---------------------------------------------------------------------------------------------
 // typedefs
@@ -69,7 +64,6 @@ int16_t FilterPosition (int16_t in);
 
 void core1_entry (void);
 bool repeating_timer_callback_40kHz (struct repeating_timer *t);
-void dacWrite16 (uint cs_pin, uint16_t a);
 
 
 //---------------------------------------------------------------------------------------------
@@ -87,16 +81,35 @@ const uint SPI_MOSI_PIN = 15;
 
 #define SPI_IF spi1
 
+// dacs, all on spi1 with 16 bit frames
+typedef dac::PicoSpi<1> DacBus;
+typedef dac::Mcp4802 Mcp;
+typedef dac::Dac<Mcp, DacBus, SPI_CS0n_PIN> RefDac;
+
 volatile bool flag100 = false;
 
 static char cmd_buffer[CMD_MAXLEN];
 static uint8_t cmd_length = 0;
 static uint8_t cmd_state = 0;
 
+// gauge wiring, adc input and drive dac chip select per gauge
+const GaugeMap gaugeMap[MAX_GAUGES] = {
+	{ 2, SPI_CS1n_PIN },
+	{ 1, SPI_CS2n_PIN }
+};
+
+static GaugeEngine gauges;
+static Metrics metrics;
+
 static volatile uint8_t sin_phase = 0;
 static volatile uint8_t dac0B = 0;
-static volatile uint8_t dac1B = 0;
-static volatile float scale = 0.0;
+static volatile uint8_t dacB[NUM_GAUGES];
+static volatile float scale[NUM_GAUGES];
+static volatile bool hold[NUM_GAUGES];
+static volatile bool refHold = false;
+static volatile uint32_t isr_max_us = 0;
+static volatile uint32_t dacWrites = 0;
+static volatile uint32_t dacSkipped = 0;
 
 // critical section for communicating between the two cores
 critical_section_t scale_critsec;
@@ -131,23 +144,14 @@ int main ()
     struct repeating_timer timer_100Hz;
 	uint8_t ledTimer;
 
-	// pid state variables
-	float   sumError = 0;
-	int16_t lastError = 0;
-	float   deltaError = 0;
-	float	previousFilterEstimate = 0;
-
-	// pid transient variables
-	int16_t target = pwl_interp (0.0);
-	uint16_t adc_result;
-	int16_t position;
-	int16_t error;
-	float   currentFilterEstimate; 
-	float   pTerm, iTerm, dTerm;
-
 	// adc avg read command variables
 	int i, sum;
 
+	// cli argument variables
+	char  cmd = 0;
+	float arg1 = 0, arg2 = 0;
+	int   sel = 0;
+
 	// initialize stdio
     stdio_uart_init_full (uart0, 115200, 0, 1);
 	
@@ -160,9 +164,11 @@ int main ()
     gpio_init    (SPI_CS0n_PIN);
     gpio_set_dir (SPI_CS0n_PIN, GPIO_OUT);
 	gpio_put     (SPI_CS0n_PIN, 1);
-    gpio_init    (SPI_CS1n_PIN);
-    gpio_set_dir (SPI_CS1n_PIN, GPIO_OUT);
-	gpio_put     (SPI_CS1n_PIN, 1);
+	for (int g = 0; g < NUM_GAUGES; g++) {
+		gpio_init    (gaugeMap[g].csPin);
+		gpio_set_dir (gaugeMap[g].csPin, GPIO_OUT);
+		gpio_put     (gaugeMap[g].csPin, 1);
+	}
     spi_init (SPI_IF, 8000000);
     spi_set_format (SPI_IF, 16, SPI_CPOL_0, SPI_CPHA_0, SPI_MSB_FIRST);
     gpio_set_function (SPI_MISO_PIN, GPIO_FUNC_SPI);
@@ -170,17 +176,22 @@ int main ()
     gpio_set_function (SPI_MOSI_PIN, GPIO_FUNC_SPI);
 
 	// initialize dac
-	dacWrite16 (SPI_CS0n_PIN, 0x3800); // write 0x800 to DAC 0 A
-	dacWrite16 (SPI_CS0n_PIN, 0xB000); // write 0x000 to DAC 0 B
-	dacWrite16 (SPI_CS1n_PIN, 0x3800); // write 0x800 to DAC 1 A
-	dacWrite16 (SPI_CS1n_PIN, 0xB000); // write 0x000 to DAC 1 B
+	RefDac::Write (Mcp::Word (Mcp::A, 0x80)); // write 0x800 to DAC 0 A
+	RefDac::Write (Mcp::Word (Mcp::B, 0x00)); // write 0x000 to DAC 0 B
+	for (int g = 0; g < NUM_GAUGES; g++) {
+		dac::Write<DacBus> (gaugeMap[g].csPin, Mcp::Word (Mcp::A, 0x80)); // write 0x800 to DAC g+1 A
+		dac::Write<DacBus> (gaugeMap[g].csPin, Mcp::Word (Mcp::B, 0x00)); // write 0x000 to DAC g+1 B
+		dacB[g] = 0;
+		scale[g] = 0;
+		hold[g] = false;
+	}
 	dac0B = 0;
-	dac1B = 0;
 
-	// initialize adc
+	// initialize adc and gauge engine
 	adc_init ();
-	adc_gpio_init (28);
-	adc_select_input (2);
+	GaugesInit (&gauges);
+	MetricsInit (&metrics, &gauges);
+	adc_select_input (gaugeMap[0].adcInput);
 
 	// hello world
 	printf ("Hello, world!\n");
@@ -210,6 +221,7 @@ int main ()
         // once a line of input is received, process it
         if (cmd_state == 2) {
             int index = 0;
+            cmd = 0;
             char *buffptr = strtok (cmd_buffer, ",");
             while (buffptr != NULL) {
 
@@ -218,26 +230,105 @@ int main ()
                     case 0:
 						if (!strcmp (buffptr, "a")) {
 							sum = 0;
+							adc_select_input (gaugeMap[sel].adcInput);
 							for (i = 0; i < 1024; i++) {
 								sum += adc_read ();
 							}
 							sum = round (sum / 1024.0);
-							printf ("avg: %d\n", sum);
-							printf ("scale: %6.3f p: %6.3f, i: %6.3f, d: %6.3f\n", scale, pTerm, iTerm, dTerm);
+							printf ("gauge: %d avg: %d holding: %d\n", sel, sum, gauges.holding[sel]);
+							printf ("scale: %6.3f p: %6.3f, i: %6.3f, d: %6.3f\n", scale[sel], 
+								gauges.pid[sel].pTerm, gauges.pid[sel].iTerm, gauges.pid[sel].dTerm);
+							printf ("ref: %8.2f b: %4.2f tau: %5.3f slew: %6.1f iband: %6.1f\n", 
+								gauges.pid[sel].ref, gauges.pid[sel].b, gauges.pid[sel].tauRef, 
+								gauges.pid[sel].slewRef, gauges.pid[sel].iBand);
 							break;
 						}
-						target = pwl_interp (atof (buffptr));
-						target = (target > 4095) ? 4095 : target;
-						target = (target <    0) ?    0 : target;
-						printf ("target = %d\n", target);
+						if (!strcmp (buffptr, "e")) {
+							printf ("x: %8.2f v: %8.2f g: %6.4f h: %6.4f\n", 
+								gauges.estimator[sel].x, gauges.estimator[sel].v, 
+								gauges.estimator[sel].g, gauges.estimator[sel].h);
+							break;
+						}
+						if (!strcmp (buffptr, "m")) {
+							MetricsPrint (&metrics);
+							break;
+						}
+						if (!strcmp (buffptr, "t")) {
+							printf ("gauges: %d isr max: %lu us budget: %d us max gauges: %d isr, %d adc\n", 
+								NUM_GAUGES, isr_max_us, ISR_BUDGET_NS / 1000, ISR_MAX_GAUGES, ADC_MAX_GAUGES);
+							printf ("dac writes: %lu skipped: %lu\n", dacWrites, dacSkipped);
+							isr_max_us = 0;
+							break;
+						}
+						if (!strcmp (buffptr, "n") || !strcmp (buffptr, "gh") ||
+							!strcmp (buffptr, "b") || !strcmp (buffptr, "pf") || !strcmp (buffptr, "ib") ||
+							!strcmp (buffptr, "s") || !strcmp (buffptr, "q")) {
+							cmd = buffptr[0];
+							break;
+						}
+						gauges.target[sel] = pwl_interp (atof (buffptr));
+						gauges.target[sel] = (gauges.target[sel] > 4095) ? 4095 : gauges.target[sel];
+						gauges.target[sel] = (gauges.target[sel] <    0) ?    0 : gauges.target[sel];
+						printf ("target %d = %d\n", sel, gauges.target[sel]);
                         break;
 
                     case 1:
-                        printf ("nothing happens.\n");
+						if (cmd == 0) {
+							printf ("nothing happens.\n");
+						}
+						arg1 = atof (buffptr);
+                        break;
+
+                    case 2:
+						arg2 = atof (buffptr);
                         break;
                 }
                 buffptr = strtok (NULL, ",");
             }
+
+			// q,<0|1> disables or enables quiescent mode on all gauges
+			if ((cmd == 'q') && (index == 2)) {
+				gauges.holdEnable = (arg1 != 0);
+				printf ("quiescent: %d\n", gauges.holdEnable);
+			}
+
+			// s,<gauge> selects the gauge the other commands apply to
+			if ((cmd == 's') && (index == 2)) {
+				if ((arg1 >= 0) && (arg1 < NUM_GAUGES)) {
+					sel = arg1;
+				}
+				printf ("gauge: %d\n", sel);
+			}
+
+			AlphaBeta *estimator = &gauges.estimator[sel];
+			Pid *pid = &gauges.pid[sel];
+
+			// n,<sigma_w>,<sigma_v> retunes the estimator from its noise model
+			// gh,<g>,<h> sets the estimator gains directly
+			if (((cmd == 'n') || (cmd == 'g')) && (index == 3)) {
+				if (cmd == 'n') {
+					AlphaBetaTune (estimator, arg1, arg2);
+				} else {
+					estimator->g = arg1;
+					estimator->h = arg2;
+				}
+				printf ("g: %6.4f h: %6.4f\n", estimator->g, estimator->h);
+			}
+
+			// b,<weight> sets the proportional setpoint weight
+			// ib,<counts> sets the integration band
+			// pf,<tau>,<slew> sets the reference prefilter time constant and slew limit
+			if ((cmd == 'b') && (index == 2)) {
+				pid->b = arg1;
+				printf ("b: %4.2f\n", pid->b);
+			} else if ((cmd == 'i') && (index == 2)) {
+				pid->iBand = arg1;
+				printf ("iband: %6.1f\n", pid->iBand);
+			} else if ((cmd == 'p') && (index == 3)) {
+				pid->tauRef = arg1;
+				pid->slewRef = arg2;
+				printf ("tau: %5.3f slew: %6.1f\n", pid->tauRef, pid->slewRef);
+			}
 			cmd_state = 0;
         }
 
@@ -272,45 +363,18 @@ int main ()
 			// adc_result = adc_read ();
 			// position = adc_result;
 
-			// get lots of adc readings
-			sum = 0;
-			for (i = 0; i < 512; i++) {
-				sum += adc_read ();
-			}
-			position = round (sum / 512.0);
-
-			// filter position
-			// position = FilterPosition (position);
-
-			// calculate error
-			error = target - position;
-
-			// calculate P term
-			pTerm = KP * error;
-
-			// calculate I term
-			sumError += error * Ts;
-			if (sumError > Imax*Ts) sumError = Imax*Ts;
-			if (sumError <= -Imax*Ts) sumError = -Imax*Ts;
-			iTerm = KI * sumError;
-
-			// calculate D term
-			deltaError = error - lastError;
-			lastError = error;
-			currentFilterEstimate = (alpha*previousFilterEstimate) + (1-alpha)*deltaError;
-			previousFilterEstimate = currentFilterEstimate;
-			dTerm = KD * currentFilterEstimate / Ts;
-
-			// add terms together
-			float newScale = pTerm + iTerm + dTerm;
-
-			// saturate result
-			if (newScale > 1.0) newScale = 1.0;
-			if (newScale < -1.0) newScale = -1.0;
+			// get a few fresh adc readings of every gauge then run estimators and pids
+			GaugesSample (&gauges);
+			GaugesUpdate (&gauges);
+			MetricsTick (&metrics, &gauges);
 
 			// update speed and direction for core 1 ISR
 			critical_section_enter_blocking (&scale_critsec);
-			scale = newScale;
+			for (int g = 0; g < NUM_GAUGES; g++) {
+				scale[g] = gauges.scale[g];
+				hold[g] = gauges.holding[g];
+			}
+			refHold = GaugesAllHolding (&gauges);
 			critical_section_exit (&scale_critsec);
         }
 	}
@@ -465,7 +529,7 @@ void core1_entry (void)
 
 	// run 40 kHz timer interrupt on core 1
     alarm_pool_add_repeating_timer_us (core1_alarm_pool, 
-		-25, repeating_timer_callback_40kHz, NULL, &timer_40kHz);
+		-ISR_PERIOD_US, repeating_timer_callback_40kHz, NULL, &timer_40kHz);
 
 	// nothing else to do on core 1
 	while (1) {
@@ -476,43 +540,48 @@ void core1_entry (void)
 
 bool repeating_timer_callback_40kHz (struct repeating_timer *t)
 {
-	uint16_t a;
-
-	a = 0xB000 | ((uint16_t)dac0B << 4);
-	gpio_put (SPI_CS0n_PIN, 0);
-	spi_write16_blocking (SPI_IF, &a, 1);
-	gpio_put (SPI_CS0n_PIN, 1);
+	uint32_t start = time_us_32 ();
+	uint32_t writes = 0;
+
+	// shadows of what the B channels hold, all were set to 0 at start up. a channel is
+	// only written when its value changes, which also covers dacs parked at mid scale
+	// by quiescent mode and the flat tops of small amplitude sines
+	static uint8_t lastRef = 0;
+	static uint8_t lastB[NUM_GAUGES];
+
+	if (dac0B != lastRef) {
+		RefDac::Write (Mcp::Word (Mcp::B, dac0B));
+		lastRef = dac0B;
+		writes++;
+	}
 
-	a = 0xB000 | ((uint16_t)dac1B << 4);
-	gpio_put (SPI_CS1n_PIN, 0);
-	spi_write16_blocking (SPI_IF, &a, 1);
-	gpio_put (SPI_CS1n_PIN, 1);
+	for (int g = 0; g < NUM_GAUGES; g++) {
+		if (dacB[g] != lastB[g]) {
+			dac::Write<DacBus> (gaugeMap[g].csPin, Mcp::Word (Mcp::B, dacB[g]));
+			lastB[g] = dacB[g];
+			writes++;
+		}
+	}
+	dacWrites += writes;
+	dacSkipped += 1 + NUM_GAUGES - writes;
 
 	if (++sin_phase >= 100) {
 		sin_phase = 0;
 	}
 
 	critical_section_enter_blocking (&scale_critsec);
-	dac0B = 128+sine[sin_phase];
-	dac1B = 128+scale*sine[sin_phase];
+	dac0B = refHold ? 128 : 128+sine[sin_phase];
+	for (int g = 0; g < NUM_GAUGES; g++) {
+		dacB[g] = hold[g] ? 128 : 128+scale[g]*sine[sin_phase];
+	}
 	critical_section_exit (&scale_critsec);
 
+	// track worst case isr time for the timing budget check
+	uint32_t elapsed = time_us_32 () - start;
+	if (elapsed > isr_max_us) {
+		isr_max_us = elapsed;
+	}
+
 	return true;
 }
 
-
-void dacWrite16 (uint cs_pin, uint16_t a)
-{
-	// CS low
-    asm volatile ("nop \n nop \n nop");
-	gpio_put (cs_pin, 0);
-    asm volatile ("nop \n nop \n nop");
-
-	// transfer data
-	spi_write16_blocking (SPI_IF, &a, 1);
-
-	// CS high
-    asm volatile ("nop \n nop \n nop");
-	gpio_put (cs_pin, 1);
-    asm volatile ("nop \n nop \n nop");
-}
@@ -0,0 +1,159 @@
+//---------------------------------------------------------------------------------------------
+// metrics.cpp
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "pico/stdlib.h"
+
+#include "metrics.h"
+
+
+//---------------------------------------------------------------------------------------------
+// prototypes
+//
+
+static void MetricsClose (Metrics *m, int g);
+
+
+//---------------------------------------------------------------------------------------------
+// MetricsInit
+//
+
+void MetricsInit (Metrics *m, const GaugeEngine *e)
+{
+	for (int g = 0; g < NUM_GAUGES; g++) {
+		m->active[g] = false;
+		m->target[g] = e->target[g];
+	}
+	m->head = 0;
+	m->count = 0;
+	m->tickCount = 0;
+}
+
+
+//---------------------------------------------------------------------------------------------
+// MetricsTick -- call once per control tick after GaugesUpdate
+//
+
+void MetricsTick (Metrics *m, const GaugeEngine *e)
+{
+	m->tickCount++;
+
+	for (int g = 0; g < NUM_GAUGES; g++) {
+		MoveRecord *r = &m->move[g];
+		int16_t error;
+
+		// a target change closes the current move and starts a new one
+		if (e->target[g] != m->target[g]) {
+			if (m->active[g]) {
+				MetricsClose (m, g);
+			}
+			m->target[g] = e->target[g];
+			m->active[g] = true;
+			m->ticks[g] = 0;
+			m->lastOutTick[g] = 0;
+			m->ssTicks[g] = 0;
+			m->ssSum[g] = 0;
+			m->intSatTicks[g] = 0;
+			m->outSatTicks[g] = 0;
+			r->startMs = m->tickCount * (uint32_t)(Ts * 1000);
+			r->gauge = g;
+			r->from = e->position[g];
+			r->to = e->target[g];
+			r->overshoot = 0;
+			r->settleMs = METRICS_NOT_SETTLED;
+			r->ssError = 0;
+		}
+
+		if (!m->active[g]) {
+			continue;
+		}
+
+		m->ticks[g]++;
+		error = e->target[g] - e->position[g];
+
+		// overshoot is error past the target in the direction of travel
+		int16_t past = (r->to >= r->from) ? -error : error;
+		if (past > r->overshoot) {
+			r->overshoot = past;
+		}
+
+		// saturation time
+		if (e->pid[g].iSaturated) {
+			m->intSatTicks[g]++;
+		}
+		if (e->pid[g].saturated) {
+			m->outSatTicks[g]++;
+		}
+
+		// settling, then steady state error once settled
+		if (abs (error) > METRICS_SETTLE_BAND) {
+			m->lastOutTick[g] = m->ticks[g];
+			r->settleMs = METRICS_NOT_SETTLED;
+			m->ssTicks[g] = 0;
+			m->ssSum[g] = 0;
+		} else if (m->ticks[g] - m->lastOutTick[g] >= METRICS_SETTLE_TICKS) {
+			if (r->settleMs == METRICS_NOT_SETTLED) {
+				r->settleMs = (m->lastOutTick[g] + 1) * (uint16_t)(Ts * 1000);
+			}
+			m->ssSum[g] += error;
+			if (++m->ssTicks[g] >= METRICS_SS_TICKS) {
+				MetricsClose (m, g);
+				continue;
+			}
+		}
+
+		if (m->ticks[g] >= METRICS_TIMEOUT_TICKS) {
+			MetricsClose (m, g);
+		}
+	}
+}
+
+
+//---------------------------------------------------------------------------------------------
+// MetricsClose -- finish the tracked move of gauge g and add it to the history ring
+//
+
+static void MetricsClose (Metrics *m, int g)
+{
+	MoveRecord *r = &m->move[g];
+
+	if (m->ssTicks[g] > 0) {
+		r->ssError = m->ssSum[g] / m->ssTicks[g];
+	}
+	r->intSatMs = m->intSatTicks[g] * (uint16_t)(Ts * 1000);
+	r->outSatPct = (m->ticks[g] > 0) ? (100 * m->outSatTicks[g] / m->ticks[g]) : 0;
+
+	m->history[m->head] = *r;
+	m->head = (m->head + 1) % METRICS_HISTORY;
+	if (m->count < METRICS_HISTORY) {
+		m->count++;
+	}
+	m->active[g] = false;
+}
+
+
+//---------------------------------------------------------------------------------------------
+// MetricsPrint -- print the history ring, oldest first
+//
+
+void MetricsPrint (const Metrics *m)
+{
+	printf ("   time g  from    to  over settle ss  isat osat\n");
+	for (int i = 0; i < m->count; i++) {
+		const MoveRecord *r = &m->history[(m->head + METRICS_HISTORY - m->count + i) % METRICS_HISTORY];
+		if (r->settleMs == METRICS_NOT_SETTLED) {
+			printf ("%7lu %d %5d %5d %5d   ---- %3d %5u %3u%%\n", 
+				(unsigned long)r->startMs, r->gauge, r->from, r->to, r->overshoot, 
+				r->ssError, r->intSatMs, r->outSatPct);
+		} else {
+			printf ("%7lu %d %5d %5d %5d %6u %3d %5u %3u%%\n", 
+				(unsigned long)r->startMs, r->gauge, r->from, r->to, r->overshoot, 
+				r->settleMs, r->ssError, r->intSatMs, r->outSatPct);
+		}
+	}
+}
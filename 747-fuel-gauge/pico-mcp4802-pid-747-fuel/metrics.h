@@ -0,0 +1,83 @@
+//---------------------------------------------------------------------------------------------
+// metrics.h
+//
+// control quality metrics, one record per target change
+//
+// after a gauge's target changes its response is tracked until it settles or times out:
+//
+//    overshoot      counts past the target in the direction of travel
+//    settling time  time until the position stays within METRICS_SETTLE_BAND of the
+//                   target for METRICS_SETTLE_TICKS ticks
+//    ss error       mean error over METRICS_SS_TICKS ticks once settled
+//    int sat time   time the pid held its integrator against a saturated output, see
+//                   Pid.iSaturated. holds for iBand don't count
+//    out sat ratio  percent of ticks with the output clipped
+//
+// finished records go into a fixed size ring holding the last METRICS_HISTORY moves of
+// all gauges. nothing is allocated.
+//
+
+#ifndef _METRICS_H_
+#define _METRICS_H_
+
+#include "gauges.h"
+
+
+//---------------------------------------------------------------------------------------------
+// defines
+//
+
+#define METRICS_HISTORY       16
+#define METRICS_SETTLE_BAND   20       // adc counts
+#define METRICS_SETTLE_TICKS  20       // 200 ms
+#define METRICS_SS_TICKS      50       // 500 ms
+#define METRICS_TIMEOUT_TICKS 1000     // 10 s
+
+#define METRICS_NOT_SETTLED   0xFFFF
+
+
+//---------------------------------------------------------------------------------------------
+// typedefs
+//
+
+typedef struct {
+	uint32_t startMs;       // time of the target change
+	uint8_t  gauge;
+	int16_t  from;          // position when the target changed, adc counts
+	int16_t  to;            // new target, adc counts
+	int16_t  overshoot;     // adc counts
+	uint16_t settleMs;      // METRICS_NOT_SETTLED if it never settled
+	int16_t  ssError;       // adc counts
+	uint16_t intSatMs;
+	uint8_t  outSatPct;
+} MoveRecord;
+
+typedef struct {
+	// move being tracked, one array per quantity indexed by gauge
+	bool     active[NUM_GAUGES];
+	int16_t  target[NUM_GAUGES];
+	uint16_t ticks[NUM_GAUGES];
+	uint16_t lastOutTick[NUM_GAUGES];
+	uint16_t ssTicks[NUM_GAUGES];
+	int32_t  ssSum[NUM_GAUGES];
+	uint16_t intSatTicks[NUM_GAUGES];
+	uint16_t outSatTicks[NUM_GAUGES];
+	MoveRecord move[NUM_GAUGES];
+
+	// ring of finished moves
+	MoveRecord history[METRICS_HISTORY];
+	uint8_t  head;
+	uint8_t  count;
+	uint32_t tickCount;
+} Metrics;
+
+
+//---------------------------------------------------------------------------------------------
+// prototypes
+//
+
+void MetricsInit  (Metrics *m, const GaugeEngine *e);
+void MetricsTick  (Metrics *m, const GaugeEngine *e);
+void MetricsPrint (const Metrics *m);
+
+#endif
@@ -0,0 +1,117 @@
+//---------------------------------------------------------------------------------------------
+// pid.cpp
+//
+
+#include <stdbool.h>
+#include <math.h>
+
+#include "pid.h"
+
+
+//---------------------------------------------------------------------------------------------
+// PidInit
+//
+
+void PidInit (Pid *pid, float Ts, float kp, float ki, float kd)
+{
+	pid->Ts = Ts;
+	pid->kp = kp;
+	pid->ki = ki;
+	pid->kd = kd;
+	pid->b = 1.0;
+	pid->tauRef = 0;
+	pid->slewRef = 0;
+	pid->outMax = 1.0;
+	pid->iBand = 0;
+
+	PidReset (pid, 0);
+	pid->primed = false;
+}
+
+
+//---------------------------------------------------------------------------------------------
+// PidReset -- start the reference at the current position with no stored integral
+//
+
+void PidReset (Pid *pid, float y)
+{
+	pid->ref = y;
+	pid->sumError = 0;
+	pid->primed = true;
+	pid->pTerm = 0;
+	pid->iTerm = 0;
+	pid->dTerm = 0;
+	pid->saturated = false;
+	pid->iHeld = false;
+	pid->iSaturated = false;
+}
+
+
+//---------------------------------------------------------------------------------------------
+// PidUpdate
+//
+// target and y are in adc counts, dydt is the measured velocity in counts / second.
+// returns the new output.
+//
+
+float PidUpdate (Pid *pid, float target, float y, float dydt)
+{
+	float step, error, sumError, out;
+
+	if (!pid->primed) {
+		PidReset (pid, y);
+	}
+
+	// reference prefilter
+	if (pid->tauRef > 0) {
+		step = (target - pid->ref) * pid->Ts / (pid->tauRef + pid->Ts);
+	} else {
+		step = target - pid->ref;
+	}
+	if (pid->slewRef > 0) {
+		float maxStep = pid->slewRef * pid->Ts;
+		if (step >  maxStep) step =  maxStep;
+		if (step < -maxStep) step = -maxStep;
+	}
+	pid->ref += step;
+
+	// calculate error
+	error = pid->ref - y;
+
+	// calculate P term with setpoint weighting
+	pid->pTerm = pid->kp * (pid->b * pid->ref - y);
+
+	// calculate D term on measurement
+	pid->dTerm = -pid->kd * dydt;
+
+	// calculate I term -- conditional integration, only accept the new integral when
+	// close to the reference and if the output isn't saturated or the error would pull
+	// it back out of saturation
+	sumError = pid->sumError + error * pid->Ts;
+	out = pid->pTerm + pid->ki * sumError + pid->dTerm;
+	pid->iSaturated = false;
+	if (((out > pid->outMax) && (error > 0)) || ((out < -pid->outMax) && (error < 0))) {
+		sumError = pid->sumError;
+		pid->iSaturated = true;
+	}
+	if ((pid->iBand > 0) && (fabsf (error) > pid->iBand)) {
+		sumError = pid->sumError;
+	}
+	pid->iHeld = (sumError == pid->sumError) && (error != 0);
+	pid->sumError = sumError;
+	pid->iTerm = pid->ki * sumError;
+
+	// add terms together and saturate result
+	out = pid->pTerm + pid->iTerm + pid->dTerm;
+	pid->saturated = false;
+	if (out > pid->outMax) {
+		out = pid->outMax;
+		pid->saturated = true;
+	}
+	if (out < -pid->outMax) {
+		out = -pid->outMax;
+		pid->saturated = true;
+	}
+
+	return out;
+}
@@ -0,0 +1,50 @@
+//---------------------------------------------------------------------------------------------
+// pid.h
+//
+// two degree of freedom pid controller for the gauge motor
+//
+// the target is first passed through a reference prefilter (first order lag plus an
+// optional slew limit) so a new target doesn't arrive as a full step. the terms are then
+//
+//    P = kp * (b*ref - y)        setpoint weighting, b = 1 is a plain pid
+//    I = ki * integral (ref - y) integrated only near ref and out of saturation
+//    D = -kd * dy/dt             derivative on measurement, no kick on target change
+//
+// the adc counts are absolute, so b below 1 leaves kp*(1-b)*ref at rest for the
+// integrator to cancel. on pidsim's model of the needle b = 1 with the prefilter settles
+// fastest without overshoot, anything less either overshoots while the integrator
+// catches up or never settles, so gauges.h leaves it at 1.
+//
+// the output is limited to +/- outMax.
+//
+
+#ifndef _PID_H_
+#define _PID_H_
+
+typedef struct {
+	// parameters
+	float Ts;         // update period in seconds
+	float kp, ki, kd; // gains
+	float b;          // proportional setpoint weight, 0 to 1
+	float tauRef;     // reference prefilter time constant in seconds, 0 for none
+	float slewRef;    // reference slew limit in counts / second, 0 for none
+	float outMax;     // output limit
+	float iBand;      // only integrate within this many counts of ref, 0 for always
+
+	// state
+	float ref;        // prefiltered target
+	float sumError;   // integral of error, counts * seconds
+	bool  primed;     // false until the first update
+
+	// last terms, for the cli
+	float pTerm, iTerm, dTerm;
+	bool  saturated;  // output was clipped to outMax
+	bool  iHeld;      // integration was inhibited this update, for any reason
+	bool  iSaturated; // integration was inhibited by the output saturating
+} Pid;
+
+void  PidInit   (Pid *pid, float Ts, float kp, float ki, float kd);
+void  PidReset  (Pid *pid, float y);
+float PidUpdate (Pid *pid, float target, float y, float dydt);
+
+#endif
@@ -22,6 +22,10 @@
 #include "hardware/spi.h"
 #include "hardware/adc.h"
 
+#include "dac/dac_pico.h"
+
+#include "synchro.h"
+
 
 //---------------------------------------------------------------------------------------------
 // defines
@@ -29,6 +33,9 @@
 
 #define CMD_MAXLEN 72
 
+// new scales are ramped to over the 5 ms between the 200 Hz timer's updates, see synchro.h
+#define SCALE_RAMP_SAMPLES 200
+
 
 //---------------------------------------------------------------------------------------------
 // typedefs
@@ -51,7 +58,6 @@ void GetCommand (void);
 
 void core1_entry (void);
 bool repeating_timer_callback_40kHz (struct repeating_timer *t);
-void dacWrite16 (spi_inst_t *spi, uint cs_pin, uint16_t a);
 
 
 //---------------------------------------------------------------------------------------------
@@ -71,42 +77,33 @@ const uint SPI1_CS0n_PIN = 13;
 const uint SPI1_SCK_PIN  = 14;
 const uint SPI1_MOSI_PIN = 15;
 
+// dacs 0 and 1 on spi0, dac 2 on spi1, 16 bit frames
+typedef dac::Mcp4802 Mcp;
+typedef dac::Dac<Mcp, dac::PicoSpi<0>, SPI0_CS0n_PIN> Dac0;
+typedef dac::Dac<Mcp, dac::PicoSpi<0>, SPI0_CS1n_PIN> Dac1;
+typedef dac::Dac<Mcp, dac::PicoSpi<1>, SPI1_CS0n_PIN> Dac2;
+
 volatile bool flag100 = false;
 
 static char cmd_buffer[CMD_MAXLEN];
 static uint8_t cmd_length = 0;
 static uint8_t cmd_state = 0;
 
-static volatile uint8_t sin_phase = 0;
-static volatile uint8_t dac0B = 0; 		// SPI 0, CS 0
-static volatile uint8_t dac1B = 0; 		// SPI 0, CS 1
-static volatile uint8_t dac2B = 0; 		// SPI 1, CS 0
+// sine phase and B channel levels of dac 0 (SPI 0, CS 0), dac 1 (SPI 0, CS 1) and
+// dac 2 (SPI 1, CS 0), all B channels are 0 at start up
+static SynchroDrive drive;
+
 static volatile float scaleDac0 = 0.0;
 static volatile float scaleDac1 = 0.0;
 static volatile float scaleDac2 = -1.0;
+static volatile uint32_t scaleCount = 1;     // bumped with each new set of scales
+static uint32_t scaleSeen = 0;               // the last set the interrupt ramped to
+static volatile uint32_t dacWrites = 0;
+static volatile uint32_t dacSkipped = 0;
 
 // critical section for communicating between the two cores
 critical_section_t scale_critsec;
 
-// sine lookup table
-// a=sin((0:99)*2*pi/100);
-// b=round(a*127);
-// min(b) ans = -127
-// max(b) ans =  127
-// b(1)   ans =  0
-static const int8_t sine[100] = {
-     0,    8,   16,   24,   32,   39,   47,   54,   61,   68,   
-    75,   81,   87,   93,   98,  103,  107,  111,  115,  118,  
-   121,  123,  125,  126,  127,  127,  127,  126,  125,  123,  
-   121,  118,  115,  111,  107,  103,   98,   93,   87,   81,   
-    75,   68,   61,   54,   47,   39,   32,   24,   16,    8,    
-     0,   -8,  -16,  -24,  -32,  -39,  -47,  -54,  -61,  -68,  
-   -75,  -81,  -87,  -93,  -98, -103, -107, -111, -115, -118, 
-  -121, -123, -125, -126, -127, -127, -127, -126, -125, -123, 
-  -121, -118, -115, -111, -107, -103,  -98,  -93,  -87,  -81,  
-   -75,  -68,  -61,  -54,  -47,  -39,  -32,  -24,  -16,   -8
-};
-
 /*
 static const int8_t sine[100] = {
    127,  127,  127,  127,  127,  127,  127,  127,  127,  127,   
@@ -165,17 +162,14 @@ int main ()
     gpio_set_function (SPI1_MOSI_PIN, GPIO_FUNC_SPI);
 
 	// initialize dacs on spi 0
-	dacWrite16 (spi0, SPI0_CS0n_PIN, 0x3800); // write 0x800 to DAC 0 A
-	dacWrite16 (spi0, SPI0_CS0n_PIN, 0xB000); // write 0x000 to DAC 0 B
-	dacWrite16 (spi0, SPI0_CS1n_PIN, 0x3800); // write 0x800 to DAC 1 A
-	dacWrite16 (spi0, SPI0_CS1n_PIN, 0xB000); // write 0x000 to DAC 1 B
-	dac0B = 0;
-	dac1B = 0;
+	Dac0::Write (Mcp::Word (Mcp::A, 0x80)); // write 0x800 to DAC 0 A
+	Dac0::Write (Mcp::Word (Mcp::B, 0x00)); // write 0x000 to DAC 0 B
+	Dac1::Write (Mcp::Word (Mcp::A, 0x80)); // write 0x800 to DAC 1 A
+	Dac1::Write (Mcp::Word (Mcp::B, 0x00)); // write 0x000 to DAC 1 B
 
 	// initialize dacs on spi 1
-	dacWrite16 (spi1, SPI1_CS0n_PIN, 0x3800); // write 0x800 to DAC 2 A
-	dacWrite16 (spi1, SPI1_CS0n_PIN, 0xB000); // write 0x000 to DAC 2 B
-	dac2B = 0;
+	Dac2::Write (Mcp::Word (Mcp::A, 0x80)); // write 0x800 to DAC 2 A
+	Dac2::Write (Mcp::Word (Mcp::B, 0x00)); // write 0x000 to DAC 2 B
 
 	// hello world
 	printf ("Hello, world!\n");
@@ -214,9 +208,12 @@ int main ()
                 switch (index++) {
 
                     case 0:
+						if (!strcmp (buffptr, "d")) {		// dac write counters
+							printf ("dac writes: %lu skipped: %lu\n", dacWrites, dacSkipped);
+							break;
+						}
 						target = fmod (atof (buffptr), 360.0);
-						newScale0 =  sin ((target + 120)*M_PI/180.0); // s3 / blue
-						newScale1 = -sin ((target + 240)*M_PI/180.0); // s1 / yellow
+						SynchroScales (target, &newScale0, &newScale1);
 						printf ("               YL-BU  BU-BK   BK-YL\n");
 						printf ("target: %6.0f %6.2f %6.2f %6.2f\n", 
 							target,                // target angle
@@ -248,24 +245,14 @@ int main ()
 			// theta = target;
 
 			// gradual move
-			float diff = fmod ((target - theta + 180), 360) - 180;
-			diff = diff < -180 ? diff + 360 : diff;
-			if (fabs(diff) == 180) { // always move CW for 180 degree difference
-				theta++;
-			} else if (diff < 0) {   // move CCW
-				theta--;
-			} else if (diff > 0) {   // move CW
-				theta++;
-			} else {          		 // no move needed
-				// nothing 
-			}
+			theta = SynchroSlew (theta, target);
 
 			// move to theta
-			newScale0 =  sin ((theta + 120)*M_PI/180.0); // s3 / blue
-			newScale1 = -sin ((theta + 240)*M_PI/180.0); // s1 / yellow
+			SynchroScales (theta, &newScale0, &newScale1);
 			critical_section_enter_blocking (&scale_critsec);
 			scaleDac0 = newScale0;
 			scaleDac1 = newScale1;
+			scaleCount = scaleCount + 1;
 			critical_section_exit (&scale_critsec);
 
             // blihk led
@@ -376,49 +363,21 @@ void core1_entry (void)
 
 bool repeating_timer_callback_40kHz (struct repeating_timer *t)
 {
-	uint16_t a;
+	// write the levels worked out last time, only the ones that changed
+	uint32_t writes = SynchroWrite<Dac0, Dac1, Dac2> (&drive);
 
-	a = 0xB000 | ((uint16_t)dac0B << 4);
-	gpio_put (SPI0_CS0n_PIN, 0);
-	spi_write16_blocking (spi0, &a, 1);
-	gpio_put (SPI0_CS0n_PIN, 1);
-
-	a = 0xB000 | ((uint16_t)dac1B << 4);
-	gpio_put (SPI0_CS1n_PIN, 0);
-	spi_write16_blocking (spi0, &a, 1);
-	gpio_put (SPI0_CS1n_PIN, 1);
-
-	a = 0xB000 | ((uint16_t)dac2B << 4);
-	gpio_put (SPI1_CS0n_PIN, 0);
-	spi_write16_blocking (spi1, &a, 1);
-	gpio_put (SPI1_CS0n_PIN, 1);
-
-	if (++sin_phase >= 100) {
-		sin_phase = 0;
-	}
+	dacWrites += writes;
+	dacSkipped += SYNCHRO_DACS - writes;
 
+	// start a ramp to new scales, then the next levels
 	critical_section_enter_blocking (&scale_critsec);
-	dac0B = 128+scaleDac0*sine[sin_phase];
-	dac1B = 128+scaleDac1*sine[sin_phase];
-	dac2B = 128+scaleDac2*sine[sin_phase];
+	if (scaleCount != scaleSeen) {
+		scaleSeen = scaleCount;
+		SynchroTarget (&drive, scaleDac0, scaleDac1, scaleDac2, SCALE_RAMP_SAMPLES);
+	}
 	critical_section_exit (&scale_critsec);
+	SynchroNext (&drive);
 
 	return true;
 }
 
-
-void dacWrite16 (spi_inst_t *spi, uint cs_pin, uint16_t a)
-{
-	// CS low
-    asm volatile ("nop \n nop \n nop");
-	gpio_put (cs_pin, 0);
-    asm volatile ("nop \n nop \n nop");
-
-	// transfer data
-	spi_write16_blocking (spi, &a, 1);
-
-	// CS high
-    asm volatile ("nop \n nop \n nop");
-	gpio_put (cs_pin, 1);
-    asm volatile ("nop \n nop \n nop");
-}
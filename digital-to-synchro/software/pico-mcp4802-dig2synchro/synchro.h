@@ -0,0 +1,183 @@
+//---------------------------------------------------------------------------------------------
+// synchro.h
+//
+// the synchro drive without the pico sdk, so the host simulation in
+// synchro-to-digital/linux-host runs the same code as the board
+//
+// SynchroSlew is the 100 Hz trajectory, one degree per call toward the target. SynchroScales
+// turns an angle into the stator drive, s3 on dac 0 and s1 on dac 1 with s2 at mid scale:
+//    s1 - s3 = sin (theta)
+//    s3 - s2 = sin (theta + 120)
+//
+// SynchroWrite and SynchroNext are the 40 kHz sample interrupt. SynchroWrite sends the levels
+// worked out on the last interrupt to the B channels that changed, SynchroNext steps the
+// sine phase and works out the next levels from the scales. the dacs are types from lib/dac,
+// dac_pico.h on the board and dac_recording.h on the host.
+//
+// SynchroTarget hands the interrupt new scales. it moves to them in a straight line over
+// rampSamples, one update interval, so the stator drive does not step part way through a
+// carrier cycle each time the trajectory moves a degree. that smooths the drive and the
+// angle the synchro sees at the cost of another update interval of lag. a rampSamples of 0
+// takes the new scales at once as the drive always did. the scales are Q16, so only
+// SynchroTarget's conversion is floating point, not every sample.
+//
+
+#ifndef _SYNCHRO_H_
+#define _SYNCHRO_H_
+
+#include <stdint.h>
+#include <math.h>
+
+#define SYNCHRO_SINE_STEPS 100          // 400 Hz at 40 kHz
+#define SYNCHRO_DACS       3            // s3, s1 and the reference
+#define SYNCHRO_MID        128
+#define SYNCHRO_ONE        (1 << 16)    // scale 1.0
+
+typedef struct {
+	uint8_t phase;                      // sine[] entry of level[]
+	uint8_t level[SYNCHRO_DACS];        // B channel levels for the next write
+	uint8_t last[SYNCHRO_DACS];         // what the B channels hold
+	int32_t scale[SYNCHRO_DACS];        // Q16 scales of level[]
+	int32_t target[SYNCHRO_DACS];       // Q16 scales the ramp ends at
+	int32_t step[SYNCHRO_DACS];         // Q16 ramp per sample
+	uint32_t rampLeft;                  // samples until scale[] is target[]
+} SynchroDrive;
+
+// sine lookup table
+// a=sin((0:99)*2*pi/100);
+// b=round(a*127);
+// min(b) ans = -127
+// max(b) ans =  127
+// b(1)   ans =  0
+static const int8_t synchroSine[SYNCHRO_SINE_STEPS] = {
+     0,    8,   16,   24,   32,   39,   47,   54,   61,   68,
+    75,   81,   87,   93,   98,  103,  107,  111,  115,  118,
+   121,  123,  125,  126,  127,  127,  127,  126,  125,  123,
+   121,  118,  115,  111,  107,  103,   98,   93,   87,   81,
+    75,   68,   61,   54,   47,   39,   32,   24,   16,    8,
+     0,   -8,  -16,  -24,  -32,  -39,  -47,  -54,  -61,  -68,
+   -75,  -81,  -87,  -93,  -98, -103, -107, -111, -115, -118,
+  -121, -123, -125, -126, -127, -127, -127, -126, -125, -123,
+  -121, -118, -115, -111, -107, -103,  -98,  -93,  -87,  -81,
+   -75,  -68,  -61,  -54,  -47,  -39,  -32,  -24,  -16,   -8
+};
+
+
+//---------------------------------------------------------------------------------------------
+// SynchroSlew -- next theta on the way to target, both in degrees
+//
+
+inline float SynchroSlew (float theta, float target)
+{
+	float diff = fmod ((target - theta + 180), 360) - 180;
+	diff = diff < -180 ? diff + 360 : diff;
+	if (fabs(diff) == 180) { // always move CW for 180 degree difference
+		theta++;
+	} else if (diff < 0) {   // move CCW
+		theta--;
+	} else if (diff > 0) {   // move CW
+		theta++;
+	} else {          		 // no move needed
+		// nothing
+	}
+	return theta;
+}
+
+
+//---------------------------------------------------------------------------------------------
+// SynchroScales -- dac 0 and dac 1 scales for theta in degrees
+//
+
+inline void SynchroScales (float theta, float *scale0, float *scale1)
+{
+	*scale0 =  sin ((theta + 120)*M_PI/180.0); // s3 / blue
+	*scale1 = -sin ((theta + 240)*M_PI/180.0); // s1 / yellow
+}
+
+
+//---------------------------------------------------------------------------------------------
+// SynchroWrite -- write the B channels that changed, dac 2 is alone on its bus so it is
+//                 started first and runs while the other two are written. returns the
+//                 number of writes
+//
+
+template <class Dac0, class Dac1, class Dac2>
+inline uint32_t SynchroWrite (SynchroDrive *drive)
+{
+	typedef typename Dac0::model Mcp;
+	uint32_t writes = 0;
+
+	bool spi1Busy = (drive->level[2] != drive->last[2]);
+	if (spi1Busy) {
+		Dac2::Start (Mcp::Word (Mcp::B, drive->level[2]));
+		drive->last[2] = drive->level[2];
+		writes++;
+	}
+
+	if (drive->level[0] != drive->last[0]) {
+		Dac0::Write (Mcp::Word (Mcp::B, drive->level[0]));
+		drive->last[0] = drive->level[0];
+		writes++;
+	}
+
+	if (drive->level[1] != drive->last[1]) {
+		Dac1::Write (Mcp::Word (Mcp::B, drive->level[1]));
+		drive->last[1] = drive->level[1];
+		writes++;
+	}
+
+	// finish spi 1
+	if (spi1Busy) {
+		Dac2::Finish ();
+	}
+
+	return writes;
+}
+
+
+//---------------------------------------------------------------------------------------------
+// SynchroTarget -- new scales for the three dacs, reached rampSamples from now
+//
+
+inline void SynchroTarget (SynchroDrive *drive, float scale0, float scale1, float scale2, uint32_t rampSamples)
+{
+	drive->target[0] = (int32_t)lroundf (scale0 * SYNCHRO_ONE);
+	drive->target[1] = (int32_t)lroundf (scale1 * SYNCHRO_ONE);
+	drive->target[2] = (int32_t)lroundf (scale2 * SYNCHRO_ONE);
+
+	for (int i = 0; i < SYNCHRO_DACS; i++) {
+		if (rampSamples == 0) {
+			drive->scale[i] = drive->target[i];
+		} else {
+			drive->step[i] = (drive->target[i] - drive->scale[i]) / (int32_t)rampSamples;
+		}
+	}
+	drive->rampLeft = rampSamples;
+}
+
+
+//---------------------------------------------------------------------------------------------
+// SynchroNext -- step the sine phase and the scales and work out the levels for the next
+//                write
+//
+
+inline void SynchroNext (SynchroDrive *drive)
+{
+	if (++drive->phase >= SYNCHRO_SINE_STEPS) {
+		drive->phase = 0;
+	}
+
+	if (drive->rampLeft) {
+		bool last = (--drive->rampLeft == 0);
+		for (int i = 0; i < SYNCHRO_DACS; i++) {
+			drive->scale[i] = last ? drive->target[i] : drive->scale[i] + drive->step[i];
+		}
+	}
+
+	int32_t sine = synchroSine[drive->phase];
+	drive->level[0] = SYNCHRO_MID + ((drive->scale[0] * sine) >> 16);
+	drive->level[1] = SYNCHRO_MID + ((drive->scale[1] * sine) >> 16);
+	drive->level[2] = SYNCHRO_MID + ((drive->scale[2] * sine) >> 16);
+}
+
+#endif
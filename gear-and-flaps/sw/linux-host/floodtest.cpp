@@ -0,0 +1,426 @@
+//---------------------------------------------------------------------------------------------
+// notes
+//
+// floodtest -- the gear and flaps firmware's report to dac path under a flood of reports,
+//              on the host
+//
+// usage:
+//    floodtest
+//
+// builds transport_hid.cpp, reports.cpp, indicators.cpp, ramp.cpp, hidlog.cpp and
+// dacdma.cpp against picosim.cpp's spi and dma and tusbsim.cpp's mock tinyusb, and runs
+// them the way main.cpp's loop does, one pass every LOOP_US unless a test says otherwise. the spi clock is main.cpp's
+// 100 kHz, so a 16 bit frame takes FRAME_US and a flush of all four chips FLUSH_US.
+//
+//    paced    one level report per 1 ms polling interval, slower than a flush. nothing is
+//             coalesced and every level latches within a flush of arriving
+//    flood    a report every 100 us, six to a flush, as the cdc transport can deliver them.
+//             levels are coalesced and every level set is accounted for as coalesced,
+//             unchanged or written. the levels only rise through the flood and so must
+//             every chip's writes, a stale level is never written after a newer one. the
+//             dacs end on the last report's levels and no level waits more than two
+//             flushes and a loop pass
+//    probe    a report 0x03 at the end of a flood comes back as report 0x04 with its
+//             sequence number and levels, latched within the same bound
+//    skew     with the loop taking STALL_US a pass, chips n and n+2 latch together and
+//             chips 1 and 3 one frame after 0 and 2, as dacdma.h says, and every chip's
+//             dac B word matches its dac A word
+//
+// in every test the chip selects only rise on whole 16 bit frames once the bus is idle.
+// it prints each check that fails and the exit status is the number of failures.
+//
+
+//---------------------------------------------------------------------------------------------
+// includes
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "pico/stdlib.h"
+
+#include "hardware/gpio.h"
+#include "hardware/spi.h"
+
+#include "dac/dac.h"
+
+#include "dacdma.h"
+#include "curves.h"
+#include "indicators.h"
+#include "ramp.h"
+#include "reports.h"
+#include "transport.h"
+#include "picosim.h"
+#include "tusb.h"
+
+
+//---------------------------------------------------------------------------------------------
+// defines
+//
+
+#define SPI_HZ    100000
+#define FRAME_US  (16 * 1000000 / SPI_HZ)
+#define FLUSH_US  (4 * FRAME_US)
+#define LOOP_US   10
+#define STALL_US  1000
+#define RUN_LIMIT (1000000 / LOOP_US)
+
+#define CHECK(cond) Check ((cond), #cond, __LINE__)
+
+
+//---------------------------------------------------------------------------------------------
+// globals
+//
+
+// main.cpp's chip selects of dac chips 0 to 3, 0 and 1 on spi0, 2 and 3 on spi1
+static const uint dacCsPins[DAC_NUM_CHIPS] = { 5, 6, 13, 11 };
+
+// what each chip latched
+static uint8_t  lastA[DAC_NUM_CHIPS];
+static uint8_t  lastB[DAC_NUM_CHIPS];
+static bool     gotB[DAC_NUM_CHIPS];
+static uint64_t latchNs[DAC_NUM_CHIPS];
+static uint32_t written[DAC_NUM_CHIPS];
+static int      prevA[DAC_NUM_CHIPS];
+static uint32_t falls = 0;
+static uint32_t orderErrors = 0;
+
+static uint32_t loopUs = 0;
+static int failures = 0;
+static const char *test = "";
+
+
+//---------------------------------------------------------------------------------------------
+// Check
+//
+
+static void Check (bool cond, const char *text, int line)
+{
+	if (!cond) {
+		printf ("%s: line %d: %s\n", test, line, text);
+		failures++;
+	}
+}
+
+
+//---------------------------------------------------------------------------------------------
+// Latch -- picosim's latch function, a tlv5626 taking a word
+//
+
+static void Latch (uint pin, uint16_t word, uint64_t ns)
+{
+	int chip = 0;
+	while ((chip < DAC_NUM_CHIPS) && (dacCsPins[chip] != pin)) {
+		chip++;
+	}
+	if (chip == DAC_NUM_CHIPS) {
+		orderErrors++;
+		return;
+	}
+
+	uint8_t code = (word >> 4) & 0xff;
+	if ((word & 0x9000) == dac::Tlv5626::B_AND_BUFFER) {
+		lastB[chip] = code;
+		gotB[chip] = true;
+	} else if ((word & 0x9000) == dac::Tlv5626::A_AND_B) {
+		// the buffer write always goes first
+		if (!gotB[chip]) {
+			orderErrors++;
+		}
+		gotB[chip] = false;
+		if (code <= prevA[chip]) {
+			falls++;
+		}
+		prevA[chip] = code;
+		lastA[chip] = code;
+		latchNs[chip] = ns;
+		written[chip]++;
+	} else {
+		orderErrors++;
+	}
+}
+
+
+//---------------------------------------------------------------------------------------------
+// Start -- a new test, the write counters start over
+//
+
+static void Start (const char *name, uint32_t intervalUs)
+{
+	test = name;
+	TusbSimInterval (intervalUs);
+	for (int chip = 0; chip < DAC_NUM_CHIPS; chip++) {
+		written[chip] = 0;
+		prevA[chip] = -1;
+	}
+	falls = 0;
+}
+
+
+//---------------------------------------------------------------------------------------------
+// Pass -- one pass of main.cpp's loop taking us
+//
+
+static void Pass (uint32_t us)
+{
+	TransportTask ();
+	DacTask ();
+	ReportsTask ();
+	PicoSimAdvance (us);
+
+	loopUs += us;
+	if (loopUs >= RAMP_TICK_MS * 1000) {
+		loopUs -= RAMP_TICK_MS * 1000;
+		IndicatorsTick ();
+	}
+}
+
+
+//---------------------------------------------------------------------------------------------
+// RunIdle -- until every report is in and the dacs are idle, false if that never happens
+//
+
+static bool RunIdle (uint32_t us)
+{
+	for (int n = 0; n < RUN_LIMIT; n++) {
+		Pass (us);
+		if ((TusbSimOutQueued () == 0) && !DacBusy ()) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+
+//---------------------------------------------------------------------------------------------
+// Send -- queue a report 0x01 or 0x03 from the host, levels in channel order
+//
+
+static void Send (uint8_t id, const uint8_t *level, uint32_t seq)
+{
+	uint8_t report[PROBE_REPORT_LEN] = { id, 0 };
+
+	for (int ch = 0; ch < NUM_CHANNELS; ch++) {
+		report[1] |= channelMap[ch].reportMask;
+		report[2 + channelMap[ch].reportByte] = level[ch];
+	}
+	report[6] = seq;
+	report[7] = seq >> 8;
+	report[8] = seq >> 16;
+	report[9] = seq >> 24;
+
+	TusbSimOut (report, (id == PROBE_REPORT_ID) ? PROBE_REPORT_LEN : LEVELS_REPORT_LEN);
+}
+
+
+//---------------------------------------------------------------------------------------------
+// OnDacs -- true when every chip holds the code for its channel's level
+//
+
+static bool OnDacs (const uint8_t *level)
+{
+	for (int ch = 0; ch < NUM_CHANNELS; ch++) {
+		if (lastA[channelMap[ch].chip] != channelMap[ch].curve->code[level[ch]]) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+
+//---------------------------------------------------------------------------------------------
+// Written -- chip writes since Start
+//
+
+static uint32_t Written (void)
+{
+	uint32_t n = 0;
+	for (int chip = 0; chip < DAC_NUM_CHIPS; chip++) {
+		n += written[chip];
+	}
+
+	return n;
+}
+
+
+//---------------------------------------------------------------------------------------------
+// Rising -- levels for report k of a run, rising with k and different on every channel
+//
+
+static void Rising (int k, int step, uint8_t *level)
+{
+	for (int ch = 0; ch < NUM_CHANNELS; ch++) {
+		level[ch] = LEVEL_MIN + step * k + 10 * ch;
+	}
+}
+
+
+//---------------------------------------------------------------------------------------------
+// TestPaced
+//
+
+static void TestPaced (void)
+{
+	DacStats s0, s1;
+	uint8_t level[NUM_CHANNELS];
+	const int reports = 50;
+
+	Start ("paced", 1000);
+	DacGetStats (&s0);
+	for (int k = 0; k < reports; k++) {
+		Rising (k, 3, level);
+		Send (LEVELS_REPORT_ID, level, 0);
+	}
+	CHECK (RunIdle (LOOP_US));
+	DacGetStats (&s1);
+
+	CHECK (s1.levels - s0.levels == reports * NUM_CHANNELS);
+	CHECK (s1.coalesced == s0.coalesced);
+	CHECK (s1.levels - s0.levels == (s1.unchanged - s0.unchanged) + Written ());
+	CHECK (s1.maxFlushUs <= FLUSH_US + LOOP_US);
+	CHECK (falls == 0);
+	CHECK (OnDacs (level));
+}
+
+
+//---------------------------------------------------------------------------------------------
+// TestFlood
+//
+
+static void TestFlood (void)
+{
+	DacStats s0, s1;
+	uint8_t level[NUM_CHANNELS];
+	const int reports = 150;
+
+	Start ("flood", 100);
+	DacGetStats (&s0);
+	for (int k = 0; k < reports; k++) {
+		Rising (k, 1, level);
+		Send (LEVELS_REPORT_ID, level, 0);
+	}
+	CHECK (RunIdle (LOOP_US));
+	DacGetStats (&s1);
+
+	uint32_t levels = s1.levels - s0.levels, coalesced = s1.coalesced - s0.coalesced;
+	CHECK (levels == reports * NUM_CHANNELS);
+	CHECK (coalesced > levels / 2);
+	CHECK (levels == coalesced + (s1.unchanged - s0.unchanged) + Written ());
+	CHECK (s1.flushes - s0.flushes < reports / 4);
+	CHECK (s1.maxFlushUs <= 2 * FLUSH_US + LOOP_US);
+	CHECK (falls == 0);
+	CHECK (OnDacs (level));
+}
+
+
+//---------------------------------------------------------------------------------------------
+// TestProbe
+//
+
+static void TestProbe (void)
+{
+	uint8_t level[NUM_CHANNELS];
+	uint8_t probe[NUM_CHANNELS] = { 100, 120, 140, 160 };
+	const uint32_t seq = 0xa5c30001;
+	uint8_t in[1 + STATUS_REPORT_LEN];
+	uint16_t len = 0;
+	bool got = false;
+
+	Start ("probe", 100);
+	for (int k = 0; k < 20; k++) {
+		Rising (k, 5, level);
+		Send (LEVELS_REPORT_ID, level, 0);
+	}
+	Send (PROBE_REPORT_ID, probe, seq);
+	CHECK (RunIdle (LOOP_US));
+	for (int n = 0; (n < RUN_LIMIT) && !got; n++) {
+		got = TusbSimIn (in, &len);
+		Pass (LOOP_US);
+	}
+
+	CHECK (got);
+	CHECK (len == 1 + STATUS_REPORT_LEN);
+	if (!got || (len != 1 + STATUS_REPORT_LEN)) {
+		return;
+	}
+	uint32_t rxSeq = in[1] | (in[2] << 8) | (in[3] << 16) | ((uint32_t)in[4] << 24);
+	uint32_t rxUs = in[5] | (in[6] << 8) | (in[7] << 16) | ((uint32_t)in[8] << 24);
+	uint32_t latchUs = in[9] | (in[10] << 8) | (in[11] << 16) | ((uint32_t)in[12] << 24);
+	CHECK (in[0] == STATUS_REPORT_ID);
+	CHECK (rxSeq == seq);
+	CHECK (in[17] == STATUS_LATCHED);
+	CHECK (latchUs - rxUs <= 2 * FLUSH_US + LOOP_US);
+	for (int ch = 0; ch < NUM_CHANNELS; ch++) {
+		CHECK (in[13 + channelMap[ch].reportByte] == probe[ch]);
+	}
+	CHECK (OnDacs (probe));
+}
+
+
+//---------------------------------------------------------------------------------------------
+// TestSkew
+//
+
+static void TestSkew (void)
+{
+	uint8_t level[NUM_CHANNELS] = { 60, 80, 180, 200 };
+
+	// every pass of the loop takes a ms, as when a log line is going out on the uart, the
+	// interrupt runs the flush whatever the loop is doing
+	Start ("skew", 1000);
+	Send (LEVELS_REPORT_ID, level, 0);
+	CHECK (RunIdle (STALL_US));
+
+	for (int chip = 0; chip < DAC_NUM_CHIPS; chip++) {
+		CHECK (written[chip] == 1);
+		CHECK (lastB[chip] == (uint8_t)(256 - lastA[chip]));
+	}
+	CHECK (latchNs[0] == latchNs[2]);
+	CHECK (latchNs[1] == latchNs[3]);
+	CHECK (latchNs[1] - latchNs[0] == FRAME_US * 1000ull);
+	CHECK (OnDacs (level));
+}
+
+
+//---------------------------------------------------------------------------------------------
+// main
+//
+
+int main (int argc, char *argv[])
+{
+	(void) argv;
+
+	if (argc > 1) {
+		fprintf (stderr, "usage: floodtest\n");
+		return 2;
+	}
+
+	// main.cpp's start up, the dacs already written with 0
+	for (int chip = 0; chip < DAC_NUM_CHIPS; chip++) {
+		PicoSimCsPin (dacCsPins[chip], chip / 2);
+	}
+	PicoSimOnLatch (Latch);
+	TransportInit ();
+	spi_init (spi0, SPI_HZ);
+	spi_init (spi1, SPI_HZ);
+	DacDmaInit (dacCsPins);
+	IndicatorsInit ();
+
+	TestPaced ();
+	TestFlood ();
+	TestProbe ();
+	TestSkew ();
+
+	test = "all";
+	CHECK (PicoSimErrors () == 0);
+	CHECK (orderErrors == 0);
+
+	printf ("%s, %d failed\n", failures ? "FAIL" : "pass", failures);
+
+	return failures;
+}
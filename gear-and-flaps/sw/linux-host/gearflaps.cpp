@@ -0,0 +1,313 @@
+//---------------------------------------------------------------------------------------------
+// gearflaps.cpp
+//
+
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+
+#include "gearflaps.h"
+
+namespace gearflaps {
+
+
+//---------------------------------------------------------------------------------------------
+// reports
+//
+
+// select mask bit and byte after the mask of each channel, as channelMap in the firmware
+static const uint8_t reportMask[NUM_CHANNELS] = { 0x80, 0x40, 0x10, 0x20 };
+static const uint8_t reportByte[NUM_CHANNELS] = { 0, 1, 3, 2 };
+
+uint8_t ChannelMask (int channel)
+{
+	return reportMask[channel];
+}
+
+Report BuildReport (uint8_t mask, const uint8_t (&level)[NUM_CHANNELS], uint16_t time_ms)
+{
+	Report r;
+
+	memset (r.data, 0, sizeof (r.data));
+	r.data[0] = time_ms ? RAMP_REPORT_ID : LEVELS_REPORT_ID;
+	r.data[1] = mask;
+	for (int ch = 0; ch < NUM_CHANNELS; ch++) {
+		r.data[2 + reportByte[ch]] = level[ch];
+	}
+	r.length = 6;
+	if (time_ms) {
+		r.data[6] = time_ms;
+		r.data[7] = time_ms >> 8;
+		r.length = 8;
+	}
+
+	return r;
+}
+
+
+//---------------------------------------------------------------------------------------------
+// HidrawTransport
+//
+
+std::unique_ptr<HidrawTransport> HidrawTransport::Open (const std::string &path)
+{
+	int fd = open (path.c_str (), O_RDWR);
+	if (fd < 0) {
+		perror (path.c_str ());
+		return nullptr;
+	}
+
+	return std::make_unique<HidrawTransport> (fd);
+}
+
+HidrawTransport::~HidrawTransport ()
+{
+	close (fd);
+}
+
+bool HidrawTransport::Write (const Report &report)
+{
+	return write (fd, report.data, report.length) == report.length;
+}
+
+
+//---------------------------------------------------------------------------------------------
+// FakeTransport
+//
+
+bool FakeTransport::Write (const Report &report)
+{
+	if (writeUs) {
+		std::this_thread::sleep_for (std::chrono::microseconds (writeUs));
+	}
+
+	std::lock_guard<std::mutex> guard (lock);
+	reports.push_back (report);
+
+	return true;
+}
+
+std::vector<Report> FakeTransport::Reports ()
+{
+	std::lock_guard<std::mutex> guard (lock);
+	return reports;
+}
+
+size_t FakeTransport::Count ()
+{
+	std::lock_guard<std::mutex> guard (lock);
+	return reports.size ();
+}
+
+
+//---------------------------------------------------------------------------------------------
+// Discover -- match HID_ID in each hidraw node's uevent against our vendor and product
+//
+
+std::vector<DeviceInfo> Discover (const std::string &sysfs)
+{
+	std::vector<DeviceInfo> found;
+	char want[32];
+	std::error_code ec;
+
+	snprintf (want, sizeof (want), "HID_ID=0003:%08X:%08X", VENDOR_ID, PRODUCT_ID);
+
+	for (const auto &entry : std::filesystem::directory_iterator (sysfs, ec)) {
+		std::ifstream uevent (entry.path () / "device" / "uevent");
+		std::string line, serial;
+		bool match = false;
+
+		while (std::getline (uevent, line)) {
+			if (!strcasecmp (line.c_str (), want)) {
+				match = true;
+			} else if (line.compare (0, 9, "HID_UNIQ=") == 0) {
+				serial = line.substr (9);
+			}
+		}
+		if (match) {
+			found.push_back ({ "/dev/" + entry.path ().filename ().string (), serial });
+		}
+	}
+
+	std::sort (found.begin (), found.end (), [] (const DeviceInfo &a, const DeviceInfo &b) {
+		return (a.serial != b.serial) ? (a.serial < b.serial) : (a.path < b.path);
+	});
+
+	return found;
+}
+
+
+//---------------------------------------------------------------------------------------------
+// Panels
+//
+
+Panels::Panels () : stop (false), stats ()
+{
+	io = std::thread (&Panels::IoThread, this);
+}
+
+Panels::~Panels ()
+{
+	Flush ();
+	{
+		std::lock_guard<std::mutex> guard (lock);
+		stop = true;
+	}
+	wake.notify_all ();
+	io.join ();
+}
+
+int Panels::Add (std::unique_ptr<Transport> transport, const std::string &name)
+{
+	auto p = std::make_unique<Panel> ();
+
+	p->transport = std::move (transport);
+	p->name = name;
+	memset (p->level, 0, sizeof (p->level));
+	memset (p->sent, 0, sizeof (p->sent));
+	p->known = false;
+	p->pending = false;
+	p->busy = false;
+
+	std::lock_guard<std::mutex> guard (lock);
+	panels.push_back (std::move (p));
+
+	return (int)panels.size () - 1;
+}
+
+bool Panels::Set (int panel, int channel, uint8_t level)
+{
+	if ((panel < 0) || (panel >= (int)panels.size ()) || (channel < 0) || (channel >= NUM_CHANNELS)) {
+		return false;
+	}
+
+	std::lock_guard<std::mutex> guard (lock);
+	panels[panel]->level[channel] = level;
+
+	return true;
+}
+
+void Panels::SetAll (int panel, const uint8_t (&level)[NUM_CHANNELS])
+{
+	for (int ch = 0; ch < NUM_CHANNELS; ch++) {
+		Set (panel, ch, level[ch]);
+	}
+}
+
+void Panels::Commit (uint16_t time_ms)
+{
+	bool work = false;
+
+	{
+		std::lock_guard<std::mutex> guard (lock);
+		stats.frames++;
+
+		for (auto &p : panels) {
+			uint8_t mask = 0;
+
+			// first report sets every channel, after that only the ones that changed
+			for (int ch = 0; ch < NUM_CHANNELS; ch++) {
+				if (!p->known || (p->level[ch] != p->sent[ch])) {
+					mask |= reportMask[ch];
+				}
+			}
+			if (mask == 0) {
+				continue;
+			}
+
+			// still waiting for the i/o thread, fold the old report into this one
+			if (p->pending) {
+				mask |= p->report.data[1];
+				stats.merged++;
+			} else {
+				stats.queued++;
+			}
+
+			p->report = BuildReport (mask, p->level, time_ms);
+			memcpy (p->sent, p->level, sizeof (p->sent));
+			p->known = true;
+			p->pending = true;
+			work = true;
+		}
+	}
+
+	if (work) {
+		wake.notify_one ();
+	}
+}
+
+void Panels::Flush ()
+{
+	std::unique_lock<std::mutex> guard (lock);
+
+	idle.wait (guard, [this] {
+		for (auto &p : panels) {
+			if (p->pending || p->busy) {
+				return false;
+			}
+		}
+		return true;
+	});
+}
+
+Stats Panels::GetStats ()
+{
+	std::lock_guard<std::mutex> guard (lock);
+	return stats;
+}
+
+
+//---------------------------------------------------------------------------------------------
+// IoThread -- write pending reports, one pass over the panels at a time so a slow panel
+//             does not hold up the others for more than one write
+//
+
+void Panels::IoThread ()
+{
+	std::unique_lock<std::mutex> guard (lock);
+
+	while (1) {
+		bool any = false;
+
+		for (size_t i = 0; i < panels.size (); i++) {
+			Panel *p = panels[i].get ();
+			if (!p->pending) {
+				continue;
+			}
+
+			Report report = p->report;
+			p->pending = false;
+			p->busy = true;
+			any = true;
+
+			guard.unlock ();
+			bool ok = p->transport->Write (report);
+			guard.lock ();
+
+			p->busy = false;
+			if (ok) {
+				stats.written++;
+			} else {
+				stats.errors++;
+			}
+		}
+
+		if (any) {
+			continue;
+		}
+
+		idle.notify_all ();
+		if (stop) {
+			break;
+		}
+		wake.wait (guard);
+	}
+}
+
+}
@@ -0,0 +1,168 @@
+//---------------------------------------------------------------------------------------------
+// gearflaps.h
+//
+// host library for driving any number of usb gear and flaps panels
+//
+// the caller sets levels on panels as the sim runs and calls Commit once per frame. for
+// every panel whose levels changed Commit builds one report holding all of that frame's
+// changes and hands it to the i/o thread, which does the actual writes. the sim thread
+// never blocks on usb. a panel whose last report has not been written yet when the next
+// frame commits gets a single merged report instead of two, so a slow panel falls behind
+// by at most one report and always ends up showing the latest levels.
+//
+// channels are in the firmware's cli order, nose, right, left, flaps. levels are 0 for
+// off or 32 to 224, see the notes in the firmware main.cpp.
+//
+// a Transport moves reports to one device. HidrawTransport writes /dev/hidrawN,
+// FakeTransport keeps every report in memory and can add a delay per write to stand in
+// for the usb polling interval.
+//
+
+#ifndef _GEARFLAPS_H_
+#define _GEARFLAPS_H_
+
+#include <stdint.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace gearflaps {
+
+enum Channel { NOSE = 0, RIGHT, LEFT, FLAPS, NUM_CHANNELS };
+
+const uint16_t VENDOR_ID  = 0x4247;
+const uint16_t PRODUCT_ID = 0x0023;
+
+const uint8_t LEVELS_REPORT_ID = 0x01;
+const uint8_t RAMP_REPORT_ID   = 0x02;
+
+
+//---------------------------------------------------------------------------------------------
+// Report -- one output report, id first
+//
+
+struct Report {
+	uint8_t data[8];
+	uint8_t length;
+};
+
+// report for the channels in mask, 0x01 when time_ms is 0 and 0x02 otherwise
+Report BuildReport (uint8_t mask, const uint8_t (&level)[NUM_CHANNELS], uint16_t time_ms);
+
+// bit in the report select mask of each channel
+uint8_t ChannelMask (int channel);
+
+
+//---------------------------------------------------------------------------------------------
+// transports
+//
+
+class Transport {
+public:
+	virtual ~Transport () {}
+	virtual bool Write (const Report &report) = 0;
+};
+
+class HidrawTransport : public Transport {
+public:
+	explicit HidrawTransport (int fd) : fd (fd) {}
+	~HidrawTransport ();
+	static std::unique_ptr<HidrawTransport> Open (const std::string &path);
+	bool Write (const Report &report) override;
+private:
+	int fd;
+};
+
+class FakeTransport : public Transport {
+public:
+	explicit FakeTransport (uint32_t writeUs = 0) : writeUs (writeUs) {}
+	bool Write (const Report &report) override;
+	std::vector<Report> Reports ();
+	size_t Count ();
+private:
+	uint32_t writeUs;
+	std::mutex lock;
+	std::vector<Report> reports;
+};
+
+
+//---------------------------------------------------------------------------------------------
+// discovery
+//
+
+struct DeviceInfo {
+	std::string path;     // /dev/hidrawN
+	std::string serial;   // pico unique board id
+};
+
+// every gear and flaps panel plugged in, sorted by serial number. sysfs can be pointed
+// somewhere else for testing
+std::vector<DeviceInfo> Discover (const std::string &sysfs = "/sys/class/hidraw");
+
+
+//---------------------------------------------------------------------------------------------
+// Panels
+//
+
+struct Stats {
+	uint64_t frames;      // Commit calls
+	uint64_t queued;      // reports handed to the i/o thread
+	uint64_t merged;      // reports merged into one still waiting to be written
+	uint64_t written;     // reports written
+	uint64_t errors;      // failed writes
+};
+
+class Panels {
+public:
+	Panels ();
+	~Panels ();
+
+	// add a panel, returns its index
+	int  Add (std::unique_ptr<Transport> transport, const std::string &name = "");
+	int  Count () const { return (int)panels.size (); }
+	const std::string &Name (int panel) const { return panels[panel]->name; }
+
+	// set a level for the next Commit, returns false for a bad panel or channel
+	bool Set (int panel, int channel, uint8_t level);
+	void SetAll (int panel, const uint8_t (&level)[NUM_CHANNELS]);
+
+	// end of frame, queue one report per changed panel. channels changed in this frame
+	// ramp over time_ms
+	void Commit (uint16_t time_ms = 0);
+
+	// wait until everything committed has been written
+	void Flush ();
+
+	Stats GetStats ();
+
+private:
+	struct Panel {
+		std::unique_ptr<Transport> transport;
+		std::string name;
+		uint8_t level[NUM_CHANNELS];    // levels set since the last commit
+		uint8_t sent[NUM_CHANNELS];     // levels in the last report queued
+		bool    known;                  // false until a report with every channel was queued
+		bool    pending;                // report waiting for the i/o thread
+		bool    busy;                   // report being written
+		Report  report;
+	};
+
+	void IoThread ();
+
+	std::vector<std::unique_ptr<Panel>> panels;
+	std::mutex lock;
+	std::condition_variable wake;       // work for the i/o thread
+	std::condition_variable idle;       // i/o thread has nothing left
+	std::thread io;
+	bool stop;
+	Stats stats;
+};
+
+}
+
+#endif
@@ -0,0 +1,210 @@
+//---------------------------------------------------------------------------------------------
+// notes
+//
+// gfbench -- throughput of the gearflaps library against the one report per change
+//            scripts it replaces
+//
+// usage:
+//    gfbench [-p panels] [-f frames] [-r frames_per_s] [-w write_us] [--hidraw]
+//
+// every frame changes a random set of channels on every panel. the synchronous run writes
+// one report per changed channel from the sim thread, the library run sets the levels
+// and commits once per frame. both use fake panels that take write_us per report, which
+// stands in for the 1 ms interrupt endpoint, unless --hidraw is given, which uses every
+// panel Discover finds instead. -r 0 runs the frames back to back.
+//
+
+//---------------------------------------------------------------------------------------------
+// includes
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <chrono>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "gearflaps.h"
+
+using namespace gearflaps;
+using Clock = std::chrono::steady_clock;
+
+
+//---------------------------------------------------------------------------------------------
+// globals
+//
+
+static int numPanels = 4;
+static int numFrames = 1000;
+static int frameRate = 0;
+static uint32_t writeUs = 1000;
+static bool useHidraw = false;
+
+
+//---------------------------------------------------------------------------------------------
+// MakeTransports
+//
+
+static std::vector<std::unique_ptr<Transport>> MakeTransports (void)
+{
+	std::vector<std::unique_ptr<Transport>> t;
+
+	if (useHidraw) {
+		for (const DeviceInfo &d : Discover ()) {
+			auto h = HidrawTransport::Open (d.path);
+			if (h) {
+				t.push_back (std::move (h));
+			}
+		}
+	} else {
+		for (int i = 0; i < numPanels; i++) {
+			t.push_back (std::make_unique<FakeTransport> (writeUs));
+		}
+	}
+
+	return t;
+}
+
+
+//---------------------------------------------------------------------------------------------
+// Frame -- pick the changes for one frame, the same sequence for both runs
+//
+
+struct Change {
+	int panel, channel;
+	uint8_t level;
+};
+
+static std::vector<Change> Frame (std::mt19937 &rng, int panels)
+{
+	std::vector<Change> changes;
+
+	for (int p = 0; p < panels; p++) {
+		for (int ch = 0; ch < NUM_CHANNELS; ch++) {
+			if (rng () & 1) {
+				changes.push_back ({ p, ch, (uint8_t)(32 + rng () % 193) });
+			}
+		}
+	}
+
+	return changes;
+}
+
+
+//---------------------------------------------------------------------------------------------
+// Pace -- wait for the start of frame n
+//
+
+static void Pace (Clock::time_point start, int n)
+{
+	if (frameRate > 0) {
+		std::this_thread::sleep_until (start + std::chrono::microseconds ((int64_t)n * 1000000 / frameRate));
+	}
+}
+
+
+//---------------------------------------------------------------------------------------------
+// Report
+//
+
+static void Print (const char *name, double seconds, double maxFrameUs, uint64_t reports, uint64_t changes)
+{
+	printf ("%-12s %8.3f s %9.0f frames/s %9.0f changes/s %8llu reports  max frame %8.0f us\n",
+		name, seconds, numFrames / seconds, changes / seconds, (unsigned long long)reports, maxFrameUs);
+}
+
+
+//---------------------------------------------------------------------------------------------
+// main
+//
+
+int main (int argc, char *argv[])
+{
+	for (int i = 1; i < argc; i++) {
+		if (!strcmp (argv[i], "-p") && (i + 1 < argc)) {
+			numPanels = atoi (argv[++i]);
+		} else if (!strcmp (argv[i], "-f") && (i + 1 < argc)) {
+			numFrames = atoi (argv[++i]);
+		} else if (!strcmp (argv[i], "-r") && (i + 1 < argc)) {
+			frameRate = atoi (argv[++i]);
+		} else if (!strcmp (argv[i], "-w") && (i + 1 < argc)) {
+			writeUs = atoi (argv[++i]);
+		} else if (!strcmp (argv[i], "--hidraw")) {
+			useHidraw = true;
+		} else {
+			fprintf (stderr, "usage: %s [-p panels] [-f frames] [-r frames_per_s] [-w write_us] [--hidraw]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	//----------------------------------------
+	// one synchronous report per change
+	//----------------------------------------
+
+	{
+		auto t = MakeTransports ();
+		if (t.empty ()) {
+			fprintf (stderr, "no panels\n");
+			return 1;
+		}
+		numPanels = (int)t.size ();
+
+		std::mt19937 rng (1);
+		uint64_t reports = 0, changes = 0;
+		double maxFrameUs = 0;
+		auto start = Clock::now ();
+		for (int n = 0; n < numFrames; n++) {
+			Pace (start, n);
+			auto f0 = Clock::now ();
+			for (const Change &c : Frame (rng, numPanels)) {
+				uint8_t level[NUM_CHANNELS] = { 0, 0, 0, 0 };
+				level[c.channel] = c.level;
+				t[c.panel]->Write (BuildReport (ChannelMask (c.channel), level, 0));
+				reports++;
+				changes++;
+			}
+			maxFrameUs = std::max (maxFrameUs, std::chrono::duration<double, std::micro> (Clock::now () - f0).count ());
+		}
+		double seconds = std::chrono::duration<double> (Clock::now () - start).count ();
+		printf ("%d panels, %d frames, %s\n", numPanels, numFrames, useHidraw ? "hidraw" : "fake panels");
+		Print ("synchronous", seconds, maxFrameUs, reports, changes);
+	}
+
+	//----------------------------------------
+	// library, one merged report per panel and frame from the i/o thread
+	//----------------------------------------
+
+	{
+		Panels panels;
+		for (auto &t : MakeTransports ()) {
+			panels.Add (std::move (t));
+		}
+
+		std::mt19937 rng (1);
+		uint64_t changes = 0;
+		double maxFrameUs = 0;
+		auto start = Clock::now ();
+		for (int n = 0; n < numFrames; n++) {
+			Pace (start, n);
+			auto f0 = Clock::now ();
+			for (const Change &c : Frame (rng, numPanels)) {
+				panels.Set (c.panel, c.channel, c.level);
+				changes++;
+			}
+			panels.Commit ();
+			maxFrameUs = std::max (maxFrameUs, std::chrono::duration<double, std::micro> (Clock::now () - f0).count ());
+		}
+		panels.Flush ();
+		double seconds = std::chrono::duration<double> (Clock::now () - start).count ();
+
+		Stats s = panels.GetStats ();
+		Print ("library", seconds, maxFrameUs, s.written, changes);
+		printf ("             %llu queued, %llu merged into a waiting report, %llu errors\n",
+			(unsigned long long)s.queued, (unsigned long long)s.merged, (unsigned long long)s.errors);
+	}
+
+	return 0;
+}
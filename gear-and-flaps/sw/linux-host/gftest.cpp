@@ -0,0 +1,299 @@
+//---------------------------------------------------------------------------------------------
+// notes
+//
+// gftest -- the gearflaps library against fake panels
+//
+// usage:
+//    gftest
+//
+// every panel is a FakeTransport and every report it got is played into a model of the
+// firmware, which takes the levels of the channels in the select mask, so the checks are
+// on what a panel would show as well as on the reports themselves:
+//
+//    frame      a frame's Set calls go out as one report per changed panel, the first
+//               report has every channel and later ones only the channels that changed,
+//               a channel set twice sends its last level and Commit (ms) sends report 0x02
+//    panels     panels keep their own levels, a frame that changes one panel writes to
+//               that one only
+//    order      one slow panel and two fast ones, frames committed faster than the slow
+//               panel takes a report. every report is written in commit order and never
+//               carries a level older than one before it, merged reports keep the channels
+//               of the reports they replaced, every panel ends on the last frame's levels
+//               and queued + merged covers every changed panel in every frame
+//
+// it prints each check that fails and the exit status is the number of failures.
+//
+
+//---------------------------------------------------------------------------------------------
+// includes
+//
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <memory>
+#include <vector>
+
+#include "gearflaps.h"
+
+using namespace gearflaps;
+
+
+//---------------------------------------------------------------------------------------------
+// defines
+//
+
+#define CHECK(cond) Check ((cond), #cond, __LINE__)
+
+// byte after the select mask of each channel, as channelMap in the firmware
+static const int reportByte[NUM_CHANNELS] = { 0, 1, 3, 2 };
+
+
+//---------------------------------------------------------------------------------------------
+// globals
+//
+
+static int failures = 0;
+static const char *test = "";
+
+
+//---------------------------------------------------------------------------------------------
+// Check
+//
+
+static void Check (bool cond, const char *text, int line)
+{
+	if (!cond) {
+		printf ("%s: line %d: %s\n", test, line, text);
+		failures++;
+	}
+}
+
+
+//---------------------------------------------------------------------------------------------
+// Apply -- a report through the firmware model, false if it is not a valid levels report
+//
+
+static bool Apply (const Report &r, uint8_t (&shown)[NUM_CHANNELS])
+{
+	if (!((r.data[0] == LEVELS_REPORT_ID) && (r.length == 6)) &&
+			!((r.data[0] == RAMP_REPORT_ID) && (r.length == 8))) {
+		return false;
+	}
+
+	for (int ch = 0; ch < NUM_CHANNELS; ch++) {
+		if (r.data[1] & ChannelMask (ch)) {
+			shown[ch] = r.data[2 + reportByte[ch]];
+		}
+	}
+
+	return true;
+}
+
+
+//---------------------------------------------------------------------------------------------
+// Same
+//
+
+static bool Same (const uint8_t (&a)[NUM_CHANNELS], const uint8_t (&b)[NUM_CHANNELS])
+{
+	return memcmp (a, b, NUM_CHANNELS) == 0;
+}
+
+
+//---------------------------------------------------------------------------------------------
+// TestFrame
+//
+
+static void TestFrame (void)
+{
+	test = "frame";
+	Panels panels;
+	FakeTransport *fake = new FakeTransport ();
+	int p = panels.Add (std::unique_ptr<Transport> (fake), "one");
+	uint8_t shown[NUM_CHANNELS] = { 0, 0, 0, 0 };
+
+	// the first report has every channel, even the ones left at 0
+	panels.Set (p, NOSE, 100);
+	panels.Set (p, FLAPS, 50);
+	panels.Set (p, FLAPS, 60);
+	panels.Commit ();
+	panels.Flush ();
+	std::vector<Report> r = fake->Reports ();
+	CHECK (r.size () == 1);
+	if (r.size () != 1) {
+		return;
+	}
+	CHECK (r[0].data[1] == 0xf0);
+	CHECK (Apply (r[0], shown));
+	const uint8_t first[NUM_CHANNELS] = { 100, 0, 0, 60 };
+	CHECK (Same (shown, first));
+
+	// nothing changed, nothing sent
+	panels.Set (p, NOSE, 100);
+	panels.Commit ();
+	panels.Flush ();
+	CHECK (fake->Count () == 1);
+
+	// one channel changed, ramping
+	panels.Set (p, LEFT, 200);
+	panels.Commit (250);
+	panels.Flush ();
+	r = fake->Reports ();
+	CHECK (r.size () == 2);
+	if (r.size () != 2) {
+		return;
+	}
+	CHECK (r[1].data[0] == RAMP_REPORT_ID);
+	CHECK (r[1].length == 8);
+	CHECK (r[1].data[1] == ChannelMask (LEFT));
+	CHECK ((r[1].data[6] | (r[1].data[7] << 8)) == 250);
+
+	// a bad panel or channel is refused
+	CHECK (!panels.Set (1, NOSE, 100));
+	CHECK (!panels.Set (p, NUM_CHANNELS, 100));
+
+	Stats s = panels.GetStats ();
+	CHECK (s.frames == 3);
+	CHECK (s.queued == 2);
+	CHECK (s.merged == 0);
+	CHECK (s.written == 2);
+	CHECK (s.errors == 0);
+}
+
+
+//---------------------------------------------------------------------------------------------
+// TestPanels
+//
+
+static void TestPanels (void)
+{
+	test = "panels";
+	Panels panels;
+	FakeTransport *fake[3];
+	uint8_t want[3][NUM_CHANNELS];
+
+	for (int i = 0; i < 3; i++) {
+		fake[i] = new FakeTransport ();
+		panels.Add (std::unique_ptr<Transport> (fake[i]));
+		for (int ch = 0; ch < NUM_CHANNELS; ch++) {
+			want[i][ch] = 32 + 40 * i + ch;
+		}
+		panels.SetAll (i, want[i]);
+	}
+	panels.Commit ();
+	panels.Flush ();
+
+	// only panel 1 changes
+	want[1][RIGHT] = 224;
+	panels.Set (1, RIGHT, 224);
+	panels.Commit ();
+	panels.Flush ();
+
+	for (int i = 0; i < 3; i++) {
+		uint8_t shown[NUM_CHANNELS] = { 0, 0, 0, 0 };
+		std::vector<Report> r = fake[i]->Reports ();
+		CHECK (r.size () == ((i == 1) ? 2u : 1u));
+		for (const Report &report : r) {
+			CHECK (Apply (report, shown));
+		}
+		CHECK (Same (shown, want[i]));
+	}
+	CHECK (panels.Count () == 3);
+}
+
+
+//---------------------------------------------------------------------------------------------
+// TestOrder
+//
+
+static void TestOrder (void)
+{
+	const int FRAMES = 150;
+	const int PANELS = 3;
+
+	test = "order";
+	Panels panels;
+	FakeTransport *fake[PANELS];
+	uint8_t last[PANELS][NUM_CHANNELS];
+	int changes = 0;
+
+	// panel 0 takes 5 ms a report, the others none
+	for (int i = 0; i < PANELS; i++) {
+		fake[i] = new FakeTransport ((i == 0) ? 5000 : 0);
+		panels.Add (std::unique_ptr<Transport> (fake[i]));
+	}
+
+	// each frame moves one channel of each panel up, a different channel every frame
+	for (int k = 0; k < FRAMES; k++) {
+		for (int i = 0; i < PANELS; i++) {
+			int ch = (k + i) % NUM_CHANNELS;
+			panels.Set (i, ch, 32 + k);
+			changes++;
+		}
+		panels.Commit ();
+		for (int i = 0; i < PANELS; i++) {
+			for (int ch = 0; ch < NUM_CHANNELS; ch++) {
+				int set = -1;
+				for (int j = k; (j >= 0) && (set < 0); j--) {
+					if ((j + i) % NUM_CHANNELS == ch) {
+						set = 32 + j;
+					}
+				}
+				last[i][ch] = (set < 0) ? 0 : set;
+			}
+		}
+	}
+	panels.Flush ();
+
+	for (int i = 0; i < PANELS; i++) {
+		uint8_t shown[NUM_CHANNELS] = { 0, 0, 0, 0 };
+		std::vector<Report> r = fake[i]->Reports ();
+		CHECK (r.size () >= 1);
+		CHECK (r.size () <= FRAMES);
+		for (const Report &report : r) {
+			uint8_t before[NUM_CHANNELS];
+			memcpy (before, shown, sizeof (before));
+			CHECK (Apply (report, shown));
+			for (int ch = 0; ch < NUM_CHANNELS; ch++) {
+				CHECK (shown[ch] >= before[ch]);
+			}
+		}
+		CHECK (Same (shown, last[i]));
+	}
+
+	// the slow panel fell behind and had its reports merged, but was not written to
+	// more often than there were frames
+	CHECK (fake[0]->Count () < FRAMES / 2);
+
+	Stats s = panels.GetStats ();
+	CHECK (s.frames == FRAMES);
+	CHECK (s.queued + s.merged == (uint64_t)changes);
+	CHECK (s.merged > 0);
+	CHECK (s.written == s.queued);
+	CHECK (s.written == fake[0]->Count () + fake[1]->Count () + fake[2]->Count ());
+}
+
+
+//---------------------------------------------------------------------------------------------
+// main
+//
+
+int main (int argc, char *argv[])
+{
+	(void) argv;
+
+	if (argc > 1) {
+		fprintf (stderr, "usage: gftest\n");
+		return 2;
+	}
+
+	TestFrame ();
+	TestPanels ();
+	TestOrder ();
+
+	printf ("%s, %d failed\n", failures ? "FAIL" : "pass", failures);
+
+	return failures;
+}
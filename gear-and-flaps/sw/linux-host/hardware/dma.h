@@ -0,0 +1,55 @@
+//---------------------------------------------------------------------------------------------
+// hardware/dma.h
+//
+// host stand in for the pico sdk's dma, just the calls dacdma.cpp makes. picosim.cpp runs
+// channels paced by the spi dreqs and raises DMA_IRQ_0 when one finishes.
+//
+
+#ifndef _HARDWARE_DMA_H_
+#define _HARDWARE_DMA_H_
+
+#include "pico/stdlib.h"
+
+#define NUM_DMA_CHANNELS 12
+
+enum dma_channel_transfer_size { DMA_SIZE_8 = 0, DMA_SIZE_16 = 1, DMA_SIZE_32 = 2 };
+
+typedef struct {
+	enum dma_channel_transfer_size size;
+	bool readIncrement;
+	bool writeIncrement;
+	uint dreq;
+} dma_channel_config;
+
+// interrupt status, writing a 1 clears that bit as on the rp2040
+struct DmaSimInts {
+	uint32_t bits;
+	operator uint32_t () const { return bits; }
+	DmaSimInts &operator= (uint32_t clear) { bits &= ~clear; return *this; }
+};
+
+typedef struct {
+	DmaSimInts ints0;
+} dma_hw_t;
+
+extern dma_hw_t picoSimDma;
+
+#define dma_hw (&picoSimDma)
+
+int  dma_claim_unused_channel (bool required);
+
+dma_channel_config dma_channel_get_default_config (uint channel);
+void channel_config_set_transfer_data_size (dma_channel_config *c, enum dma_channel_transfer_size size);
+void channel_config_set_read_increment     (dma_channel_config *c, bool incr);
+void channel_config_set_write_increment    (dma_channel_config *c, bool incr);
+void channel_config_set_dreq               (dma_channel_config *c, uint dreq);
+
+void dma_channel_configure        (uint channel, const dma_channel_config *config, volatile void *write_addr,
+                                   const volatile void *read_addr, uint transfer_count, bool trigger);
+void dma_channel_set_read_addr    (uint channel, const volatile void *read_addr, bool trigger);
+void dma_channel_set_trans_count  (uint channel, uint32_t trans_count, bool trigger);
+void dma_channel_set_irq0_enabled (uint channel, bool enabled);
+bool dma_channel_is_busy          (uint channel);
+void dma_start_channel_mask       (uint32_t chan_mask);
+
+#endif
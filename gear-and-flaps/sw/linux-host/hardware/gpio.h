@@ -0,0 +1,19 @@
+//---------------------------------------------------------------------------------------------
+// hardware/gpio.h
+//
+// host stand in for the pico sdk's gpio, picosim.cpp watches the chip selects
+//
+
+#ifndef _HARDWARE_GPIO_H_
+#define _HARDWARE_GPIO_H_
+
+#include "pico/stdlib.h"
+
+#define GPIO_IN  0
+#define GPIO_OUT 1
+
+void gpio_init    (uint gpio);
+void gpio_set_dir (uint gpio, bool out);
+void gpio_put     (uint gpio, bool value);
+
+#endif
@@ -0,0 +1,40 @@
+//---------------------------------------------------------------------------------------------
+// hardware/spi.h
+//
+// host stand in for the pico sdk's spi. picosim.cpp shifts the bytes the dma writes at the
+// rate spi_init sets and reads back zeros.
+//
+
+#ifndef _HARDWARE_SPI_H_
+#define _HARDWARE_SPI_H_
+
+#include "pico/stdlib.h"
+
+typedef struct {
+	volatile uint32_t dr;
+} spi_hw_t;
+
+typedef struct spi_inst {
+	spi_hw_t hw;
+	uint64_t bitNs;
+	uint64_t idleNs;     // when the last queued byte is out
+} spi_inst_t;
+
+extern struct spi_inst picoSimSpi[2];
+
+#define spi0 (&picoSimSpi[0])
+#define spi1 (&picoSimSpi[1])
+
+// dreq numbers as on the rp2040
+#define DREQ_SPI0_TX 16
+#define DREQ_SPI0_RX 17
+#define DREQ_SPI1_TX 18
+#define DREQ_SPI1_RX 19
+
+uint      spi_init        (spi_inst_t *spi, uint baudrate);
+bool      spi_is_busy     (const spi_inst_t *spi);
+bool      spi_is_readable (const spi_inst_t *spi);
+spi_hw_t *spi_get_hw      (spi_inst_t *spi);
+uint      spi_get_dreq    (spi_inst_t *spi, bool is_tx);
+
+#endif
@@ -0,0 +1,18 @@
+//---------------------------------------------------------------------------------------------
+// hardware/sync.h
+//
+// host stand in for the pico sdk's interrupt masking. picosim.cpp only runs interrupt
+// handlers from PicoSimAdvance, never in the middle of firmware code, so there is nothing
+// to hold off.
+//
+
+#ifndef _HARDWARE_SYNC_H_
+#define _HARDWARE_SYNC_H_
+
+#include <stdint.h>
+
+static inline void     __compiler_memory_barrier  (void) {}
+static inline uint32_t save_and_disable_interrupts (void) { return 0; }
+static inline void     restore_interrupts          (uint32_t status) { (void) status; }
+
+#endif
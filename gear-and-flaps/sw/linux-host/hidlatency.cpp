@@ -0,0 +1,348 @@
+//---------------------------------------------------------------------------------------------
+// notes
+//
+// hidlatency -- measure how long the usb gear and flaps indicators take to apply levels
+//
+// usage:
+//    hidlatency [-n count] [-i interval_ms] /dev/hidrawN
+//    hidlatency [-n count] [-i interval_ms] --mock
+//
+// sends report 0x03 with alternating levels on all four channels and a sequence number,
+// then waits for the matching status report 0x04. two latencies are recorded per probe:
+//
+//    host     write of report 0x03 to read of report 0x04, as seen by this program
+//    device   receipt of report 0x03 to the end of the dac write, device clock
+//
+// --mock runs against a simulated device on the other end of a socketpair instead of a
+// hidraw node, so the tool can be tried without hardware.
+//
+
+//---------------------------------------------------------------------------------------------
+// includes
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/socket.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+
+//---------------------------------------------------------------------------------------------
+// defines
+//
+
+#define PROBE_REPORT_ID     0x03
+#define PROBE_REPORT_LEN    10      // including report id
+#define STATUS_REPORT_ID    0x04
+#define STATUS_REPORT_LEN   18      // including report id
+
+#define STATUS_LATCHED      0x01
+#define STATUS_UNCHANGED    0x02
+
+#define REPLY_TIMEOUT_MS    100
+#define HISTOGRAM_BINS      20
+#define HISTOGRAM_BIN_US    250
+
+
+//---------------------------------------------------------------------------------------------
+// typedefs
+//
+
+typedef struct {
+	uint32_t seq;
+	uint32_t rxUs;
+	uint32_t latchUs;
+	uint8_t  level[4];
+	uint8_t  flags;
+} Status;
+
+
+//---------------------------------------------------------------------------------------------
+// globals
+//
+
+static std::atomic<bool> mockRun (true);
+
+
+//---------------------------------------------------------------------------------------------
+// NowUs -- monotonic time in us, wraps like the device's time_us_32
+//
+
+static uint32_t NowUs (void)
+{
+	return (uint32_t)std::chrono::duration_cast<std::chrono::microseconds> (
+		std::chrono::steady_clock::now ().time_since_epoch ()).count ();
+}
+
+
+//---------------------------------------------------------------------------------------------
+// Get32 / Put32 -- little endian fields
+//
+
+static uint32_t Get32 (const uint8_t *p)
+{
+	return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static void Put32 (uint8_t *p, uint32_t v)
+{
+	p[0] = v;
+	p[1] = v >> 8;
+	p[2] = v >> 16;
+	p[3] = v >> 24;
+}
+
+
+//---------------------------------------------------------------------------------------------
+// MockDevice -- answers report 0x03 like the firmware does: the report waits for the next
+//               1 ms poll, a dac write takes about 160 us unless the levels did not change
+//
+
+static void MockDevice (int fd)
+{
+	uint8_t level[4] = { 0, 0, 0, 0 };
+
+	while (mockRun) {
+		uint8_t rx[64];
+		struct pollfd pfd = { fd, POLLIN, 0 };
+
+		if (poll (&pfd, 1, 10) <= 0) {
+			continue;
+		}
+		ssize_t n = read (fd, rx, sizeof (rx));
+		if (n <= 0) {
+			break;
+		}
+		if ((n != PROBE_REPORT_LEN) || (rx[0] != PROBE_REPORT_ID)) {
+			continue;
+		}
+
+		// interrupt out endpoint polled every ms
+		std::this_thread::sleep_for (std::chrono::microseconds (200 + rand () % 800));
+		uint32_t rxUs = NowUs ();
+
+		bool changed = false;
+		for (int ch = 0; ch < 4; ch++) {
+			if ((rx[1] & (0x80 >> ch)) && (level[ch] != rx[2 + ch])) {
+				level[ch] = rx[2 + ch];
+				changed = true;
+			}
+		}
+
+		uint8_t tx[STATUS_REPORT_LEN];
+		uint32_t latchUs = rxUs;
+		if (changed) {
+			std::this_thread::sleep_for (std::chrono::microseconds (140 + rand () % 40));
+			latchUs = NowUs ();
+		}
+		tx[0] = STATUS_REPORT_ID;
+		memcpy (&tx[1], &rx[6], 4);
+		Put32 (&tx[5], rxUs);
+		Put32 (&tx[9], latchUs);
+		memcpy (&tx[13], level, 4);
+		tx[17] = changed ? STATUS_LATCHED : (STATUS_LATCHED | STATUS_UNCHANGED);
+
+		// interrupt in endpoint polled every ms
+		std::this_thread::sleep_for (std::chrono::microseconds (rand () % 1000));
+		if (write (fd, tx, sizeof (tx)) < 0) {
+			break;
+		}
+	}
+}
+
+
+//---------------------------------------------------------------------------------------------
+// WaitStatus -- read reports until the status of seq arrives, false on timeout
+//
+
+static bool WaitStatus (int fd, uint32_t seq, Status *status)
+{
+	uint32_t start = NowUs ();
+
+	while (1) {
+		uint8_t rx[64];
+		int32_t left = REPLY_TIMEOUT_MS - (int32_t)((NowUs () - start) / 1000);
+		struct pollfd pfd = { fd, POLLIN, 0 };
+
+		if (left <= 0) {
+			return false;
+		}
+		int r = poll (&pfd, 1, left);
+		if (r < 0 && errno != EINTR) {
+			perror ("poll");
+			return false;
+		}
+		if (r <= 0) {
+			continue;
+		}
+
+		ssize_t n = read (fd, rx, sizeof (rx));
+		if (n < 0) {
+			perror ("read");
+			return false;
+		}
+
+		// status of an older probe that timed out, keep waiting
+		if ((n != STATUS_REPORT_LEN) || (rx[0] != STATUS_REPORT_ID) || (Get32 (&rx[1]) != seq)) {
+			continue;
+		}
+
+		status->seq = seq;
+		status->rxUs = Get32 (&rx[5]);
+		status->latchUs = Get32 (&rx[9]);
+		memcpy (status->level, &rx[13], 4);
+		status->flags = rx[17];
+		return true;
+	}
+}
+
+
+//---------------------------------------------------------------------------------------------
+// PrintDistribution
+//
+
+static void PrintDistribution (const char *name, std::vector<uint32_t> &us)
+{
+	if (us.empty ()) {
+		printf ("%s: no samples\n", name);
+		return;
+	}
+
+	std::sort (us.begin (), us.end ());
+
+	double sum = 0;
+	for (uint32_t v : us) {
+		sum += v;
+	}
+	auto pct = [&us] (double p) { return us[(size_t)(p * (us.size () - 1) + 0.5)]; };
+
+	printf ("\n%s latency, %zu samples (us)\n", name, us.size ());
+	printf ("    min %u  p50 %u  p90 %u  p99 %u  max %u  mean %.1f\n",
+		us.front (), pct (0.50), pct (0.90), pct (0.99), us.back (), sum / us.size ());
+
+	uint32_t bins[HISTOGRAM_BINS] = { 0 };
+	uint32_t most = 0;
+	for (uint32_t v : us) {
+		uint32_t b = std::min<uint32_t> (v / HISTOGRAM_BIN_US, HISTOGRAM_BINS - 1);
+		most = std::max (most, ++bins[b]);
+	}
+	for (int b = 0; b < HISTOGRAM_BINS; b++) {
+		if (bins[b] == 0) {
+			continue;
+		}
+		int bar = (int)((bins[b] * 50 + most - 1) / most);
+		printf ("    %5u%s %6u %.*s\n", b * HISTOGRAM_BIN_US, (b == HISTOGRAM_BINS - 1) ? "+" : " ",
+			bins[b], bar, "##################################################");
+	}
+}
+
+
+//---------------------------------------------------------------------------------------------
+// main
+//
+
+int main (int argc, char *argv[])
+{
+	int count = 1000;
+	int interval_ms = 10;
+	const char *path = NULL;
+	bool mock = false;
+
+	for (int i = 1; i < argc; i++) {
+		if (!strcmp (argv[i], "-n") && (i + 1 < argc)) {
+			count = atoi (argv[++i]);
+		} else if (!strcmp (argv[i], "-i") && (i + 1 < argc)) {
+			interval_ms = atoi (argv[++i]);
+		} else if (!strcmp (argv[i], "--mock")) {
+			mock = true;
+		} else if (argv[i][0] != '-') {
+			path = argv[i];
+		} else {
+			path = NULL;
+			mock = false;
+			break;
+		}
+	}
+	if (!mock && !path) {
+		fprintf (stderr, "usage: %s [-n count] [-i interval_ms] /dev/hidrawN | --mock\n", argv[0]);
+		return 1;
+	}
+
+	// open the device or start the mock
+	int fd;
+	std::thread mockThread;
+	if (mock) {
+		int sv[2];
+		if (socketpair (AF_UNIX, SOCK_SEQPACKET, 0, sv) < 0) {
+			perror ("socketpair");
+			return 1;
+		}
+		fd = sv[0];
+		mockThread = std::thread (MockDevice, sv[1]);
+	} else {
+		fd = open (path, O_RDWR);
+		if (fd < 0) {
+			perror (path);
+			return 1;
+		}
+	}
+
+	std::vector<uint32_t> hostUs, deviceUs;
+	int lost = 0, unchanged = 0;
+
+	for (int i = 0; i < count; i++) {
+		uint8_t tx[PROBE_REPORT_LEN];
+		uint32_t seq = (uint32_t)i;
+		uint8_t level = (i & 1) ? 224 : 32;   // alternate so every probe writes the dacs
+		Status status;
+
+		tx[0] = PROBE_REPORT_ID;
+		tx[1] = 0xF0;
+		memset (&tx[2], level, 4);
+		Put32 (&tx[6], seq);
+
+		uint32_t sent = NowUs ();
+		if (write (fd, tx, sizeof (tx)) != sizeof (tx)) {
+			perror ("write");
+			break;
+		}
+		if (!WaitStatus (fd, seq, &status)) {
+			lost++;
+			continue;
+		}
+		hostUs.push_back (NowUs () - sent);
+
+		if (status.flags & STATUS_UNCHANGED) {
+			unchanged++;
+		} else if (status.flags & STATUS_LATCHED) {
+			deviceUs.push_back (status.latchUs - status.rxUs);
+		}
+
+		if (interval_ms > 0) {
+			std::this_thread::sleep_for (std::chrono::milliseconds (interval_ms));
+		}
+	}
+
+	printf ("%d probes, %d lost, %d with levels already set\n", count, lost, unchanged);
+	PrintDistribution ("host round trip", hostUs);
+	PrintDistribution ("device receive to latch", deviceUs);
+
+	if (mock) {
+		mockRun = false;
+		mockThread.join ();
+	}
+	close (fd);
+
+	return 0;
+}
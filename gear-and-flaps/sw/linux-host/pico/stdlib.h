@@ -0,0 +1,20 @@
+//---------------------------------------------------------------------------------------------
+// pico/stdlib.h
+//
+// host stand in for the pico sdk header, just what the gear and flaps firmware modules use
+// so they build into floodtest. time is picosim.cpp's simulated clock, see picosim.h.
+//
+
+#ifndef _PICO_STDLIB_H_
+#define _PICO_STDLIB_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "hardware/sync.h"
+
+typedef unsigned int uint;
+
+uint32_t time_us_32 (void);
+
+#endif
@@ -0,0 +1,394 @@
+//---------------------------------------------------------------------------------------------
+// picosim.cpp
+//
+// the rp2040 gpio, spi, dma and interrupt calls the gear and flaps firmware makes, see
+// picosim.h
+//
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "pico/stdlib.h"
+
+#include "hardware/gpio.h"
+#include "hardware/spi.h"
+#include "hardware/dma.h"
+#include "hardware/irq.h"
+
+#include "picosim.h"
+
+
+//---------------------------------------------------------------------------------------------
+// defines
+//
+
+#define NUM_PINS 30
+
+
+//---------------------------------------------------------------------------------------------
+// typedefs
+//
+
+typedef struct {
+	bool     claimed;
+	bool     busy;
+	bool     irq0;
+	dma_channel_config config;
+	volatile void *write;
+	const volatile void *read;
+	uint32_t count;
+	uint64_t doneNs;
+} Channel;
+
+typedef struct {
+	int      bus;        // -1 if not a chip select
+	bool     level;
+	int      bytes;      // bytes shifted while low
+	uint16_t word;
+} Pin;
+
+
+//---------------------------------------------------------------------------------------------
+// globals
+//
+
+struct spi_inst picoSimSpi[2];
+dma_hw_t picoSimDma;
+
+static Channel chan[NUM_DMA_CHANNELS];
+static Pin pin[NUM_PINS];
+static bool pinsInit = false;
+
+static irq_handler_t dmaHandler = 0;
+static bool dmaIrqEnabled = false;
+
+static PicoSimLatchFn latchFn = 0;
+static uint64_t nowNs = 0;
+static uint32_t errors = 0;
+
+
+//---------------------------------------------------------------------------------------------
+// host controls
+//
+
+static void InitPins (void)
+{
+	if (!pinsInit) {
+		for (int i = 0; i < NUM_PINS; i++) {
+			pin[i].bus = -1;
+			pin[i].level = true;
+		}
+		pinsInit = true;
+	}
+}
+
+void PicoSimCsPin (uint gpio, uint bus)
+{
+	InitPins ();
+	pin[gpio].bus = bus;
+	pin[gpio].level = true;
+}
+
+void PicoSimOnLatch (PicoSimLatchFn fn)
+{
+	latchFn = fn;
+}
+
+uint64_t PicoSimNs (void)
+{
+	return nowNs;
+}
+
+uint32_t PicoSimErrors (void)
+{
+	return errors;
+}
+
+uint32_t time_us_32 (void)
+{
+	return nowNs / 1000;
+}
+
+
+//---------------------------------------------------------------------------------------------
+// gpio
+//
+
+void gpio_init (uint gpio)
+{
+	(void) gpio;
+	InitPins ();
+}
+
+void gpio_set_dir (uint gpio, bool out)
+{
+	(void) gpio;
+	(void) out;
+}
+
+void gpio_put (uint gpio, bool value)
+{
+	InitPins ();
+	Pin *p = &pin[gpio];
+
+	if (p->bus >= 0) {
+		if (!p->level && value) {
+			if ((nowNs < picoSimSpi[p->bus].idleNs) || (p->bytes != 2)) {
+				errors++;
+			} else if (latchFn) {
+				latchFn (gpio, p->word, nowNs);
+			}
+		} else if (p->level && !value) {
+			p->bytes = 0;
+			p->word = 0;
+		}
+	}
+	p->level = value;
+}
+
+
+//---------------------------------------------------------------------------------------------
+// spi
+//
+
+uint spi_init (spi_inst_t *spi, uint baudrate)
+{
+	spi->bitNs = 1000000000ull / baudrate;
+	spi->idleNs = 0;
+	return baudrate;
+}
+
+bool spi_is_busy (const spi_inst_t *spi)
+{
+	return nowNs < spi->idleNs;
+}
+
+bool spi_is_readable (const spi_inst_t *spi)
+{
+	(void) spi;
+	return false;
+}
+
+spi_hw_t *spi_get_hw (spi_inst_t *spi)
+{
+	return &spi->hw;
+}
+
+uint spi_get_dreq (spi_inst_t *spi, bool is_tx)
+{
+	return DREQ_SPI0_TX + 2 * (spi - picoSimSpi) + (is_tx ? 0 : 1);
+}
+
+
+//---------------------------------------------------------------------------------------------
+// Shift -- queue one byte on a bus and into the frame of every chip select low on it
+//
+
+static void Shift (int bus, uint8_t byte)
+{
+	spi_inst_t *spi = &picoSimSpi[bus];
+
+	if (spi->idleNs < nowNs) {
+		spi->idleNs = nowNs;
+	}
+	spi->idleNs += 8 * spi->bitNs;
+
+	for (int i = 0; i < NUM_PINS; i++) {
+		if ((pin[i].bus == bus) && !pin[i].level) {
+			pin[i].word = (pin[i].word << 8) | byte;
+			pin[i].bytes++;
+		}
+	}
+}
+
+
+//---------------------------------------------------------------------------------------------
+// dma
+//
+
+int dma_claim_unused_channel (bool required)
+{
+	for (int i = 0; i < NUM_DMA_CHANNELS; i++) {
+		if (!chan[i].claimed) {
+			chan[i].claimed = true;
+			return i;
+		}
+	}
+	if (required) {
+		fprintf (stderr, "picosim: out of dma channels\n");
+	}
+	return -1;
+}
+
+dma_channel_config dma_channel_get_default_config (uint channel)
+{
+	(void) channel;
+	dma_channel_config c = { DMA_SIZE_32, true, false, 0 };
+	return c;
+}
+
+void channel_config_set_transfer_data_size (dma_channel_config *c, enum dma_channel_transfer_size size)
+{
+	c->size = size;
+}
+
+void channel_config_set_read_increment (dma_channel_config *c, bool incr)
+{
+	c->readIncrement = incr;
+}
+
+void channel_config_set_write_increment (dma_channel_config *c, bool incr)
+{
+	c->writeIncrement = incr;
+}
+
+void channel_config_set_dreq (dma_channel_config *c, uint dreq)
+{
+	c->dreq = dreq;
+}
+
+void dma_channel_configure (uint channel, const dma_channel_config *config, volatile void *write_addr,
+		const volatile void *read_addr, uint transfer_count, bool trigger)
+{
+	chan[channel].config = *config;
+	chan[channel].write = write_addr;
+	chan[channel].read = read_addr;
+	chan[channel].count = transfer_count;
+	if (trigger) {
+		dma_start_channel_mask (1u << channel);
+	}
+}
+
+void dma_channel_set_read_addr (uint channel, const volatile void *read_addr, bool trigger)
+{
+	chan[channel].read = read_addr;
+	if (trigger) {
+		dma_start_channel_mask (1u << channel);
+	}
+}
+
+void dma_channel_set_trans_count (uint channel, uint32_t trans_count, bool trigger)
+{
+	chan[channel].count = trans_count;
+	if (trigger) {
+		dma_start_channel_mask (1u << channel);
+	}
+}
+
+void dma_channel_set_irq0_enabled (uint channel, bool enabled)
+{
+	chan[channel].irq0 = enabled;
+}
+
+bool dma_channel_is_busy (uint channel)
+{
+	return chan[channel].busy;
+}
+
+
+//---------------------------------------------------------------------------------------------
+// dma_start_channel_mask -- only 8 bit spi transfers are modelled. a tx channel hands all
+//                           its bytes to the spi fifo at once and is done, an rx channel
+//                           finishes when the last byte queued on its bus is shifted
+//
+
+void dma_start_channel_mask (uint32_t chan_mask)
+{
+	// tx channels first, the rx channels wait on what they queued
+	for (int pass = 0; pass < 2; pass++) {
+		for (int i = 0; i < NUM_DMA_CHANNELS; i++) {
+			Channel *c = &chan[i];
+			if (!(chan_mask & (1u << i)) || (c->config.dreq < DREQ_SPI0_TX) || (c->config.dreq > DREQ_SPI1_RX)) {
+				continue;
+			}
+			int bus = (c->config.dreq - DREQ_SPI0_TX) / 2;
+			bool tx = ((c->config.dreq - DREQ_SPI0_TX) % 2) == 0;
+			if (tx != (pass == 0)) {
+				continue;
+			}
+			if (c->config.size != DMA_SIZE_8) {
+				errors++;
+				continue;
+			}
+
+			c->busy = true;
+			if (tx) {
+				const volatile uint8_t *src = (const volatile uint8_t *)c->read;
+				for (uint32_t n = 0; n < c->count; n++) {
+					Shift (bus, c->config.readIncrement ? src[n] : src[0]);
+				}
+				c->doneNs = nowNs;
+			} else {
+				c->doneNs = (picoSimSpi[bus].idleNs > nowNs) ? picoSimSpi[bus].idleNs : nowNs;
+			}
+		}
+	}
+}
+
+
+//---------------------------------------------------------------------------------------------
+// irq
+//
+
+void irq_set_exclusive_handler (uint num, irq_handler_t handler)
+{
+	if (num == DMA_IRQ_0) {
+		dmaHandler = handler;
+	}
+}
+
+void irq_set_enabled (uint num, bool enabled)
+{
+	if (num == DMA_IRQ_0) {
+		dmaIrqEnabled = enabled;
+	}
+}
+
+
+//---------------------------------------------------------------------------------------------
+// PicoSimAdvance -- run the clock on, finishing channels in time order
+//
+
+void PicoSimAdvance (uint32_t us)
+{
+	uint64_t endNs = nowNs + 1000ull * us;
+
+	while (1) {
+		int next = -1;
+		for (int i = 0; i < NUM_DMA_CHANNELS; i++) {
+			if (chan[i].busy && (chan[i].doneNs <= endNs) && ((next < 0) || (chan[i].doneNs < chan[next].doneNs))) {
+				next = i;
+			}
+		}
+		if (next < 0) {
+			break;
+		}
+
+		Channel *c = &chan[next];
+		if (c->doneNs > nowNs) {
+			nowNs = c->doneNs;
+		}
+		c->busy = false;
+		if (((c->config.dreq - DREQ_SPI0_TX) % 2) == 1) {
+			volatile uint8_t *dst = (volatile uint8_t *)c->write;
+			for (uint32_t n = 0; n < c->count; n++) {
+				dst[c->config.writeIncrement ? n : 0] = 0;
+			}
+		}
+		if (c->irq0) {
+			picoSimDma.ints0.bits |= 1u << next;
+		}
+
+		// the handler has to clear what it was called for or it would be called forever
+		if (dmaIrqEnabled && dmaHandler && picoSimDma.ints0.bits) {
+			dmaHandler ();
+			if (picoSimDma.ints0.bits) {
+				errors++;
+				picoSimDma.ints0.bits = 0;
+			}
+		}
+	}
+
+	nowNs = endNs;
+}
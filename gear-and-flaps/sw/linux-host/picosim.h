@@ -0,0 +1,32 @@
+//---------------------------------------------------------------------------------------------
+// picosim.h
+//
+// host only controls of picosim.cpp, the simulated rp2040 under the firmware modules
+//
+// time stands still until PicoSimAdvance runs it on. on the way it finishes dma channels at
+// the time their spi bytes have been shifted and calls the DMA_IRQ_0 handler, so the
+// firmware sees its interrupts between two calls from the host tool's main loop, never in
+// the middle of one.
+//
+// PicoSimCsPin ties a chip select to a bus. the bytes shifted while it is low make up a
+// frame, and when it goes high a 16 bit frame is handed to the latch function with the
+// time, the way a tlv5626 latches its word. raising a chip select while its bus is still
+// shifting, or on a frame that is not 16 bits, counts an error.
+//
+
+#ifndef _PICOSIM_H_
+#define _PICOSIM_H_
+
+#include <stdint.h>
+
+#include "pico/stdlib.h"
+
+typedef void (*PicoSimLatchFn) (uint pin, uint16_t word, uint64_t ns);
+
+void     PicoSimCsPin   (uint pin, uint bus);
+void     PicoSimOnLatch (PicoSimLatchFn fn);
+void     PicoSimAdvance (uint32_t us);
+uint64_t PicoSimNs      (void);
+uint32_t PicoSimErrors  (void);
+
+#endif
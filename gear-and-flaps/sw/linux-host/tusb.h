@@ -0,0 +1,46 @@
+//---------------------------------------------------------------------------------------------
+// tusb.h
+//
+// host mock of the tinyusb device calls transport_hid.cpp makes, see tusbsim.cpp
+//
+// the host side queues output reports with TusbSimOut. tud_task hands them to
+// tud_hid_set_report_cb the way tinyusb does for the interrupt out endpoint, report id 0
+// with the id in the buffer, at most one per polling interval. input reports the firmware
+// sends are kept for TusbSimIn, the in endpoint is ready again one interval after each.
+//
+
+#ifndef _TUSB_H_
+#define _TUSB_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef enum {
+	HID_REPORT_TYPE_INVALID = 0,
+	HID_REPORT_TYPE_INPUT,
+	HID_REPORT_TYPE_OUTPUT,
+	HID_REPORT_TYPE_FEATURE
+} hid_report_type_t;
+
+bool tusb_init      (void);
+void tud_task       (void);
+bool tud_hid_ready  (void);
+bool tud_hid_report (uint8_t report_id, void const *report, uint16_t len);
+
+// callbacks the firmware provides
+void     tud_mount_cb          (void);
+void     tud_umount_cb         (void);
+void     tud_suspend_cb        (bool remote_wakeup_en);
+void     tud_resume_cb         (void);
+uint16_t tud_hid_get_report_cb (uint8_t itf, uint8_t report_id, hid_report_type_t report_type,
+                                uint8_t *buffer, uint16_t reqlen);
+void     tud_hid_set_report_cb (uint8_t itf, uint8_t report_id, hid_report_type_t report_type,
+                                uint8_t const *buffer, uint16_t bufsize);
+
+// host only, polling interval, reports to the device and reports back, with the id first
+void     TusbSimInterval (uint32_t us);
+void     TusbSimOut      (const uint8_t *report, uint16_t len);
+uint32_t TusbSimOutQueued (void);
+bool     TusbSimIn       (uint8_t *report, uint16_t *len);
+
+#endif
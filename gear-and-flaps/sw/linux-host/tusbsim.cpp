@@ -0,0 +1,105 @@
+//---------------------------------------------------------------------------------------------
+// tusbsim.cpp
+//
+// mock tinyusb device, see tusb.h
+//
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include <deque>
+#include <vector>
+
+#include "pico/stdlib.h"
+
+#include "tusb.h"
+
+
+//---------------------------------------------------------------------------------------------
+// globals
+//
+
+static std::deque<std::vector<uint8_t>> outQueue;
+static std::deque<std::vector<uint8_t>> inQueue;
+static uint32_t intervalUs = 1000;
+static uint32_t lastOutUs = 0;
+static uint32_t lastInUs = 0;
+static bool outSent = false;
+static bool inSent = false;
+
+
+//---------------------------------------------------------------------------------------------
+// host side
+//
+
+void TusbSimInterval (uint32_t us)
+{
+	intervalUs = us;
+}
+
+void TusbSimOut (const uint8_t *report, uint16_t len)
+{
+	outQueue.push_back (std::vector<uint8_t> (report, report + len));
+}
+
+uint32_t TusbSimOutQueued (void)
+{
+	return outQueue.size ();
+}
+
+bool TusbSimIn (uint8_t *report, uint16_t *len)
+{
+	if (inQueue.empty ()) {
+		return false;
+	}
+	memcpy (report, inQueue.front ().data (), inQueue.front ().size ());
+	*len = inQueue.front ().size ();
+	inQueue.pop_front ();
+	return true;
+}
+
+
+//---------------------------------------------------------------------------------------------
+// device side
+//
+
+bool tusb_init (void)
+{
+	tud_mount_cb ();
+	return true;
+}
+
+void tud_task (void)
+{
+	uint32_t now = time_us_32 ();
+
+	if (outQueue.empty () || (outSent && (now - lastOutUs < intervalUs))) {
+		return;
+	}
+
+	std::vector<uint8_t> report = outQueue.front ();
+	outQueue.pop_front ();
+	lastOutUs = now;
+	outSent = true;
+	tud_hid_set_report_cb (0, 0, HID_REPORT_TYPE_INVALID, report.data (), report.size ());
+}
+
+bool tud_hid_ready (void)
+{
+	return !inSent || (time_us_32 () - lastInUs >= intervalUs);
+}
+
+bool tud_hid_report (uint8_t report_id, void const *report, uint16_t len)
+{
+	if (!tud_hid_ready ()) {
+		return false;
+	}
+
+	std::vector<uint8_t> r (1, report_id);
+	r.insert (r.end (), (const uint8_t *)report, (const uint8_t *)report + len);
+	inQueue.push_back (r);
+	lastInUs = time_us_32 ();
+	inSent = true;
+	return true;
+}
@@ -0,0 +1,157 @@
+//---------------------------------------------------------------------------------------------
+// curves.h
+//
+// brightness correction tables for the indicator lamps, built at compile time
+//
+// a Curve maps a level from the reports or the cli to the dac A code written for it, so the
+// write path costs one table lookup. 0 stays 0 (off) and the ends of the 32 to 224 range
+// stay where they are, only the steps in between move.
+//
+//    LinearCurve ()            code = level, what the firmware always did
+//    GammaCurve (g)            code follows (level fraction)^g, 2.2 is the usual choice
+//    PerceptualCurve (points)  equal level steps give equal steps in perceived lightness
+//                              (cie L*) on a lamp whose light output was measured at a few
+//                              dac codes, see indicators.cpp, whose points are still
+//                              placeholders
+//
+// the math is done in constexpr helpers because std::pow and friends are not constexpr.
+//
+
+#ifndef _CURVES_H_
+#define _CURVES_H_
+
+#include <stdint.h>
+
+#define CURVE_LEVEL_MIN 32
+#define CURVE_LEVEL_MAX 224
+
+typedef struct {
+	uint8_t code[256];
+} Curve;
+
+typedef struct {
+	uint8_t code;         // dac A code
+	float   output;       // light output at that code, any unit
+} CurvePoint;
+
+
+//---------------------------------------------------------------------------------------------
+// constexpr math
+//
+
+namespace curve_math {
+
+constexpr double Ln (double x)
+{
+	// bring x into [0.5, 1) then 2 atanh ((x-1)/(x+1))
+	const double LN2 = 0.69314718055994530942;
+	int k = 0;
+	while (x >= 1.0) { x *= 0.5; k++; }
+	while (x < 0.5)  { x *= 2.0; k--; }
+	double z = (x - 1.0) / (x + 1.0), z2 = z * z, term = z, sum = 0;
+	for (int n = 1; n < 60; n += 2) {
+		sum += term / n;
+		term *= z2;
+	}
+	return 2.0 * sum + k * LN2;
+}
+
+constexpr double Exp (double y)
+{
+	// halve y until it is small, sum the series, square back up
+	int k = 0;
+	while (y > 0.5 || y < -0.5) { y *= 0.5; k++; }
+	double sum = 1.0, term = 1.0;
+	for (int n = 1; n < 20; n++) {
+		term *= y / n;
+		sum += term;
+	}
+	while (k-- > 0) {
+		sum *= sum;
+	}
+	return sum;
+}
+
+constexpr double Pow (double x, double g)
+{
+	return (x <= 0.0) ? 0.0 : Exp (g * Ln (x));
+}
+
+// cie 1976 lightness L* (0 to 1) to relative luminance
+constexpr double LightnessToLuminance (double l)
+{
+	double f = (100.0 * l + 16.0) / 116.0;
+	return (l > 0.08) ? f * f * f : l * 100.0 / 903.3;
+}
+
+constexpr uint8_t Round (double x)
+{
+	return (x <= 0.0) ? 0 : (x >= 255.0) ? 255 : (uint8_t)(x + 0.5);
+}
+
+}
+
+
+//---------------------------------------------------------------------------------------------
+// curve builders
+//
+
+// fill in a curve from a function of the level fraction, 0 to 1 across 32 to 224
+template <class F>
+constexpr Curve MakeCurve (F f)
+{
+	Curve c = {};
+	const double span = CURVE_LEVEL_MAX - CURVE_LEVEL_MIN;
+	for (int level = 1; level < 256; level++) {
+		int l = (level < CURVE_LEVEL_MIN) ? CURVE_LEVEL_MIN : (level > CURVE_LEVEL_MAX) ? CURVE_LEVEL_MAX : level;
+		double t = (l - CURVE_LEVEL_MIN) / span;
+		c.code[level] = curve_math::Round (CURVE_LEVEL_MIN + span * f (t));
+	}
+	c.code[0] = 0;
+	return c;
+}
+
+constexpr Curve LinearCurve (void)
+{
+	return MakeCurve ([] (double t) { return t; });
+}
+
+constexpr Curve GammaCurve (double g)
+{
+	return MakeCurve ([g] (double t) { return curve_math::Pow (t, g); });
+}
+
+// points sorted by code with output rising, from code 32 to code 224
+template <int N>
+constexpr Curve PerceptualCurve (const CurvePoint (&p)[N])
+{
+	static_assert (N >= 2, "need at least two measured points");
+	return MakeCurve ([&p] (double t) {
+		// luminance wanted, scaled between the first and last measured outputs
+		double y = p[0].output + (p[N-1].output - p[0].output) * curve_math::LightnessToLuminance (t);
+		// invert the measured curve by linear interpolation
+		for (int i = 1; i < N; i++) {
+			if ((y <= p[i].output) || (i == N - 1)) {
+				double dy = p[i].output - p[i-1].output;
+				double u = (dy > 0) ? (y - p[i-1].output) / dy : 0.0;
+				double code = p[i-1].code + u * (p[i].code - p[i-1].code);
+				return (code - CURVE_LEVEL_MIN) / (CURVE_LEVEL_MAX - CURVE_LEVEL_MIN);
+			}
+		}
+		return 1.0;
+	});
+}
+
+// true when the codes never fall as the level rises and the ends are in place
+constexpr bool CurveValid (const Curve &c)
+{
+	for (int level = 2; level < 256; level++) {
+		if (c.code[level] < c.code[level - 1]) {
+			return false;
+		}
+	}
+	return (c.code[0] == 0) && (c.code[CURVE_LEVEL_MIN] == CURVE_LEVEL_MIN) &&
+		(c.code[CURVE_LEVEL_MAX] == CURVE_LEVEL_MAX);
+}
+
+#endif
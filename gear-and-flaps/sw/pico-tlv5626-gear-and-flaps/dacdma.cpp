@@ -0,0 +1,299 @@
+//---------------------------------------------------------------------------------------------
+// dacdma.cpp
+//
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "pico/stdlib.h"
+
+#include "hardware/gpio.h"
+#include "hardware/spi.h"
+#include "hardware/dma.h"
+#include "hardware/irq.h"
+#include "hardware/sync.h"
+
+#include "dac/dac.h"
+
+#include "dacdma.h"
+
+
+//---------------------------------------------------------------------------------------------
+// defines
+//
+
+// flush phases, a slot is one chip on each bus
+enum {
+	PHASE_IDLE = 0,
+	PHASE_B_SLOT0,
+	PHASE_B_SLOT1,
+	PHASE_A_SLOT0,
+	PHASE_A_SLOT1,
+	PHASE_DONE
+};
+
+
+//---------------------------------------------------------------------------------------------
+// globals
+//
+
+static spi_inst_t *const dacSpi[2] = { spi0, spi1 };
+static uint dacCsPin[DAC_NUM_CHIPS];
+static int  txChan[2];
+static int  rxChan[2];
+static uint8_t rxDiscard[2];
+
+// pending levels set by DacSetLevel
+static uint8_t pendingLevel[DAC_NUM_CHIPS];
+static uint8_t pendingMask = 0;
+static uint8_t shadowLevel[DAC_NUM_CHIPS];   // level each chip holds
+static uint32_t pendingSince = 0;
+static uint32_t flushSince = 0;
+static uint32_t flushLevels = 0;
+static DacStats dacStats;
+
+// flush in progress, DacTask starts it and DacDmaIrq runs it to the end
+static uint8_t flushMask = 0;
+static volatile uint8_t flushPhase = PHASE_IDLE;
+static uint8_t txB[DAC_NUM_CHIPS][2];
+static uint8_t txA[DAC_NUM_CHIPS][2];
+static uint8_t activeMask = 0;
+
+
+//---------------------------------------------------------------------------------------------
+// prototypes
+//
+
+static void DacDmaIrq (void);
+
+
+//---------------------------------------------------------------------------------------------
+// DacDmaInit -- csPins are the chip selects of chips 0 to 3
+//
+
+void DacDmaInit (const uint *csPins)
+{
+	for (int i = 0; i < DAC_NUM_CHIPS; i++) {
+		dacCsPin[i] = csPins[i];
+		shadowLevel[i] = 0;
+	}
+
+	// a tx channel feeds each bus and an rx channel takes back what was clocked in. the
+	// rx channel only finishes once the last bit is out, so its interrupt is the end of
+	// the transfer on the wire, the tx channel finishes with 16 bits still to shift
+	for (int bus = 0; bus < 2; bus++) {
+		txChan[bus] = dma_claim_unused_channel (true);
+		dma_channel_config c = dma_channel_get_default_config (txChan[bus]);
+		channel_config_set_transfer_data_size (&c, DMA_SIZE_8);
+		channel_config_set_read_increment (&c, true);
+		channel_config_set_write_increment (&c, false);
+		channel_config_set_dreq (&c, spi_get_dreq (dacSpi[bus], true));
+		dma_channel_configure (txChan[bus], &c, &spi_get_hw (dacSpi[bus])->dr, NULL, 2, false);
+
+		rxChan[bus] = dma_claim_unused_channel (true);
+		c = dma_channel_get_default_config (rxChan[bus]);
+		channel_config_set_transfer_data_size (&c, DMA_SIZE_8);
+		channel_config_set_read_increment (&c, false);
+		channel_config_set_write_increment (&c, false);
+		channel_config_set_dreq (&c, spi_get_dreq (dacSpi[bus], false));
+		dma_channel_configure (rxChan[bus], &c, &rxDiscard[bus], &spi_get_hw (dacSpi[bus])->dr, 2, false);
+		dma_channel_set_irq0_enabled (rxChan[bus], true);
+
+		// whatever the start up writes left behind
+		while (spi_is_readable (dacSpi[bus])) {
+			(void) spi_get_hw (dacSpi[bus])->dr;
+		}
+	}
+	irq_set_exclusive_handler (DMA_IRQ_0, DacDmaIrq);
+	irq_set_enabled (DMA_IRQ_0, true);
+}
+
+
+//---------------------------------------------------------------------------------------------
+// DacSetLevel
+//
+// record a new level for a chip. 0 powers the indicator down, otherwise dac A gets the
+// level and dac B its complement.
+//
+
+void DacSetLevel (uint8_t chip, uint8_t level)
+{
+	if (pendingMask == 0) {
+		pendingSince = time_us_32 ();
+	}
+	if (pendingMask & (1 << chip)) {
+		dacStats.coalesced++;
+	}
+	dacStats.levels++;
+
+	pendingLevel[chip] = level;
+	pendingMask |= 1 << chip;
+}
+
+
+//---------------------------------------------------------------------------------------------
+// DacGetStats
+//
+
+void DacGetStats (DacStats *stats)
+{
+	// the interrupt writes latched, latchUs and maxFlushUs at the end of a flush
+	uint32_t save = save_and_disable_interrupts ();
+	*stats = dacStats;
+	restore_interrupts (save);
+}
+
+
+//---------------------------------------------------------------------------------------------
+// DacBusy
+//
+
+bool DacBusy (void)
+{
+	return (flushPhase != PHASE_IDLE) || (pendingMask != 0);
+}
+
+
+//---------------------------------------------------------------------------------------------
+// StartPhase -- drop the chip selects for this phase and start the dma on both buses,
+//               false if no chip in the phase has anything to write
+//
+
+static bool StartPhase (void)
+{
+	uint32_t chanMask = 0;
+	uint8_t slot = (flushPhase == PHASE_B_SLOT0 || flushPhase == PHASE_A_SLOT0) ? 0 : 1;
+	bool isA = (flushPhase >= PHASE_A_SLOT0);
+
+	activeMask = 0;
+	for (int bus = 0; bus < 2; bus++) {
+		uint8_t chip = 2*bus + slot;
+		if (flushMask & (1 << chip)) {
+			activeMask |= 1 << chip;
+			gpio_put (dacCsPin[chip], 0);
+			dma_channel_set_read_addr (txChan[bus], isA ? txA[chip] : txB[chip], false);
+			dma_channel_set_trans_count (txChan[bus], 2, false);
+			dma_channel_set_trans_count (rxChan[bus], 2, false);
+			chanMask |= (1u << txChan[bus]) | (1u << rxChan[bus]);
+		}
+	}
+
+	// both buses start together
+	if (chanMask) {
+		dma_start_channel_mask (chanMask);
+	}
+
+	return chanMask != 0;
+}
+
+
+//---------------------------------------------------------------------------------------------
+// NextPhase -- start the next phase with something to write, or finish the flush
+//
+
+static void NextPhase (void)
+{
+	while (++flushPhase != PHASE_DONE) {
+		if (StartPhase ()) {
+			return;
+		}
+	}
+
+	flushPhase = PHASE_IDLE;
+	dacStats.latchUs = time_us_32 ();
+	dacStats.latched = flushLevels;
+	uint32_t elapsed = dacStats.latchUs - flushSince;
+	if (elapsed > dacStats.maxFlushUs) {
+		dacStats.maxFlushUs = elapsed;
+	}
+}
+
+
+//---------------------------------------------------------------------------------------------
+// DacDmaIrq -- an rx channel has finished, once both buses of the phase are done raise
+//              the chip selects, which latches the words, and go straight on to the next
+//              phase
+//
+
+static void DacDmaIrq (void)
+{
+	for (int bus = 0; bus < 2; bus++) {
+		if (dma_hw->ints0 & (1u << rxChan[bus])) {
+			dma_hw->ints0 = 1u << rxChan[bus];
+		}
+	}
+
+	if (flushPhase == PHASE_IDLE) {
+		return;
+	}
+	for (int bus = 0; bus < 2; bus++) {
+		if ((activeMask & (3 << (2*bus))) && dma_channel_is_busy (rxChan[bus])) {
+			return;
+		}
+	}
+
+	for (int chip = 0; chip < DAC_NUM_CHIPS; chip++) {
+		if (activeMask & (1 << chip)) {
+			gpio_put (dacCsPin[chip], 1);
+		}
+	}
+
+	NextPhase ();
+}
+
+
+//---------------------------------------------------------------------------------------------
+// DacTask -- call from the main loop, never blocks. starts a flush of the pending levels
+//            when none is running
+//
+
+void DacTask (void)
+{
+	if ((flushPhase == PHASE_IDLE) && (pendingMask != 0)) {
+		// take a snapshot of the pending levels, leaving out chips that already hold
+		// their level
+		flushMask = pendingMask;
+		flushSince = pendingSince;
+		flushLevels = dacStats.levels;
+		pendingMask = 0;
+		for (int chip = 0; chip < DAC_NUM_CHIPS; chip++) {
+			if ((flushMask & (1 << chip)) && (pendingLevel[chip] == shadowLevel[chip])) {
+				flushMask &= ~(1 << chip);
+				dacStats.unchanged++;
+			}
+		}
+
+		// nothing to write, everything pending is already on the dacs
+		if (flushMask == 0) {
+			dacStats.latchUs = time_us_32 ();
+			dacStats.latched = flushLevels;
+			return;
+		}
+
+		// build the two words for each chip
+		dacStats.flushes++;
+		for (int chip = 0; chip < DAC_NUM_CHIPS; chip++) {
+			if (flushMask & (1 << chip)) {
+				uint8_t dacA, dacB;
+				shadowLevel[chip] = pendingLevel[chip];
+				if (pendingLevel[chip] == 0) {
+					dacA = 0;
+					dacB = 0;
+				} else {
+					dacA = pendingLevel[chip];
+					dacB = 256 - dacA;
+				}
+				uint16_t wordB = dac::Tlv5626::Word (dac::Tlv5626::B_AND_BUFFER, dacB);
+				uint16_t wordA = dac::Tlv5626::Word (dac::Tlv5626::A_AND_B, dacA);
+				txB[chip][0] = wordB >> 8;     // write buff and dac B
+				txB[chip][1] = wordB & 0xff;
+				txA[chip][0] = wordA >> 8;     // write A, mv buf to B
+				txA[chip][1] = wordA & 0xff;
+			}
+		}
+
+		// start the first phase, from here the interrupt owns the flush
+		NextPhase ();
+	}
+}
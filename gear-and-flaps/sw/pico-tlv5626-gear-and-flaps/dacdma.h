@@ -0,0 +1,53 @@
+//---------------------------------------------------------------------------------------------
+// dacdma.h
+//
+// non-blocking tlv5626 update using both spi buses and dma
+//
+// levels are recorded with DacSetLevel and DacTask starts a flush of them from the main
+// loop. the dma completion interrupt then raises the chip selects and starts each next
+// phase, so the main loop has no part in the timing once a flush is going. chips 0 and 1
+// are on spi0, chips 2 and 3 on spi1, and chip n and chip n+2 are written at the same
+// time. every chip first gets its buffer / dac B write and then its dac A write, which
+// also moves the buffer into dac B, and a chip latches when its chip select goes high.
+//
+// skew between the channels, worked out from the clocks and not measured on a board:
+// chips n and n+2 latch within a few system clocks of each other, both buses start from
+// one dma trigger. chips 1 and 3 latch one 16 bit transfer after chips 0 and 2, 160 us
+// at the 100 kHz spi clock main.cpp sets, plus the interrupt latency, a few us. before
+// the interrupt ran the phases the main loop polled them and usb and cli work could add
+// to that.
+//
+// a level set while a flush is running is written by the next flush. only the latest
+// level of each chip is kept, so reports arriving faster than the dacs can be written
+// are coalesced and a stale level is never written after a newer one.
+//
+// the driver keeps a shadow of the level each chip holds. a pending level equal to the
+// shadow is dropped when the flush starts, so a chip is only written when its level
+// actually changes. DacDmaInit expects every chip to have been written with 0 (off).
+//
+// a level is on the dacs once DacStats.latched has caught up with the value DacStats.levels
+// had just after it was set. latchUs is when that happened.
+//
+
+#ifndef _DACDMA_H_
+#define _DACDMA_H_
+
+#define DAC_NUM_CHIPS 4
+
+typedef struct {
+	uint32_t levels;      // levels passed to DacSetLevel
+	uint32_t coalesced;   // levels replaced by a newer one before being written
+	uint32_t unchanged;   // levels dropped because the chip already held them
+	uint32_t flushes;     // flushes started
+	uint32_t maxFlushUs;  // longest time from first pending level to last latch
+	uint32_t latched;     // value of levels when the last completed flush started
+	uint32_t latchUs;     // time_us_32 at the end of the last completed flush
+} DacStats;
+
+void DacDmaInit  (const uint *csPins);
+void DacSetLevel (uint8_t chip, uint8_t level);
+void DacTask     (void);
+bool DacBusy     (void);
+void DacGetStats (DacStats *stats);
+
+#endif
@@ -0,0 +1,115 @@
+//---------------------------------------------------------------------------------------------
+// hidlog.cpp
+//
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "pico/stdlib.h"
+
+#include "hidlog.h"
+
+
+//---------------------------------------------------------------------------------------------
+// globals
+//
+
+static HidLogEntry hidLog[HIDLOG_SIZE];
+
+// count of entries ever written and ever printed, the ring index is the low bits
+static volatile uint32_t logHead = 0;
+static uint32_t logTail = 0;
+
+static uint8_t logVerbosity = 1;
+
+
+//---------------------------------------------------------------------------------------------
+// HidLogReport -- producer, record a report as received by tud_hid_set_report_cb
+//
+
+void HidLogReport (uint8_t const *buffer, uint16_t bufsize)
+{
+	HidLogEntry *e = &hidLog[logHead & (HIDLOG_SIZE - 1)];
+
+	e->time_us = time_us_32 ();
+	e->report_id = (bufsize > 0) ? buffer[0] : 0;
+	e->mask = (bufsize > 1) ? buffer[1] : 0;
+	for (int i = 0; i < 4; i++) {
+		e->level[i] = (bufsize > 2 + i) ? buffer[2 + i] : 0;
+	}
+
+	// publish the entry after it has been filled in
+	__compiler_memory_barrier ();
+	logHead = logHead + 1;
+}
+
+
+//---------------------------------------------------------------------------------------------
+// PrintEntry
+//
+
+static void PrintEntry (const HidLogEntry *e)
+{
+	printf ("%10lu %02x %02x %02x %02x %02x %02x\n", (unsigned long)e->time_us, 
+		e->report_id, e->mask, e->level[0], e->level[1], e->level[2], e->level[3]);
+}
+
+
+//---------------------------------------------------------------------------------------------
+// HidLogTask -- consumer, call from the main loop, prints at most one entry per call
+//
+
+void HidLogTask (void)
+{
+	uint32_t head = logHead;
+
+	if (logTail == head) {
+		return;
+	}
+
+	// skip over anything that has already been overwritten
+	if (head - logTail > HIDLOG_SIZE) {
+		if (logVerbosity >= 1) {
+			printf ("hidlog: %lu reports not printed\n", (unsigned long)(head - logTail - HIDLOG_SIZE));
+		}
+		logTail = head - HIDLOG_SIZE;
+	}
+
+	if (logVerbosity >= 2) {
+		HidLogEntry e = hidLog[logTail & (HIDLOG_SIZE - 1)];
+		__compiler_memory_barrier ();
+		// entry may have been overwritten while it was copied
+		if (logHead - logTail <= HIDLOG_SIZE) {
+			PrintEntry (&e);
+		}
+	}
+
+	logTail++;
+}
+
+
+//---------------------------------------------------------------------------------------------
+// HidLogDump -- print everything still in the ring, oldest first
+//
+
+void HidLogDump (void)
+{
+	uint32_t head = logHead;
+	uint32_t count = (head < HIDLOG_SIZE) ? head : HIDLOG_SIZE;
+
+	printf ("%lu reports received\n", (unsigned long)head);
+	for (uint32_t i = head - count; i != head; i++) {
+		PrintEntry (&hidLog[i & (HIDLOG_SIZE - 1)]);
+	}
+}
+
+
+//---------------------------------------------------------------------------------------------
+// HidLogSetVerbosity
+//
+
+void HidLogSetVerbosity (uint8_t verbosity)
+{
+	logVerbosity = verbosity;
+}
@@ -0,0 +1,34 @@
+//---------------------------------------------------------------------------------------------
+// hidlog.h
+//
+// binary event log for hid reports
+//
+// HidLogReport only copies the report into a ring of fixed size entries, it is safe to
+// call from the tinyusb callbacks. formatting happens later, either one entry per call
+// of HidLogTask from the main loop or all at once from the cli with HidLogDump. the ring
+// always holds the last HIDLOG_SIZE reports whatever the verbosity.
+//
+// verbosity:
+//    0  silent
+//    1  print a line when entries were overwritten before they could be printed
+//    2  print every report
+//
+
+#ifndef _HIDLOG_H_
+#define _HIDLOG_H_
+
+#define HIDLOG_SIZE 64   // power of 2
+
+typedef struct {
+	uint32_t time_us;
+	uint8_t  report_id;
+	uint8_t  mask;
+	uint8_t  level[4];
+} HidLogEntry;
+
+void HidLogReport       (uint8_t const *buffer, uint16_t bufsize);
+void HidLogTask         (void);
+void HidLogDump         (void);
+void HidLogSetVerbosity (uint8_t verbosity);
+
+#endif
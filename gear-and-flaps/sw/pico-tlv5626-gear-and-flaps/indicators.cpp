@@ -0,0 +1,100 @@
+//---------------------------------------------------------------------------------------------
+// indicators.cpp
+//
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "pico/stdlib.h"
+
+#include "dacdma.h"
+#include "ramp.h"
+#include "curves.h"
+#include "indicators.h"
+
+
+//---------------------------------------------------------------------------------------------
+// globals
+//
+
+// light output of the lamps at a few dac codes, from 32 to 224. PLACEHOLDER, no lamp has
+// been measured yet, this is a lamp whose output rises linearly with the code so the curve
+// is only the perceptual correction. every channel uses it until there are measurements,
+// then a lamp type that differs gets its own table and curve here and its rows in
+// channelMap point at that. measure the output at five or more codes, a light meter at a
+// fixed distance is enough
+static constexpr CurvePoint linearLamp[] = {
+	{  32, 0.0f }, { 224, 1.0f }
+};
+
+static constexpr Curve lampCurve = PerceptualCurve (linearLamp);
+static_assert (CurveValid (lampCurve), "lamp curve");
+
+// nose and right gear are on spi0, flaps and left gear on spi1
+const ChannelMap channelMap[NUM_CHANNELS] = {
+	{ "nose",  &lampCurve, 0, 0x80, 0 },
+	{ "right", &lampCurve, 1, 0x40, 1 },
+	{ "left",  &lampCurve, 3, 0x10, 3 },
+	{ "flaps", &lampCurve, 2, 0x20, 2 }
+};
+
+static Ramp ramp;
+
+
+//---------------------------------------------------------------------------------------------
+// WriteChannel -- ramp write function
+//
+
+static void WriteChannel (uint8_t channel, uint8_t level)
+{
+	DacSetLevel (channelMap[channel].chip, channelMap[channel].curve->code[level]);
+}
+
+
+//---------------------------------------------------------------------------------------------
+// IndicatorsInit -- call after DacDmaInit
+//
+
+void IndicatorsInit (void)
+{
+	RampInit (&ramp, WriteChannel);
+}
+
+
+//---------------------------------------------------------------------------------------------
+// IndicatorSet -- ramp a channel to a level, a zero time sets it now
+//
+
+void IndicatorSet (uint8_t channel, uint8_t level, uint16_t time_ms)
+{
+	if (channel >= NUM_CHANNELS) {
+		return;
+	}
+
+	if (level != LEVEL_OFF) {
+		if (level < LEVEL_MIN) { level = LEVEL_MIN; }
+		if (level > LEVEL_MAX) { level = LEVEL_MAX; }
+	}
+
+	RampStart (&ramp, channel, level, time_ms);
+}
+
+
+//---------------------------------------------------------------------------------------------
+// IndicatorLevel -- level last handed to the dacs
+//
+
+uint8_t IndicatorLevel (uint8_t channel)
+{
+	return ramp.written[channel];
+}
+
+
+//---------------------------------------------------------------------------------------------
+// IndicatorsTick -- call every RAMP_TICK_MS
+//
+
+void IndicatorsTick (void)
+{
+	RampTick (&ramp);
+}
@@ -0,0 +1,44 @@
+//---------------------------------------------------------------------------------------------
+// indicators.h
+//
+// the four gear and flaps indicators, whatever transport the levels arrive on
+//
+// channels are numbered in cli order, nose, right, left, flaps. channelMap is the one
+// place that ties a channel to its dac chip and to its mask bit and byte in the hid and
+// cdc reports, and to the brightness curve its lamp uses, see curves.h. levels go through
+// the ramps and the curve to DacSetLevel, DacTask writes them.
+//
+// levels:
+//    0          indicator off
+//    32 - 224   gear or flaps up to down, anything else between 1 and 255 is clamped
+//
+
+#ifndef _INDICATORS_H_
+#define _INDICATORS_H_
+
+#include <stdint.h>
+
+#include "curves.h"
+
+#define NUM_CHANNELS 4
+
+#define LEVEL_OFF 0
+#define LEVEL_MIN 32
+#define LEVEL_MAX 224
+
+typedef struct {
+	const char *name;
+	const Curve *curve;   // level to dac A code
+	uint8_t chip;         // dac chip, see dacdma.h
+	uint8_t reportMask;   // bit in the report select mask
+	uint8_t reportByte;   // level byte in the report after the select mask
+} ChannelMap;
+
+extern const ChannelMap channelMap[NUM_CHANNELS];
+
+void    IndicatorsInit (void);
+void    IndicatorSet   (uint8_t channel, uint8_t level, uint16_t time_ms);
+uint8_t IndicatorLevel (uint8_t channel);
+void    IndicatorsTick (void);
+
+#endif
@@ -1,8 +1,51 @@
 //---------------------------------------------------------------------------------------------
 // notes
 //
+// one firmware for the gear and flaps indicators, the transport is picked at build time,
+// see transport.h. the channel order and the dac chip of each channel are in channelMap
+// in indicators.cpp.
 //
-// <nose>,<right>,<left>,<flaps>
+// hid and cdc reports:
+//
+// report id (0x01)
+// select mask:
+//    0x80: nose gear
+//    0x40: right wing gear
+//    0x20: flaps
+//    0x10: left wing gear
+// four bytes of data from 32 to 224 for a level or 0 to power down channel:
+//    'd32 gear up to 'd224 gear down
+//    'd32 flaps up to 'd224 flaps down
+//
+// report id (0x02)
+// same select mask and four levels as report 0x01 followed by a little endian 16 bit
+// transition time in ms. the selected channels ramp from their current level to the
+// new one over that time.
+//
+// report id (0x03)
+// same select mask and four levels as report 0x01 followed by a little endian 32 bit
+// sequence number chosen by the host. the levels are applied immediately and once they
+// are on the dacs the device sends input report 0x04 back.
+//
+// report id (0x04), input
+//    bytes 0-3    sequence number from the last report 0x03
+//    bytes 4-7    time_us_32 when report 0x03 was received
+//    bytes 8-11   time_us_32 when the last dac write it caused completed
+//    bytes 12-15  current levels of nose, right, flaps, left
+//    byte 16      flags, 0x01 latched, 0x02 nothing to write, levels were already set
+// all multi byte fields are little endian. the same report can be read with get report.
+// only the latest report 0x03 is tracked, one that arrives before the status of the
+// previous one was sent replaces it.
+//
+// cli, in every build:
+//    <nose>,<right>,<left>,<flaps>[,<ms>]
+//                 set the levels, 0 for off or 32 to 224, optionally ramping over ms.
+//                 an empty field leaves that channel alone
+//    log          dump the last reports received
+//    stats        dac write and coalescing counters
+//    v,<0|1|2>    log verbosity, 0 silent, 1 overruns only, 2 every report
+//
+
 
 //---------------------------------------------------------------------------------------------
 // includes
@@ -19,11 +62,28 @@
 #include "hardware/gpio.h"
 #include "hardware/spi.h"
 
+#include "dac/dac_pico.h"
+
+#include "dacdma.h"
+#include "hidlog.h"
+#include "curves.h"
+#include "indicators.h"
+#include "reports.h"
+#include "transport.h"
+
 
 //---------------------------------------------------------------------------------------------
 // defines
 //
 
+// tlv5626 control word, fast mode, powered up and the internal reference
+//    0x01  1.024V
+//    0x02  2.048V
+#ifndef DAC_REF
+#define DAC_REF 0x01
+#endif
+
+// cli buffer length
 #define CMD_MAXLEN 72
 
 
@@ -36,12 +96,14 @@
 // prototypes
 //
 
+void InitGpioToOff (uint pin);
+
 bool repeating_timer_callback (struct repeating_timer *t);
 
 void InitCommand (void);
 void GetCommand (void);
 
-void dacWrite2 (uint8_t select, uint8_t a, uint8_t b);
+void SetLevels (char *fields);
 
 
 //---------------------------------------------------------------------------------------------
@@ -53,17 +115,28 @@ const uint LED_PIN = 25;
 const uint SPI0_SCK_PIN  = 2;
 const uint SPI0_MOSI_PIN = 3;
 const uint SPI0_MISO_PIN = 4;
-const uint SPI0_CS0n_PIN = 5;	// nose gear
-const uint SPI0_CS1n_PIN = 6;	// right gear
+const uint SPI0_CS0n_PIN = 5;   // nose gear
+const uint SPI0_CS1n_PIN = 6;   // right gear
 
 const uint SPI1_SCK_PIN  = 14;
 const uint SPI1_MOSI_PIN = 15;
 const uint SPI1_MISO_PIN = 12;
-const uint SPI1_CS0n_PIN = 13;	// flaps
-const uint SPI1_CS1n_PIN = 11;	// left gear
+const uint SPI1_CS0n_PIN = 13;  // flaps
+const uint SPI1_CS1n_PIN = 11;  // left gear
+
+// chip selects of dac chips 0 to 3, see dacdma.h
+const uint dacCsPins[DAC_NUM_CHIPS] = {
+	SPI0_CS0n_PIN, SPI0_CS1n_PIN, SPI1_CS0n_PIN, SPI1_CS1n_PIN
+};
+
+// the dacs on each bus, 8 bit frames, for writing all of them at start up
+typedef dac::Tlv5626 Tlv;
+typedef dac::Bank<dac::PicoSpi<0, 8>, SPI0_CS0n_PIN, SPI0_CS1n_PIN> Spi0Dacs;
+typedef dac::Bank<dac::PicoSpi<1, 8>, SPI1_CS0n_PIN, SPI1_CS1n_PIN> Spi1Dacs;
 
 volatile bool flag100 = false;
 
+
 static char cmd_buffer[CMD_MAXLEN];
 static uint8_t cmd_length = 0;
 static uint8_t cmd_state = 0;
@@ -75,188 +148,184 @@ static uint8_t cmd_state = 0;
 
 int main ()
 {
-    // local system variables
-    struct repeating_timer timer;
-    uint8_t ledTimer;
-	uint8_t dacState = 0;
-	uint8_t dacA = 0, dacB = 255;
+	// local system variables
+    struct repeating_timer timer100Hz;
+	uint16_t ledTimer = 0;
 
 	// initialize stdio
     stdio_uart_init_full (uart0, 115200, 0, 1);
 	
 	// initialize led to off
-    gpio_init (LED_PIN);
-    gpio_set_dir (LED_PIN, GPIO_OUT);
-	gpio_put (LED_PIN, 0);
+	InitGpioToOff (LED_PIN);
+
+	// initialize the usb stack, if any
+	TransportInit ();
 
-	// initialize spi 0
+    // initialize spi 0
     gpio_init    (SPI0_CS0n_PIN);
     gpio_set_dir (SPI0_CS0n_PIN, GPIO_OUT);
-	gpio_put     (SPI0_CS0n_PIN, 1);
+    gpio_put     (SPI0_CS0n_PIN, 1);
     gpio_init    (SPI0_CS1n_PIN);
     gpio_set_dir (SPI0_CS1n_PIN, GPIO_OUT);
-	gpio_put     (SPI0_CS1n_PIN, 1);
+    gpio_put     (SPI0_CS1n_PIN, 1);
     spi_init (spi0, 100000);
     spi_set_format (spi0, 8, SPI_CPOL_1, SPI_CPHA_0, SPI_MSB_FIRST);
     gpio_set_function (SPI0_MISO_PIN, GPIO_FUNC_SPI);
     gpio_set_function (SPI0_SCK_PIN, GPIO_FUNC_SPI);
     gpio_set_function (SPI0_MOSI_PIN, GPIO_FUNC_SPI);
 
-	// initialize spi 1
+    // initialize spi 1
     gpio_init    (SPI1_CS0n_PIN);
     gpio_set_dir (SPI1_CS0n_PIN, GPIO_OUT);
-	gpio_put     (SPI1_CS0n_PIN, 1);
+    gpio_put     (SPI1_CS0n_PIN, 1);
     gpio_init    (SPI1_CS1n_PIN);
     gpio_set_dir (SPI1_CS1n_PIN, GPIO_OUT);
-	gpio_put     (SPI1_CS1n_PIN, 1);
+    gpio_put     (SPI1_CS1n_PIN, 1);
     spi_init (spi1, 100000);
     spi_set_format (spi1, 8, SPI_CPOL_1, SPI_CPHA_0, SPI_MSB_FIRST);
     gpio_set_function (SPI1_MISO_PIN, GPIO_FUNC_SPI);
     gpio_set_function (SPI1_SCK_PIN, GPIO_FUNC_SPI);
     gpio_set_function (SPI1_MOSI_PIN, GPIO_FUNC_SPI);
 
-	// slow down IOs
-	gpio_set_slew_rate (SPI0_SCK_PIN,  GPIO_SLEW_RATE_SLOW);
-	gpio_set_slew_rate (SPI0_MOSI_PIN, GPIO_SLEW_RATE_SLOW);
-	gpio_set_slew_rate (SPI0_CS0n_PIN, GPIO_SLEW_RATE_SLOW);
-	gpio_set_slew_rate (SPI0_CS1n_PIN, GPIO_SLEW_RATE_SLOW);
-	gpio_set_drive_strength (SPI0_SCK_PIN,  GPIO_DRIVE_STRENGTH_2MA);
-	gpio_set_drive_strength (SPI0_MOSI_PIN, GPIO_DRIVE_STRENGTH_2MA);
-	gpio_set_drive_strength (SPI0_CS0n_PIN, GPIO_DRIVE_STRENGTH_2MA);
-	gpio_set_drive_strength (SPI0_CS1n_PIN, GPIO_DRIVE_STRENGTH_2MA);
-	gpio_set_slew_rate (SPI1_SCK_PIN,  GPIO_SLEW_RATE_SLOW);
-	gpio_set_slew_rate (SPI1_MOSI_PIN, GPIO_SLEW_RATE_SLOW);
-	gpio_set_slew_rate (SPI1_CS0n_PIN, GPIO_SLEW_RATE_SLOW);
-	gpio_set_slew_rate (SPI1_CS1n_PIN, GPIO_SLEW_RATE_SLOW);
-	gpio_set_drive_strength (SPI1_SCK_PIN,  GPIO_DRIVE_STRENGTH_2MA);
-	gpio_set_drive_strength (SPI1_MOSI_PIN, GPIO_DRIVE_STRENGTH_2MA);
-	gpio_set_drive_strength (SPI1_CS0n_PIN, GPIO_DRIVE_STRENGTH_2MA);
-	gpio_set_drive_strength (SPI1_CS1n_PIN, GPIO_DRIVE_STRENGTH_2MA);
-
-	// initialize dac
-	dacWrite2 (0x0F, 0x00, 0x00); // write to buffer and dac b
-	dacWrite2 (0x0F, 0x80, 0x00); // xfer buffer to dac b and write to dac a
-	dacWrite2 (0x0F, 0x90, 0x02); // fast mode, powered up, use 2.048V internal ref voltage
-	dacWrite2 (0x0F, 0x00, 0x00); // write to buffer and dac b
-	dacWrite2 (0x0F, 0x80, 0x00); // xfer buffer to dac b and write to dac a
+    // slow down IOs
+    gpio_set_slew_rate (SPI0_SCK_PIN,  GPIO_SLEW_RATE_SLOW);
+    gpio_set_slew_rate (SPI0_MOSI_PIN, GPIO_SLEW_RATE_SLOW);
+    gpio_set_slew_rate (SPI0_CS0n_PIN, GPIO_SLEW_RATE_SLOW);
+    gpio_set_slew_rate (SPI0_CS1n_PIN, GPIO_SLEW_RATE_SLOW);
+    gpio_set_drive_strength (SPI0_SCK_PIN,  GPIO_DRIVE_STRENGTH_2MA);
+    gpio_set_drive_strength (SPI0_MOSI_PIN, GPIO_DRIVE_STRENGTH_2MA);
+    gpio_set_drive_strength (SPI0_CS0n_PIN, GPIO_DRIVE_STRENGTH_2MA);
+    gpio_set_drive_strength (SPI0_CS1n_PIN, GPIO_DRIVE_STRENGTH_2MA);
+    gpio_set_slew_rate (SPI1_SCK_PIN,  GPIO_SLEW_RATE_SLOW);
+    gpio_set_slew_rate (SPI1_MOSI_PIN, GPIO_SLEW_RATE_SLOW);
+    gpio_set_slew_rate (SPI1_CS0n_PIN, GPIO_SLEW_RATE_SLOW);
+    gpio_set_slew_rate (SPI1_CS1n_PIN, GPIO_SLEW_RATE_SLOW);
+    gpio_set_drive_strength (SPI1_SCK_PIN,  GPIO_DRIVE_STRENGTH_2MA);
+    gpio_set_drive_strength (SPI1_MOSI_PIN, GPIO_DRIVE_STRENGTH_2MA);
+    gpio_set_drive_strength (SPI1_CS0n_PIN, GPIO_DRIVE_STRENGTH_2MA);
+    gpio_set_drive_strength (SPI1_CS1n_PIN, GPIO_DRIVE_STRENGTH_2MA);
+
+    // initialize dac
+    const uint16_t dacInit[] = {
+        Tlv::Word (Tlv::B_AND_BUFFER, 0),                // write to buffer and dac b
+        Tlv::Word (Tlv::A_AND_B, 0),                     // xfer buffer to dac b and write to dac a
+        Tlv::Control ((Tlv::Reference)DAC_REF),          // fast mode, powered up, internal ref voltage
+        Tlv::Word (Tlv::B_AND_BUFFER, 0),                // write to buffer and dac b
+        Tlv::Word (Tlv::A_AND_B, 0)                      // xfer buffer to dac b and write to dac a
+    };
+    for (uint16_t word : dacInit) {
+        Spi0Dacs::Broadcast (word);
+        Spi1Dacs::Broadcast (word);
+    }
+
+	// hand the dacs over to the dma driver
+	DacDmaInit (dacCsPins);
+	IndicatorsInit ();
 
 	// hello world
-	printf ("Hello, world!\n");
+	printf ("\n\nHello, world! (%s)\n", transportName);
 
     // set up command processor
     InitCommand ();
 
-    // set up 10 ms / 100 Hz repeating timer
-    add_repeating_timer_ms (-10, repeating_timer_callback, NULL, &timer);
+	// create timer
+    add_repeating_timer_ms (-10, repeating_timer_callback, NULL, &timer100Hz);
 
 	// main loop
 	while (1) {
+	
+		//----------------------------------------
+		// run fast tasks
+		//----------------------------------------
+
+		// usb tasks, levels received are applied from here
+		TransportTask ();
+
+		// start writing any levels received since the last flush, the dma interrupt finishes it
+		DacTask ();
 
-        //----------------------------------------
-        // fast tasks
-        //----------------------------------------
+		// status report becomes pending once the levels of a report 0x03 have latched
+		ReportsTask ();
 
         // run get command state machine to get a line of input (non-blocking)
         GetCommand ();
 
         // once a line of input is received, process it
-        if (cmd_state == 2) {
-            printf ("processing command %s with length %d\n", cmd_buffer, cmd_length);
-
+        if ((cmd_state == 2) && (((cmd_buffer[0] >= '0') && (cmd_buffer[0] <= '9')) || (cmd_buffer[0] == ','))) {
+            SetLevels (cmd_buffer);                        // levels
+            cmd_state = 0;
+        } else if (cmd_state == 2) {
             int index = 0;
+            bool verbosity = false;
             char *buffptr = strtok (cmd_buffer, ",");
             while (buffptr != NULL) {
 
-                int16_t a = atoi (buffptr);
-				if (a == 0) {
-					dacA = 0;
-					dacB = 0;
-				} else {
-					if (a < 32) { a = 32; }
-					if (a > 224) { a = 224; }
-					dacA = a;
-					dacB = 255 - dacA;
-				}
-
                 switch (index++) {
 
                     case 0:
-						dacWrite2 (0x01, 0x00 | ((dacB >> 4) & 0x0f),	// write buff and dac B
-                                         0x00 | ((dacB << 4) & 0xf0));
-						dacWrite2 (0x01, 0x80 | ((dacA >> 4) & 0x0f),	// write A, mv buf to B
-                                         0x00 | ((dacA << 4) & 0xf0));
+                        if (!strcmp (buffptr, "log")) {    // dump recent reports
+                            HidLogDump ();
+                        } else if (!strcmp (buffptr, "stats")) {
+                            DacStats stats;
+                            DacGetStats (&stats);
+                            printf ("levels: %lu coalesced: %lu unchanged: %lu flushes: %lu max latency: %lu us\n", 
+                                (unsigned long)stats.levels, (unsigned long)stats.coalesced, 
+                                (unsigned long)stats.unchanged, (unsigned long)stats.flushes, 
+                                (unsigned long)stats.maxFlushUs);
+                        } else if (!strcmp (buffptr, "v")) {
+                            verbosity = true;
+                        } else {
+                            printf ("unknown command %s\n", buffptr);
+                        }
                         break;
 
                     case 1:
-						dacWrite2 (0x02, 0x00 | ((dacB >> 4) & 0x0f),	// write buff and dac B
-                                         0x00 | ((dacB << 4) & 0xf0));
-						dacWrite2 (0x02, 0x80 | ((dacA >> 4) & 0x0f),	// write A, mv buf to B
-                                         0x00 | ((dacA << 4) & 0xf0));
-                        break;
-
-                    case 2:
-						dacWrite2 (0x08, 0x00 | ((dacB >> 4) & 0x0f),	// write buff and dac B
-                                         0x00 | ((dacB << 4) & 0xf0));
-						dacWrite2 (0x08, 0x80 | ((dacA >> 4) & 0x0f),	// write A, mv buf to B
-                                         0x00 | ((dacA << 4) & 0xf0));
-                        break;
-
-                    case 3:
-						dacWrite2 (0x04, 0x00 | ((dacB >> 4) & 0x0f),	// write buff and dac B
-                                         0x00 | ((dacB << 4) & 0xf0));
-						dacWrite2 (0x04, 0x80 | ((dacA >> 4) & 0x0f),	// write A, mv buf to B
-                                         0x00 | ((dacA << 4) & 0xf0));
+                        if (verbosity) {                   // v,<0|1|2> sets log verbosity
+                            HidLogSetVerbosity (atoi (buffptr));
+                        }
                         break;
                 }
                 buffptr = strtok (NULL, ",");
             }
+			cmd_state = 0;
+		}
 
-            cmd_state = 0;
-        }
+		// print logged reports a line at a time once the dacs are idle
+		if (!DacBusy ()) {
+			HidLogTask ();
+		}
 
+		
+		//----------------------------------------
+		// run 100Hz tasks
+		//----------------------------------------
 
-        //----------------------------------------
-        // 100 Hz tasks
-        //----------------------------------------
+		if (flag100) {
+			flag100 = false;
 
-        if (flag100) {
-            flag100 = false;
+			// step any ramping channels, changed levels go to DacTask
+			IndicatorsTick ();
 
-            // blihk led
-            if (ledTimer == 0) {
-                // led on
+			if (ledTimer == 0) {												// first blink
 				gpio_put (LED_PIN, 1);
-            } else if (ledTimer == 25) {
-                // led off
+			} else if (ledTimer == 2*7) {
+				gpio_put (LED_PIN, 0);
+			} else if ((ledTimer == 2*14) && (TransportState () >= TRANSPORT_NOT_MOUNTED)) {	// second blink
+				gpio_put (LED_PIN, 1);
+			} else if (ledTimer == 2*21) {
+				gpio_put (LED_PIN, 0);
+			} else if ((ledTimer == 2*28) && (TransportState () >= TRANSPORT_CONFIGURED)) {	// third blink
+				gpio_put (LED_PIN, 1);
+			} else if (ledTimer == 2*35) {
 				gpio_put (LED_PIN, 0);
-            }
-
-            // increment led timer counter, 1 second period
-            if (++ledTimer >= 100) {
-                ledTimer = 0;
-            }
-
-/*
-			dacWrite2 (0x10 | ((dacB >> 4) & 0x0f),	// write buff and dac B
-					   0x00 | ((dacB << 4) & 0xf0));
-			dacWrite2 (0x80 | ((dacA >> 4) & 0x0f),	// write dac A, mv buff to B
-					   0x00 | ((dacA << 4) & 0xf0));
-*/
-			if (dacA == 255) {
-				dacState = 1;
-			}
-			if (dacA == 0) {
-				dacState = 0;
 			}
-			if (dacState == 0) {
-				dacA++;
-				dacB--;
-			} else {
-				dacA--;
-				dacB++;
+            
+			// increment led timer counter, 1.5 second period
+			if (++ledTimer >= 2*75) {
+				ledTimer = 0;
 			}
 
-        }
+		}
 	}
 
 	// not really
@@ -264,14 +333,77 @@ int main ()
 }
 
 
+//---------------------------------------------------------------------------------------------
+// InitGpioToOff
+//
+
+void InitGpioToOff (uint pin)
+{
+    gpio_init (pin);
+    gpio_set_dir (pin, GPIO_OUT);
+	gpio_put (pin, 0);
+}
+
+
+//---------------------------------------------------------------------------------------------
+// Loop100Hz -- This is called at interrupt time so just set a flag then let the
+//              main loop run the tasks.
+//
+
 bool repeating_timer_callback (struct repeating_timer *t)
 {
-    flag100 = true;
+	flag100 = true;
+
+	return true;
+}
+
+
+//---------------------------------------------------------------------------------------------
+// SetLevels -- <nose>,<right>,<left>,<flaps>[,<ms>] from the cli, empty fields are skipped
+//
+
+void SetLevels (char *fields)
+{
+	int level[NUM_CHANNELS];
+	bool present[NUM_CHANNELS];
+	uint16_t time_ms = 0;
+	char *p = fields;
+
+	for (int i = 0; i <= NUM_CHANNELS; i++) {
+		char *comma = strchr (p, ',');
+		if (comma) {
+			*comma = 0;
+		}
+		if (i < NUM_CHANNELS) {
+			present[i] = (*p != 0);
+			level[i] = atoi (p);
+		} else if (*p != 0) {
+			time_ms = atoi (p);
+		}
+		if (!comma) {
+			// missing trailing fields are empty too
+			for (int j = i + 1; j < NUM_CHANNELS; j++) {
+				present[j] = false;
+			}
+			break;
+		}
+		p = comma + 1;
+	}
 
-    return true;
+	for (int ch = 0; ch < NUM_CHANNELS; ch++) {
+		if (present[ch]) {
+			if (level[ch] < 0)   { level[ch] = 0; }
+			if (level[ch] > 255) { level[ch] = 255; }
+			IndicatorSet (ch, level[ch], time_ms);
+		}
+	}
 }
 
 
+//---------------------------------------------------------------------------------------------
+// InitCommand
+//
+
 void InitCommand (void)
 {
     cmd_state == 0;
@@ -279,6 +411,10 @@ void InitCommand (void)
 }
 
 
+//---------------------------------------------------------------------------------------------
+// GetCommand
+//
+
 void GetCommand (void)
 {
     int ch;
@@ -299,7 +435,7 @@ void GetCommand (void)
                 putchar (0x0d);
                 putchar (0x0a);
                 cmd_state++;
-            } else if (ch == 0x08) {                    // backspace
+            } else if ((ch == 127) || (ch == 0x08)) {   // backspace
                 if (cmd_length > 0) {
                     putchar (0x08);
                     putchar (' ');
@@ -323,50 +459,3 @@ void GetCommand (void)
         }
     }
 }
-
-
-void dacWrite2 (uint8_t select, uint8_t a, uint8_t b)
-{
-	// printf ("%02x %02x\n", a, b);
-
-	// CS low
-	asm volatile ("nop \n nop \n nop");
-	if (select & 1) {
-		gpio_put (SPI0_CS0n_PIN, 0);
-	}
-	if (select & 2) {
-		gpio_put (SPI0_CS1n_PIN, 0);
-	}
-	if (select & 4) {
-		gpio_put (SPI1_CS0n_PIN, 0);
-	}
-	if (select & 8) {
-		gpio_put (SPI1_CS1n_PIN, 0);
-	}
-	asm volatile ("nop \n nop \n nop");
-
-	// transfer data
-	if (select & 3) {
-		spi_write_blocking (spi0, &a, 1);
-		spi_write_blocking (spi0, &b, 1);
-	}
-	if (select & 12) {
-		spi_write_blocking (spi1, &a, 1);
-		spi_write_blocking (spi1, &b, 1);
-	}
-
-	// CS high
-	asm volatile ("nop \n nop \n nop");
-	gpio_put (SPI0_CS0n_PIN, 1);
-	gpio_put (SPI0_CS1n_PIN, 1);
-	gpio_put (SPI1_CS0n_PIN, 1);
-	gpio_put (SPI1_CS1n_PIN, 1);
-	asm volatile ("nop \n nop \n nop");
-
-	// enforce a small delay between writes
-	asm volatile ("nop \n nop \n nop");
-	asm volatile ("nop \n nop \n nop");
-	asm volatile ("nop \n nop \n nop");
-	asm volatile ("nop \n nop \n nop");
-	asm volatile ("nop \n nop \n nop");
-}
@@ -0,0 +1,85 @@
+//---------------------------------------------------------------------------------------------
+// ramp.cpp
+//
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "ramp.h"
+
+
+//---------------------------------------------------------------------------------------------
+// RampInit -- all channels start off
+//
+
+void RampInit (Ramp *r, RampWriteFn write)
+{
+	r->write = write;
+	for (int ch = 0; ch < RAMP_CHANNELS; ch++) {
+		r->level[ch] = 0;
+		r->step[ch] = 0;
+		r->ticksLeft[ch] = 0;
+		r->target[ch] = 0;
+		r->written[ch] = 0;
+	}
+}
+
+
+//---------------------------------------------------------------------------------------------
+// RampStart
+//
+
+void RampStart (Ramp *r, uint8_t channel, uint8_t target, uint16_t time_ms)
+{
+	uint16_t ticks = time_ms / RAMP_TICK_MS;
+
+	r->target[channel] = target;
+
+	// no time to ramp, jump to the target now
+	if (ticks == 0) {
+		r->level[channel] = (uint16_t)target << 8;
+		r->ticksLeft[channel] = 0;
+		r->step[channel] = 0;
+		if (r->written[channel] != target) {
+			r->written[channel] = target;
+			r->write (channel, target);
+		}
+		return;
+	}
+
+	r->step[channel] = (((int32_t)target << 8) - r->level[channel]) / ticks;
+	r->ticksLeft[channel] = ticks;
+}
+
+
+//---------------------------------------------------------------------------------------------
+// RampTick -- call every RAMP_TICK_MS
+//
+
+void RampTick (Ramp *r)
+{
+	for (int ch = 0; ch < RAMP_CHANNELS; ch++) {
+		uint8_t level;
+
+		if (r->ticksLeft[ch] == 0) {
+			continue;
+		}
+
+		// land exactly on the target on the last tick
+		if (--r->ticksLeft[ch] == 0) {
+			r->level[ch] = (uint16_t)r->target[ch] << 8;
+		} else {
+			r->level[ch] += r->step[ch];
+		}
+
+		// round to the nearest level and only write changes
+		level = (r->level[ch] + 0x80) >> 8;
+		if (r->ticksLeft[ch] == 0) {
+			level = r->target[ch];
+		}
+		if (level != r->written[ch]) {
+			r->written[ch] = level;
+			r->write (ch, level);
+		}
+	}
+}
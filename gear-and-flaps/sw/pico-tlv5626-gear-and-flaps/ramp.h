@@ -0,0 +1,33 @@
+//---------------------------------------------------------------------------------------------
+// ramp.h
+//
+// per channel level ramps for the indicator lamps
+//
+// RampStart sets a channel's target level and the time to get there. RampTick runs on
+// the 100 Hz tick, steps every ramping channel in 8.8 fixed point and calls the write
+// function only for channels whose 8 bit level actually changed. a zero transition
+// time writes the target straight away.
+//
+
+#ifndef _RAMP_H_
+#define _RAMP_H_
+
+#define RAMP_CHANNELS 4
+#define RAMP_TICK_MS  10
+
+typedef void (*RampWriteFn) (uint8_t channel, uint8_t level);
+
+typedef struct {
+	RampWriteFn write;
+	uint16_t level[RAMP_CHANNELS];       // current level, 8.8 fixed point
+	int16_t  step[RAMP_CHANNELS];        // change per tick, 8.8 fixed point
+	uint16_t ticksLeft[RAMP_CHANNELS];
+	uint8_t  target[RAMP_CHANNELS];
+	uint8_t  written[RAMP_CHANNELS];     // last level passed to write
+} Ramp;
+
+void RampInit  (Ramp *r, RampWriteFn write);
+void RampStart (Ramp *r, uint8_t channel, uint8_t target, uint16_t time_ms);
+void RampTick  (Ramp *r);
+
+#endif
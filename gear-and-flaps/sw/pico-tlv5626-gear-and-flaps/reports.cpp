@@ -0,0 +1,169 @@
+//---------------------------------------------------------------------------------------------
+// reports.cpp
+//
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "pico/stdlib.h"
+
+#include "dacdma.h"
+#include "hidlog.h"
+#include "curves.h"
+#include "indicators.h"
+#include "reports.h"
+
+
+//---------------------------------------------------------------------------------------------
+// typedefs
+//
+
+// status of the last report 0x03
+typedef struct {
+	uint32_t seq;
+	uint32_t rxUs;
+	uint32_t latchUs;
+	uint32_t levels;    // DacStats.levels after the report's levels were set
+	uint8_t  flags;
+	bool     waiting;   // levels not on the dacs yet
+	bool     send;      // status report not sent yet
+} ProbeStatus;
+
+
+//---------------------------------------------------------------------------------------------
+// globals
+//
+
+static ProbeStatus probe;
+
+
+//---------------------------------------------------------------------------------------------
+// ReportLength -- length of a report including its id, 0 for unknown ids
+//
+
+uint16_t ReportLength (uint8_t report_id)
+{
+	switch (report_id) {
+		case LEVELS_REPORT_ID: return LEVELS_REPORT_LEN;
+		case RAMP_REPORT_ID:   return RAMP_REPORT_LEN;
+		case PROBE_REPORT_ID:  return PROBE_REPORT_LEN;
+	}
+
+	return 0;
+}
+
+
+//---------------------------------------------------------------------------------------------
+// ReportReceive -- apply a report starting with its id, false if it was not recognized
+//
+
+bool ReportReceive (uint8_t const *buffer, uint16_t bufsize, uint32_t rxUs)
+{
+	uint16_t time_ms = 0;
+	bool isProbe = false;
+	DacStats stats;
+
+	// log the report, printing is deferred to the main loop
+	HidLogReport (buffer, bufsize);
+
+	if ((bufsize == 0) || (bufsize != ReportLength (buffer[0]))) {
+		return false;
+	}
+
+	if (buffer[0] == RAMP_REPORT_ID) {
+		time_ms = buffer[6] | (buffer[7] << 8);
+	} else if (buffer[0] == PROBE_REPORT_ID) {
+		isProbe = true;
+		DacGetStats (&stats);
+		probe.seq = buffer[6] | (buffer[7] << 8) | (buffer[8] << 16) | ((uint32_t)buffer[9] << 24);
+		probe.rxUs = rxUs;
+		probe.levels = stats.levels;
+	}
+
+	// start ramps, a zero time writes the level now. DacTask writes them from the
+	// main loop
+	for (int ch = 0; ch < NUM_CHANNELS; ch++) {
+		if (buffer[1] & channelMap[ch].reportMask) {
+			IndicatorSet (ch, buffer[2 + channelMap[ch].reportByte], time_ms);
+		}
+	}
+
+	// wait for DacTask to latch whatever was written, if nothing changed the
+	// levels were already on the dacs
+	if (isProbe) {
+		DacGetStats (&stats);
+		if (stats.levels == probe.levels) {
+			probe.latchUs = rxUs;
+			probe.flags = STATUS_LATCHED | STATUS_UNCHANGED;
+			probe.waiting = false;
+			probe.send = true;
+		} else {
+			probe.levels = stats.levels;
+			probe.flags = 0;
+			probe.waiting = true;
+			probe.send = false;
+		}
+	}
+
+	return true;
+}
+
+
+//---------------------------------------------------------------------------------------------
+// ReportsTask -- call from the main loop after DacTask
+//
+
+void ReportsTask (void)
+{
+	if (probe.waiting) {
+		DacStats stats;
+		DacGetStats (&stats);
+		if ((int32_t)(stats.latched - probe.levels) >= 0) {
+			probe.latchUs = stats.latchUs;
+			probe.flags = STATUS_LATCHED;
+			probe.waiting = false;
+			probe.send = true;
+		}
+	}
+}
+
+
+//---------------------------------------------------------------------------------------------
+// ReportStatusPending / ReportStatusSent
+//
+
+bool ReportStatusPending (void)
+{
+	return probe.send;
+}
+
+void ReportStatusSent (void)
+{
+	probe.send = false;
+}
+
+
+//---------------------------------------------------------------------------------------------
+// ReportStatusBuild -- fill in the status report without its report id, returns the length
+//
+
+static void Put32 (uint8_t *p, uint32_t v)
+{
+	p[0] = v;
+	p[1] = v >> 8;
+	p[2] = v >> 16;
+	p[3] = v >> 24;
+}
+
+uint16_t ReportStatusBuild (uint8_t *buffer)
+{
+	Put32 (&buffer[0], probe.seq);
+	Put32 (&buffer[4], probe.rxUs);
+	Put32 (&buffer[8], probe.latchUs);
+	for (int ch = 0; ch < NUM_CHANNELS; ch++) {
+		buffer[12 + channelMap[ch].reportByte] = IndicatorLevel (ch);
+	}
+	buffer[16] = probe.flags;
+
+	return STATUS_REPORT_LEN;
+}
@@ -0,0 +1,37 @@
+//---------------------------------------------------------------------------------------------
+// reports.h
+//
+// binary level reports shared by the hid and cdc transports
+//
+// every report starts with its report id, the hid transport gets them from the out
+// endpoint and the cdc transport from the byte stream. see the notes in main.cpp for
+// the layout of each report.
+//
+// ReportReceive applies a report. after a report 0x03 the status report becomes pending
+// once its levels are on the dacs, the transport polls ReportStatusPending, sends the
+// report built by ReportStatusBuild and calls ReportStatusSent.
+//
+
+#ifndef _REPORTS_H_
+#define _REPORTS_H_
+
+#define LEVELS_REPORT_ID    0x01
+#define LEVELS_REPORT_LEN   6      // including report id
+#define RAMP_REPORT_ID      0x02
+#define RAMP_REPORT_LEN     8
+#define PROBE_REPORT_ID     0x03
+#define PROBE_REPORT_LEN    10
+#define STATUS_REPORT_ID    0x04
+#define STATUS_REPORT_LEN   17     // not including report id
+
+#define STATUS_LATCHED      0x01
+#define STATUS_UNCHANGED    0x02
+
+uint16_t ReportLength       (uint8_t report_id);
+bool     ReportReceive      (uint8_t const *buffer, uint16_t bufsize, uint32_t rxUs);
+void     ReportsTask        (void);
+bool     ReportStatusPending (void);
+uint16_t ReportStatusBuild  (uint8_t *buffer);
+void     ReportStatusSent   (void);
+
+#endif
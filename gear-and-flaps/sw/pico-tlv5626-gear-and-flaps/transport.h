@@ -0,0 +1,30 @@
+//---------------------------------------------------------------------------------------------
+// transport.h
+//
+// how the levels get to the board, chosen at build time with -DTRANSPORT=UART|HID|CDC
+//
+//    UART   ascii levels on the uart0 cli only, no usb
+//    HID    usb hid reports, see usb_descriptors.c
+//    CDC    the same reports as a byte stream on a usb cdc serial port
+//
+// the uart0 cli is there in every build, so TransportTask only has work to do for the
+// usb transports.
+//
+
+#ifndef _TRANSPORT_H_
+#define _TRANSPORT_H_
+
+// transport states, the led blinks once more for each state
+enum {
+	TRANSPORT_SUSPENDED = 0,     // 1 blink
+	TRANSPORT_NOT_MOUNTED = 1,   // 2 blinks
+	TRANSPORT_CONFIGURED = 2     // 3 blinks
+};
+
+extern const char *const transportName;
+
+void    TransportInit  (void);
+void    TransportTask  (void);
+uint8_t TransportState (void);
+
+#endif
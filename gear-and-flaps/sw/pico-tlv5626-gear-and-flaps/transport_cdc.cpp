@@ -0,0 +1,141 @@
+//---------------------------------------------------------------------------------------------
+// transport_cdc.cpp
+//
+// the hid reports sent as a byte stream on a cdc serial port
+//
+// each frame is a report id followed by that report's bytes, exactly what is written to
+// the hid device. the length comes from the report id, bytes that are not a known report
+// id are dropped one at a time until the stream lines up with a frame again. a frame not
+// complete within 100 ms is dropped, so a host that stops part way through one, or restarts,
+// doesn't leave the next frame read at the wrong offset. the status report goes back the
+// same way, 0x04 followed by its 17 bytes, and only once the whole frame fits in the tx
+// fifo, so the host never sees part of one.
+//
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "pico/stdlib.h"
+#include "tusb.h"
+
+#include "reports.h"
+#include "transport.h"
+
+
+//---------------------------------------------------------------------------------------------
+// defines
+//
+
+#define FRAME_TIMEOUT_US 100000
+
+
+//---------------------------------------------------------------------------------------------
+// globals
+//
+
+const char *const transportName = "cdc";
+
+static uint8_t usbState = TRANSPORT_NOT_MOUNTED;
+
+// frame being received
+static uint8_t  frame[16];
+static uint16_t frameLength = 0;
+static uint16_t frameNeeded = 0;
+static uint32_t frameUs = 0;
+
+
+//---------------------------------------------------------------------------------------------
+// TransportInit / TransportState
+//
+
+void TransportInit (void)
+{
+	tusb_init ();
+}
+
+uint8_t TransportState (void)
+{
+	return usbState;
+}
+
+
+//---------------------------------------------------------------------------------------------
+// ReceiveByte -- add a byte to the frame, apply the report once it is complete
+//
+
+static void ReceiveByte (uint8_t ch)
+{
+	// drop a frame that stopped part way
+	if (frameLength && (time_us_32 () - frameUs > FRAME_TIMEOUT_US)) {
+		frameLength = 0;
+	}
+
+	if (frameLength == 0) {
+		frameNeeded = ReportLength (ch);
+		if (frameNeeded == 0) {
+			return;
+		}
+		frameUs = time_us_32 ();
+	}
+
+	frame[frameLength++] = ch;
+	if (frameLength == frameNeeded) {
+		ReportReceive (frame, frameLength, frameUs);
+		frameLength = 0;
+	}
+}
+
+
+//---------------------------------------------------------------------------------------------
+// TransportTask -- run tinyusb, apply received frames and send the status report
+//
+
+void TransportTask (void)
+{
+	tud_task ();
+
+	while (tud_cdc_available ()) {
+		uint8_t rx[64];
+		uint32_t n = tud_cdc_read (rx, sizeof (rx));
+		for (uint32_t i = 0; i < n; i++) {
+			ReceiveByte (rx[i]);
+		}
+	}
+
+	// the whole frame or nothing, it stays pending until there is room
+	uint8_t report[1 + STATUS_REPORT_LEN];
+	if (ReportStatusPending () && tud_cdc_connected () && (tud_cdc_write_available () >= sizeof (report))) {
+		report[0] = STATUS_REPORT_ID;
+		ReportStatusBuild (&report[1]);
+		if (tud_cdc_write (report, sizeof (report)) == sizeof (report)) {
+			ReportStatusSent ();
+		}
+		tud_cdc_write_flush ();
+	}
+}
+
+
+//---------------------------------------------------------------------------------------------
+// set usb state via TinyUSB callbacks
+//
+
+void tud_mount_cb (void)
+{
+	usbState = TRANSPORT_CONFIGURED;
+}
+
+void tud_umount_cb (void)
+{
+	usbState = TRANSPORT_NOT_MOUNTED;
+}
+
+void tud_suspend_cb (bool remote_wakeup_en)
+{
+	(void) remote_wakeup_en;
+	usbState = TRANSPORT_SUSPENDED;
+}
+
+void tud_resume_cb (void)
+{
+	usbState = TRANSPORT_CONFIGURED;
+}
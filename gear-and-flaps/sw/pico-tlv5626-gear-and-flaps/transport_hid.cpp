@@ -0,0 +1,118 @@
+//---------------------------------------------------------------------------------------------
+// transport_hid.cpp
+//
+// levels arrive as hid output reports, the status report goes back on the in endpoint
+//
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "pico/stdlib.h"
+#include "tusb.h"
+
+#include "reports.h"
+#include "transport.h"
+
+
+//---------------------------------------------------------------------------------------------
+// globals
+//
+
+const char *const transportName = "hid";
+
+static uint8_t usbState = TRANSPORT_NOT_MOUNTED;
+
+
+//---------------------------------------------------------------------------------------------
+// TransportInit / TransportState
+//
+
+void TransportInit (void)
+{
+	tusb_init ();
+}
+
+uint8_t TransportState (void)
+{
+	return usbState;
+}
+
+
+//---------------------------------------------------------------------------------------------
+// TransportTask -- run tinyusb and send the status report once it is ready
+//
+
+void TransportTask (void)
+{
+	tud_task ();
+
+	if (ReportStatusPending () && tud_hid_ready ()) {
+		uint8_t report[STATUS_REPORT_LEN];
+		ReportStatusBuild (report);
+		if (tud_hid_report (STATUS_REPORT_ID, report, STATUS_REPORT_LEN)) {
+			ReportStatusSent ();
+		}
+	}
+}
+
+
+//---------------------------------------------------------------------------------------------
+// set usb state via TinyUSB callbacks
+//
+
+void tud_mount_cb (void)
+{
+	usbState = TRANSPORT_CONFIGURED;
+}
+
+void tud_umount_cb (void)
+{
+	usbState = TRANSPORT_NOT_MOUNTED;
+}
+
+void tud_suspend_cb (bool remote_wakeup_en)
+{
+	(void) remote_wakeup_en;
+	usbState = TRANSPORT_SUSPENDED;
+}
+
+void tud_resume_cb (void)
+{
+	usbState = TRANSPORT_CONFIGURED;
+}
+
+
+//---------------------------------------------------------------------------------------------
+// TinyUSB HID Get Report callback -- returns the status report
+//
+
+uint16_t tud_hid_get_report_cb (uint8_t itf, uint8_t report_id, hid_report_type_t report_type,
+			uint8_t* buffer, uint16_t reqlen)
+{
+	(void) itf;
+
+	if ((report_id != STATUS_REPORT_ID) || (report_type != HID_REPORT_TYPE_INPUT) ||
+			(reqlen < STATUS_REPORT_LEN)) {
+		return 0;
+	}
+
+	return ReportStatusBuild (buffer);
+}
+
+
+//---------------------------------------------------------------------------------------------
+// TinyUSB HID Set Report callback
+//
+
+void tud_hid_set_report_cb(uint8_t itf, uint8_t report_id, hid_report_type_t report_type, uint8_t const* buffer, uint16_t bufsize)
+{
+	// this example doesn't use itf and report_type
+	(void) itf;
+	(void) report_type;
+
+	// check that we were called from hidd_xfer_cb in lib/tinyusb/src/class/hid/hid_device.c,
+	// the buffer then starts with the report id
+	if (report_id == 0) {
+		ReportReceive (buffer, bufsize, time_us_32 ());
+	}
+}
@@ -0,0 +1,28 @@
+//---------------------------------------------------------------------------------------------
+// transport_uart.cpp
+//
+// levels arrive on the uart0 cli in main.cpp, nothing to do here
+//
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "pico/stdlib.h"
+
+#include "transport.h"
+
+
+const char *const transportName = "uart";
+
+void TransportInit (void)
+{
+}
+
+void TransportTask (void)
+{
+}
+
+uint8_t TransportState (void)
+{
+	return TRANSPORT_CONFIGURED;
+}
@@ -95,15 +95,25 @@
 #endif
 
 //------------- CLASS -------------//
+// one class per build, TRANSPORT_CDC is set by CMakeLists.txt
+#ifdef TRANSPORT_CDC
+#define CFG_TUD_CDC               1
+#define CFG_TUD_HID               0
+#else
 #define CFG_TUD_CDC               0
-#define CFG_TUD_MSC               0
 #define CFG_TUD_HID               1
+#endif
+#define CFG_TUD_MSC               0
 #define CFG_TUD_MIDI              0
 #define CFG_TUD_VENDOR            0
 
 // HID buffer size Should be sufficient to hold ID (if any) + Data
 #define CFG_TUD_HID_EP_BUFSIZE    64
 
+// CDC FIFO size of TX and RX
+#define CFG_TUD_CDC_RX_BUFSIZE    64
+#define CFG_TUD_CDC_TX_BUFSIZE    64
+
 #ifdef __cplusplus
  }
 #endif
@@ -34,13 +34,25 @@ tusb_desc_device_t const desc_device =
     .bLength            = sizeof(tusb_desc_device_t),
     .bDescriptorType    = TUSB_DESC_DEVICE,
     .bcdUSB             = 0x0200,
+#if CFG_TUD_CDC
+    // Use Interface Association Descriptor (IAD) for CDC
+    // As required by USB Specs IAD's subclass must be common class (2) and protocol must be IAD (1)
+    .bDeviceClass       = TUSB_CLASS_MISC,
+    .bDeviceSubClass    = MISC_SUBCLASS_COMMON,
+    .bDeviceProtocol    = MISC_PROTOCOL_IAD,
+#else
     .bDeviceClass       = 0x00,
     .bDeviceSubClass    = 0x00,
     .bDeviceProtocol    = 0x00,
+#endif
     .bMaxPacketSize0    = CFG_TUD_ENDPOINT0_SIZE,
 
     .idVendor           = 0x4247, // vendor id - my poached vendor id
+#if CFG_TUD_CDC
+    .idProduct          = 0x0024, // product id - USB Gear and Flaps Indicators, serial
+#else
     .idProduct          = 0x0023, // product id - USB Gear and Flaps Indicators
+#endif
     .bcdDevice          = 0x0100,
 
     .iManufacturer      = 0x01,
@@ -57,9 +69,11 @@ uint8_t const * tud_descriptor_device_cb(void)
   return (uint8_t const *) &desc_device;
 }
 
+#if CFG_TUD_HID
+
 //--------------------------------------------------------------------+
 // HID Report Descriptor
-// a single OUT report with report ID of 1
+// an OUT report with report ID of 1
 // first byte is accept mask:
 //   0x80 to accept channel 0
 //   0x40 to accept channel 1
@@ -70,6 +84,12 @@ uint8_t const * tud_descriptor_device_cb(void)
 //   valid range from 32 to 224
 //   values below 32 are set 32
 //   values above 224 are set to 224
+// an OUT report with report ID of 2
+// same as report 1 followed by a little endian transition time in ms
+// an OUT report with report ID of 3
+// same as report 1 followed by a little endian 32 bit sequence number
+// an IN report with report ID of 4
+// status of the last report 3, see notes in main.cpp
 //--------------------------------------------------------------------+
 
 uint8_t const desc_hid_report[] =
@@ -86,6 +106,30 @@ uint8_t const desc_hid_report[] =
 	0x09, 0x01,        //   Usage (0x01)
 	0x91, 0x02,        //   Output (Data,Var,Abs,No Wrap,Linear,Preferred State,No Null Position)
 
+	0x85, 0x02,        //   Report ID (2)
+	0x95, 0x07,        //   Report Count (7)
+	0x75, 0x08,        //   Report Size (8)
+	0x26, 0xFF, 0x00,  //   Logical Maximum (255)
+	0x15, 0x00,        //   Logical Minimum (0)
+	0x09, 0x02,        //   Usage (0x02)
+	0x91, 0x02,        //   Output (Data,Var,Abs,No Wrap,Linear,Preferred State,No Null Position)
+
+	0x85, 0x03,        //   Report ID (3)
+	0x95, 0x09,        //   Report Count (9)
+	0x75, 0x08,        //   Report Size (8)
+	0x26, 0xFF, 0x00,  //   Logical Maximum (255)
+	0x15, 0x00,        //   Logical Minimum (0)
+	0x09, 0x03,        //   Usage (0x03)
+	0x91, 0x02,        //   Output (Data,Var,Abs,No Wrap,Linear,Preferred State,No Null Position)
+
+	0x85, 0x04,        //   Report ID (4)
+	0x95, 0x11,        //   Report Count (17)
+	0x75, 0x08,        //   Report Size (8)
+	0x26, 0xFF, 0x00,  //   Logical Maximum (255)
+	0x15, 0x00,        //   Logical Minimum (0)
+	0x09, 0x04,        //   Usage (0x04)
+	0x81, 0x02,        //   Input (Data,Var,Abs,No Wrap,Linear,Preferred State,No Null Position)
+
 	0xC0              // End Collection
 };
 
@@ -112,15 +156,52 @@ enum
 
 #define EPNUM_HID   0x01
 
+// interrupt endpoint polling interval in ms, every ms adds up to that much latency to
+// each level change
+#ifndef HID_POLL_INTERVAL_MS
+#define HID_POLL_INTERVAL_MS 1
+#endif
+
 uint8_t const desc_configuration[] =
 {
   // Config number, interface count, string index, total length, attribute, power in mA
   TUD_CONFIG_DESCRIPTOR(1, ITF_NUM_TOTAL, 0, CONFIG_TOTAL_LEN, 0x00, 100),
 
   // Interface number, string index, protocol, report descriptor len, EP In & Out address, size & polling interval
-  TUD_HID_INOUT_DESCRIPTOR(ITF_NUM_HID, 0, HID_ITF_PROTOCOL_NONE, sizeof(desc_hid_report), EPNUM_HID, 0x80 | EPNUM_HID, CFG_TUD_HID_EP_BUFSIZE, 10)
+  TUD_HID_INOUT_DESCRIPTOR(ITF_NUM_HID, 0, HID_ITF_PROTOCOL_NONE, sizeof(desc_hid_report), EPNUM_HID, 0x80 | EPNUM_HID, CFG_TUD_HID_EP_BUFSIZE, HID_POLL_INTERVAL_MS)
 };
 
+#else
+
+//--------------------------------------------------------------------+
+// Configuration Descriptor, CDC
+// the hid reports as a byte stream, see transport_cdc.cpp
+//--------------------------------------------------------------------+
+
+enum
+{
+  ITF_NUM_CDC = 0,
+  ITF_NUM_CDC_DATA,
+  ITF_NUM_TOTAL
+};
+
+#define CONFIG_TOTAL_LEN    (TUD_CONFIG_DESC_LEN + TUD_CDC_DESC_LEN)
+
+#define EPNUM_CDC_NOTIF   0x81
+#define EPNUM_CDC_OUT     0x02
+#define EPNUM_CDC_IN      0x82
+
+uint8_t const desc_configuration[] =
+{
+  // Config number, interface count, string index, total length, attribute, power in mA
+  TUD_CONFIG_DESCRIPTOR(1, ITF_NUM_TOTAL, 0, CONFIG_TOTAL_LEN, 0x00, 100),
+
+  // Interface number, string index, EP notification address and size, EP data address (out, in) and size.
+  TUD_CDC_DESCRIPTOR(ITF_NUM_CDC, 4, EPNUM_CDC_NOTIF, 8, EPNUM_CDC_OUT, EPNUM_CDC_IN, 64)
+};
+
+#endif
+
 // Invoked when received GET CONFIGURATION DESCRIPTOR
 // Application return pointer to descriptor
 // Descriptor contents must exist long enough for transfer to complete
@@ -141,6 +222,7 @@ char const* string_desc_arr [] =
   "bikerglen.com",                  // 1: Manufacturer
   "USB Gear and Flaps Indicator",   // 2: Product
   "123456",                         // 3: Serial, not used, returns pico unique board id string
+  "Gear and Flaps Reports",         // 4: CDC Interface
 };
 
 static uint16_t _desc_str[32];
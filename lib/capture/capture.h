@@ -0,0 +1,199 @@
+//---------------------------------------------------------------------------------------------
+// capture.h
+//
+// header only reader and writer for sample captures, the host side of record.py
+//
+// a capture is a header, one channel entry per channel, then int16 samples interleaved one
+// set at a time, the layout convert.py unpacks with struct.unpack ("<hhhh"). everything is
+// little endian.
+//
+//    Header     32 bytes    magic "SCAP", version, channel count, sample rate, set count,
+//                           start time in unix microseconds
+//    Channel    32 bytes    name, volts = count * scale + offset
+//    samples    channels * 2 bytes per set
+//
+// sets is patched in when the recorder closes the file. a recorder that was killed leaves
+// it 0 and the reader works it out from the file size instead.
+//
+//    capture::Reader r;
+//    if (r.Open ("run.cap")) {
+//        int ref = r.Find ("Vr1-Vr2");
+//        while ((n = r.Read (buf, 4096)) > 0) { ... buf[i * r.Channels () + ref] ... }
+//    }
+//
+
+#ifndef _CAPTURE_H_
+#define _CAPTURE_H_
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+namespace capture {
+
+static constexpr char     MAGIC[4] = { 'S', 'C', 'A', 'P' };
+static constexpr uint16_t VERSION = 1;
+
+struct Header {
+	char     magic[4];
+	uint16_t version;
+	uint16_t channels;
+	uint32_t sampleHz;    // sets per second
+	uint32_t reserved;
+	uint64_t sets;        // 0 if the recorder did not close the file
+	int64_t  startUs;     // unix time of the first set
+};
+
+struct Channel {
+	char     name[16];    // nul padded, for example "Vs1-Vs3"
+	float    scale;       // volts per count
+	float    offset;      // volts at count 0
+	uint32_t reserved[2];
+};
+
+static_assert (sizeof (Header) == 32, "capture header layout");
+static_assert (sizeof (Channel) == 32, "capture channel layout");
+
+
+//---------------------------------------------------------------------------------------------
+// MakeChannel
+//
+
+inline Channel MakeChannel (const char *name, float scale, float offset = 0.0f)
+{
+	Channel c = {};
+	strncpy (c.name, name, sizeof (c.name) - 1);
+	c.scale = scale;
+	c.offset = offset;
+	return c;
+}
+
+
+//---------------------------------------------------------------------------------------------
+// Writer
+//
+
+class Writer {
+public:
+	~Writer () { Close (); }
+
+	bool Open (const char *path, uint32_t sampleHz, const std::vector<Channel> &channels, int64_t startUs = 0)
+	{
+		Close ();
+		f = fopen (path, "wb");
+		if (!f) {
+			return false;
+		}
+		memset (&header, 0, sizeof (header));
+		memcpy (header.magic, MAGIC, sizeof (MAGIC));
+		header.version = VERSION;
+		header.channels = (uint16_t)channels.size ();
+		header.sampleHz = sampleHz;
+		header.startUs = startUs;
+		return (fwrite (&header, sizeof (header), 1, f) == 1) &&
+			(fwrite (channels.data (), sizeof (Channel), channels.size (), f) == channels.size ());
+	}
+
+	bool Write (const int16_t *samples, size_t sets)
+	{
+		if (!f || (fwrite (samples, header.channels * sizeof (int16_t), sets, f) != sets)) {
+			return false;
+		}
+		header.sets += sets;
+		return true;
+	}
+
+	// patches the set count into the header
+	bool Close (void)
+	{
+		if (!f) {
+			return true;
+		}
+		bool ok = (fseek (f, 0, SEEK_SET) == 0) && (fwrite (&header, sizeof (header), 1, f) == 1);
+		ok = (fclose (f) == 0) && ok;
+		f = NULL;
+		return ok;
+	}
+
+private:
+	FILE  *f = NULL;
+	Header header;
+};
+
+
+//---------------------------------------------------------------------------------------------
+// Reader
+//
+
+class Reader {
+public:
+	~Reader () { Close (); }
+
+	bool Open (const char *path)
+	{
+		Close ();
+		f = fopen (path, "rb");
+		if (!f || (fread (&header, sizeof (header), 1, f) != 1) ||
+				memcmp (header.magic, MAGIC, sizeof (MAGIC)) || (header.version != VERSION) ||
+				(header.channels == 0)) {
+			Close ();
+			return false;
+		}
+		channels.resize (header.channels);
+		if (fread (channels.data (), sizeof (Channel), header.channels, f) != header.channels) {
+			Close ();
+			return false;
+		}
+
+		// a capture that was never closed has no set count
+		if (header.sets == 0) {
+			long dataStart = ftell (f);
+			fseek (f, 0, SEEK_END);
+			header.sets = (ftell (f) - dataStart) / (header.channels * sizeof (int16_t));
+			fseek (f, dataStart, SEEK_SET);
+		}
+		return true;
+	}
+
+	void Close (void)
+	{
+		if (f) {
+			fclose (f);
+			f = NULL;
+		}
+	}
+
+	// index of the channel called name, -1 if there is none
+	int Find (const char *name) const
+	{
+		for (size_t i = 0; i < channels.size (); i++) {
+			if (!strncmp (channels[i].name, name, sizeof (channels[i].name))) {
+				return (int)i;
+			}
+		}
+		return -1;
+	}
+
+	// up to maxSets sets into samples, returns the sets read
+	size_t Read (int16_t *samples, size_t maxSets)
+	{
+		return f ? fread (samples, header.channels * sizeof (int16_t), maxSets, f) : 0;
+	}
+
+	const Header &Info (void) const { return header; }
+	int Channels (void) const { return header.channels; }
+	const Channel &Chan (int i) const { return channels[i]; }
+	std::string Name (int i) const { return std::string (channels[i].name, strnlen (channels[i].name, sizeof (channels[i].name))); }
+
+private:
+	FILE  *f = NULL;
+	Header header;
+	std::vector<Channel> channels;
+};
+
+}
+
+#endif
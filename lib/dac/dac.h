@@ -0,0 +1,184 @@
+//---------------------------------------------------------------------------------------------
+// dac.h
+//
+// header only driver for the spi dacs used on these boards, MCP4802 and TLV5626
+//
+// a dac is a type, Dac<Model, Bus, CsPin>. Model builds the 16 bit command words, Bus moves
+// them, see dac_pico.h for the rp2040 spi and dac_recording.h for a host backend that
+// records every transfer. the command words are constexpr, with constant arguments they
+// fold to the same immediates the old hand written code used, and everything inlines to
+// a gpio_put, the spi write and a gpio_put.
+//
+// a Bus provides
+//    Select (pin), Deselect (pin)    chip select low and high
+//    Start (word)                    queue one word, at most 8 words between Finish calls
+//    Finish ()                       wait for the bus to go idle and drop what was clocked in
+//    Write (word)                    Start then Finish
+//
+// for 8 bit bus frames, as on the TLV5626 boards, the bus sends the word high byte first.
+//
+
+#ifndef _DAC_H_
+#define _DAC_H_
+
+#include <stdint.h>
+
+namespace dac {
+
+
+//---------------------------------------------------------------------------------------------
+// Mcp4802 -- dual 8 bit dac, one word per write
+//
+//    bit 15       channel, 0 A, 1 B
+//    bit 13       gain, 0 2x, 1 1x
+//    bit 12       0 shut down the channel, 1 active
+//    bits 11-4    level
+//
+
+struct Mcp4802 {
+	enum Channel : uint16_t { A = 0x0000, B = 0x8000 };
+	enum Gain : uint16_t { GAIN_2X = 0x0000, GAIN_1X = 0x2000 };
+
+	static constexpr uint16_t ACTIVE = 0x1000;
+
+	static constexpr uint16_t Word (Channel ch, uint8_t level, Gain gain = GAIN_1X)
+	{
+		return ch | gain | ACTIVE | ((uint16_t)level << 4);
+	}
+
+	static constexpr uint16_t Shutdown (Channel ch)
+	{
+		return ch;
+	}
+};
+
+static_assert (Mcp4802::Word (Mcp4802::A, 0x80) == 0x3800, "mcp4802 mid scale on A");
+static_assert (Mcp4802::Word (Mcp4802::B, 0x00) == 0xB000, "mcp4802 zero on B");
+
+
+//---------------------------------------------------------------------------------------------
+// Tlv5626 -- dual 8 bit dac with a double buffer for B
+//
+//    bits 15,12   register, see Register
+//    bit 14       speed, bit 13 power down, for the control register only
+//    bits 11-4    level
+//    bits 1-0     reference, control register only
+//
+// writing A also moves the buffer to B, so B_AND_BUFFER then A_AND_B updates both outputs
+// at the same time.
+//
+
+struct Tlv5626 {
+	enum Register : uint16_t {
+		B_AND_BUFFER = 0x0000,    // write dac B and the buffer
+		BUFFER       = 0x1000,    // write the buffer only
+		A_AND_B      = 0x8000,    // write dac A and move the buffer to dac B
+		CONTROL      = 0x9000
+	};
+	enum Reference : uint16_t { REF_EXTERNAL = 0x0000, REF_1V024 = 0x0001, REF_2V048 = 0x0002 };
+
+	static constexpr uint16_t Word (Register reg, uint8_t level)
+	{
+		return reg | ((uint16_t)level << 4);
+	}
+
+	static constexpr uint16_t Control (Reference ref)
+	{
+		return CONTROL | ref;
+	}
+};
+
+static_assert (Tlv5626::Word (Tlv5626::A_AND_B, 0xAB) == 0x8AB0, "tlv5626 dac A");
+static_assert (Tlv5626::Control (Tlv5626::REF_1V024) == 0x9001, "tlv5626 control, 1.024V");
+
+
+//---------------------------------------------------------------------------------------------
+// Write -- one word to the chip on pin, for chip selects that come from a table
+//
+
+template <class Bus>
+inline void Write (unsigned csPin, uint16_t word)
+{
+	Bus::Select (csPin);
+	Bus::Write (word);
+	Bus::Deselect (csPin);
+}
+
+
+//---------------------------------------------------------------------------------------------
+// Dac -- one chip
+//
+
+template <class Model, class Bus, unsigned CsPin>
+struct Dac {
+	typedef Model model;
+	typedef Bus bus;
+	static constexpr unsigned csPin = CsPin;
+
+	static inline void Write (uint16_t word)
+	{
+		dac::Write<Bus> (CsPin, word);
+	}
+
+	// start a write and leave the chip selected, for overlapping writes on two buses
+	static inline void Start (uint16_t word)
+	{
+		Bus::Select (CsPin);
+		Bus::Start (word);
+	}
+
+	static inline void Finish (void)
+	{
+		Bus::Finish ();
+		Bus::Deselect (CsPin);
+	}
+};
+
+
+//---------------------------------------------------------------------------------------------
+// Bank -- chips sharing a bus, written in one pass
+//
+
+template <class Bus, unsigned... CsPins>
+struct Bank {
+	static constexpr unsigned size = sizeof... (CsPins);
+
+	// the same word to every chip with one transfer, all chip selects low together
+	static inline void Broadcast (uint16_t word)
+	{
+		(Bus::Select (CsPins), ...);
+		Bus::Write (word);
+		(Bus::Deselect (CsPins), ...);
+	}
+
+	// one word per chip, back to back
+	static inline void Write (const uint16_t (&words)[size])
+	{
+		unsigned i = 0;
+		((Bus::Select (CsPins), Bus::Write (words[i++]), Bus::Deselect (CsPins)), ...);
+	}
+
+	// one word per chip, skipping chips whose word matches the shadow of what they hold.
+	// returns the number of chips written
+	static inline unsigned Update (const uint16_t (&words)[size], uint16_t (&shadow)[size])
+	{
+		unsigned i = 0, writes = 0;
+		((UpdateOne<CsPins> (words[i], shadow[i], writes), i++), ...);
+		return writes;
+	}
+
+private:
+	template <unsigned CsPin>
+	static inline void UpdateOne (uint16_t word, uint16_t &shadow, unsigned &writes)
+	{
+		if (word != shadow) {
+			dac::Write<Bus> (CsPin, word);
+			shadow = word;
+			writes++;
+		}
+	}
+};
+
+}
+
+#endif
@@ -0,0 +1,73 @@
+//---------------------------------------------------------------------------------------------
+// dac_pico.h
+//
+// rp2040 spi bus for dac.h
+//
+// PicoSpi<0> and PicoSpi<1> are spi0 and spi1. Bits is the frame size the bus was set up
+// with by spi_set_format, 16 for the MCP4802 boards and 8 for the TLV5626 boards. the
+// caller sets up the spi and the chip select pins as before.
+//
+
+#ifndef _DAC_PICO_H_
+#define _DAC_PICO_H_
+
+#include "pico/stdlib.h"
+#include "hardware/gpio.h"
+#include "hardware/spi.h"
+
+#include "dac.h"
+
+namespace dac {
+
+template <unsigned Index, unsigned Bits = 16>
+struct PicoSpi {
+	static_assert (Index < 2, "rp2040 has spi0 and spi1");
+	static_assert (Bits == 8 || Bits == 16, "8 or 16 bit frames");
+
+	static inline spi_inst_t *Inst (void)
+	{
+		return Index ? spi1 : spi0;
+	}
+
+	static inline void Select (unsigned pin)
+	{
+		gpio_put (pin, 0);
+	}
+
+	static inline void Deselect (unsigned pin)
+	{
+		gpio_put (pin, 1);
+	}
+
+	static inline void Start (uint16_t word)
+	{
+		if constexpr (Bits == 16) {
+			spi_get_hw (Inst ())->dr = word;
+		} else {
+			spi_get_hw (Inst ())->dr = word >> 8;
+			spi_get_hw (Inst ())->dr = word & 0xff;
+		}
+	}
+
+	// same as the tail of spi_write16_blocking
+	static inline void Finish (void)
+	{
+		while (spi_is_busy (Inst ())) {
+			tight_loop_contents ();
+		}
+		while (spi_is_readable (Inst ())) {
+			(void) spi_get_hw (Inst ())->dr;
+		}
+		spi_get_hw (Inst ())->icr = SPI_SSPICR_RORIC_BITS;
+	}
+
+	static inline void Write (uint16_t word)
+	{
+		Start (word);
+		Finish ();
+	}
+};
+
+}
+
+#endif
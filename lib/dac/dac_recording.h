@@ -0,0 +1,75 @@
+//---------------------------------------------------------------------------------------------
+// dac_recording.h
+//
+// host bus for dac.h that records every word with the chip selects that were low when it
+// was sent, so the traffic of a driver can be checked without hardware
+//
+//    typedef dac::RecordingSpi<0> Bus;
+//    dac::Dac<dac::Mcp4802, Bus, 5>::Write (dac::Mcp4802::Word (dac::Mcp4802::B, 10));
+//    Bus::log[0].word == 0xB0A0, Bus::log[0].selected == 1u << 5
+//
+
+#ifndef _DAC_RECORDING_H_
+#define _DAC_RECORDING_H_
+
+#include <stdint.h>
+#include <vector>
+
+#include "dac.h"
+
+namespace dac {
+
+template <unsigned Id>
+struct RecordingSpi {
+	struct Transfer {
+		uint16_t word;
+		uint32_t selected;    // bit n set when pin n was selected
+		bool operator== (const Transfer &t) const { return word == t.word && selected == t.selected; }
+	};
+
+	static inline std::vector<Transfer> log;
+	static inline uint32_t selected = 0;
+	static inline unsigned pending = 0;     // words started and not finished
+	static inline unsigned maxPending = 0;
+
+	static void Clear (void)
+	{
+		log.clear ();
+		selected = 0;
+		pending = 0;
+		maxPending = 0;
+	}
+
+	static void Select (unsigned pin)
+	{
+		selected |= 1u << pin;
+	}
+
+	static void Deselect (unsigned pin)
+	{
+		selected &= ~(1u << pin);
+	}
+
+	static void Start (uint16_t word)
+	{
+		log.push_back ({ word, selected });
+		if (++pending > maxPending) {
+			maxPending = pending;
+		}
+	}
+
+	static void Finish (void)
+	{
+		pending = 0;
+	}
+
+	static void Write (uint16_t word)
+	{
+		Start (word);
+		Finish ();
+	}
+};
+
+}
+
+#endif
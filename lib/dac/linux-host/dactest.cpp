@@ -0,0 +1,299 @@
+//---------------------------------------------------------------------------------------------
+// notes
+//
+// dactest -- dac.h through dac_recording.h against the hand written dac code it replaced
+//
+// usage:
+//    dactest
+//
+// the expected words and chip selects are the ones the firmwares sent before lib/dac,
+// written out as those firmwares wrote them:
+//
+//    mcp4802    dacWrite16's 0x3800 and 0xB000 and the isrs' 0xB000 | level << 4, for
+//               every level
+//    tlv5626    dacdma.cpp's txB and txA bytes for every level, and the start up bytes of
+//               dacWrite2, with 0x90 DAC_REF for the control word
+//    fuel747    the start up writes of the reference dac and of each gauge dac from
+//               gaugeMap, one chip select at a time
+//    broadcast  dacWrite2 (0x0F, ...) at start up, every chip select on a bus low for the
+//               two bytes, spi0 then spi1
+//    bank       Bank::Write one word per chip in pin order, Bank::Update only the chips
+//               whose word differs from the shadow, and the shadow after
+//    overlap    Dac::Start on two buses leaves both chips selected until Finish
+//
+// it prints each check that fails and the exit status is the number of failures.
+//
+
+//---------------------------------------------------------------------------------------------
+// includes
+//
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <vector>
+
+#include "dac/dac.h"
+#include "dac/dac_recording.h"
+
+
+//---------------------------------------------------------------------------------------------
+// defines
+//
+
+#define CHECK(cond) Check ((cond), #cond, __LINE__)
+
+
+//---------------------------------------------------------------------------------------------
+// typedefs
+//
+
+typedef dac::Mcp4802 Mcp;
+typedef dac::Tlv5626 Tlv;
+
+typedef dac::RecordingSpi<0> Spi0;
+typedef dac::RecordingSpi<1> Spi1;
+
+
+//---------------------------------------------------------------------------------------------
+// globals
+//
+
+static int failures = 0;
+static const char *test = "";
+
+
+//---------------------------------------------------------------------------------------------
+// Check
+//
+
+static void Check (bool cond, const char *text, int line)
+{
+	if (!cond) {
+		printf ("%s: line %d: %s\n", test, line, text);
+		failures++;
+	}
+}
+
+
+//---------------------------------------------------------------------------------------------
+// Start -- a new test with empty logs
+//
+
+static void Start (const char *name)
+{
+	test = name;
+	Spi0::Clear ();
+	Spi1::Clear ();
+}
+
+
+//---------------------------------------------------------------------------------------------
+// Pins -- selected mask of a list of pins
+//
+
+static uint32_t Pins (std::initializer_list<unsigned> pins)
+{
+	uint32_t mask = 0;
+	for (unsigned pin : pins) {
+		mask |= 1u << pin;
+	}
+
+	return mask;
+}
+
+
+//---------------------------------------------------------------------------------------------
+// TestMcp4802
+//
+
+static void TestMcp4802 (void)
+{
+	Start ("mcp4802");
+
+	CHECK (Mcp::Word (Mcp::A, 0x80) == 0x3800);
+	CHECK (Mcp::Word (Mcp::B, 0x00) == 0xB000);
+	for (int level = 0; level < 256; level++) {
+		CHECK (Mcp::Word (Mcp::B, level) == (0xB000 | ((uint16_t)level << 4)));
+	}
+}
+
+
+//---------------------------------------------------------------------------------------------
+// TestTlv5626
+//
+
+static void TestTlv5626 (void)
+{
+	Start ("tlv5626");
+
+	for (int level = 0; level < 256; level++) {
+		uint16_t wordB = Tlv::Word (Tlv::B_AND_BUFFER, level);
+		uint16_t wordA = Tlv::Word (Tlv::A_AND_B, level);
+		CHECK ((wordB >> 8) == (0x00 | ((level >> 4) & 0x0f)));
+		CHECK ((wordB & 0xff) == (0x00 | ((level << 4) & 0xf0)));
+		CHECK ((wordA >> 8) == (0x80 | ((level >> 4) & 0x0f)));
+		CHECK ((wordA & 0xff) == (0x00 | ((level << 4) & 0xf0)));
+	}
+
+	CHECK (Tlv::Word (Tlv::B_AND_BUFFER, 0) == ((0x00 << 8) | 0x00));
+	CHECK (Tlv::Word (Tlv::A_AND_B, 0) == ((0x80 << 8) | 0x00));
+	CHECK (Tlv::Control (Tlv::REF_1V024) == ((0x90 << 8) | 0x01));
+	CHECK (Tlv::Control (Tlv::REF_2V048) == ((0x90 << 8) | 0x02));
+}
+
+
+//---------------------------------------------------------------------------------------------
+// TestFuel747 -- fuel747's start up, reference dac on pin 13 and gauges on 11 and 10
+//
+
+static void TestFuel747 (void)
+{
+	static const unsigned gaugePins[2] = { 11, 10 };
+
+	Start ("fuel747");
+
+	typedef dac::Dac<Mcp, Spi1, 13> RefDac;
+	RefDac::Write (Mcp::Word (Mcp::A, 0x80));
+	RefDac::Write (Mcp::Word (Mcp::B, 0x00));
+	for (unsigned pin : gaugePins) {
+		dac::Write<Spi1> (pin, Mcp::Word (Mcp::A, 0x80));
+		dac::Write<Spi1> (pin, Mcp::Word (Mcp::B, 0x00));
+	}
+
+	// dacWrite16 (cs, 0x3800), dacWrite16 (cs, 0xB000) for each chip
+	const std::vector<Spi1::Transfer> old = {
+		{ 0x3800, Pins ({ 13 }) }, { 0xB000, Pins ({ 13 }) },
+		{ 0x3800, Pins ({ 11 }) }, { 0xB000, Pins ({ 11 }) },
+		{ 0x3800, Pins ({ 10 }) }, { 0xB000, Pins ({ 10 }) }
+	};
+	CHECK (Spi1::log == old);
+	CHECK (Spi1::selected == 0);
+	CHECK (Spi1::maxPending == 1);
+	CHECK (Spi0::log.empty ());
+}
+
+
+//---------------------------------------------------------------------------------------------
+// TestBroadcast -- gear and flaps start up, chips 0 and 1 on spi0 pins 5 and 6, chips 2
+//                  and 3 on spi1 pins 13 and 11
+//
+
+static void TestBroadcast (void)
+{
+	const uint8_t DAC_REF = 0x01;
+
+	Start ("broadcast");
+
+	typedef dac::Bank<Spi0, 5, 6> Spi0Dacs;
+	typedef dac::Bank<Spi1, 13, 11> Spi1Dacs;
+	const uint16_t dacInit[] = {
+		Tlv::Word (Tlv::B_AND_BUFFER, 0),
+		Tlv::Word (Tlv::A_AND_B, 0),
+		Tlv::Control ((Tlv::Reference)DAC_REF),
+		Tlv::Word (Tlv::B_AND_BUFFER, 0),
+		Tlv::Word (Tlv::A_AND_B, 0)
+	};
+	for (uint16_t word : dacInit) {
+		Spi0Dacs::Broadcast (word);
+		Spi1Dacs::Broadcast (word);
+	}
+
+	// dacWrite2 (0x0F, a, b), the same two bytes on both buses with all four selected
+	const uint8_t old[5][2] = {
+		{ 0x00, 0x00 }, { 0x80, 0x00 }, { 0x90, DAC_REF }, { 0x00, 0x00 }, { 0x80, 0x00 }
+	};
+	CHECK (Spi0::log.size () == 5);
+	CHECK (Spi1::log.size () == 5);
+	for (unsigned i = 0; (i < 5) && (i < Spi0::log.size ()) && (i < Spi1::log.size ()); i++) {
+		uint16_t word = (old[i][0] << 8) | old[i][1];
+		CHECK (Spi0::log[i] == (Spi0::Transfer { word, Pins ({ 5, 6 }) }));
+		CHECK (Spi1::log[i] == (Spi1::Transfer { word, Pins ({ 13, 11 }) }));
+	}
+	CHECK (Spi0::selected == 0);
+	CHECK (Spi1::selected == 0);
+}
+
+
+//---------------------------------------------------------------------------------------------
+// TestBank
+//
+
+static void TestBank (void)
+{
+	typedef dac::Bank<Spi0, 5, 6, 7> Dacs;
+	const uint16_t words[3] = { 0xB100, 0xB200, 0xB300 };
+	uint16_t shadow[3] = { 0xB100, 0x0000, 0xB300 };
+
+	Start ("bank");
+	Dacs::Write (words);
+	const std::vector<Spi0::Transfer> all = {
+		{ 0xB100, Pins ({ 5 }) }, { 0xB200, Pins ({ 6 }) }, { 0xB300, Pins ({ 7 }) }
+	};
+	CHECK (Spi0::log == all);
+
+	Start ("bank");
+	CHECK (Dacs::Update (words, shadow) == 1);
+	const std::vector<Spi0::Transfer> changed = { { 0xB200, Pins ({ 6 }) } };
+	CHECK (Spi0::log == changed);
+	CHECK ((shadow[0] == 0xB100) && (shadow[1] == 0xB200) && (shadow[2] == 0xB300));
+
+	// nothing left to write
+	Start ("bank");
+	CHECK (Dacs::Update (words, shadow) == 0);
+	CHECK (Spi0::log.empty ());
+	CHECK (Spi0::selected == 0);
+}
+
+
+//---------------------------------------------------------------------------------------------
+// TestOverlap -- dig2synchro's isr starts dac 2 on spi1 while it writes spi0
+//
+
+static void TestOverlap (void)
+{
+	typedef dac::Dac<Mcp, Spi0, 5> Dac0;
+	typedef dac::Dac<Mcp, Spi1, 13> Dac2;
+
+	Start ("overlap");
+	Dac2::Start (Mcp::Word (Mcp::B, 0x40));
+	CHECK (Spi1::selected == Pins ({ 13 }));
+	Dac0::Write (Mcp::Word (Mcp::B, 0x20));
+	CHECK (Spi1::selected == Pins ({ 13 }));
+	CHECK (Spi1::pending == 1);
+	Dac2::Finish ();
+
+	const std::vector<Spi0::Transfer> spi0 = { { 0xB200, Pins ({ 5 }) } };
+	const std::vector<Spi1::Transfer> spi1 = { { 0xB400, Pins ({ 13 }) } };
+	CHECK (Spi0::log == spi0);
+	CHECK (Spi1::log == spi1);
+	CHECK (Spi1::selected == 0);
+	CHECK (Spi1::pending == 0);
+}
+
+
+//---------------------------------------------------------------------------------------------
+// main
+//
+
+int main (int argc, char *argv[])
+{
+	(void) argv;
+
+	if (argc > 1) {
+		fprintf (stderr, "usage: dactest\n");
+		return 2;
+	}
+
+	TestMcp4802 ();
+	TestTlv5626 ();
+	TestFuel747 ();
+	TestBroadcast ();
+	TestBank ();
+	TestOverlap ();
+
+	printf ("%s, %d failed\n", failures ? "FAIL" : "pass", failures);
+
+	return failures;
+}
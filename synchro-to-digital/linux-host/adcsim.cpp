@@ -0,0 +1,341 @@
+//---------------------------------------------------------------------------------------------
+// adcsim.cpp
+//
+// the rp2040 adc, dma and interrupt calls sdconv.cpp makes. each conversion goes from the
+// fifo to the running channel paced by DREQ_ADC. a channel that has done its transfer count
+// starts the channel it chains to and raises DMA_IRQ_1, the handler runs there and then as
+// the interrupt would. as on the rp2040 a restarted channel reloads its count but carries on
+// from where its write address got to, so the handler has to put that back.
+//
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "pico/stdlib.h"
+
+#include "hardware/adc.h"
+#include "hardware/dma.h"
+#include "hardware/irq.h"
+
+
+//---------------------------------------------------------------------------------------------
+// defines
+//
+
+// adc clock, one conversion every (1 + clkdiv) clocks, at least 96
+#define ADC_CLOCK_HZ 48000000
+
+
+//---------------------------------------------------------------------------------------------
+// typedefs
+//
+
+typedef struct {
+	bool     claimed;
+	bool     busy;
+	bool     irq1;
+	dma_channel_config config;
+	volatile uint16_t *write;
+	uint32_t count;       // reloaded at each start
+	uint32_t left;
+} Channel;
+
+
+//---------------------------------------------------------------------------------------------
+// globals
+//
+
+adc_hw_t adcSimHw;
+dma_hw_t adcSimDma;
+
+static AdcSource source = 0;
+static uint selected = 0;
+static uint roundRobin = 0;
+static bool running = false;
+static float clkdiv = 0;
+static uint32_t dropped = 0;
+
+static Channel chan[NUM_DMA_CHANNELS];
+static irq_handler_t dmaHandler = 0;
+static bool dmaIrqEnabled = false;
+
+static uint64_t nowNs = 0;
+
+
+//---------------------------------------------------------------------------------------------
+// prototypes
+//
+
+static void Transfer (uint16_t value);
+
+
+//---------------------------------------------------------------------------------------------
+// clock
+//
+
+uint32_t time_us_32 (void)
+{
+	return nowNs / 1000;
+}
+
+
+//---------------------------------------------------------------------------------------------
+// adc
+//
+
+void adc_init (void)
+{
+	selected = 0;
+	roundRobin = 0;
+	running = false;
+}
+
+
+void adc_gpio_init (uint gpio)
+{
+	(void) gpio;
+}
+
+
+void adc_select_input (uint input)
+{
+	selected = input & 3;
+}
+
+
+void adc_set_round_robin (uint mask)
+{
+	roundRobin = mask & 0xf;
+}
+
+
+void adc_fifo_setup (bool en, bool dreq_en, uint16_t dreq_thresh, bool err_in_fifo, bool byte_shift)
+{
+	(void) err_in_fifo;
+	if (!en || !dreq_en || (dreq_thresh != 1) || byte_shift) {
+		printf ("adcsim: only a fifo with a dreq per 12 bit sample is modelled\n");
+	}
+}
+
+
+void adc_set_clkdiv (float div)
+{
+	clkdiv = div;
+}
+
+
+void adc_fifo_drain (void)
+{
+}
+
+
+void adc_run (bool run)
+{
+	running = run;
+}
+
+
+//---------------------------------------------------------------------------------------------
+// dma
+//
+
+int dma_claim_unused_channel (bool required)
+{
+	(void) required;
+	for (int i = 0; i < NUM_DMA_CHANNELS; i++) {
+		if (!chan[i].claimed) {
+			chan[i].claimed = true;
+			return i;
+		}
+	}
+
+	return -1;
+}
+
+
+dma_channel_config dma_channel_get_default_config (uint channel)
+{
+	dma_channel_config c = { DMA_SIZE_32, true, false, 0, channel };
+	return c;
+}
+
+
+void channel_config_set_transfer_data_size (dma_channel_config *c, enum dma_channel_transfer_size size)
+{
+	c->size = size;
+}
+
+
+void channel_config_set_read_increment (dma_channel_config *c, bool incr)
+{
+	c->readIncrement = incr;
+}
+
+
+void channel_config_set_write_increment (dma_channel_config *c, bool incr)
+{
+	c->writeIncrement = incr;
+}
+
+
+void channel_config_set_dreq (dma_channel_config *c, uint dreq)
+{
+	c->dreq = dreq;
+}
+
+
+void channel_config_set_chain_to (dma_channel_config *c, uint chain_to)
+{
+	c->chainTo = chain_to;
+}
+
+
+void dma_channel_configure (uint channel, const dma_channel_config *config, volatile void *write_addr,
+	const volatile void *read_addr, uint transfer_count, bool trigger)
+{
+	if ((config->size != DMA_SIZE_16) || config->readIncrement || (config->dreq != DREQ_ADC) ||
+			(read_addr != &adcSimHw.fifo)) {
+		printf ("adcsim: only 16 bit transfers from the adc fifo are modelled\n");
+	}
+	chan[channel].config = *config;
+	chan[channel].write = (volatile uint16_t *)write_addr;
+	chan[channel].count = transfer_count;
+	if (trigger) {
+		dma_channel_start (channel);
+	}
+}
+
+
+void dma_channel_set_write_addr (uint channel, volatile void *write_addr, bool trigger)
+{
+	chan[channel].write = (volatile uint16_t *)write_addr;
+	if (trigger) {
+		dma_channel_start (channel);
+	}
+}
+
+
+void dma_channel_set_irq1_enabled (uint channel, bool enabled)
+{
+	chan[channel].irq1 = enabled;
+}
+
+
+void dma_channel_start (uint channel)
+{
+	chan[channel].left = chan[channel].count;
+	chan[channel].busy = chan[channel].count > 0;
+}
+
+
+//---------------------------------------------------------------------------------------------
+// irq
+//
+
+void irq_set_exclusive_handler (uint num, irq_handler_t handler)
+{
+	if (num == DMA_IRQ_1) {
+		dmaHandler = handler;
+	}
+}
+
+
+void irq_set_enabled (uint num, bool enabled)
+{
+	if (num == DMA_IRQ_1) {
+		dmaIrqEnabled = enabled;
+	}
+}
+
+
+//---------------------------------------------------------------------------------------------
+// Transfer -- one sample from the fifo to the running channel, if there is one
+//
+
+static void Transfer (uint16_t value)
+{
+	int c;
+
+	for (c = 0; c < NUM_DMA_CHANNELS; c++) {
+		if (chan[c].busy && (chan[c].config.dreq == DREQ_ADC)) {
+			break;
+		}
+	}
+	if (c == NUM_DMA_CHANNELS) {
+		dropped++;
+		return;
+	}
+
+	Channel *ch = &chan[c];
+	*ch->write = value;
+	if (ch->config.writeIncrement) {
+		ch->write++;
+	}
+	if (--ch->left > 0) {
+		return;
+	}
+
+	// done, chain and interrupt
+	ch->busy = false;
+	if (ch->config.chainTo != (uint)c) {
+		dma_channel_start (ch->config.chainTo);
+	}
+	if (ch->irq1) {
+		adcSimDma.ints1.bits |= 1u << c;
+	}
+	if (dmaIrqEnabled && dmaHandler && adcSimDma.ints1.bits) {
+		dmaHandler ();
+		if (adcSimDma.ints1.bits) {
+			printf ("adcsim: DMA_IRQ_1 handler left status 0x%x set\n", (unsigned)adcSimDma.ints1.bits);
+			adcSimDma.ints1.bits = 0;
+		}
+	}
+}
+
+
+//---------------------------------------------------------------------------------------------
+// host only
+//
+
+void AdcSimSource (AdcSource s)
+{
+	source = s;
+}
+
+
+bool AdcSimRunning (void)
+{
+	return running;
+}
+
+
+uint32_t AdcSimDropped (void)
+{
+	return dropped;
+}
+
+
+//---------------------------------------------------------------------------------------------
+// AdcSimRun -- take conversions round robin, nothing until the firmware starts the adc
+//
+
+void AdcSimRun (uint32_t conversions)
+{
+	uint64_t convNs = (uint64_t)((1.0 + clkdiv) * 1e9 / ADC_CLOCK_HZ);
+
+	for (uint32_t n = 0; (n < conversions) && running; n++) {
+		uint input = selected;
+		uint16_t value = source ? (source (input) & 0x0fff) : 0;
+
+		if (roundRobin) {
+			do {
+				selected = (selected + 1) & 3;
+			} while (!(roundRobin & (1 << selected)));
+		}
+
+		nowNs += convNs;
+		adcSimHw.fifo = value;
+		Transfer (value);
+	}
+}
@@ -0,0 +1,148 @@
+//---------------------------------------------------------------------------------------------
+// notes
+//
+// capgen -- writes a synthetic synchro capture in record.py's format, for sdreplay
+//
+// usage:
+//    capgen [-s seconds] [-c carrier_hz] [-a from_deg] [-b to_deg] [-r dps] [-p phase_deg]
+//           [-n noise] [-o offset_v] out.cap
+//
+// the capture has record.py's Vr1-Vr2, Vs1-Vs3 and Vs3-Vs2 at 40000 sets per second and the
+// DI-2108's 10/32768 volts per count, so sdreplay takes it as it takes a recording. it is
+// not a recording, it is the synchro sdmodel and sdsim model, for a regression test that
+// has to be small and has to be in the tree.
+//
+// the shaft holds at from_deg (30) for 100 ms, turns to to_deg (120) at dps (720) and holds
+// there to the end, seconds (0.5) in all. the reference is 8 V peak at carrier_hz, 401 by
+// default so it slips against the generator's nominal 400. the stators are 1800 S/D adc
+// counts peak, delayed by phase_deg (10) of the carrier, with gaussian noise of noise adc
+// counts rms (2) and offset_v volts (0.05) of dc on each, which sdconv.cpp takes off.
+// the noise has a fixed seed so the same options give the same file.
+//
+// testdata/move.cap is capgen's defaults.
+//
+
+//---------------------------------------------------------------------------------------------
+// includes
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+
+#include <random>
+#include <vector>
+
+#include "capture/capture.h"
+
+
+//---------------------------------------------------------------------------------------------
+// defines
+//
+
+#define SAMPLE_HZ     40000
+#define VOLTS_PER_LSB (10.0 / 32768.0)
+#define REF_PEAK_V    8.0
+#define STATOR_PEAK   1800.0                  // S/D adc counts, sdloop.h's nominal
+#define COUNT_V       (10.0 / 2048.0)         // volts per S/D adc count at 10 V full scale
+#define HOLD_S        0.1
+
+
+//---------------------------------------------------------------------------------------------
+// ToSample -- volts to a capture sample
+//
+
+static int16_t ToSample (double v)
+{
+	long s = lround (v / VOLTS_PER_LSB);
+	return (s > 32767) ? 32767 : (s < -32768) ? -32768 : (int16_t)s;
+}
+
+
+//---------------------------------------------------------------------------------------------
+// main
+//
+
+int main (int argc, char *argv[])
+{
+	const char *outName = NULL;
+	double seconds = 0.5, carrier = 401.0, from = 30.0, to = 120.0, dps = 720.0;
+	double phase = 10.0, noise = 2.0, offset = 0.05;
+
+	for (int i = 1; i < argc; i++) {
+		if (!strcmp (argv[i], "-s") && (i + 1 < argc)) {
+			seconds = atof (argv[++i]);
+		} else if (!strcmp (argv[i], "-c") && (i + 1 < argc)) {
+			carrier = atof (argv[++i]);
+		} else if (!strcmp (argv[i], "-a") && (i + 1 < argc)) {
+			from = atof (argv[++i]);
+		} else if (!strcmp (argv[i], "-b") && (i + 1 < argc)) {
+			to = atof (argv[++i]);
+		} else if (!strcmp (argv[i], "-r") && (i + 1 < argc)) {
+			dps = atof (argv[++i]);
+		} else if (!strcmp (argv[i], "-p") && (i + 1 < argc)) {
+			phase = atof (argv[++i]);
+		} else if (!strcmp (argv[i], "-n") && (i + 1 < argc)) {
+			noise = atof (argv[++i]);
+		} else if (!strcmp (argv[i], "-o") && (i + 1 < argc)) {
+			offset = atof (argv[++i]);
+		} else if (!outName && (argv[i][0] != '-')) {
+			outName = argv[i];
+		} else {
+			outName = NULL;
+			break;
+		}
+	}
+	if (!outName || (seconds <= 0) || (carrier <= 0) || (dps <= 0) || (noise < 0)) {
+		fprintf (stderr, "usage: capgen [-s seconds] [-c carrier_hz] [-a from_deg] [-b to_deg] [-r dps] [-p phase_deg]\n"
+			"              [-n noise] [-o offset_v] out.cap\n");
+		return 2;
+	}
+
+	capture::Writer cap;
+	std::vector<capture::Channel> channels = {
+		capture::MakeChannel ("Vr1-Vr2", VOLTS_PER_LSB),
+		capture::MakeChannel ("Vs1-Vs3", VOLTS_PER_LSB),
+		capture::MakeChannel ("Vs3-Vs2", VOLTS_PER_LSB)
+	};
+	if (!cap.Open (outName, SAMPLE_HZ, channels)) {
+		perror (outName);
+		return 2;
+	}
+
+	std::mt19937 rng (1);
+	std::normal_distribution<double> dist (0.0, noise * COUNT_V);
+	uint64_t sets = (uint64_t)llround (seconds * SAMPLE_HZ);
+	double turn = fabs (to - from) / dps;
+
+	for (uint64_t n = 0; n < sets; n++) {
+		double t = (double)n / SAMPLE_HZ;
+		double f = (t < HOLD_S) ? 0 : (t < HOLD_S + turn) ? (t - HOLD_S) / turn : 1;
+		double theta = (from + f * (to - from)) * M_PI / 180.0;
+
+		// the loop demodulates with the sign of Vr2-Vr1, see sdloop.h
+		double wt = 2.0 * M_PI * carrier * t;
+		double ref = sin (wt - phase * M_PI / 180.0);
+		int16_t s[3];
+
+		s[0] = ToSample (-REF_PEAK_V * sin (wt));
+		s[1] = ToSample (STATOR_PEAK * COUNT_V * ref * sin (theta) + offset + dist (rng));
+		s[2] = ToSample (STATOR_PEAK * COUNT_V * ref * sin (theta + 120.0 * M_PI / 180.0) + offset + dist (rng));
+		if (!cap.Write (s, 1)) {
+			perror (outName);
+			return 2;
+		}
+	}
+	if (!cap.Close ()) {
+		perror (outName);
+		return 2;
+	}
+
+	printf ("%llu sets, %.3f s, %.1f to %.1f degrees at %.0f dps, carrier %.1f Hz\n",
+		(unsigned long long)sets, seconds, from, to, dps, carrier);
+
+	return 0;
+}
@@ -0,0 +1,43 @@
+//---------------------------------------------------------------------------------------------
+// hardware/adc.h
+//
+// host stand in for the pico sdk's adc, just the calls sdconv.cpp makes. adcsim.cpp steps
+// the round robin the way the rp2040 does and gets each conversion from a source the host
+// tool sets, which is where the capture goes in. conversions only happen when the host tool
+// asks for them with AdcSimRun, and only once the firmware has started the adc.
+//
+
+#ifndef _HARDWARE_ADC_H_
+#define _HARDWARE_ADC_H_
+
+#include "pico/stdlib.h"
+
+#define DREQ_ADC 36
+
+typedef struct {
+	volatile uint32_t fifo;
+} adc_hw_t;
+
+extern adc_hw_t adcSimHw;
+
+#define adc_hw (&adcSimHw)
+
+void adc_init            (void);
+void adc_gpio_init       (uint gpio);
+void adc_select_input    (uint input);
+void adc_set_round_robin (uint mask);
+void adc_fifo_setup      (bool en, bool dreq_en, uint16_t dreq_thresh, bool err_in_fifo, bool byte_shift);
+void adc_set_clkdiv      (float clkdiv);
+void adc_fifo_drain      (void);
+void adc_run             (bool run);
+
+// host only, the source of every conversion, conversions to take and those that found no
+// dma channel running to take them
+typedef uint16_t (*AdcSource) (uint input);
+
+void     AdcSimSource  (AdcSource source);
+void     AdcSimRun     (uint32_t conversions);
+bool     AdcSimRunning (void);
+uint32_t AdcSimDropped (void);
+
+#endif
@@ -0,0 +1,18 @@
+//---------------------------------------------------------------------------------------------
+// pico/stdlib.h
+//
+// host stand in for the pico sdk header, just what sdconv.cpp uses so it builds into
+// sdreplay. time is adcsim.cpp's clock, one conversion time per conversion.
+//
+
+#ifndef _PICO_STDLIB_H_
+#define _PICO_STDLIB_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef unsigned int uint;
+
+uint32_t time_us_32 (void);
+
+#endif
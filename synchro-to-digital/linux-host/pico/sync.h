@@ -0,0 +1,20 @@
+//---------------------------------------------------------------------------------------------
+// pico/sync.h
+//
+// host stand in for the pico sdk's critical sections. the replay runs on one thread and
+// adcsim.cpp only calls the dma handler from AdcSimRun, never in the middle of firmware
+// code, so there is nothing to hold off.
+//
+
+#ifndef _PICO_SYNC_H_
+#define _PICO_SYNC_H_
+
+typedef struct {
+	int entered;
+} critical_section_t;
+
+static inline void critical_section_init            (critical_section_t *crit_sec) { crit_sec->entered = 0; }
+static inline void critical_section_enter_blocking  (critical_section_t *crit_sec) { crit_sec->entered++; }
+static inline void critical_section_exit            (critical_section_t *crit_sec) { crit_sec->entered--; }
+
+#endif
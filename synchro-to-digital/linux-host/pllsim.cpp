@@ -0,0 +1,275 @@
+//---------------------------------------------------------------------------------------------
+// notes
+//
+// pllsim -- the reference generator locking to a drifting external reference, on the host
+//
+// usage:
+//    pllsim [-f hz] [-r ref_hz] [-d drift_hz_per_s] [-w wander_hz] [-p wander_s]
+//           [-c ppm] [-j jitter_us] [-x from_s,to_s] [-s seconds] [-b bandwidth_hz]
+//           [-z damping] [-o trace.txt]
+//
+// the generator is the tiny2040 source's refgen.cpp and the pll its refpll.cpp, run as its
+// main.cpp runs them. the 40 kHz interrupt writes a sample, notes the time and RefPhase and
+// asks RefSample for the next. a rising edge of the external reference takes the time, works
+// out the generator's phase from the last sample with RefPllPhase and goes to RefPllEdge.
+// RefPllCheck and RefSteer run every ms.
+//
+// the generator is set to hz, 400 by default, and runs from a crystal ppm fast, 50 by default,
+// which is the board's time_us_32 as well. the external reference starts at ref_hz, 403 by
+// default, moves drift_hz_per_s, 0 by default, and wanders by a sine of wander_hz peak, 1 by
+// default, with a period of wander_s, 5 s by default. each edge is seen up to jitter_us late,
+// 2 by default, the interrupt's latency. from_s to to_s, 6 to 6.5 by default, the reference
+// is gone and the pll holds the last frequency. the run is seconds long, 10 by default.
+//
+// the true phase error is the generator's phase at the exact time of each edge, interpolated
+// between the samples either side of it, which checks the pll's own measurement too.
+//
+// it prints the time to lock from the start and after the gap, the true phase error while
+// locked, rms and worst, the worst difference between the pll's frequency and the
+// reference's, how far the phase moved over the gap and whether the reference was ever
+// measured out of the pll's pull range. the exit status is 1 if a lock takes more than
+// 1 s, the lock is lost while the reference is there or the worst error while locked is
+// more than REF_PLL_LOCK_DEG.
+//
+// -o writes seconds, state, the reference's frequency, the pll's, the pll's phase error, the
+// true one and the trim once per edge.
+//
+
+//---------------------------------------------------------------------------------------------
+// includes
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+
+#include <random>
+
+#include "refgen.h"
+#include "refpll.h"
+
+
+//---------------------------------------------------------------------------------------------
+// defines
+//
+
+#define TICK_US     (1000000 / REF_SAMPLE_HZ)
+#define LOCK_LIMIT  1.0                 // seconds
+
+
+//---------------------------------------------------------------------------------------------
+// globals
+//
+
+static double hz = REF_HZ_DEFAULT;
+static double refHz = 403.0;
+static double drift = 0.0;
+static double wander = 1.0;
+static double wanderS = 5.0;
+static double ppm = 50.0;
+static double jitterUs = 2.0;
+static double gapFrom = 6.0;
+static double gapTo = 6.5;
+static double seconds = 10.0;
+
+
+//---------------------------------------------------------------------------------------------
+// RefAt -- the external reference's frequency at t seconds
+//
+
+static double RefAt (double t)
+{
+	return refHz + drift * t + wander * sin (2.0 * M_PI * t / wanderS);
+}
+
+
+//---------------------------------------------------------------------------------------------
+// main
+//
+
+int main (int argc, char *argv[])
+{
+	const char *traceName = NULL;
+	float bandwidth = REF_PLL_BANDWIDTH_DEFAULT;
+	float damping = REF_PLL_DAMPING_DEFAULT;
+	bool usage = false;
+
+	for (int i = 1; i < argc; i++) {
+		if (!strcmp (argv[i], "-f") && (i + 1 < argc)) {
+			hz = atof (argv[++i]);
+		} else if (!strcmp (argv[i], "-r") && (i + 1 < argc)) {
+			refHz = atof (argv[++i]);
+		} else if (!strcmp (argv[i], "-d") && (i + 1 < argc)) {
+			drift = atof (argv[++i]);
+		} else if (!strcmp (argv[i], "-w") && (i + 1 < argc)) {
+			wander = atof (argv[++i]);
+		} else if (!strcmp (argv[i], "-p") && (i + 1 < argc)) {
+			wanderS = atof (argv[++i]);
+		} else if (!strcmp (argv[i], "-c") && (i + 1 < argc)) {
+			ppm = atof (argv[++i]);
+		} else if (!strcmp (argv[i], "-j") && (i + 1 < argc)) {
+			jitterUs = atof (argv[++i]);
+		} else if (!strcmp (argv[i], "-x") && (i + 1 < argc)) {
+			usage = (sscanf (argv[++i], "%lf,%lf", &gapFrom, &gapTo) != 2) || (gapTo < gapFrom);
+		} else if (!strcmp (argv[i], "-s") && (i + 1 < argc)) {
+			seconds = atof (argv[++i]);
+		} else if (!strcmp (argv[i], "-b") && (i + 1 < argc)) {
+			bandwidth = atof (argv[++i]);
+		} else if (!strcmp (argv[i], "-z") && (i + 1 < argc)) {
+			damping = atof (argv[++i]);
+		} else if (!strcmp (argv[i], "-o") && (i + 1 < argc)) {
+			traceName = argv[++i];
+		} else {
+			usage = true;
+			break;
+		}
+	}
+	if (usage || (hz < REF_HZ_MIN) || (hz > REF_HZ_MAX) || (refHz <= 0) || (wanderS <= 0) || (jitterUs < 0) ||
+			(seconds <= 0) || (bandwidth <= 0) || (damping <= 0)) {
+		fprintf (stderr, "usage: pllsim [-f hz] [-r ref_hz] [-d drift_hz_per_s] [-w wander_hz] [-p wander_s]\n"
+			"              [-c ppm] [-j jitter_us] [-x from_s,to_s] [-s seconds] [-b bandwidth_hz]\n"
+			"              [-z damping] [-o trace.txt]\n");
+		return 2;
+	}
+
+	FILE *trace = NULL;
+	if (traceName) {
+		trace = fopen (traceName, "w");
+		if (!trace) {
+			perror (traceName);
+			return 2;
+		}
+		fprintf (trace, "# seconds state ref_hz pll_hz pll_err_deg true_err_deg trim\n");
+	}
+
+	RefConfig config;
+	RefDefaults (&config);
+	config.hz = hz;
+	config.rampMs = 0;
+	RefInit (&config);
+
+	RefPll pll;
+	RefPllInit (&pll, hz, bandwidth, damping, REF_PLL_PULL_DEFAULT);
+
+	printf ("generator %.1f Hz, crystal %+.0f ppm, reference %.2f Hz %+.3f Hz/s wandering %.2f Hz over %.1f s,\n"
+		"jitter %.1f us, gone %.2f to %.2f s, pll %.1f Hz %.3f\n",
+		hz, ppm, refHz, drift, wander, wanderS, jitterUs, gapFrom, gapTo, bandwidth, damping);
+
+	std::mt19937 rng (1);
+	std::uniform_real_distribution<double> late (0.0, jitterUs);
+
+	// a tick of the board's 25 us is a little shorter in true time with a fast crystal
+	double tickS = TICK_US * 1e-6 / (1.0 + ppm * 1e-6);
+	uint64_t ticks = (uint64_t)(seconds / tickS);
+
+	// the last sample as the interrupt notes it, and its phase at the tick before for the
+	// true error
+	uint32_t sampleUs = 0, samplePhase = 0, sampleStep = 0;
+	uint8_t index;
+
+	double refPhase = 0;                // cycles of the external reference
+	double slip = 0;                    // cycles the generator would slip without the pll
+	RefPllState last = REF_PLL_NO_REFERENCE;
+	double lockAt = -1, relockAt = -1, gapError = 0;
+	bool back = false;
+	double errSum = 0, errMax = 0, hzMax = 0;
+	long errN = 0, losses = 0;
+	bool outOfRange = false;
+
+	for (uint64_t n = 0; n < ticks; n++) {
+		double t = n * tickS;
+
+		// external reference up to this tick, an edge where it passes a whole cycle
+		double f = RefAt (t);
+		double before = refPhase;
+		refPhase += f * tickS;
+		slip += (hz * (1.0 + ppm * 1e-6) - f) * tickS;
+		bool present = (t < gapFrom) || (t >= gapTo);
+		if (n && present && (floor (refPhase) != floor (before))) {
+			double edgeS = t - tickS + (floor (refPhase) - before) / (refPhase - before) * tickS;
+			double at = (edgeS - (t - tickS)) / tickS;
+			uint32_t us = (uint32_t)((edgeS * 1e6 + late (rng)) * (1.0 + ppm * 1e-6));
+			uint32_t since = (us > sampleUs) ? us - sampleUs : 0;
+
+			RefPllEdge (&pll, us, RefPllPhase (samplePhase, sampleStep, since));
+			outOfRange = outOfRange || pll.outOfRange;
+
+			double phase = fmod (samplePhase + sampleStep * at, (double)REF_CYCLE) / REF_CYCLE;
+			double trueDeg = remainder (phase, 1.0) * 360.0;
+			if (pll.state == REF_PLL_LOCKED) {
+				errSum += trueDeg * trueDeg;
+				errN++;
+				errMax = (fabs (trueDeg) > errMax) ? fabs (trueDeg) : errMax;
+				double hzErr = fabs (pll.refHz - f);
+				hzMax = (hzErr > hzMax) ? hzErr : hzMax;
+			}
+			if (!back && (t >= gapTo) && (gapTo > gapFrom)) {
+				gapError = trueDeg;
+				back = true;
+			}
+			if (trace) {
+				fprintf (trace, "%.6f %d %.4f %.4f %.3f %.3f %d\n", edgeS, pll.state, f, pll.refHz, pll.errDeg,
+					trueDeg, pll.trim);
+			}
+		}
+
+		// the pll's task
+		if ((n % (REF_SAMPLE_HZ / 1000)) == 0) {
+			RefPllCheck (&pll, (uint32_t)(n * TICK_US));
+			RefSteer (pll.trim);
+		}
+		if (pll.state != last) {
+			if (pll.state == REF_PLL_LOCKED) {
+				if (lockAt < 0) {
+					lockAt = t;
+				} else if ((relockAt < 0) && (t >= gapTo)) {
+					relockAt = t;
+				}
+			} else if ((last == REF_PLL_LOCKED) && present) {
+				losses++;
+			}
+			last = pll.state;
+		}
+
+		// the interrupt, write, note the time and phase, then the next sample
+		sampleUs = (uint32_t)(n * TICK_US);
+		samplePhase = RefPhase ();
+		sampleStep = RefStep ();
+		RefSample (&index);
+	}
+
+	if (trace) {
+		fclose (trace);
+	}
+
+	bool gap = (gapTo > gapFrom) && (gapFrom < seconds);
+	double rms = errN ? sqrt (errSum / errN) : 0;
+	if (lockAt < 0) {
+		printf ("never locked");
+	} else {
+		printf ("locked after %.3f s", lockAt);
+	}
+	if (gap && (relockAt >= 0)) {
+		printf (", again %.3f s after the gap", relockAt - gapTo);
+	}
+	if (gap && back) {
+		printf (", %.2f deg off when the reference came back", gapError);
+	}
+	printf ("\nwhile locked: %.3f deg rms, %.3f deg worst, frequency within %.4f Hz, lost %ld times\n",
+		rms, errMax, hzMax, losses);
+	if (outOfRange) {
+		printf ("the reference was more than %.0f%% from the generator's frequency\n", REF_PLL_PULL_DEFAULT * 100);
+	}
+	printf ("free running the generator would have slipped %.1f cycles\n", slip);
+
+	bool pass = (lockAt >= 0) && (lockAt <= LOCK_LIMIT) && (losses == 0) && (errMax <= REF_PLL_LOCK_DEG);
+	if (gap && (gapTo < seconds - LOCK_LIMIT)) {
+		pass = pass && (relockAt >= 0) && (relockAt - gapTo <= LOCK_LIMIT);
+	}
+	printf ("%s\n", pass ? "pass" : "FAIL");
+
+	return pass ? 0 : 1;
+}
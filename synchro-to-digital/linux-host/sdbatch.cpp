@@ -0,0 +1,482 @@
+//---------------------------------------------------------------------------------------------
+// notes
+//
+// sdbatch -- runs the firmware's tracking loop over a recorded capture on every core
+//
+// usage:
+//    sdbatch [-j threads] [-l lanes] [-d decimate] [-c chunk_ms] [-w warmup_ms] [-r rate]
+//            [-a amplitude] [-b bandwidth_hz] [-z damping]
+//            [-g other.bin [-t angle_tol] [-v vel_tol]] [-e end_deg] capture.bin out.bin
+//
+// the capture is what convert.py reads from the DI-2108, four little endian int16 per
+// sample set, struct.unpack ("<hhhh"):
+//    Ch1 Vr1-Vr2, Ch2 Vs1-Vs3, Ch3 Vs3-Vs2, Ch4 Vs2-Vs1
+// at -r samples per second, 40000 by default. a capture from record.py or capgen, which puts
+// a header in front, see lib/capture/capture.h, can have any number of channels in any
+// order, the ones called Vr1-Vr2, Vs1-Vs3 and Vs3-Vs2 are used and the rate comes from the
+// header unless -r is given.
+// the reference is the sign of -Ch1 as in convert.py and the stator differences are taken
+// down to the loop's 12 bits. -a is the stator amplitude in capture counts, it sets the
+// loop's detector gain, see sdloop.h.
+//
+// the capture is memory mapped and cut into chunks of chunk_ms, 1000 ms by default, which
+// the threads take in turn. each chunk starts warmup_ms early, 200 ms by default, with the
+// loop preset to the angle of the first carrier cycle, and only writes its output once it
+// reaches its own first sample, so chunk boundaries do not show in the output. the warmup
+// is rounded up to whole records.
+//
+// a thread takes lanes chunks at a time, 8 by default, and runs them side by side as the
+// channels of one SdBank, see sdloop.h, a millisecond of sets per SdBankRun call. the bank
+// shares one reference between its channels, so each lane's reference is folded into its
+// stator inputs and the bank's is +1, which can move a detector output by 1 count against
+// SdLoopStep. the bank gives the lanes the gains and the loop overhead once per set and
+// independent state for the cpu to overlap, it is not simd, the sine table lookups in the
+// detector are one per lane and keep the compiler from vectorizing it.
+//
+// out.bin gets one record for every decimate sample sets, 40 by default, four little endian
+// float32 each:
+//    angle (degrees, -180 to +180), tracking error (degrees), velocity (dps), loss of tracking
+// numpy.fromfile ("out.bin", dtype = "<f4").reshape (-1, 4) reads it back.
+//
+//    -g   compare out.bin with other.bin, an earlier run's, record by record. angles and
+//         errors have to match to within angle_tol degrees (0.01), velocities to within
+//         vel_tol dps (0.5) and the loss of tracking flag exactly, so a run on more threads
+//         or smaller chunks can be checked against one on a single thread
+//    -e   the mean angle of the last 100 ms has to be within angle_tol of end_deg
+// either makes the exit status 1 on a mismatch.
+//
+// the ctests run testdata/move.cap, which ends at 120 degrees, on one thread and then on
+// four in 100 ms chunks against that.
+//
+
+//---------------------------------------------------------------------------------------------
+// includes
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "capture/capture.h"
+#include "sdloop.h"
+
+using Clock = std::chrono::steady_clock;
+
+
+//---------------------------------------------------------------------------------------------
+// defines
+//
+
+#define RAW_CHANNELS  4         // a capture with no header, convert.py's <hhhh
+#define CARRIER_HZ    400
+#define DAQ_SHIFT     4         // 16 bit capture counts to the loop's 12 bits
+#define RECORD_FLOATS 4
+#define END_S         0.1       // -e averages the last 100 ms
+
+
+//---------------------------------------------------------------------------------------------
+// globals
+//
+
+static int numThreads = 0;
+static int lanes = 8;
+static int decimate = 40;
+static double chunkMs = 1000.0;
+static double warmupMs = 200.0;
+static double sampleHz = 0;
+
+static SdLoopConfig config;
+
+// sets are stride int16 apart, the reference and stator differences at these offsets
+static int stride = RAW_CHANNELS;
+static int refCh = 0;
+static int s1ms3Ch = 1;
+static int s3ms2Ch = 2;
+
+static const int16_t *samples;
+static size_t numSets;
+static size_t chunkSets;
+static size_t warmupSets;
+static size_t blockSets;
+static float *output;
+
+static std::atomic<size_t> nextChunk (0);
+static std::atomic<size_t> lotRecords (0);
+
+static double angleTol = 0.01;
+static double velTol = 0.5;
+
+
+//---------------------------------------------------------------------------------------------
+// Unpack -- capture sets to one lane's bank inputs with its reference folded in, set i goes
+//           to s1ms3[i * count + lane]
+//
+
+static void Unpack (const int16_t *raw, int sets, int lane, int count, int16_t *s1ms3, int16_t *s3ms2)
+{
+	for (int i = 0; i < sets; i++) {
+		int16_t r = raw[i * stride + refCh];
+		int refsq = (r < 0) - (r > 0);
+		s1ms3[i * count + lane] = (int16_t)(refsq * (raw[i * stride + s1ms3Ch] >> DAQ_SHIFT));
+		s3ms2[i * count + lane] = (int16_t)(refsq * (raw[i * stride + s3ms2Ch] >> DAQ_SHIFT));
+	}
+}
+
+
+//---------------------------------------------------------------------------------------------
+// FindChannel -- index of the channel called name in a capture's table, -1 if there is none,
+//                as capture::Reader::Find
+//
+
+static int FindChannel (const capture::Channel *c, int channels, const char *name)
+{
+	for (int i = 0; i < channels; i++) {
+		if (!strncmp (c[i].name, name, sizeof (c[i].name))) {
+			return i;
+		}
+	}
+
+	return -1;
+}
+
+
+//---------------------------------------------------------------------------------------------
+// PresetAngle -- angle of the first carrier cycle from the demodulated scott t outputs
+//
+
+static uint32_t PresetAngle (const int16_t *raw, size_t count)
+{
+	double s = 0, c = 0;
+
+	for (size_t i = 0; i < count; i++) {
+		int16_t r = raw[i * stride + refCh];
+		int refsq = (r < 0) - (r > 0);
+		double s1ms3 = raw[i * stride + s1ms3Ch];
+		double s3ms2 = raw[i * stride + s3ms2Ch];
+		s += refsq * s1ms3;
+		c += refsq * (2.0 * s3ms2 + s1ms3) / sqrt (3.0);
+	}
+
+	return (uint32_t)(int64_t)llround (atan2 (s, c) / M_PI * 2147483648.0);
+}
+
+
+//---------------------------------------------------------------------------------------------
+// RunChunks -- chunks c to c + n - 1 side by side, one bank channel each
+//
+
+static void RunChunks (size_t c, int n)
+{
+	static thread_local SdBank bank;
+	static thread_local std::vector<int8_t> refsq;
+	static thread_local std::vector<int16_t> s1ms3, s3ms2;
+
+	size_t first[SD_BANK_MAX], start[SD_BANK_MAX], end[SD_BANK_MAX];
+	size_t cycle = (size_t)(sampleHz / CARRIER_HZ);
+	size_t steps = 0;
+	size_t lot = 0;
+
+	refsq.assign (blockSets, 1);
+	s1ms3.resize (blockSets * n);
+	s3ms2.resize (blockSets * n);
+
+	SdBankInit (&bank, n, &config);
+	for (int l = 0; l < n; l++) {
+		start[l] = (c + l) * chunkSets;
+		end[l] = (numSets - start[l] < chunkSets) ? numSets : start[l] + chunkSets;
+		first[l] = (start[l] > warmupSets) ? start[l] - warmupSets : 0;
+		bank.theta[l] = PresetAngle (&samples[first[l] * stride], (end[l] - first[l] < cycle) ? end[l] - first[l] : cycle);
+		steps = (end[l] - first[l] > steps) ? end[l] - first[l] : steps;
+	}
+
+	// first and the records are on block boundaries, so records only fall at the end of one
+	for (size_t k = 0; k < steps; k += blockSets) {
+		for (int l = 0; l < n; l++) {
+			size_t set = first[l] + k;
+			int sets = (set >= end[l]) ? 0 : (end[l] - set < blockSets) ? (int)(end[l] - set) : (int)blockSets;
+
+			Unpack (&samples[set * stride], sets, l, n, s1ms3.data (), s3ms2.data ());
+			for (int i = sets; i < (int)blockSets; i++) {
+				s1ms3[i * n + l] = 0;
+				s3ms2[i * n + l] = 0;
+			}
+		}
+
+		SdBankRun (&bank, refsq.data (), s1ms3.data (), s3ms2.data (), (int)blockSets);
+
+		for (int l = 0; l < n; l++) {
+			size_t at = first[l] + k + blockSets;
+			if ((at > start[l]) && (at <= end[l]) && ((at % decimate) == 0)) {
+				float *rec = &output[(at / decimate - 1) * RECORD_FLOATS];
+				rec[0] = SdBankDegrees (&bank, l);
+				rec[1] = atan2f ((float)bank.err[l], (float)bank.level[l]) * (180.0f / (float)M_PI);
+				rec[2] = SdBankDps (&bank, l);
+				rec[3] = bank.lot[l] ? 1.0f : 0.0f;
+				lot += bank.lot[l];
+			}
+		}
+	}
+
+	lotRecords += lot;
+}
+
+
+//---------------------------------------------------------------------------------------------
+// Worker
+//
+
+static void Worker (void)
+{
+	size_t chunks = (numSets + chunkSets - 1) / chunkSets;
+
+	for (size_t c = nextChunk.fetch_add (lanes); c < chunks; c = nextChunk.fetch_add (lanes)) {
+		RunChunks (c, (chunks - c < (size_t)lanes) ? (int)(chunks - c) : lanes);
+	}
+}
+
+
+//---------------------------------------------------------------------------------------------
+// Compare -- the output against another run's, prints the first few mismatches and the
+//            largest differences, true if all match
+//
+
+static bool Compare (const char *name, size_t records)
+{
+	FILE *f = fopen (name, "rb");
+	if (!f) {
+		perror (name);
+		return false;
+	}
+	std::vector<float> other (records * RECORD_FLOATS + 1);
+	size_t n = fread (other.data (), RECORD_FLOATS * sizeof (float), records + 1, f);
+	fclose (f);
+	if (n != records) {
+		printf ("%s has %s records than this run's %zu\n", name, (n > records) ? "more" : "fewer", records);
+		return false;
+	}
+
+	double maxAngle = 0, maxError = 0, maxVel = 0;
+	size_t bad = 0;
+	for (size_t i = 0; i < records; i++) {
+		const float *g = &other[i * RECORD_FLOATS], *r = &output[i * RECORD_FLOATS];
+		double da = fabs (remainder ((double)r[0] - g[0], 360.0));
+		double de = fabs ((double)r[1] - g[1]);
+		double dv = fabs ((double)r[2] - g[2]);
+
+		maxAngle = (da > maxAngle) ? da : maxAngle;
+		maxError = (de > maxError) ? de : maxError;
+		maxVel = (dv > maxVel) ? dv : maxVel;
+
+		if ((da > angleTol) || (de > angleTol) || (dv > velTol) || (r[3] != g[3])) {
+			if (bad++ < 10) {
+				printf ("record %zu: %s %9.4f %9.4f %9.2f %.0f this run %9.4f %9.4f %9.2f %.0f\n", i, name,
+					g[0], g[1], g[2], g[3], r[0], r[1], r[2], r[3]);
+			}
+		}
+	}
+
+	printf ("%zu records compared, %zu mismatched\n", records, bad);
+	printf ("largest differences: angle %.4f error %.4f velocity %.3f\n", maxAngle, maxError, maxVel);
+
+	return bad == 0;
+}
+
+
+//---------------------------------------------------------------------------------------------
+// main
+//
+
+int main (int argc, char *argv[])
+{
+	const char *inName = NULL, *outName = NULL, *otherName = NULL;
+	double endDeg = NAN;
+
+	SdLoopDefaults (&config, sampleHz);
+	config.amplitude = 0;
+
+	for (int i = 1; i < argc; i++) {
+		if (!strcmp (argv[i], "-j") && (i + 1 < argc)) {
+			numThreads = atoi (argv[++i]);
+		} else if (!strcmp (argv[i], "-l") && (i + 1 < argc)) {
+			lanes = atoi (argv[++i]);
+		} else if (!strcmp (argv[i], "-d") && (i + 1 < argc)) {
+			decimate = atoi (argv[++i]);
+		} else if (!strcmp (argv[i], "-c") && (i + 1 < argc)) {
+			chunkMs = atof (argv[++i]);
+		} else if (!strcmp (argv[i], "-w") && (i + 1 < argc)) {
+			warmupMs = atof (argv[++i]);
+		} else if (!strcmp (argv[i], "-r") && (i + 1 < argc)) {
+			sampleHz = atof (argv[++i]);
+		} else if (!strcmp (argv[i], "-a") && (i + 1 < argc)) {
+			config.amplitude = atof (argv[++i]);
+		} else if (!strcmp (argv[i], "-b") && (i + 1 < argc)) {
+			config.bandwidthHz = atof (argv[++i]);
+		} else if (!strcmp (argv[i], "-z") && (i + 1 < argc)) {
+			config.damping = atof (argv[++i]);
+		} else if (!strcmp (argv[i], "-g") && (i + 1 < argc)) {
+			otherName = argv[++i];
+		} else if (!strcmp (argv[i], "-t") && (i + 1 < argc)) {
+			angleTol = atof (argv[++i]);
+		} else if (!strcmp (argv[i], "-v") && (i + 1 < argc)) {
+			velTol = atof (argv[++i]);
+		} else if (!strcmp (argv[i], "-e") && (i + 1 < argc)) {
+			endDeg = atof (argv[++i]);
+		} else if (!inName) {
+			inName = argv[i];
+		} else if (!outName) {
+			outName = argv[i];
+		} else {
+			inName = NULL;
+			break;
+		}
+	}
+	if (!inName || !outName || (lanes < 1) || (lanes > SD_BANK_MAX) || (decimate < 1) || (chunkMs <= 0) || (warmupMs < 0) || (sampleHz < 0)) {
+		fprintf (stderr, "usage: sdbatch [-j threads] [-l lanes] [-d decimate] [-c chunk_ms] [-w warmup_ms] [-r rate]\n"
+			"               [-a amplitude] [-b bandwidth_hz] [-z damping]\n"
+			"               [-g other.bin [-t angle_tol] [-v vel_tol]] [-e end_deg] capture.bin out.bin\n");
+		return 2;
+	}
+
+	// the default amplitude is in the loop's 12 bit counts
+	config.amplitude = (config.amplitude > 0) ? config.amplitude / (1 << DAQ_SHIFT) : SD_AMPLITUDE_DEFAULT;
+	if (numThreads < 1) {
+		numThreads = (int)std::thread::hardware_concurrency ();
+		numThreads = (numThreads < 1) ? 1 : numThreads;
+	}
+
+	// map the capture
+	int fd = open (inName, O_RDONLY);
+	struct stat st;
+	if ((fd < 0) || (fstat (fd, &st) < 0)) {
+		perror (inName);
+		return 1;
+	}
+	void *in = (st.st_size > 0) ? mmap (NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+	if (in == MAP_FAILED) {
+		fprintf (stderr, "%s: cannot map\n", inName);
+		return 1;
+	}
+	madvise (in, st.st_size, MADV_SEQUENTIAL);
+	close (fd);
+
+	// a record.py capture has a header, the channels are found by name in its table
+	size_t dataStart = 0;
+	const capture::Header *h = (const capture::Header *)in;
+	if ((st.st_size >= (off_t)sizeof (capture::Header)) && !memcmp (h->magic, capture::MAGIC, sizeof (capture::MAGIC))) {
+		dataStart = sizeof (capture::Header) + h->channels * sizeof (capture::Channel);
+		if ((h->version != capture::VERSION) || (h->channels == 0) || ((off_t)dataStart > st.st_size)) {
+			fprintf (stderr, "%s: not a capture\n", inName);
+			return 1;
+		}
+		const capture::Channel *c = (const capture::Channel *)(h + 1);
+		stride = h->channels;
+		refCh = FindChannel (c, h->channels, "Vr1-Vr2");
+		s1ms3Ch = FindChannel (c, h->channels, "Vs1-Vs3");
+		s3ms2Ch = FindChannel (c, h->channels, "Vs3-Vs2");
+		if ((refCh < 0) || (s1ms3Ch < 0) || (s3ms2Ch < 0)) {
+			fprintf (stderr, "%s: needs channels Vr1-Vr2, Vs1-Vs3 and Vs3-Vs2\n", inName);
+			return 1;
+		}
+		sampleHz = (sampleHz > 0) ? sampleHz : h->sampleHz;
+	}
+	sampleHz = (sampleHz > 0) ? sampleHz : 40000.0;
+	config.sampleHz = sampleHz;
+	if (sampleHz < 2 * CARRIER_HZ) {
+		fprintf (stderr, "rate too low\n");
+		return 2;
+	}
+
+	samples = (const int16_t *)((const uint8_t *)in + dataStart);
+	numSets = (st.st_size - dataStart) / (stride * sizeof (int16_t));
+	if (numSets == 0) {
+		fprintf (stderr, "%s: empty capture\n", inName);
+		return 1;
+	}
+
+	// map the output, one record per decimate sets
+	size_t records = numSets / decimate;
+	size_t outBytes = records * RECORD_FLOATS * sizeof (float);
+	int ofd = open (outName, O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if ((ofd < 0) || (ftruncate (ofd, outBytes) < 0)) {
+		perror (outName);
+		return 1;
+	}
+	void *out = NULL;
+	if (outBytes > 0) {
+		out = mmap (NULL, outBytes, PROT_READ | PROT_WRITE, MAP_SHARED, ofd, 0);
+		if (out == MAP_FAILED) {
+			perror ("mmap");
+			return 1;
+		}
+	}
+	output = (float *)out;
+	close (ofd);
+
+	// chunks are whole records so every record comes from one chunk
+	chunkSets = (size_t)(chunkMs * sampleHz / 1000.0);
+	chunkSets = (chunkSets < (size_t)decimate) ? decimate : chunkSets - chunkSets % decimate;
+	warmupSets = (size_t)(warmupMs * sampleHz / 1000.0);
+	warmupSets = (warmupSets + decimate - 1) / decimate * decimate;
+
+	// a bank block is the largest part of a record no longer than 1 ms, the loss of tracking
+	// test runs once a block
+	blockSets = (size_t)(sampleHz / 1000.0);
+	blockSets = (blockSets < 1) ? 1 : (blockSets > (size_t)decimate) ? decimate : blockSets;
+	while ((decimate % blockSets) != 0) {
+		blockSets--;
+	}
+
+	auto t0 = Clock::now ();
+	std::vector<std::thread> threads;
+	for (int t = 0; t < numThreads; t++) {
+		threads.emplace_back (Worker);
+	}
+	for (std::thread &t : threads) {
+		t.join ();
+	}
+	double secs = std::chrono::duration<double> (Clock::now () - t0).count ();
+
+	bool ok = true;
+	if (otherName) {
+		ok = Compare (otherName, records);
+	}
+	if (!isnan (endDeg)) {
+		// the angle ripples at the carrier, so average the last 100 ms
+		size_t n = (size_t)lround (END_S * sampleHz / decimate);
+		n = (n < 1) ? 1 : (n > records) ? records : n;
+		double sum = 0;
+		for (size_t i = records - n; i < records; i++) {
+			sum += remainder (output[i * RECORD_FLOATS] - endDeg, 360.0);
+		}
+		double off = (n > 0) ? sum / n : NAN;
+		printf ("ends %.4f degrees from %.4f over the last %zu records\n", off, endDeg, n);
+		ok = ok && (fabs (off) <= angleTol);
+	}
+
+	if (out) {
+		munmap (out, outBytes);
+	}
+	munmap (in, st.st_size);
+
+	printf ("%zu sets, %.1f s of capture, %zu records, %zu with loss of tracking\n",
+		numSets, numSets / sampleHz, records, (size_t)lotRecords);
+	printf ("%.3f s on %d threads, %.0f MB/s, %.0fx real time\n",
+		secs, numThreads, st.st_size / secs / 1e6, numSets / sampleHz / secs);
+	if (otherName || !isnan (endDeg)) {
+		printf ("%s\n", ok ? "match" : "MISMATCH");
+	}
+
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,257 @@
+//---------------------------------------------------------------------------------------------
+// notes
+//
+// sdbench -- cost per channel of the s/d tracking loop, one SdLoopStep per channel per
+//            sample against SdBankRun over the whole bank a block at a time
+//
+// usage:
+//    sdbench [-n max_channels] [-b block_sets] [-t seconds] [-u core_fraction]
+//
+// every channel is a synchro at its own angle on a shared 400 Hz reference, sampled at
+// 40 kSPS and fed to the loops in blocks of 40 sets, the 1 ms blocks the firmware runs.
+// the channel count doubles from 1 to max_channels and each count runs for the given time.
+//
+// the max channel counts are for one core of this host at the given fraction of its
+// time, from a straight line through the bank's cost at the two largest counts. they are
+// host figures only, an rp2040 core at 125 MHz without an fpu is a good deal slower and
+// they say nothing about how many channels the pico can run. on the pico use the
+// firmware's s command, which prints the longest block time, against the 1 ms block.
+//
+// before timing, the bank and the single loops are run on the same input and their angles
+// and velocities have to match exactly.
+//
+
+//---------------------------------------------------------------------------------------------
+// includes
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+
+#include <chrono>
+#include <vector>
+
+#include "sdloop.h"
+
+using Clock = std::chrono::steady_clock;
+
+
+//---------------------------------------------------------------------------------------------
+// defines
+//
+
+#define SAMPLE_HZ  40000
+#define STIM_SETS  1000      // ten carrier cycles, played over and over
+
+
+//---------------------------------------------------------------------------------------------
+// globals
+//
+
+static int maxChannels = 64;
+static int blockSets = 40;
+static double seconds = 0.25;
+static double coreFraction = 1.0;
+
+static volatile uint32_t sink;
+
+
+//---------------------------------------------------------------------------------------------
+// Stimulus -- STIM_SETS sets for count channels, laid out the way SdBankRun takes them
+//
+
+static void Stimulus (int count, std::vector<int8_t> &refsq, std::vector<int16_t> &s1ms3, std::vector<int16_t> &s3ms2)
+{
+	refsq.resize (STIM_SETS);
+	s1ms3.resize (STIM_SETS * count);
+	s3ms2.resize (STIM_SETS * count);
+
+	for (int n = 0; n < STIM_SETS; n++) {
+		double ref = sin (2.0 * M_PI * 400.0 * n / SAMPLE_HZ);
+		refsq[n] = (ref > 0) ? +1 : (ref < 0) ? -1 : 0;
+		for (int ch = 0; ch < count; ch++) {
+			double angle = 2.0 * M_PI * ch / count;
+			s1ms3[n * count + ch] = (int16_t)lround (1800.0 * ref * sin (angle));
+			s3ms2[n * count + ch] = (int16_t)lround (1800.0 * ref * sin (angle + 120.0 * M_PI / 180.0));
+		}
+	}
+}
+
+
+//---------------------------------------------------------------------------------------------
+// RunLoops / RunBank -- sets samples through count channels starting at stimulus set start
+//
+
+static void RunLoops (SdLoop *loops, int count, int start, int sets,
+	const std::vector<int8_t> &refsq, const std::vector<int16_t> &s1ms3, const std::vector<int16_t> &s3ms2)
+{
+	for (int n = start; n < start + sets; n++) {
+		for (int ch = 0; ch < count; ch++) {
+			SdLoopStep (&loops[ch], refsq[n], s1ms3[n * count + ch], s3ms2[n * count + ch]);
+		}
+	}
+}
+
+static void RunBank (SdBank *bank, int start, int sets,
+	const std::vector<int8_t> &refsq, const std::vector<int16_t> &s1ms3, const std::vector<int16_t> &s3ms2)
+{
+	int count = bank->count;
+	SdBankRun (bank, &refsq[start], &s1ms3[start * count], &s3ms2[start * count], sets);
+}
+
+
+//---------------------------------------------------------------------------------------------
+// Check -- bank and single loops agree on the same input
+//
+
+static bool Check (const SdLoopConfig *config)
+{
+	int count = (maxChannels < 8) ? maxChannels : 8;
+	std::vector<int8_t> refsq;
+	std::vector<int16_t> s1ms3, s3ms2;
+	std::vector<SdLoop> loops (count);
+	SdBank *bank = new SdBank;
+
+	Stimulus (count, refsq, s1ms3, s3ms2);
+	for (int ch = 0; ch < count; ch++) {
+		SdLoopInit (&loops[ch], config);
+	}
+	SdBankInit (bank, count, config);
+
+	for (int start = 0; start + blockSets <= STIM_SETS; start += blockSets) {
+		RunLoops (loops.data (), count, start, blockSets, refsq, s1ms3, s3ms2);
+		RunBank (bank, start, blockSets, refsq, s1ms3, s3ms2);
+	}
+
+	bool ok = true;
+	for (int ch = 0; ch < count; ch++) {
+		if ((loops[ch].theta != bank->theta[ch]) || (loops[ch].vel != bank->vel[ch])) {
+			printf ("channel %d: loop %08x %d bank %08x %d\n", ch,
+				loops[ch].theta, loops[ch].vel, bank->theta[ch], bank->vel[ch]);
+			ok = false;
+		}
+	}
+
+	delete bank;
+	return ok;
+}
+
+
+//---------------------------------------------------------------------------------------------
+// Time -- ns per set of every channel
+//
+
+template <class F>
+static double Time (F run)
+{
+	long sets = 0;
+	int start = 0;
+	auto t0 = Clock::now ();
+	auto end = t0 + std::chrono::duration<double> (seconds);
+	auto t1 = t0;
+
+	do {
+		for (int i = 0; i < 25; i++) {
+			run (start);
+			sets += blockSets;
+			start += blockSets;
+			if (start + blockSets > STIM_SETS) {
+				start = 0;
+			}
+		}
+		t1 = Clock::now ();
+	} while (t1 < end);
+
+	return std::chrono::duration<double, std::nano> (t1 - t0).count () / sets;
+}
+
+
+//---------------------------------------------------------------------------------------------
+// main
+//
+
+int main (int argc, char *argv[])
+{
+	SdLoopConfig config;
+
+	for (int i = 1; i < argc; i++) {
+		if (!strcmp (argv[i], "-n") && (i + 1 < argc)) {
+			maxChannels = atoi (argv[++i]);
+		} else if (!strcmp (argv[i], "-b") && (i + 1 < argc)) {
+			blockSets = atoi (argv[++i]);
+		} else if (!strcmp (argv[i], "-t") && (i + 1 < argc)) {
+			seconds = atof (argv[++i]);
+		} else if (!strcmp (argv[i], "-u") && (i + 1 < argc)) {
+			coreFraction = atof (argv[++i]);
+		} else {
+			fprintf (stderr, "usage: sdbench [-n max_channels] [-b block_sets] [-t seconds] [-u core_fraction]\n");
+			return 2;
+		}
+	}
+	if ((maxChannels < 2) || (maxChannels > SD_BANK_MAX) || (blockSets < 1) || (blockSets > STIM_SETS)) {
+		fprintf (stderr, "channels 2 to %d, block 1 to %d sets\n", SD_BANK_MAX, STIM_SETS);
+		return 2;
+	}
+
+	SdLoopDefaults (&config, SAMPLE_HZ);
+
+	if (!Check (&config)) {
+		printf ("bank does not match SdLoopStep\n");
+		return 1;
+	}
+	printf ("bank matches SdLoopStep\n\n");
+
+	printf ("channels   loop ns/ch   bank ns/ch   speedup   bank ns/set\n");
+
+	double lastN = 0, lastSet = 0, prevN = 0, prevSet = 0;
+	for (int count = 1; count <= maxChannels; count *= 2) {
+		std::vector<int8_t> refsq;
+		std::vector<int16_t> s1ms3, s3ms2;
+		std::vector<SdLoop> loops (count);
+		SdBank *bank = new SdBank;
+
+		Stimulus (count, refsq, s1ms3, s3ms2);
+		for (int ch = 0; ch < count; ch++) {
+			SdLoopInit (&loops[ch], &config);
+		}
+		SdBankInit (bank, count, &config);
+
+		double loopSet = Time ([&] (int start) {
+			RunLoops (loops.data (), count, start, blockSets, refsq, s1ms3, s3ms2);
+		});
+		double bankSet = Time ([&] (int start) {
+			RunBank (bank, start, blockSets, refsq, s1ms3, s3ms2);
+		});
+		sink = loops[0].theta + bank->theta[0];
+
+		printf ("%8d   %10.2f   %10.2f   %6.2fx   %11.1f\n",
+			count, loopSet / count, bankSet / count, loopSet / bankSet, bankSet);
+
+		prevN = lastN;
+		prevSet = lastSet;
+		lastN = count;
+		lastSet = bankSet;
+		delete bank;
+	}
+
+	// ns per set = overhead + per channel * channels
+	double perChannel = (lastSet - prevSet) / (lastN - prevN);
+	double overhead = lastSet - perChannel * lastN;
+	if ((perChannel <= 0) || (overhead < 0)) {
+		perChannel = lastSet / lastN;
+		overhead = 0;
+	}
+	printf ("\nbank on this host: %.2f ns per channel per set + %.1f ns per set\n", perChannel, overhead);
+	for (int rate : { 40000, 10000 }) {
+		double budget = 1e9 / rate * coreFraction;
+		printf ("host only, max channels at %2d kSPS, %.0f%% of a host core: %d\n",
+			rate / 1000, coreFraction * 100.0, (int)floor ((budget - overhead) / perChannel));
+	}
+	printf ("not a pico figure, on the pico the firmware's s command prints the max block time per 1 ms block\n");
+
+	return 0;
+}
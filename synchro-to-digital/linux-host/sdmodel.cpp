@@ -0,0 +1,210 @@
+//---------------------------------------------------------------------------------------------
+// notes
+//
+// sdmodel -- runs the firmware's tracking loop, sdloop.cpp, on the model.m stimulus
+//
+// usage:
+//    sdmodel [-b bandwidth_hz] [-z damping] [-a amplitude] [-c trace.csv]
+//
+// the stimulus is model.m's, 40 kSPS for 625 ms: hold at -90 degrees, ramp to 0 at 720
+// degrees per second, hold, ramp to +90, hold. the synchro voltages are quantized to adc
+// counts at the given amplitude and the reference is squared with sign () as model.m does.
+//
+// the loop runs twice, once as convert.py's pure integrator (ki = 0, kp = 1/64 per sample
+// at full scale) and once as the type II loop. for each it prints the mean and worst error
+// over the last 50 ms of each hold and each ramp, the velocity at the end of each, and
+// how many samples had the loss of tracking flag set. the exit status is 1 if the type II
+// loop's mean error at the end of a ramp is more than 0.05 degrees, which is its steady
+// state error plus half a sine table step, or it loses tracking after the first hold.
+// the worst error also has the loop's ripple at twice the carrier in it.
+//
+// -c writes sample, set point, type I angle and type II angle, velocity and flag as csv.
+//
+
+//---------------------------------------------------------------------------------------------
+// includes
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+
+#include "sdloop.h"
+
+
+//---------------------------------------------------------------------------------------------
+// defines
+//
+
+#define SAMPLE_HZ   40000
+#define NUM_SAMPLES 25001
+#define NUM_SEGS    5
+#define SEG_LEN     5000
+#define MEASURE_LEN 2000     // last 50 ms of each segment
+
+// convert.py's gain, 1/64 radian per sample for a full scale error, in Q16
+#define TYPE1_KP 10430
+
+
+//---------------------------------------------------------------------------------------------
+// typedefs
+//
+
+typedef struct {
+	double sum;
+	double worst;
+	int    count;
+	float  dps;
+} SegStats;
+
+
+//---------------------------------------------------------------------------------------------
+// globals
+//
+
+static const char *segName[NUM_SEGS] = { "hold -90", "ramp", "hold 0", "ramp", "hold +90" };
+
+
+//---------------------------------------------------------------------------------------------
+// SetPoint -- model.m's setpts in degrees
+//
+
+static double SetPoint (int i)
+{
+	if (i < 5000)  { return -90.0; }
+	if (i < 10000) { return -90.0 + 90.0 * (i - 5000) / 5000.0; }
+	if (i < 15000) { return 0.0; }
+	if (i < 20000) { return 90.0 * (i - 15000) / 5000.0; }
+	return 90.0;
+}
+
+
+//---------------------------------------------------------------------------------------------
+// Run -- one pass over the stimulus, returns the number of samples with the flag set
+//        after the first hold has settled
+//
+
+static int Run (SdLoop *loop, double amplitude, SegStats *seg, float *trace, int stride)
+{
+	int lot = 0;
+
+	memset (seg, 0, NUM_SEGS * sizeof (SegStats));
+
+	for (int i = 0; i < NUM_SAMPLES; i++) {
+		double sp = SetPoint (i) * M_PI / 180.0;
+		double ref = sin (2.0 * M_PI * 400.0 * i / SAMPLE_HZ);
+
+		int16_t s1ms3 = (int16_t)lround (amplitude * ref * sin (sp));
+		int16_t s3ms2 = (int16_t)lround (amplitude * ref * sin (sp + 120.0 * M_PI / 180.0));
+		int8_t refsq = (ref > 0) ? +1 : (ref < 0) ? -1 : 0;
+
+		SdLoopStep (loop, refsq, s1ms3, s3ms2);
+
+		double err = remainder (SdLoopDegrees (loop) - SetPoint (i), 360.0);
+		int s = i / SEG_LEN;
+		if ((s < NUM_SEGS) && ((i % SEG_LEN) >= SEG_LEN - MEASURE_LEN)) {
+			seg[s].sum += err;
+			seg[s].worst = (fabs (err) > fabs (seg[s].worst)) ? err : seg[s].worst;
+			seg[s].count++;
+			seg[s].dps = SdLoopDps (loop);
+		}
+		if (loop->lot && (i >= SEG_LEN)) {
+			lot++;
+		}
+
+		if (trace) {
+			trace[i * stride + 0] = SdLoopDegrees (loop);
+			trace[i * stride + 1] = SdLoopDps (loop);
+			trace[i * stride + 2] = loop->lot;
+		}
+	}
+
+	return lot;
+}
+
+
+//---------------------------------------------------------------------------------------------
+// Print
+//
+
+static void Print (const char *name, const SegStats *seg, int lot)
+{
+	printf ("%s\n", name);
+	printf ("    segment      mean err   worst err    vel (dps)\n");
+	for (int s = 0; s < NUM_SEGS; s++) {
+		printf ("    %-10s %9.4f   %9.4f   %10.2f\n",
+			segName[s], seg[s].sum / seg[s].count, seg[s].worst, seg[s].dps);
+	}
+	printf ("    loss of tracking after settling: %d samples\n\n", lot);
+}
+
+
+//---------------------------------------------------------------------------------------------
+// main
+//
+
+int main (int argc, char *argv[])
+{
+	SdLoopConfig config;
+	const char *csvName = NULL;
+
+	SdLoopDefaults (&config, SAMPLE_HZ);
+
+	for (int i = 1; i < argc; i++) {
+		if (!strcmp (argv[i], "-b") && (i + 1 < argc)) {
+			config.bandwidthHz = atof (argv[++i]);
+		} else if (!strcmp (argv[i], "-z") && (i + 1 < argc)) {
+			config.damping = atof (argv[++i]);
+		} else if (!strcmp (argv[i], "-a") && (i + 1 < argc)) {
+			config.amplitude = atof (argv[++i]);
+		} else if (!strcmp (argv[i], "-c") && (i + 1 < argc)) {
+			csvName = argv[++i];
+		} else {
+			fprintf (stderr, "usage: sdmodel [-b bandwidth_hz] [-z damping] [-a amplitude] [-c trace.csv]\n");
+			return 2;
+		}
+	}
+
+	printf ("bandwidth %.1f Hz, damping %.3f, amplitude %.0f counts\n\n",
+		config.bandwidthHz, config.damping, config.amplitude);
+
+	static float trace1[NUM_SAMPLES * 3];
+	static float trace2[NUM_SAMPLES * 3];
+	SegStats seg1[NUM_SEGS], seg2[NUM_SEGS];
+	SdLoop loop;
+
+	// convert.py's loop
+	SdLoopInit (&loop, &config);
+	loop.kp = TYPE1_KP;
+	loop.ki = 0;
+	int lot1 = Run (&loop, config.amplitude, seg1, trace1, 3);
+	Print ("type I (convert.py)", seg1, lot1);
+
+	// type II
+	SdLoopInit (&loop, &config);
+	int lot2 = Run (&loop, config.amplitude, seg2, trace2, 3);
+	Print ("type II", seg2, lot2);
+
+	if (csvName) {
+		FILE *f = fopen (csvName, "w");
+		if (!f) {
+			perror (csvName);
+			return 2;
+		}
+		fprintf (f, "sample,setpoint,type1,type2,dps,lot\n");
+		for (int i = 0; i < NUM_SAMPLES; i++) {
+			fprintf (f, "%d,%.4f,%.4f,%.4f,%.2f,%d\n", i, SetPoint (i),
+				trace1[i * 3], trace2[i * 3], trace2[i * 3 + 1], (int)trace2[i * 3 + 2]);
+		}
+		fclose (f);
+	}
+
+	bool pass = (fabs (seg2[1].sum / seg2[1].count) <= 0.05) &&
+		(fabs (seg2[3].sum / seg2[3].count) <= 0.05) && (lot2 == 0);
+	printf ("%s\n", pass ? "pass" : "FAIL");
+
+	return pass ? 0 : 1;
+}
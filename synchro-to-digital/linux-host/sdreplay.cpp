@@ -0,0 +1,413 @@
+//---------------------------------------------------------------------------------------------
+// notes
+//
+// sdreplay -- feeds a recorded capture through the firmware's converter and checks the
+//             result against a golden file
+//
+// usage:
+//    sdreplay [-d decimate] [-f full_scale_v] [-m mid_counts] [-p trim] [-b bandwidth_hz]
+//             [-z damping] [-w golden.txt | -g golden.txt [-t angle_tol] [-v vel_tol]]
+//             capture.cap
+//
+// the capture comes from record.py or capgen, see lib/capture/capture.h. it needs channels
+// called Vr1-Vr2, Vs1-Vs3 and Vs3-Vs2 at 40000 sets per second, the rate the firmware
+// samples at. samples are turned into volts with the channel scale and offset and then into
+// adc counts, full_scale_v volts (10 by default, the DI-2108's range) being 2048, on top of
+// the mid_counts (2048) each input is biased to on the board.
+//
+// the converter is sdconv.cpp, the code the tiny2040 runs, with sdloop.cpp under it. the
+// adc, dma and interrupt it sets up are adcsim.cpp's: Vs1-Vs3 and Vs3-Vs2 go in on ADC1 and
+// ADC2 as synchro 0, ADC0 and ADC3 sit at mid_counts with no synchro 1. so the replay
+// covers what the board does to the samples, the round robin into the two dma blocks, the
+// dc offset removal and the demodulation against the generator's phase less trim (50 by
+// default, see sdconv.h), as well as the loop.
+//
+// the generator is the one part of the board the capture doesn't have. its phase is taken
+// from the capture's reference instead: sine[] entry 0 at each positive going zero crossing
+// of Vr1-Vr2, the last cycle's period stepped through 100 entries from there. the crossing
+// is interpolated between sets and one less than half a period after the last is noise.
+// the first crossing is the first SdReference call, which starts the adc, so sets before it
+// are not converted.
+//
+// replay runs as fast as the host goes. every decimate blocks, 1 by default, it gives a
+// record
+//    set   angle   velocity   lot   offset1   offset2
+// of synchro 0 at the end of the block, in capture sets, degrees, degrees per second, 0 or 1
+// and the offset being taken off ADC1 and ADC2 in counts.
+//
+//    -w   write the records to golden.txt, with the settings in a comment line
+//    -g   compare the records with golden.txt. angles have to match to within angle_tol
+//         degrees (0.01), velocities to within vel_tol dps (0.5), the set, the loss of
+//         tracking flag and the offsets exactly. the exit status is 1 on any mismatch.
+//
+// a field capture and a golden file made from it before a change to sdconv.cpp or
+// sdloop.cpp show what the change did to real data:
+//
+//    sdreplay -w golden.txt run.cap          on the old code
+//    sdreplay -g golden.txt run.cap          on the new code
+//
+// testdata/move.cap and move.txt are that for the ctest, see CMakeLists.txt.
+//
+
+//---------------------------------------------------------------------------------------------
+// includes
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+
+#include <chrono>
+#include <vector>
+
+#include "pico/stdlib.h"
+
+#include "hardware/adc.h"
+
+#include "capture/capture.h"
+#include "sdloop.h"
+#include "sdconv.h"
+
+using Clock = std::chrono::steady_clock;
+
+
+//---------------------------------------------------------------------------------------------
+// defines
+//
+
+#define READ_SETS 4096
+
+#define GEN_HZ_DEFAULT 400.0              // generator frequency until two crossings are seen
+#define GEN_HZ_MIN     20.0               // refgen.h's range, a period outside it is ignored
+#define GEN_HZ_MAX     1000.0
+
+
+//---------------------------------------------------------------------------------------------
+// typedefs
+//
+
+typedef struct {
+	uint64_t set;
+	float    angle;
+	float    dps;
+	int      lot;
+	int      offset1;
+	int      offset2;
+} Record;
+
+typedef struct {
+	bool     started;
+	double   edge;       // set of the last positive going crossing, fractional
+	double   period;     // sets per cycle
+	double   last;       // last reference sample, volts
+} Generator;
+
+
+//---------------------------------------------------------------------------------------------
+// globals
+//
+
+static int decimate = 1;
+static double fullScale = 10.0;
+static int mid = SD_FULL_SCALE;
+static double angleTol = 0.01;
+static double velTol = 0.5;
+
+// adc input levels of the set being converted
+static uint16_t level[SD_ADC_INPUTS];
+
+
+//---------------------------------------------------------------------------------------------
+// Level -- adcsim.cpp's source, the input levels of the set being converted
+//
+
+static uint16_t Level (uint input)
+{
+	return level[input];
+}
+
+
+//---------------------------------------------------------------------------------------------
+// ToVolts / ToLevel -- capture sample to volts, volts to a 12 bit adc level
+//
+
+static double ToVolts (const capture::Channel &c, int16_t sample)
+{
+	return sample * c.scale + c.offset;
+}
+
+static uint16_t ToLevel (double v)
+{
+	long counts = mid + lround (v / fullScale * SD_FULL_SCALE);
+	return (counts < 0) ? 0 : (counts > 4095) ? 4095 : (uint16_t)counts;
+}
+
+
+//---------------------------------------------------------------------------------------------
+// GenIndex -- the generator's sine[] entry at set n given its reference sample, -1 until
+//             the first crossing
+//
+
+static int GenIndex (Generator *g, uint64_t n, double ref, double sampleHz)
+{
+	if ((g->last < 0) && (ref >= 0) && (!g->started || (n - g->edge > g->period / 2))) {
+		double edge = (n - 1) + g->last / (g->last - ref);
+		if (g->started) {
+			double period = edge - g->edge;
+			if ((period >= sampleHz / GEN_HZ_MAX) && (period <= sampleHz / GEN_HZ_MIN)) {
+				g->period = period;
+			}
+		}
+		g->edge = edge;
+		g->started = true;
+	}
+	g->last = ref;
+
+	if (!g->started) {
+		return -1;
+	}
+
+	return (int)(llround ((n - g->edge) / g->period * SD_REF_STEPS) % SD_REF_STEPS);
+}
+
+
+//---------------------------------------------------------------------------------------------
+// AngleDiff -- a - b in degrees, -180 to +180
+//
+
+static double AngleDiff (double a, double b)
+{
+	return remainder (a - b, 360.0);
+}
+
+
+//---------------------------------------------------------------------------------------------
+// ReadGolden
+//
+
+static bool ReadGolden (const char *path, std::vector<Record> &golden)
+{
+	FILE *f = fopen (path, "r");
+	char line[256];
+
+	if (!f) {
+		perror (path);
+		return false;
+	}
+	while (fgets (line, sizeof (line), f)) {
+		Record r;
+		unsigned long long set;
+		if (line[0] == '#') {
+			continue;
+		}
+		if (sscanf (line, "%llu %f %f %d %d %d", &set, &r.angle, &r.dps, &r.lot, &r.offset1, &r.offset2) == 6) {
+			r.set = set;
+			golden.push_back (r);
+		}
+	}
+	fclose (f);
+
+	return true;
+}
+
+
+//---------------------------------------------------------------------------------------------
+// Compare -- prints the first few mismatches and the largest differences, true if all match
+//
+
+static bool Compare (const std::vector<Record> &golden, const std::vector<Record> &records)
+{
+	double maxAngle = 0, maxVel = 0;
+	size_t bad = 0;
+
+	if (golden.size () != records.size ()) {
+		printf ("golden has %zu records, replay has %zu\n", golden.size (), records.size ());
+	}
+
+	size_t n = (golden.size () < records.size ()) ? golden.size () : records.size ();
+	for (size_t i = 0; i < n; i++) {
+		const Record &g = golden[i], &r = records[i];
+		double da = fabs (AngleDiff (r.angle, g.angle));
+		double dv = fabs (r.dps - g.dps);
+
+		maxAngle = (da > maxAngle) ? da : maxAngle;
+		maxVel = (dv > maxVel) ? dv : maxVel;
+
+		if ((g.set != r.set) || (da > angleTol) || (dv > velTol) || (g.lot != r.lot) ||
+				(g.offset1 != r.offset1) || (g.offset2 != r.offset2)) {
+			if (bad++ < 10) {
+				printf ("set %llu: golden %9.4f %9.2f %d %d %d replay %9.4f %9.2f %d %d %d\n",
+					(unsigned long long)r.set, g.angle, g.dps, g.lot, g.offset1, g.offset2,
+					r.angle, r.dps, r.lot, r.offset1, r.offset2);
+			}
+		}
+	}
+
+	printf ("%zu records compared, %zu mismatched\n", n, bad);
+	printf ("largest differences: angle %.4f velocity %.3f\n", maxAngle, maxVel);
+
+	return (bad == 0) && (golden.size () == records.size ());
+}
+
+
+//---------------------------------------------------------------------------------------------
+// main
+//
+
+int main (int argc, char *argv[])
+{
+	const char *capName = NULL, *writeName = NULL, *goldenName = NULL;
+	float bandwidth = SD_BANDWIDTH_DEFAULT, damping = SD_DAMPING_DEFAULT;
+	int trim = SD_TRIM_DEFAULT;
+
+	for (int i = 1; i < argc; i++) {
+		if (!strcmp (argv[i], "-d") && (i + 1 < argc)) {
+			decimate = atoi (argv[++i]);
+		} else if (!strcmp (argv[i], "-f") && (i + 1 < argc)) {
+			fullScale = atof (argv[++i]);
+		} else if (!strcmp (argv[i], "-m") && (i + 1 < argc)) {
+			mid = atoi (argv[++i]);
+		} else if (!strcmp (argv[i], "-p") && (i + 1 < argc)) {
+			trim = atoi (argv[++i]);
+		} else if (!strcmp (argv[i], "-b") && (i + 1 < argc)) {
+			bandwidth = atof (argv[++i]);
+		} else if (!strcmp (argv[i], "-z") && (i + 1 < argc)) {
+			damping = atof (argv[++i]);
+		} else if (!strcmp (argv[i], "-w") && (i + 1 < argc)) {
+			writeName = argv[++i];
+		} else if (!strcmp (argv[i], "-g") && (i + 1 < argc)) {
+			goldenName = argv[++i];
+		} else if (!strcmp (argv[i], "-t") && (i + 1 < argc)) {
+			angleTol = atof (argv[++i]);
+		} else if (!strcmp (argv[i], "-v") && (i + 1 < argc)) {
+			velTol = atof (argv[++i]);
+		} else if (!capName && (argv[i][0] != '-')) {
+			capName = argv[i];
+		} else {
+			capName = NULL;
+			break;
+		}
+	}
+	if (!capName || (decimate < 1) || (fullScale <= 0) || (mid < 0) || (mid > 4095) ||
+			(trim < 0) || (trim >= SD_REF_STEPS) || (writeName && goldenName)) {
+		fprintf (stderr, "usage: sdreplay [-d decimate] [-f full_scale_v] [-m mid_counts] [-p trim] [-b bandwidth_hz]\n"
+			"                [-z damping] [-w golden.txt | -g golden.txt [-t angle_tol] [-v vel_tol]] capture.cap\n");
+		return 2;
+	}
+
+	capture::Reader cap;
+	if (!cap.Open (capName)) {
+		fprintf (stderr, "%s: not a capture\n", capName);
+		return 2;
+	}
+	int ref = cap.Find ("Vr1-Vr2");
+	int s1ms3 = cap.Find ("Vs1-Vs3");
+	int s3ms2 = cap.Find ("Vs3-Vs2");
+	if ((ref < 0) || (s1ms3 < 0) || (s3ms2 < 0)) {
+		fprintf (stderr, "%s: needs channels Vr1-Vr2, Vs1-Vs3 and Vs3-Vs2\n", capName);
+		return 2;
+	}
+	const capture::Header &info = cap.Info ();
+	if (info.sampleHz != SD_SAMPLE_HZ) {
+		fprintf (stderr, "%s: %u sets per second, the firmware samples at %u\n", capName, info.sampleHz, SD_SAMPLE_HZ);
+		return 2;
+	}
+
+	// the firmware's converter, set up as its core 1 does
+	SdLoopConfig config;
+	AdcSimSource (Level);
+	SdInit ();
+	SdSetTrim (trim);
+	SdSetLoop (bandwidth, damping);
+	SdGetLoop (&config);
+	if ((config.bandwidthHz != bandwidth) || (config.damping != damping)) {
+		fprintf (stderr, "sdreplay: sdconv refused bandwidth %.1f Hz damping %.3f\n", bandwidth, damping);
+		return 2;
+	}
+	for (int i = 0; i < SD_ADC_INPUTS; i++) {
+		level[i] = mid;
+	}
+
+	// replay
+	Generator gen = { false, 0, SD_SAMPLE_HZ / GEN_HZ_DEFAULT, 0 };
+	std::vector<int16_t> buf (READ_SETS * cap.Channels ());
+	std::vector<Record> records;
+	uint64_t set = 0, firstSet = 0;
+	uint32_t blocks = 0;
+	size_t n;
+	auto t0 = Clock::now ();
+
+	while ((n = cap.Read (buf.data (), READ_SETS)) > 0) {
+		for (size_t i = 0; i < n; i++, set++) {
+			const int16_t *s = &buf[i * cap.Channels ()];
+
+			// the timer writes the generator's sample, then the adc converts the set
+			int index = GenIndex (&gen, set, ToVolts (cap.Chan (ref), s[ref]), SD_SAMPLE_HZ);
+			if (index >= 0) {
+				if (!AdcSimRunning ()) {
+					firstSet = set;
+				}
+				SdReference (index);
+			}
+			level[1] = ToLevel (ToVolts (cap.Chan (s1ms3), s[s1ms3]));
+			level[2] = ToLevel (ToVolts (cap.Chan (s3ms2), s[s3ms2]));
+			AdcSimRun (SD_ADC_INPUTS);
+
+			SdTask ();
+
+			SdStats stats;
+			SdGetStats (&stats);
+			if (stats.blocks != blocks) {
+				blocks = stats.blocks;
+				if ((blocks % decimate) == 0) {
+					int32_t angle = (int32_t)SdAngle (0);
+					records.push_back ({ firstSet + (uint64_t)blocks * SD_BLOCK_SETS,
+						(float)(angle * (360.0 / 4294967296.0)), SdVelocity (0), SdLossOfTracking (0),
+						stats.offset[1], stats.offset[2] });
+				}
+			}
+		}
+	}
+
+	double secs = std::chrono::duration<double> (Clock::now () - t0).count ();
+	printf ("%llu sets, %.1f s of capture at %u Hz replayed in %.3f s, %.0fx real time\n",
+		(unsigned long long)set, (double)set / info.sampleHz, info.sampleHz, secs,
+		(secs > 0) ? set / (double)info.sampleHz / secs : 0.0);
+
+	SdStats stats;
+	SdGetStats (&stats);
+	printf ("first set %llu, %u blocks, %u overruns, %u conversions dropped, offsets %d %d counts\n",
+		(unsigned long long)firstSet, stats.blocks, stats.overruns, AdcSimDropped (), stats.offset[1], stats.offset[2]);
+
+	// golden file
+	if (writeName) {
+		FILE *f = fopen (writeName, "w");
+		if (!f) {
+			perror (writeName);
+			return 2;
+		}
+		fprintf (f, "# sdreplay %s decimate %d full scale %.3f V mid %d counts trim %d bandwidth %.1f Hz damping %.3f\n",
+			capName, decimate, fullScale, mid, trim, config.bandwidthHz, config.damping);
+		fprintf (f, "# set angle velocity lot offset1 offset2\n");
+		for (const Record &r : records) {
+			fprintf (f, "%llu %.4f %.3f %d %d %d\n", (unsigned long long)r.set, r.angle, r.dps, r.lot, r.offset1, r.offset2);
+		}
+		fclose (f);
+		printf ("%zu records written to %s\n", records.size (), writeName);
+	}
+
+	if (goldenName) {
+		std::vector<Record> golden;
+		if (!ReadGolden (goldenName, golden)) {
+			return 2;
+		}
+		bool ok = Compare (golden, records);
+		printf ("%s\n", ok ? "match" : "MISMATCH");
+		return ok ? 0 : 1;
+	}
+
+	return 0;
+}
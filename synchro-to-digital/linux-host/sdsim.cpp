@@ -0,0 +1,592 @@
+//---------------------------------------------------------------------------------------------
+// notes
+//
+// sdsim -- the digital to synchro drive feeding the synchro to digital converter, end to
+//          end on the host
+//
+// usage:
+//    sdsim [-g gain] [-p phase_deg] [-n noise] [-t trim] [-b bandwidth_hz] [-z damping]
+//          [-u update_ms] [-r ramp_ms] [-l limit_deg] [-s script.txt] [-o trace.txt]
+//
+// the drive is digital-to-synchro's synchro.h, the code its main.cpp runs: SynchroSlew,
+// SynchroScales and SynchroTarget every update_ms, 5 ms by default, the period of the timer
+// behind its 100 Hz tasks, and SynchroWrite and SynchroNext every 25 us as its 40 kHz
+// interrupt does. the scales ramp to each new set over ramp_ms, update_ms by default as on
+// the board, 0 steps them at once as the drive did before it ramped them. the dacs
+// are dac_recording.h buses, the levels the synchro sees are decoded from the words the
+// interrupt sent, so a write it skipped leaves the old level in place.
+//
+// the synchro is the stator differences of the two dacs against s2 at mid scale, times gain
+// S/D adc counts at full drive, 1800 by default, delayed by phase_deg of the 400 Hz carrier,
+// 0 by default, with gaussian noise of noise counts rms added, 2 by default, and quantized
+// to the adc's +/-2048. the delay is a fraction of a sample interpolated between the two
+// nearest, for a 400 Hz carrier it is the phase shift of the transformer. it holds back
+// the angle as well, by phase_deg / 360 of 2.5 ms, which shows in the latency.
+//
+// the converter is sdloop.cpp run as sdconv.cpp runs it, an SdBank of one synchro stepped a
+// 1 ms block at a time, demodulated against the drive's own sine phase less trim steps of
+// 3.6 degrees. trim is phase_deg / 3.6 rounded unless it is given.
+//
+// the script is a list of "seconds target_degrees" lines, a new target at each time, '#'
+// starts a comment. the run ends a second after the last one. without -s the sweep is
+// moves of 90, 45, 155 and 180 degrees, a 30 degree move the short way across 0 and a
+// 5 degree step.
+//
+// the drive steps one degree at a time, so while it moves the measured angle is checked
+// against the line through its steps, each at the time SynchroSlew made it, see Ramp.
+//
+// for each target it prints how long the drive took to get there, how long until the
+// measured angle stayed within limit_deg of it, the worst and mean lag of the measured
+// angle behind that line while the drive moves, the mean error and the peak to
+// peak ripple over the last 100 ms and the blocks with loss of tracking. over the whole run
+// the latency is the delay that best lines the measured angle up with the line while the
+// drive moves. the exit status is 1 if a hold ends more than limit_deg, 0.25 by
+// default, from its target or tracking is lost after the first 100 ms.
+//
+// -o writes ms, target, commanded, the line, measured, error from commanded, velocity and
+// the loss of tracking flag once per 1 ms block.
+//
+// to compare the ramp with steps it also prints the spectrum of s1 - s3 as the dacs hold it,
+// over 200 ms windows while the drive moves and while it holds: the total harmonic
+// distortion, harmonics 2 to 9 against the 400 Hz carrier, and while it moves the zipper,
+// the sidebands the steps put on the carrier at multiples of the update rate, in dB below
+// the carrier. it prints the ripple on the converter's velocity as well, the rms difference
+// from the drive's one degree per update_ms from 50 ms after a move starts to 20 ms before
+// it ends, and the latency shows the lag the ramp adds.
+//
+
+//---------------------------------------------------------------------------------------------
+// includes
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+
+#include <random>
+#include <vector>
+
+#include "dac/dac_recording.h"
+#include "synchro.h"
+
+#include "sdloop.h"
+#include "sdconv.h"
+
+
+//---------------------------------------------------------------------------------------------
+// defines
+//
+
+#define TICK_HZ      SD_SAMPLE_HZ       // the drive's interrupt and the converter's sets
+#define HISTORY      256                // delay line, a power of 2 above a carrier cycle
+#define HOLD_MS      100                // end of each target the hold error is taken over
+#define MOVE_MS      20                 // the drive is moving if it did in this long
+#define MAX_LAG_MS   50.0               // latency search range
+#define LAG_STEP_MS  0.05
+#define SPECTRUM_SETS 8000               // 200 ms windows, 5 Hz bins
+#define SPECTRUM_CLEAR 20.0             // Hz a sideband has to be from a harmonic
+#define HARMONICS    9
+#define STEADY_MS    50                 // a move is at speed this long after it starts
+
+
+//---------------------------------------------------------------------------------------------
+// typedefs
+//
+
+// the drive's dacs as in its main.cpp, dacs 0 and 1 on spi 0, dac 2 on spi 1
+typedef dac::RecordingSpi<0> Spi0;
+typedef dac::RecordingSpi<1> Spi1;
+typedef dac::Dac<dac::Mcp4802, Spi0, 5> Dac0;
+typedef dac::Dac<dac::Mcp4802, Spi0, 6> Dac1;
+typedef dac::Dac<dac::Mcp4802, Spi1, 13> Dac2;
+
+typedef struct {
+	double seconds;
+	float  target;
+} Move;
+
+typedef struct {
+	float target;
+	float commanded;      // unwrapped, as SynchroSlew keeps it
+	float ramp;           // commanded through the steps, see Ramp
+	float measured;       // unwrapped
+	float dps;
+	bool  lot;
+} Record;
+
+
+//---------------------------------------------------------------------------------------------
+// globals
+//
+
+static double gain = 1800.0;
+static double phaseDeg = 0.0;
+static double noise = 2.0;
+static int trim = -1;
+static double updateMs = 5.0;
+static double rampMs = -1;
+static double limitDeg = 0.25;
+
+static const Move sweep[] = {
+	{ 0.0,   0 },
+	{ 0.2,  90 },
+	{ 1.0,  45 },
+	{ 1.6, 200 },
+	{ 2.8,  20 },
+	{ 4.0, 350 },
+	{ 4.6, 355 },
+};
+
+
+//---------------------------------------------------------------------------------------------
+// Wrap -- degrees to 0 to 360
+//
+
+static double Wrap (double degrees)
+{
+	degrees = fmod (degrees, 360.0);
+	return (degrees < 0) ? degrees + 360.0 : degrees;
+}
+
+
+//---------------------------------------------------------------------------------------------
+// ReadScript
+//
+
+static bool ReadScript (const char *path, std::vector<Move> &moves)
+{
+	FILE *f = fopen (path, "r");
+	char line[256];
+
+	if (!f) {
+		perror (path);
+		return false;
+	}
+	while (fgets (line, sizeof (line), f)) {
+		Move m;
+		char *hash = strchr (line, '#');
+		if (hash) {
+			*hash = 0;
+		}
+		if (sscanf (line, "%lf %f", &m.seconds, &m.target) == 2) {
+			if (!moves.empty () && (m.seconds <= moves.back ().seconds)) {
+				fprintf (stderr, "%s: times have to increase\n", path);
+				fclose (f);
+				return false;
+			}
+			moves.push_back (m);
+		}
+	}
+	fclose (f);
+
+	return !moves.empty ();
+}
+
+
+//---------------------------------------------------------------------------------------------
+// Decode -- follow the B channel levels through the words the interrupt sent
+//
+
+static void Decode (uint8_t *held)
+{
+	for (const Spi0::Transfer &t : Spi0::log) {
+		if (t.word & dac::Mcp4802::B) {
+			held[(t.selected & (1u << Dac1::csPin)) ? 1 : 0] = (uint8_t)(t.word >> 4);
+		}
+	}
+	for (const Spi1::Transfer &t : Spi1::log) {
+		if (t.word & dac::Mcp4802::B) {
+			held[2] = (uint8_t)(t.word >> 4);
+		}
+	}
+	Spi0::Clear ();
+	Spi1::Clear ();
+}
+
+
+//---------------------------------------------------------------------------------------------
+// ToCounts -- stator difference in dac levels to adc counts, with noise
+//
+
+static int16_t ToCounts (double levels, std::normal_distribution<double> &dist, std::mt19937 &rng)
+{
+	double v = levels / 127.0 * gain + dist (rng);
+	v = (v > SD_FULL_SCALE - 1) ? SD_FULL_SCALE - 1 : (v < -SD_FULL_SCALE) ? -SD_FULL_SCALE : v;
+	return (int16_t)lround (v);
+}
+
+
+//---------------------------------------------------------------------------------------------
+// Ramp -- while the drive slews, the line through its steps with each step at the time
+//         SynchroSlew made it, otherwise the commanded angle. it is what the staircase of
+//         steps stands for and what the measured angle is checked against
+//
+
+static void Ramp (std::vector<Record> &records)
+{
+	std::vector<size_t> steps;
+
+	for (size_t i = 0; i < records.size (); i++) {
+		records[i].ramp = records[i].commanded;
+		if ((i > 0) && (records[i].commanded != records[i - 1].commanded)) {
+			steps.push_back (i);
+		}
+	}
+
+	// record i is the end of block i, step j was made at the start of block steps[j]
+	for (size_t j = 0; j + 1 < steps.size (); j++) {
+		size_t a = steps[j], b = steps[j + 1];
+		if (b - a > updateMs + 0.5) {
+			continue;
+		}
+		for (size_t i = a; i < b; i++) {
+			double f = (i + 1.0 - a) / (b - a);
+			records[i].ramp = records[a].commanded + f * (records[b].commanded - records[a].commanded);
+		}
+	}
+}
+
+
+//---------------------------------------------------------------------------------------------
+// Direction -- +1 or -1 while the drive is on its way to the target, 0 once it is there
+//
+
+static int Direction (const std::vector<Record> &records, size_t i)
+{
+	const Record &r = records[i];
+	if ((i < MOVE_MS) || (fabs (remainder (r.commanded - r.target, 360.0)) < 0.5)) {
+		return 0;
+	}
+	float before = records[i - MOVE_MS].ramp;
+	return (r.ramp > before) ? +1 : (r.ramp < before) ? -1 : 0;
+}
+
+
+//---------------------------------------------------------------------------------------------
+// Latency -- delay in ms that best lines measured up with the ramp while the drive moves
+//
+
+static double Latency (const std::vector<Record> &records, double *rms)
+{
+	double best = 0, bestRms = -1;
+
+	for (double lag = 0; lag <= MAX_LAG_MS; lag += LAG_STEP_MS) {
+		int whole = (int)lag;
+		double frac = lag - whole;
+		double sum = 0;
+		size_t n = 0;
+
+		for (size_t i = whole + 1; i < records.size (); i++) {
+			const Record &r = records[i];
+			if (!Direction (records, i)) {
+				continue;
+			}
+			double c = records[i - whole].ramp * (1 - frac) + records[i - whole - 1].ramp * frac;
+			sum += (r.measured - c) * (r.measured - c);
+			n++;
+		}
+		if (n && ((bestRms < 0) || (sum / n < bestRms * bestRms))) {
+			best = lag;
+			bestRms = sqrt (sum / n);
+		}
+	}
+
+	*rms = bestRms;
+	return best;
+}
+
+
+//---------------------------------------------------------------------------------------------
+// Power -- power of x at hz over n samples from first, hann windowed, goertzel
+//
+
+static double Power (const std::vector<float> &x, size_t first, size_t n, double hz)
+{
+	double k = 2.0 * cos (2.0 * M_PI * hz / TICK_HZ);
+	double s1 = 0, s2 = 0;
+
+	for (size_t i = 0; i < n; i++) {
+		double w = 0.5 - 0.5 * cos (2.0 * M_PI * i / n);
+		double s0 = w * x[first + i] + k * s1 - s2;
+		s2 = s1;
+		s1 = s0;
+	}
+	return s1 * s1 + s2 * s2 - k * s1 * s2;
+}
+
+
+//---------------------------------------------------------------------------------------------
+// Spectrum -- add the carrier's, its harmonics' and the update's sidebands' power over the
+//             windows of x where want is set
+//
+
+static void Spectrum (const std::vector<float> &x, const std::vector<bool> &want, double *carrier,
+	double *harmonics, double *sidebands)
+{
+	double fc = (double)TICK_HZ / SYNCHRO_SINE_STEPS, fu = 1000.0 / updateMs;
+
+	for (size_t first = 0; first + SPECTRUM_SETS <= x.size (); first += SPECTRUM_SETS) {
+		bool all = true;
+		for (size_t i = first; all && (i < first + SPECTRUM_SETS); i++) {
+			all = want[i];
+		}
+		if (!all) {
+			continue;
+		}
+
+		*carrier += Power (x, first, SPECTRUM_SETS, fc);
+		for (int h = 2; h <= HARMONICS; h++) {
+			*harmonics += Power (x, first, SPECTRUM_SETS, h * fc);
+		}
+
+		// the carrier moved by the update rate, clear of its harmonics
+		for (int m = -HARMONICS; m <= HARMONICS; m++) {
+			double f = fc + m * fu;
+			double off = fabs (remainder (f, fc));
+			if ((f > 0) && (f <= HARMONICS * fc) && (off > SPECTRUM_CLEAR)) {
+				*sidebands += Power (x, first, SPECTRUM_SETS, f);
+			}
+		}
+	}
+}
+
+
+//---------------------------------------------------------------------------------------------
+// main
+//
+
+int main (int argc, char *argv[])
+{
+	const char *scriptName = NULL, *traceName = NULL;
+	SdLoopConfig config;
+	SdLoopDefaults (&config, TICK_HZ);
+
+	for (int i = 1; i < argc; i++) {
+		if (!strcmp (argv[i], "-g") && (i + 1 < argc)) {
+			gain = atof (argv[++i]);
+		} else if (!strcmp (argv[i], "-p") && (i + 1 < argc)) {
+			phaseDeg = atof (argv[++i]);
+		} else if (!strcmp (argv[i], "-n") && (i + 1 < argc)) {
+			noise = atof (argv[++i]);
+		} else if (!strcmp (argv[i], "-t") && (i + 1 < argc)) {
+			trim = atoi (argv[++i]);
+		} else if (!strcmp (argv[i], "-b") && (i + 1 < argc)) {
+			config.bandwidthHz = atof (argv[++i]);
+		} else if (!strcmp (argv[i], "-z") && (i + 1 < argc)) {
+			config.damping = atof (argv[++i]);
+		} else if (!strcmp (argv[i], "-u") && (i + 1 < argc)) {
+			updateMs = atof (argv[++i]);
+		} else if (!strcmp (argv[i], "-r") && (i + 1 < argc)) {
+			rampMs = atof (argv[++i]);
+		} else if (!strcmp (argv[i], "-l") && (i + 1 < argc)) {
+			limitDeg = atof (argv[++i]);
+		} else if (!strcmp (argv[i], "-s") && (i + 1 < argc)) {
+			scriptName = argv[++i];
+		} else if (!strcmp (argv[i], "-o") && (i + 1 < argc)) {
+			traceName = argv[++i];
+		} else {
+			scriptName = "";
+			break;
+		}
+	}
+	if ((scriptName && !scriptName[0]) || (gain <= 0) || (phaseDeg < 0) || (phaseDeg >= 360) || (noise < 0) ||
+			(updateMs < 1) || (trim >= SD_REF_STEPS)) {
+		fprintf (stderr, "usage: sdsim [-g gain] [-p phase_deg] [-n noise] [-t trim] [-b bandwidth_hz] [-z damping]\n"
+			"             [-u update_ms] [-r ramp_ms] [-l limit_deg] [-s script.txt] [-o trace.txt]\n");
+		return 2;
+	}
+	rampMs = (rampMs < 0) ? updateMs : rampMs;
+
+	std::vector<Move> moves (sweep, sweep + sizeof (sweep) / sizeof (sweep[0]));
+	if (scriptName) {
+		moves.clear ();
+		if (!ReadScript (scriptName, moves)) {
+			fprintf (stderr, "%s: no moves\n", scriptName);
+			return 2;
+		}
+	}
+
+	// the converter demodulates against the drive's phase, the trim takes out the synchro's
+	double delay = phaseDeg / 360.0 * SYNCHRO_SINE_STEPS;
+	if (trim < 0) {
+		trim = (int)lround (delay) % SD_REF_STEPS;
+	}
+	int8_t refSign[SD_REF_STEPS];
+	for (int i = 0; i < SD_REF_STEPS; i++) {
+		refSign[i] = ((i % (SD_REF_STEPS / 2)) == 0) ? 0 : (i < SD_REF_STEPS / 2) ? +1 : -1;
+	}
+
+	config.amplitude = gain;
+	static SdBank bank;
+	SdBankInit (&bank, 1, &config);
+
+	printf ("gain %.0f counts, phase %.1f deg, trim %d, noise %.1f counts rms, loop %.1f Hz %.3f, update %.1f ms,\n"
+		"ramp %.1f ms\n", gain, phaseDeg, trim, noise, config.bandwidthHz, config.damping, updateMs, rampMs);
+
+	// drive state as main.cpp has it after start up
+	SynchroDrive drive = {};
+	uint8_t held[SYNCHRO_DACS] = { 0, 0, 0 };
+	float scale0 = 0, scale1 = 0, scale2 = -1;
+	float target = 0, theta = 0;
+	Spi0::Clear ();
+	Spi1::Clear ();
+
+	std::mt19937 rng (1);
+	std::normal_distribution<double> dist (0.0, noise);
+	double hist1[HISTORY] = {}, hist3[HISTORY] = {};
+	int whole = (int)delay;
+	double frac = delay - whole;
+
+	int8_t refBlock[SD_BLOCK_SETS];
+	int16_t s1ms3Block[SD_BLOCK_SETS], s3ms2Block[SD_BLOCK_SETS];
+
+	std::vector<Record> records;
+	double endSeconds = moves.back ().seconds + 1.0;
+	uint64_t ticks = (uint64_t)llround (endSeconds * TICK_HZ);
+	uint64_t updateTicks = (uint64_t)llround (updateMs * TICK_HZ / 1000.0);
+	uint32_t rampTicks = (uint32_t)llround (rampMs * TICK_HZ / 1000.0);
+	size_t nextMove = 0;
+	float measured = 0;
+
+	// s1 - s3 as the dacs hold it, for its spectrum
+	std::vector<float> drive13;
+	std::vector<bool> moving, holding;
+	uint64_t changed = 0;
+
+	for (uint64_t n = 0; n < ticks; n++) {
+
+		// main loop, targets from the script and the trajectory
+		if ((nextMove < moves.size ()) && (n >= (uint64_t)llround (moves[nextMove].seconds * TICK_HZ))) {
+			target = Wrap (moves[nextMove++].target);
+		}
+		if ((n % updateTicks) == 0) {
+			float before = theta;
+			theta = SynchroSlew (theta, target);
+			SynchroScales (theta, &scale0, &scale1);
+			SynchroTarget (&drive, scale0, scale1, scale2, rampTicks);
+			changed = (theta != before) ? n : changed;
+		}
+
+		// 40 kHz interrupt, the levels it writes are what the synchro sees for this set
+		SynchroWrite<Dac0, Dac1, Dac2> (&drive);
+		Decode (held);
+		uint8_t phase = drive.phase;
+		SynchroNext (&drive);
+
+		// moving while the drive changed within the last update, holding once it has been
+		// still for a ramp and a carrier cycle
+		drive13.push_back ((float)held[1] - held[0]);
+		moving.push_back (n - changed < updateTicks);
+		holding.push_back (n - changed >= rampTicks + SYNCHRO_SINE_STEPS);
+
+		// synchro, s1 on dac 1, s3 on dac 0, s2 at mid scale
+		int h = n % HISTORY;
+		hist1[h] = (double)held[1] - held[0];
+		hist3[h] = (double)held[0] - SYNCHRO_MID;
+		int a = (h - whole + HISTORY) % HISTORY, b = (a - 1 + HISTORY) % HISTORY;
+		double s1ms3 = hist1[a] * (1 - frac) + hist1[b] * frac;
+		double s3ms2 = hist3[a] * (1 - frac) + hist3[b] * frac;
+
+		// converter
+		int k = n % SD_BLOCK_SETS;
+		refBlock[k] = refSign[(phase + SD_REF_STEPS - trim) % SD_REF_STEPS];
+		s1ms3Block[k] = ToCounts (s1ms3, dist, rng);
+		s3ms2Block[k] = ToCounts (s3ms2, dist, rng);
+		if (k == SD_BLOCK_SETS - 1) {
+			SdBankRun (&bank, refBlock, s1ms3Block, s3ms2Block, SD_BLOCK_SETS);
+			float angle = SdBankDegrees (&bank, 0);
+			measured += remainder (angle - measured, 360.0);
+			records.push_back ({ target, theta, theta, measured, SdBankDps (&bank, 0), bank.lot[0] });
+		}
+	}
+
+	// per target
+	Ramp (records);
+	bool pass = true;
+	printf ("\n   start   target   move ms  settle ms   max lag  mean lag  hold err    ripple   lot\n");
+	for (size_t m = 0; m < moves.size (); m++) {
+		size_t first = (size_t)llround (moves[m].seconds * 1000.0);
+		size_t end = (m + 1 < moves.size ()) ? (size_t)llround (moves[m + 1].seconds * 1000.0) : records.size ();
+		end = (end > records.size ()) ? records.size () : end;
+		double moveMs = -1, settleMs = 0, maxLag = 0, lagSum = 0, holdSum = 0, lo = 1e9, hi = -1e9;
+		size_t lagN = 0, holdN = 0, lot = 0;
+
+		for (size_t i = first; i < end; i++) {
+			const Record &r = records[i];
+			double fromTarget = remainder (r.measured - r.target, 360.0);
+			if ((moveMs < 0) && (fabs (remainder (r.commanded - r.target, 360.0)) < 1.0)) {
+				moveMs = i + 1 - first;
+			}
+			if (fabs (fromTarget) > limitDeg) {
+				settleMs = i + 1 - first;
+			}
+			int dir = Direction (records, i);
+			if (dir) {
+				double lag = dir * (r.ramp - r.measured);
+				maxLag = (lag > maxLag) ? lag : maxLag;
+				lagSum += lag;
+				lagN++;
+			}
+			if (i + HOLD_MS >= end) {
+				holdSum += fromTarget;
+				lo = (fromTarget < lo) ? fromTarget : lo;
+				hi = (fromTarget > hi) ? fromTarget : hi;
+				holdN++;
+			}
+			lot += r.lot && (i >= 100);
+		}
+
+		double hold = holdN ? holdSum / holdN : 0;
+		printf ("%8.3f %8.1f %9.0f %10.0f %9.3f %9.3f %9.3f %9.3f %5zu\n", moves[m].seconds, Wrap (moves[m].target),
+			moveMs, settleMs, maxLag, lagN ? lagSum / lagN : 0.0, hold, holdN ? hi - lo : 0.0, lot);
+		pass = pass && (fabs (hold) <= limitDeg) && (lot == 0);
+	}
+
+	double rms;
+	double latency = Latency (records, &rms);
+	printf ("\nlatency %.2f ms, %.3f deg rms from the delayed ramp while moving\n", latency, rms);
+
+	// velocity ripple once a move is at speed
+	double rippleSum = 0;
+	size_t rippleN = 0;
+	for (size_t i = STEADY_MS; i + MOVE_MS < records.size (); i++) {
+		int dir = Direction (records, i);
+		if (dir && (Direction (records, i - STEADY_MS) == dir) && (Direction (records, i + MOVE_MS) == dir)) {
+			double d = records[i].dps - dir * 1000.0 / updateMs;
+			rippleSum += d * d;
+			rippleN++;
+		}
+	}
+	printf ("velocity ripple %.2f dps rms while moving\n", rippleN ? sqrt (rippleSum / rippleN) : 0.0);
+
+	double carrier = 0, harmonics = 0, sidebands = 0, holdCarrier = 0, holdHarmonics = 0, unused = 0;
+	Spectrum (drive13, moving, &carrier, &harmonics, &sidebands);
+	Spectrum (drive13, holding, &holdCarrier, &holdHarmonics, &unused);
+	if ((carrier > 0) && (holdCarrier > 0)) {
+		printf ("s1-s3 drive: thd %.3f%% moving, %.3f%% holding, zipper %.1f dBc while moving\n",
+			100.0 * sqrt (harmonics / carrier), 100.0 * sqrt (holdHarmonics / holdCarrier),
+			10.0 * log10 (sidebands / carrier));
+	}
+
+	if (traceName) {
+		FILE *f = fopen (traceName, "w");
+		if (!f) {
+			perror (traceName);
+			return 2;
+		}
+		fprintf (f, "# ms target commanded ramp measured error dps lot\n");
+		for (size_t i = 0; i < records.size (); i++) {
+			const Record &r = records[i];
+			fprintf (f, "%zu %.1f %.1f %.3f %.4f %.4f %.2f %d\n", i + 1, r.target, Wrap (r.commanded),
+				Wrap (r.ramp), Wrap (r.measured), remainder (r.measured - r.commanded, 360.0), r.dps, r.lot);
+		}
+		fclose (f);
+	}
+
+	printf ("%s\n", pass ? "pass" : "FAIL");
+
+	return pass ? 0 : 1;
+}
@@ -3,6 +3,49 @@
 //
 // make && openocd -f interface/raspberrypi-swd.cfg -f target/rp2040.cfg -c "program sin400.elf verify reset ; init ; reset halt ; rp2040.core1 arp_reset assert 0 ; rp2040.core0 arp_reset assert 0 ; exit"
 //
+// core 1 generates the reference, 400 Hz unless set otherwise, see refgen.h, and runs the
+// synchro to digital converter in sdconv.cpp, see sdconv.h for the adc inputs.
+//
+// commands:
+//    a     start or stop printing synchro 0's shaft angle in degrees at 100 Hz
+//    s     print the converter's block, overrun and timing counters and the input offsets
+//    t     print the demodulator's reference trim
+//    t,<n> set the trim to n hundredths of a cycle of reference lag, 0 to 99, 25 us each at
+//          400 Hz, see sdconv.h
+//    v     print each synchro's shaft angle, velocity and loss of tracking flag
+//    b     print the tracking loop's bandwidth and damping
+//    b,<hz>[,<damping>]
+//          set the tracking loop's closed loop bandwidth, 1 to 200 Hz, and damping, 0.1 to 5,
+//          see sdloop.h
+//    e     print the reference's amplitude, frequency and ramp time
+//    e,<amplitude>[,<hz>[,<ramp_ms>]]
+//          set the reference's amplitude, 0 to 1 of the dac's swing, frequency, 20 to 1000 Hz,
+//          and the time amplitude changes ramp over, 0 to 10000 ms, see refgen.h. the change
+//          is made at the next zero crossing. a field that is not a number or is out of
+//          range, or a fifth field, changes nothing
+//    p     print the reference pll's state, the external reference's frequency and the
+//          phase error
+//    p,<n> lock the reference to the external one on GP6, 1, or let it run free, 0, see
+//          below
+//
+// the external reference, a 400 Hz bus the panel shares, comes in on GP6 as a logic level
+// that rises at its positive going zero crossing, from a comparator or a schmitt buffer
+// behind a divider and clamp. with the pll on, the reference's frequency is pulled up to
+// 2% onto it and its phase zero lined up with that edge, see refpll.h. the green led is on
+// while it is locked.
+//
+// binary commands, for programs on the same port. a frame starts at the beginning of a line
+// with a byte no typed command starts with, that byte fixes its length. values are little
+// endian, a frame not complete within 100 ms is dropped:
+//    0x01  set the reference, 7 bytes
+//          bytes 1-2    amplitude, 1/10000 of the dac's swing
+//          bytes 3-4    frequency, 1/10 Hz
+//          bytes 5-6    ramp time, ms
+//    0x02  get the reference, 1 byte
+// both are answered with 0x03 and 7 bytes:
+//          byte 1       0 ok, 1 out of range, 2 busy, try again within a cycle
+//          bytes 2-7    the reference's settings as in 0x01
+//
 
 //---------------------------------------------------------------------------------------------
 // includes
@@ -22,6 +65,13 @@
 #include "hardware/spi.h"
 #include "hardware/adc.h"
 
+#include "dac/dac_pico.h"
+
+#include "sdloop.h"
+#include "sdconv.h"
+#include "refgen.h"
+#include "refpll.h"
+
 
 //---------------------------------------------------------------------------------------------
 // defines
@@ -29,6 +79,14 @@
 
 #define CMD_MAXLEN 72
 
+#define BIN_SET_REF     0x01
+#define BIN_SET_REF_LEN 7
+#define BIN_GET_REF     0x02
+#define BIN_GET_REF_LEN 1
+#define BIN_REF         0x03
+#define BIN_REF_LEN     8
+#define BIN_TIMEOUT_US  100000
+
 
 //---------------------------------------------------------------------------------------------
 // typedefs
@@ -43,6 +101,12 @@ bool repeating_timer_callback_100Hz (struct repeating_timer *t);
 
 void InitCommand (void);
 void GetCommand (void);
+void BinaryByte (uint8_t ch);
+void BinaryCommand (const uint8_t *frame);
+void PrintReference (const RefConfig *config);
+bool ParseFloat (const char *text, float min, float max, float *value);
+void PrintPll (void);
+void PllRestart (void);
 
 
 //---------------------------------------------------------------------------------------------
@@ -51,7 +115,8 @@ void GetCommand (void);
 
 void core1_entry (void);
 bool repeating_timer_callback_40kHz (struct repeating_timer *t);
-void dacWrite16 (spi_inst_t *spi, uint cs_pin, uint16_t a);
+void RefEdgeIrq (uint gpio, uint32_t events);
+void PllTask (void);
 
 
 //---------------------------------------------------------------------------------------------
@@ -73,41 +138,44 @@ const uint SPI0_CS0n_PIN = 1;
 const uint SPI0_SCK_PIN  = 2;
 const uint SPI0_MOSI_PIN = 3;
 
+const uint REF_IN_PIN = 6;
+
+// the one dac, on spi0 with 16 bit frames
+typedef dac::Mcp4802 Mcp;
+typedef dac::Dac<Mcp, dac::PicoSpi<0>, SPI0_CS0n_PIN> Dac2;
+
 volatile bool flag100 = false;
+static bool showAngle = false;
 
 static char cmd_buffer[CMD_MAXLEN];
 static uint8_t cmd_length = 0;
 static uint8_t cmd_state = 0;
 
-static volatile uint8_t sin_phase = 0;
 // static volatile uint8_t dac0B = 0; 		// SPI 0, CS 0
 // static volatile uint8_t dac1B = 0; 		// SPI 0, CS 1
-static volatile uint8_t dac2B = 0; 		// SPI 1, CS 0
+static volatile uint8_t dac2B = REF_MID; 	// SPI 1, CS 0
+static uint8_t dac2Index = 0;				// sine[] entry of dac2B, see refgen.h
 // static volatile float scaleDac0 = 1.0;
 // static volatile float scaleDac1 = 1.0;
-static volatile float scaleDac2 = 0.90;
-
-// critical section for communicating between the two cores
-critical_section_t scale_critsec;
-
-// sine lookup table
-// a=sin((0:99)*2*pi/100);
-// b=round(a*127);
-// min(b) ans = -127
-// max(b) ans =  127
-// b(1)   ans =  0
-static const int8_t sine[100] = {
-     0,    8,   16,   24,   32,   39,   47,   54,   61,   68,   
-    75,   81,   87,   93,   98,  103,  107,  111,  115,  118,  
-   121,  123,  125,  126,  127,  127,  127,  126,  125,  123,  
-   121,  118,  115,  111,  107,  103,   98,   93,   87,   81,   
-    75,   68,   61,   54,   47,   39,   32,   24,   16,    8,    
-     0,   -8,  -16,  -24,  -32,  -39,  -47,  -54,  -61,  -68,  
-   -75,  -81,  -87,  -93,  -98, -103, -107, -111, -115, -118, 
-  -121, -123, -125, -126, -127, -127, -127, -126, -125, -123, 
-  -121, -118, -115, -111, -107, -103,  -98,  -93,  -87,  -81,  
-   -75,  -68,  -61,  -54,  -47,  -39,  -32,  -24,  -16,   -8
-};
+
+// the sample just written and the last external reference edge, core 1's interrupts
+static volatile uint32_t sampleUs = 0;
+static volatile uint32_t samplePhase = 0;
+static volatile uint32_t edgeUs = 0;
+static volatile uint32_t edgePhase = 0;
+static volatile uint32_t edgeCount = 0;
+
+// reference pll, run by core 1, core 0 turns it on and off and reads it to print
+static RefPll pll;
+static volatile bool pllOn = false;
+static volatile bool pllRestart = false;
+static volatile float pllNominalHz = REF_HZ_DEFAULT;
+
+// binary command being received
+static uint8_t binFrame[BIN_SET_REF_LEN];
+static uint8_t binLength = 0;
+static uint8_t binNeeded = 0;
+static uint32_t binUs = 0;
 
 
 //---------------------------------------------------------------------------------------------
@@ -166,9 +234,13 @@ int main ()
 	// dac1B = 0;
 
 	// initialize dacs on spi 1
-	dacWrite16 (spi0, SPI0_CS0n_PIN, 0x3800); // write 0x800 to DAC 2 A
-	dacWrite16 (spi0, SPI0_CS0n_PIN, 0xB000); // write 0x000 to DAC 2 B
-	dac2B = 0;
+	Dac2::Write (Mcp::Word (Mcp::A, 0x80)); // write 0x800 to DAC 2 A
+	Dac2::Write (Mcp::Word (Mcp::B, 0x00)); // write 0x000 to DAC 2 B
+
+	// reference generator, it ramps up from mid scale once the 40 kHz timer starts
+	RefConfig refConfig;
+	RefDefaults (&refConfig);
+	RefInit (&refConfig);
 
 	// hello world
 	printf ("Hello, world!\n");
@@ -179,9 +251,6 @@ int main ()
     // set up 10 ms / 100 Hz repeating timer on core 0
     add_repeating_timer_ms (-10, repeating_timer_callback_100Hz, NULL, &timer_100Hz);
 
-	// initialize critical section
-	critical_section_init (&scale_critsec);
-
 	// start core 1 tasks
 	multicore_launch_core1 (core1_entry);
 
@@ -200,12 +269,59 @@ int main ()
         // once a line of input is received, process it
         if (cmd_state == 2) {
             int index = 0;
+            char cmd = 0;
+            SdLoopConfig loopConfig;
+            RefConfig refConfig;
+            bool refBad = false;
             char *buffptr = strtok (cmd_buffer, ",");
             while (buffptr != NULL) {
 
                 switch (index++) {
 
                     case 0:
+						if (!strcmp (buffptr, "a")) {		// shaft angle on or off
+							showAngle = !showAngle;
+							break;
+						}
+						if (!strcmp (buffptr, "s")) {		// converter counters
+							SdStats stats;
+							SdGetStats (&stats);
+							printf ("blocks: %lu overruns: %lu max block: %lu us\n",
+								stats.blocks, stats.overruns, stats.maxBlockUs);
+							printf ("offsets: %d %d %d %d\n",
+								stats.offset[0], stats.offset[1], stats.offset[2], stats.offset[3]);
+							break;
+						}
+						if (!strcmp (buffptr, "v")) {		// angle, velocity, tracking
+							for (int ch = 0; ch < SD_SYNCHROS; ch++) {
+								printf ("synchro %d angle: %8.2f velocity: %8.2f dps %s\n", ch,
+									(int32_t)SdAngle (ch) * (180.0 / 2147483648.0), SdVelocity (ch),
+									SdLossOfTracking (ch) ? "loss of tracking" : "tracking");
+							}
+							break;
+						}
+						if (!strcmp (buffptr, "b")) {		// loop bandwidth and damping
+							cmd = 'b';
+							SdGetLoop (&loopConfig);
+							printf ("bandwidth: %.1f Hz damping: %.3f\n", loopConfig.bandwidthHz, loopConfig.damping);
+							break;
+						}
+						if (!strcmp (buffptr, "t")) {		// reference trim
+							cmd = 't';
+							printf ("trim: %d steps, %.1f degrees\n", SdTrim (), SdTrim () * 3.6);
+							break;
+						}
+						if (!strcmp (buffptr, "e")) {		// reference excitation
+							cmd = 'e';
+							RefGet (&refConfig);
+							PrintReference (&refConfig);
+							break;
+						}
+						if (!strcmp (buffptr, "p")) {		// reference pll
+							cmd = 'p';
+							PrintPll ();
+							break;
+						}
                         printf ("nothing happens (0).\n");
 						// theta = atof (buffptr);
 						// newScale0 =  sin ((theta + 120)*M_PI/180.0); // s3 / blue
@@ -222,11 +338,67 @@ int main ()
                         break;
 
                     case 1:
+						if (cmd == 't') {
+							SdSetTrim (atoi (buffptr));
+							printf ("trim: %d steps, %.1f degrees\n", SdTrim (), SdTrim () * 3.6);
+							break;
+						}
+						if (cmd == 'b') {
+							SdSetLoop (atof (buffptr), loopConfig.damping);
+							SdGetLoop (&loopConfig);
+							printf ("bandwidth: %.1f Hz damping: %.3f\n", loopConfig.bandwidthHz, loopConfig.damping);
+							break;
+						}
+						if (cmd == 'e') {
+							refBad |= !ParseFloat (buffptr, 0.0f, 1.0f, &refConfig.amplitude);
+							break;
+						}
+						if (cmd == 'p') {
+							pllOn = atoi (buffptr) != 0;
+							PllRestart ();
+							printf ("pll: %s\n", pllOn ? "on" : "off");
+							break;
+						}
                         printf ("nothing happens (1).\n");
                         break;
+
+                    case 2:
+						if (cmd == 'b') {
+							SdSetLoop (loopConfig.bandwidthHz, atof (buffptr));
+							SdGetLoop (&loopConfig);
+							printf ("bandwidth: %.1f Hz damping: %.3f\n", loopConfig.bandwidthHz, loopConfig.damping);
+						}
+						if (cmd == 'e') {
+							refBad |= !ParseFloat (buffptr, REF_HZ_MIN, REF_HZ_MAX, &refConfig.hz);
+						}
+                        break;
+
+                    case 3:
+						if (cmd == 'e') {
+							refBad |= !ParseFloat (buffptr, 0.0f, REF_RAMP_MS_MAX, &refConfig.rampMs);
+						}
+                        break;
+
+                    default:
+						refBad = true;
+                        break;
                 }
                 buffptr = strtok (NULL, ",");
             }
+
+			// the reference takes all its values at once
+			if ((cmd == 'e') && (index > 1)) {
+				if (refBad) {
+					printf ("bad reference setting, nothing changed.\n");
+				} else {
+					if (!RefSet (&refConfig)) {
+						printf ("out of range or busy.\n");
+					}
+					PllRestart ();
+				}
+				RefGet (&refConfig);
+				PrintReference (&refConfig);
+			}
 			cmd_state = 0;
         }
 
@@ -251,6 +423,14 @@ int main ()
             if (++ledTimer >= 100) {
                 ledTimer = 0;
             }
+
+			// green led while the reference is locked to the external one
+			gpio_put (LED_GRN_PIN, !(pllOn && (pll.state == REF_PLL_LOCKED)));
+
+			// shaft angle, the format convert.py sends to the serial display
+			if (showAngle) {
+				printf ("%8.2f\n", (int32_t)SdAngle (0) * (180.0 / 2147483648.0));
+			}
         }
 	}
 
@@ -287,9 +467,16 @@ void GetCommand (void)
         // get character
         ch = getchar_timeout_us (0);
 
+        // drop a binary frame that stopped part way
+        if (binLength && (time_us_32 () - binUs > BIN_TIMEOUT_US)) {
+            binLength = 0;
+        }
+
         // process character
         if (ch != PICO_ERROR_TIMEOUT) {
-            if (ch == 0x0d) {                           // return
+            if (binLength || ((cmd_length == 0) && (ch == BIN_SET_REF || ch == BIN_GET_REF))) {
+                BinaryByte (ch);                        // binary command
+            } else if (ch == 0x0d) {                    // return
                 // carriage return and linefeed
                 putchar (0x0d);
                 putchar (0x0a);
@@ -320,8 +507,102 @@ void GetCommand (void)
 }
 
 
+// a whole field as a number from min to max, false and value untouched if not
+bool ParseFloat (const char *text, float min, float max, float *value)
+{
+	char *end;
+	float v = strtof (text, &end);
+
+	if ((end == text) || (*end != 0) || !(v >= min && v <= max)) {
+		return false;
+	}
+	*value = v;
+
+	return true;
+}
+
+
+void PrintReference (const RefConfig *config)
+{
+	printf ("reference: amplitude %.3f frequency %.1f Hz ramp %.0f ms\n",
+		config->amplitude, config->hz, config->rampMs);
+}
+
+
+void PrintPll (void)
+{
+	if (!pllOn) {
+		printf ("pll: off\n");
+		return;
+	}
+	printf ("pll: %s%s, reference %.3f Hz, phase error %.2f degrees, trim %ld\n",
+		RefPllStateName (pll.state), pll.outOfRange ? " out of range" : "", pll.refHz, pll.errDeg, (long)pll.trim);
+}
+
+
+// the pll starts again at the reference's frequency, core 1 picks it up in PllTask
+void PllRestart (void)
+{
+	RefConfig config;
+	RefGet (&config);
+	pllNominalHz = config.hz;
+	__sync_synchronize ();
+	pllRestart = true;
+}
+
+
+void BinaryByte (uint8_t ch)
+{
+	if (binLength == 0) {
+		binNeeded = (ch == BIN_SET_REF) ? BIN_SET_REF_LEN : BIN_GET_REF_LEN;
+		binUs = time_us_32 ();
+	}
+
+	binFrame[binLength++] = ch;
+	if (binLength == binNeeded) {
+		BinaryCommand (binFrame);
+		binLength = 0;
+	}
+}
+
+
+void BinaryCommand (const uint8_t *frame)
+{
+	uint8_t reply[BIN_REF_LEN];
+	uint8_t status = 0;
+	RefConfig config;
+
+	if (frame[0] == BIN_SET_REF) {
+		config.amplitude = (frame[1] | (frame[2] << 8)) / 10000.0f;
+		config.hz = (frame[3] | (frame[4] << 8)) / 10.0f;
+		config.rampMs = frame[5] | (frame[6] << 8);
+		status = !RefValid (&config) ? 1 : !RefSet (&config) ? 2 : 0;
+		if (status == 0) {
+			PllRestart ();
+		}
+	}
+
+	// raw so a 0x0a is not sent as cr lf
+	RefGet (&config);
+	uint16_t amplitude = (uint16_t)lroundf (config.amplitude * 10000.0f);
+	uint16_t hz = (uint16_t)lroundf (config.hz * 10.0f);
+	uint16_t rampMs = (uint16_t)lroundf (config.rampMs);
+	reply[0] = BIN_REF;
+	reply[1] = status;
+	reply[2] = amplitude & 0xff;
+	reply[3] = amplitude >> 8;
+	reply[4] = hz & 0xff;
+	reply[5] = hz >> 8;
+	reply[6] = rampMs & 0xff;
+	reply[7] = rampMs >> 8;
+	for (int i = 0; i < BIN_REF_LEN; i++) {
+		putchar_raw (reply[i]);
+	}
+}
+
+
 //=============================================================================================
-// core 1 tasks -- keep the sine waves going
+// core 1 tasks -- keep the sine waves going and track the synchro
 //
 
 void core1_entry (void)
@@ -330,6 +611,9 @@ void core1_entry (void)
 	alarm_pool_t *core1_alarm_pool;
     struct repeating_timer timer_40kHz;
 	
+	// start the converter, its dma interrupt runs on this core
+	SdInit ();
+
 	// create new alarm pool
     core1_alarm_pool = alarm_pool_create (2, 16);
 
@@ -337,17 +621,65 @@ void core1_entry (void)
     alarm_pool_add_repeating_timer_us (core1_alarm_pool, 
 		-25, repeating_timer_callback_40kHz, NULL, &timer_40kHz);
 
-	// nothing else to do on core 1
+	// external reference edges, on this core so they can not land part way through a sample
+	gpio_init (REF_IN_PIN);
+	gpio_set_dir (REF_IN_PIN, GPIO_IN);
+	gpio_pull_down (REF_IN_PIN);
+	gpio_set_irq_enabled_with_callback (REF_IN_PIN, GPIO_IRQ_EDGE_RISE, true, &RefEdgeIrq);
+
+	// run the tracking loop over each block of adc samples, and the reference pll
 	while (1) {
-		tight_loop_contents ();
+		SdTask ();
+		PllTask ();
 	}
 }
 
 
-bool repeating_timer_callback_40kHz (struct repeating_timer *t)
+void PllTask (void)
+{
+	static uint32_t seen = 0;
+	uint32_t count, us, phase;
+
+	if (pllRestart) {
+		pllRestart = false;
+		__sync_synchronize ();
+		RefPllInit (&pll, pllNominalHz, REF_PLL_BANDWIDTH_DEFAULT, REF_PLL_DAMPING_DEFAULT, REF_PLL_PULL_DEFAULT);
+		RefSteer (0);
+		seen = edgeCount;
+	}
+	if (!pllOn) {
+		return;
+	}
+
+	// the edge interrupt may come in part way through, read until the count holds still
+	do {
+		count = edgeCount;
+		us = edgeUs;
+		phase = edgePhase;
+	} while (count != edgeCount);
+
+	if (count != seen) {
+		seen = count;
+		RefPllEdge (&pll, us, phase);
+	}
+	RefPllCheck (&pll, time_us_32 ());
+	RefSteer (pll.trim);
+}
+
+
+void RefEdgeIrq (uint gpio, uint32_t events)
 {
-	uint16_t a;
+	uint32_t us = time_us_32 ();
+
+	// where the generator is now, from the sample that went out last
+	edgePhase = RefPllPhase (samplePhase, RefStep (), us - sampleUs);
+	edgeUs = us;
+	edgeCount = edgeCount + 1;
+}
 
+
+bool repeating_timer_callback_40kHz (struct repeating_timer *t)
+{
 	// a = 0xB000 | ((uint16_t)dac0B << 4);
 	// gpio_put (SPI0_CS0n_PIN, 0);
 	// spi_write16_blocking (spi0, &a, 1);
@@ -358,37 +690,18 @@ bool repeating_timer_callback_40kHz (struct repeating_timer *t)
 	// spi_write16_blocking (spi0, &a, 1);
 	// gpio_put (SPI0_CS1n_PIN, 1);
 
-	a = 0xB000 | ((uint16_t)dac2B << 4);
-	gpio_put (SPI0_CS0n_PIN, 0);
-	spi_write16_blocking (spi0, &a, 1);
-	gpio_put (SPI0_CS0n_PIN, 1);
+	Dac2::Write (Mcp::Word (Mcp::B, dac2B));
+	sampleUs = time_us_32 ();
+	samplePhase = RefPhase ();
 
-	if (++sin_phase >= 100) {
-		sin_phase = 0;
-	}
+	// tell the converter which part of the sine just went out, the first time starts it
+	SdReference (dac2Index);
 
-	critical_section_enter_blocking (&scale_critsec);
+	// next sample, new settings are picked up at the zero crossing without waiting
 	// dac0B = 128+scaleDac0*sine[sin_phase];
 	// dac1B = 128+scaleDac1*sine[sin_phase];
-	dac2B = 128+scaleDac2*sine[sin_phase];
-	critical_section_exit (&scale_critsec);
+	dac2B = RefSample (&dac2Index);
 
 	return true;
 }
 
-
-void dacWrite16 (spi_inst_t *spi, uint cs_pin, uint16_t a)
-{
-	// CS low
-    asm volatile ("nop \n nop \n nop");
-	gpio_put (cs_pin, 0);
-    asm volatile ("nop \n nop \n nop");
-
-	// transfer data
-	spi_write16_blocking (spi, &a, 1);
-
-	// CS high
-    asm volatile ("nop \n nop \n nop");
-	gpio_put (cs_pin, 1);
-    asm volatile ("nop \n nop \n nop");
-}
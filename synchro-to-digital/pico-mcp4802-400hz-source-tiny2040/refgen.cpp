@@ -0,0 +1,260 @@
+//---------------------------------------------------------------------------------------------
+// refgen.cpp
+//
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <math.h>
+
+#include "refgen.h"
+
+
+//---------------------------------------------------------------------------------------------
+// defines
+//
+
+#define REF_ONE     (1 << 24)                       // amplitude 1.0
+#define REF_SLOTS   4                               // settings queue, a power of 2
+
+
+//---------------------------------------------------------------------------------------------
+// typedefs
+//
+
+// settings as the sample interrupt uses them, worked out on the caller's side
+typedef struct {
+	uint32_t step;        // Q16 sine[] entries per sample
+	int32_t  amplitude;   // Q24
+	uint32_t rampSamples;
+} RefSettings;
+
+
+//---------------------------------------------------------------------------------------------
+// prototypes
+//
+
+static void Apply (void);
+
+
+//---------------------------------------------------------------------------------------------
+// globals
+//
+
+// sine lookup table
+// a=sin((0:99)*2*pi/100);
+// b=round(a*127);
+// min(b) ans = -127
+// max(b) ans =  127
+// b(1)   ans =  0
+static const int8_t sine[REF_STEPS] = {
+     0,    8,   16,   24,   32,   39,   47,   54,   61,   68,
+    75,   81,   87,   93,   98,  103,  107,  111,  115,  118,
+   121,  123,  125,  126,  127,  127,  127,  126,  125,  123,
+   121,  118,  115,  111,  107,  103,   98,   93,   87,   81,
+    75,   68,   61,   54,   47,   39,   32,   24,   16,    8,
+     0,   -8,  -16,  -24,  -32,  -39,  -47,  -54,  -61,  -68,
+   -75,  -81,  -87,  -93,  -98, -103, -107, -111, -115, -118,
+  -121, -123, -125, -126, -127, -127, -127, -126, -125, -123,
+  -121, -118, -115, -111, -107, -103,  -98,  -93,  -87,  -81,
+   -75,  -68,  -61,  -54,  -47,  -39,  -32,  -24,  -16,   -8
+};
+
+// queue from RefSet to RefSample, RefSet owns head and the slot it points at, RefSample
+// owns tail and the slots from tail up to head
+static RefSettings slot[REF_SLOTS];
+static volatile uint32_t head = 0;
+static volatile uint32_t tail = 0;
+
+// last settings RefSet queued, for RefGet
+static RefConfig current;
+
+// generator, RefSample only
+static uint32_t phase = 0;
+static uint32_t step = 0;
+static int32_t  amplitude = 0;
+static int32_t  target = 0;
+static int32_t  rampStep = 0;
+static uint32_t rampLeft = 0;
+
+// added to step by RefSteer, a single word so a store from anywhere is seen whole
+static volatile int32_t steer = 0;
+
+
+//---------------------------------------------------------------------------------------------
+// RefDefaults
+//
+
+void RefDefaults (RefConfig *config)
+{
+	config->amplitude = REF_AMPLITUDE_DEFAULT;
+	config->hz = REF_HZ_DEFAULT;
+	config->rampMs = REF_RAMP_MS_DEFAULT;
+}
+
+
+//---------------------------------------------------------------------------------------------
+// Settings -- config to the interrupt's fixed point, false if it is out of range
+//
+
+static bool Settings (const RefConfig *config, RefSettings *s)
+{
+	if (!(config->amplitude >= 0.0f && config->amplitude <= 1.0f) ||
+			!(config->hz >= REF_HZ_MIN && config->hz <= REF_HZ_MAX) ||
+			!(config->rampMs >= 0.0f && config->rampMs <= REF_RAMP_MS_MAX)) {
+		return false;
+	}
+
+	s->step = (uint32_t)lround ((double)config->hz * REF_CYCLE / REF_SAMPLE_HZ);
+	s->amplitude = (int32_t)lround ((double)config->amplitude * REF_ONE);
+	s->rampSamples = (uint32_t)lround ((double)config->rampMs * REF_SAMPLE_HZ / 1000.0);
+	return true;
+}
+
+
+//---------------------------------------------------------------------------------------------
+// RefInit -- before the sample interrupt starts, the output starts at zero and ramps up
+//            to the config's amplitude
+//
+
+void RefInit (const RefConfig *config)
+{
+	phase = 0;
+	amplitude = 0;
+	target = 0;
+	rampLeft = 0;
+	step = 0;
+	head = 0;
+	tail = 0;
+
+	if (!RefSet (config)) {
+		RefConfig defaults;
+		RefDefaults (&defaults);
+		RefSet (&defaults);
+	}
+	Apply ();
+}
+
+
+//---------------------------------------------------------------------------------------------
+// RefValid -- true if config is in range
+//
+
+bool RefValid (const RefConfig *config)
+{
+	RefSettings s;
+	return Settings (config, &s);
+}
+
+
+//---------------------------------------------------------------------------------------------
+// RefSet -- queue new settings, false if they are out of range or the queue is full
+//
+
+bool RefSet (const RefConfig *config)
+{
+	RefSettings s;
+
+	if (!Settings (config, &s) || (head - tail >= REF_SLOTS)) {
+		return false;
+	}
+
+	// fill the slot before head tells the interrupt it is there
+	slot[head % REF_SLOTS] = s;
+	__sync_synchronize ();
+	head = head + 1;
+
+	current = *config;
+	return true;
+}
+
+
+//---------------------------------------------------------------------------------------------
+// RefGet -- the settings last queued, they are on the output within a cycle
+//
+
+void RefGet (RefConfig *config)
+{
+	*config = current;
+}
+
+
+//---------------------------------------------------------------------------------------------
+// Apply -- newest queued settings, at the start of a cycle
+//
+
+static void Apply (void)
+{
+	uint32_t h = head;
+
+	if (h == tail) {
+		return;
+	}
+	__sync_synchronize ();
+	const RefSettings *s = &slot[(h - 1) % REF_SLOTS];
+
+	step = s->step;
+	target = s->amplitude;
+	if (s->rampSamples == 0) {
+		amplitude = target;
+		rampLeft = 0;
+	} else {
+		rampStep = (target - amplitude) / (int32_t)s->rampSamples;
+		rampLeft = s->rampSamples;
+	}
+
+	// hand the slots back once they have been read
+	__sync_synchronize ();
+	tail = h;
+}
+
+
+//---------------------------------------------------------------------------------------------
+// RefSample -- from the 40 kHz timer, the dac level for the next sample, its sine[] entry
+//              goes in index
+//
+
+uint8_t RefSample (uint8_t *index)
+{
+	phase += step + steer;
+	if (phase >= REF_CYCLE) {
+		phase -= REF_CYCLE;
+		Apply ();
+	}
+
+	if (rampLeft) {
+		amplitude += rampStep;
+		if (--rampLeft == 0) {
+			amplitude = target;
+		}
+	}
+
+	*index = phase >> 16;
+	return REF_MID + ((amplitude * sine[*index]) >> 24);
+}
+
+
+//---------------------------------------------------------------------------------------------
+// RefSteer -- add to the phase step to pull the frequency, Q16 sine[] entries per sample,
+//             see refpll.h
+//
+
+void RefSteer (int32_t stepTrim)
+{
+	steer = stepTrim;
+}
+
+
+//---------------------------------------------------------------------------------------------
+// RefPhase / RefStep -- Q16 phase of the last sample RefSample gave and the step it is
+//                       taking, call from the 40 kHz timer's core
+//
+
+uint32_t RefPhase (void)
+{
+	return phase;
+}
+
+uint32_t RefStep (void)
+{
+	return step + steer;
+}
@@ -0,0 +1,60 @@
+//---------------------------------------------------------------------------------------------
+// refgen.h
+//
+// reference generator, the sine on dac 2 with its amplitude, frequency and soft start ramp
+// set while it runs
+//
+// the phase is a Q16 index into the 100 entry sine[] table, stepped once per 40 kHz sample.
+// a step of 1.0 is the old fixed 400 Hz, other frequencies step a fraction of an entry so
+// one board drives 400 Hz aircraft synchros or 60 Hz surplus ones. amplitude is a fraction
+// of the dac's swing around mid scale, in Q24.
+//
+// RefSet may be called from core 0 while RefSample runs in the 40 kHz timer on core 1. the
+// settings go through a four slot single producer, single consumer queue that needs only
+// loads and stores, so neither side ever waits: RefSet returns false when the queue is full
+// and RefSample takes whatever is there without blocking. it applies the newest settings
+// at the start of a cycle, where the sine crosses zero, so a frequency change keeps the
+// phase and an amplitude change does not step the output. from there the amplitude moves
+// to its new value in a straight line over rampMs, which is also the soft start from zero
+// at power up.
+//
+// RefSteer adds a small trim to the step without going through the queue, for refpll.h to
+// pull the frequency onto an external reference. RefPhase and RefStep tell it where the
+// generator is.
+//
+// nothing in here needs the pico sdk so the generator also builds on the host.
+//
+
+#ifndef _REFGEN_H_
+#define _REFGEN_H_
+
+#define REF_SAMPLE_HZ  40000
+#define REF_STEPS      100              // sine[] entries per cycle
+#define REF_MID        128              // dac level at zero
+#define REF_CYCLE      ((uint32_t)REF_STEPS << 16)      // Q16 phase of a whole cycle
+
+// settings ranges and defaults, the defaults are what the generator always did
+#define REF_HZ_MIN            20.0f
+#define REF_HZ_MAX            1000.0f
+#define REF_RAMP_MS_MAX       10000.0f
+#define REF_HZ_DEFAULT        400.0f
+#define REF_AMPLITUDE_DEFAULT 0.90f
+#define REF_RAMP_MS_DEFAULT   100.0f
+
+typedef struct {
+	float amplitude;      // 0 to 1 of the dac's swing
+	float hz;             // REF_HZ_MIN to REF_HZ_MAX
+	float rampMs;         // time for an amplitude change, 0 to REF_RAMP_MS_MAX
+} RefConfig;
+
+void    RefDefaults (RefConfig *config);
+void    RefInit     (const RefConfig *config);
+bool    RefValid    (const RefConfig *config);
+bool    RefSet      (const RefConfig *config);
+void    RefGet      (RefConfig *config);
+uint8_t RefSample   (uint8_t *index);
+void    RefSteer    (int32_t stepTrim);
+uint32_t RefPhase   (void);
+uint32_t RefStep    (void);
+
+#endif
@@ -0,0 +1,200 @@
+//---------------------------------------------------------------------------------------------
+// refpll.cpp
+//
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <math.h>
+
+#include "refgen.h"
+#include "refpll.h"
+
+
+//---------------------------------------------------------------------------------------------
+// RefPllInit -- start with no reference and no trim
+//
+
+void RefPllInit (RefPll *pll, float nominalHz, float bandwidthHz, float damping, float pull)
+{
+	// closed loop -3 dB bandwidth to natural frequency for a type II loop, as sdloop.cpp
+	double a = 1.0 + 2.0 * damping * damping;
+	double wn = 2.0 * M_PI * bandwidthHz / sqrt (a + sqrt (a * a + 1.0));
+
+	// phase error e in cycles moves at the frequency difference, so with the trim at
+	// offset - kp * e and offset less ki * e each cycle, s^2 + kp s + ki nominalHz = 0
+	pll->nominalHz = nominalHz;
+	pll->pull = pull;
+	pll->kp = (float)(2.0 * damping * wn);
+	pll->ki = (float)(wn * wn / nominalHz);
+	pll->lockEdges = (int)(nominalHz * REF_PLL_LOCK_MS / 1000) + 1;
+	pll->trackEdges = (int)(nominalHz * REF_PLL_TRACK_MS / 1000) + 1;
+
+	pll->state = REF_PLL_NO_REFERENCE;
+	pll->outOfRange = false;
+	pll->lastUs = 0;
+	pll->firstUs = 0;
+	pll->edges = 0;
+	pll->good = 0;
+	pll->bad = 0;
+	pll->offsetHz = 0;
+	pll->refHz = 0;
+	pll->errDeg = 0;
+	pll->trim = 0;
+}
+
+
+//---------------------------------------------------------------------------------------------
+// RefPllPhase -- generator phase sinceUs after a sample at phase went out, Q16 sine[]
+//                entries
+//
+
+uint32_t RefPllPhase (uint32_t phase, uint32_t step, uint32_t sinceUs)
+{
+	uint64_t moved = (uint64_t)step * sinceUs * REF_SAMPLE_HZ / 1000000;
+	return (uint32_t)((phase + moved) % REF_CYCLE);
+}
+
+
+//---------------------------------------------------------------------------------------------
+// Steer -- trim for a frequency offset in Hz, limited to pull
+//
+
+static void Steer (RefPll *pll, float hz)
+{
+	float limit = pll->pull * pll->nominalHz;
+	hz = (hz > limit) ? limit : (hz < -limit) ? -limit : hz;
+	pll->trim = (int32_t)lroundf (hz * ((float)REF_CYCLE / REF_SAMPLE_HZ));
+}
+
+
+//---------------------------------------------------------------------------------------------
+// Acquire -- start measuring the reference's frequency from the edge at us
+//
+
+static void Acquire (RefPll *pll, uint32_t us)
+{
+	pll->state = REF_PLL_ACQUIRING;
+	pll->firstUs = us;
+	pll->edges = 0;
+}
+
+
+//---------------------------------------------------------------------------------------------
+// RefPllEdge -- a rising edge of the reference at us, the generator was at phase, see
+//               RefPllPhase
+//
+
+void RefPllEdge (RefPll *pll, uint32_t us, uint32_t phase)
+{
+	float periodUs = 1e6f / pll->nominalHz;
+	uint32_t sinceUs = us - pll->lastUs;
+
+	// noise on the input
+	if ((pll->state != REF_PLL_NO_REFERENCE) && (sinceUs < periodUs / 2)) {
+		return;
+	}
+	pll->lastUs = us;
+
+	if (pll->state == REF_PLL_NO_REFERENCE) {
+		Acquire (pll, us);
+		return;
+	}
+
+	if (pll->state == REF_PLL_ACQUIRING) {
+
+		// a missed edge spoils the measurement
+		if (sinceUs > periodUs * 3 / 2) {
+			Acquire (pll, us);
+			return;
+		}
+		if (++pll->edges < REF_PLL_ACQUIRE_EDGES) {
+			return;
+		}
+
+		float hz = pll->edges * 1e6f / (us - pll->firstUs);
+		pll->refHz = hz;
+		pll->outOfRange = fabsf (hz - pll->nominalHz) > pll->pull * pll->nominalHz;
+		if (pll->outOfRange) {
+			Acquire (pll, us);
+			return;
+		}
+
+		// track from the measured frequency, the phase is pulled in from wherever it is
+		pll->offsetHz = hz - pll->nominalHz;
+		Steer (pll, pll->offsetHz);
+		pll->state = REF_PLL_TRACKING;
+		pll->edges = 0;
+		pll->good = 0;
+		pll->bad = 0;
+		return;
+	}
+
+	// phase error, -0.5 to +0.5 cycle
+	float e = (float)phase / REF_CYCLE;
+	e = (e >= 0.5f) ? e - 1.0f : e;
+	pll->errDeg = e * 360.0f;
+
+	// generator ahead runs it slower, the integral is kept within pull so it can not wind up
+	float limit = pll->pull * pll->nominalHz;
+	pll->offsetHz -= pll->ki * e;
+	pll->offsetHz = (pll->offsetHz > limit) ? limit : (pll->offsetHz < -limit) ? -limit : pll->offsetHz;
+	pll->refHz = pll->nominalHz + pll->offsetHz;
+	Steer (pll, pll->offsetHz - pll->kp * e);
+
+	// lock detect
+	if (fabsf (pll->errDeg) <= REF_PLL_LOCK_DEG) {
+		pll->bad = 0;
+		if (++pll->good >= pll->lockEdges) {
+			pll->good = pll->lockEdges;
+			pll->state = REF_PLL_LOCKED;
+		}
+	} else {
+		pll->good = 0;
+		if ((pll->state == REF_PLL_LOCKED) && (++pll->bad >= REF_PLL_UNLOCK_EDGES)) {
+			pll->state = REF_PLL_TRACKING;
+			pll->edges = 0;
+		}
+	}
+
+	if ((pll->state == REF_PLL_TRACKING) && (++pll->edges >= pll->trackEdges)) {
+		Acquire (pll, us);
+	}
+}
+
+
+//---------------------------------------------------------------------------------------------
+// RefPllCheck -- call often, drops to no reference when the edges stop and holds the last
+//                frequency offset
+//
+
+void RefPllCheck (RefPll *pll, uint32_t us)
+{
+	if (pll->state == REF_PLL_NO_REFERENCE) {
+		return;
+	}
+	// signed, an edge may have been timed after us
+	if ((int32_t)(us - pll->lastUs) > REF_PLL_LOST_PERIODS * 1e6f / pll->nominalHz) {
+		if (pll->state != REF_PLL_ACQUIRING) {
+			Steer (pll, pll->offsetHz);
+		}
+		pll->state = REF_PLL_NO_REFERENCE;
+		pll->good = 0;
+		pll->bad = 0;
+	}
+}
+
+
+//---------------------------------------------------------------------------------------------
+// RefPllStateName
+//
+
+const char *RefPllStateName (RefPllState state)
+{
+	switch (state) {
+		case REF_PLL_NO_REFERENCE: return "no reference";
+		case REF_PLL_ACQUIRING:    return "acquiring";
+		case REF_PLL_TRACKING:     return "tracking";
+		case REF_PLL_LOCKED:       return "locked";
+	}
+	return "?";
+}
@@ -0,0 +1,85 @@
+//---------------------------------------------------------------------------------------------
+// refpll.h
+//
+// phase locks the reference generator in refgen.h to an external reference, the 400 Hz bus
+// of the aircraft or bench the panel shares, so the synchros on both see the same phase
+// instead of one that slips by the difference between two crystals
+//
+// the reference comes in as a rising edge at its positive going zero crossing, from a
+// comparator or a schmitt input behind a divider. at each edge RefPllEdge gets the time in
+// us and the generator's Q16 phase at that time, RefPllPhase works that out from the last
+// sample's phase, its step and the us since it went out. a phase of 0 is the generator's
+// own positive going zero crossing, so the phase at the edge is how far the generator is
+// ahead of the reference.
+//
+// locking has three stages:
+//    acquiring  the period over REF_PLL_ACQUIRE_EDGES edges gives the reference's frequency.
+//               it has to be within pull of the generator's nominal frequency, otherwise
+//               the pll stays here with outOfRange set
+//    tracking   a type II loop, a proportional and an integral term in Hz per cycle of
+//               phase error, steers the generator. the integral is the frequency offset
+//               from nominal and starts at the measured one
+//    locked     the phase error has been within REF_PLL_LOCK_DEG for REF_PLL_LOCK_MS.
+//               REF_PLL_UNLOCK_EDGES edges in a row outside it drop back to tracking
+// tracking that has not locked within REF_PLL_TRACK_MS starts acquiring again.
+//
+// the loop runs once per reference cycle. kp and ki come from the closed loop -3 dB
+// bandwidth and damping the same way as sdloop.h's. the output is a trim to the
+// generator's step for RefSteer, limited to pull of nominal.
+//
+// an edge less than half a nominal period after the last is noise on the input and
+// dropped. RefPllCheck drops to no reference when there has been no edge for
+// REF_PLL_LOST_PERIODS periods, the trim then holds the last frequency offset so the
+// generator free runs where the reference was.
+//
+// nothing in here needs the pico sdk so the pll also builds on the host.
+//
+
+#ifndef _REFPLL_H_
+#define _REFPLL_H_
+
+#define REF_PLL_BANDWIDTH_DEFAULT 10.0f  // Hz
+#define REF_PLL_DAMPING_DEFAULT   0.707f
+#define REF_PLL_PULL_DEFAULT      0.02f  // 8 Hz at 400 Hz, the bus's normal range and then some
+
+#define REF_PLL_ACQUIRE_EDGES 16
+#define REF_PLL_LOCK_DEG      5.0f
+#define REF_PLL_LOCK_MS       100
+#define REF_PLL_UNLOCK_EDGES  4
+#define REF_PLL_TRACK_MS      2000
+#define REF_PLL_LOST_PERIODS  4
+
+typedef enum {
+	REF_PLL_NO_REFERENCE,
+	REF_PLL_ACQUIRING,
+	REF_PLL_TRACKING,
+	REF_PLL_LOCKED
+} RefPllState;
+
+typedef struct {
+	float       nominalHz;      // generator's frequency without trim
+	float       pull;           // fraction of nominalHz the trim may move it
+	float       kp;             // Hz per cycle of phase error
+	float       ki;             // Hz per cycle of phase error, per edge
+	int         lockEdges;      // REF_PLL_LOCK_MS and REF_PLL_TRACK_MS in edges
+	int         trackEdges;
+	RefPllState state;
+	bool        outOfRange;     // last frequency measured was more than pull from nominal
+	uint32_t    lastUs;         // last edge
+	uint32_t    firstUs;        // first edge of the frequency measurement
+	int         edges;          // edges in the frequency measurement, or since tracking started
+	int         good;           // edges in a row inside the lock window
+	int         bad;            // edges in a row outside it
+	float       offsetHz;       // integral, the reference's frequency less nominalHz
+	float       refHz;          // the reference's frequency
+	float       errDeg;         // phase error at the last edge, generator ahead is positive
+	int32_t     trim;           // for RefSteer
+} RefPll;
+
+void     RefPllInit  (RefPll *pll, float nominalHz, float bandwidthHz, float damping, float pull);
+uint32_t RefPllPhase (uint32_t phase, uint32_t step, uint32_t sinceUs);
+void     RefPllEdge  (RefPll *pll, uint32_t us, uint32_t phase);
+void     RefPllCheck (RefPll *pll, uint32_t us);
+const char *RefPllStateName (RefPllState state);
+
+#endif
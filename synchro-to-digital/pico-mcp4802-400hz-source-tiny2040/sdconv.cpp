@@ -0,0 +1,352 @@
+//---------------------------------------------------------------------------------------------
+// sdconv.cpp
+//
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "pico/stdlib.h"
+#include "pico/sync.h"
+
+#include "hardware/adc.h"
+#include "hardware/dma.h"
+#include "hardware/irq.h"
+
+#include "sdloop.h"
+#include "sdconv.h"
+
+
+//---------------------------------------------------------------------------------------------
+// defines
+//
+
+// adc clock is 48 MHz, one conversion every (1 + div) clocks
+#define SD_ADC_CLKDIV ((48000000 / (SD_SAMPLE_HZ * SD_ADC_INPUTS)) - 1)
+
+#define SD_BLOCK_LEN  (SD_BLOCK_SETS * SD_ADC_INPUTS)
+
+// the dc offsets are measured over whole cycles of the carrier, 100 ms is whole cycles of
+// 400, 60 and 50 Hz
+#define SD_OFFSET_SETS (SD_SAMPLE_HZ / 10)
+
+// generator phase of each set, a power of 2 that covers both blocks and the trim
+#define SD_PHASE_RING 256
+
+
+//---------------------------------------------------------------------------------------------
+// prototypes
+//
+
+static void SdDmaIrq (void);
+static void SdRunBlock (const uint16_t *block, uint32_t first);
+
+
+//---------------------------------------------------------------------------------------------
+// globals
+//
+
+// filled by dma in turn, ready is set by the interrupt and cleared by SdTask
+static uint16_t adcBlock[2][SD_BLOCK_LEN];
+static volatile bool blockReady[2];
+static volatile uint32_t blockSet[2];    // number of each block's first set
+static uint32_t dmaSet = 0;              // number of the first set of the block being filled
+static int  dmaChan[2];
+static int  nextBlock = 0;
+static bool sdStarted = false;
+
+// sign of sine[] in refgen.cpp at each phase, and the phase of every set as SdReference
+// gives it
+static int8_t refSign[SD_REF_STEPS];
+static uint8_t phaseRing[SD_PHASE_RING];
+static uint32_t phaseSets = 0;
+static volatile uint8_t sdTrim = SD_TRIM_DEFAULT;
+
+// adc inputs of each synchro's Vs1-Vs3 and Vs3-Vs2
+static const uint8_t sdInput[SD_SYNCHROS][2] = {
+	{ 1, 2 },
+	{ 3, 0 }
+};
+
+static SdBank bank;
+static int8_t  refBlock[SD_BLOCK_SETS];
+static int16_t s1ms3Block[SD_BLOCK_SETS * SD_SYNCHROS];
+static int16_t s3ms2Block[SD_BLOCK_SETS * SD_SYNCHROS];
+static volatile uint32_t sdAngle[SD_SYNCHROS];
+static volatile int32_t sdVel[SD_SYNCHROS];
+static volatile bool sdLot[SD_SYNCHROS];
+static SdStats sdStats;
+
+// loop config, SdSetLoop changes it from either core and the next block picks it up
+static SdLoopConfig sdConfig;
+static volatile bool configPending = false;
+static critical_section_t config_critsec;
+
+// dc offset of each input in 1/256 counts, starts at mid scale
+static int32_t offsetQ8[SD_ADC_INPUTS];
+static int32_t offsetSum[SD_ADC_INPUTS];
+static uint32_t offsetSets = 0;
+
+
+//---------------------------------------------------------------------------------------------
+// SdInit -- call on core 1, the dma interrupt is enabled on the calling core
+//
+
+void SdInit (void)
+{
+	critical_section_init (&config_critsec);
+	SdLoopDefaults (&sdConfig, SD_SAMPLE_HZ);
+	SdBankInit (&bank, SD_SYNCHROS, &sdConfig);
+	for (int ch = 0; ch < SD_SYNCHROS; ch++) {
+		sdAngle[ch] = 0;
+		sdVel[ch] = 0;
+		sdLot[ch] = true;
+	}
+
+	for (int i = 0; i < SD_REF_STEPS; i++) {
+		refSign[i] = ((i % (SD_REF_STEPS / 2)) == 0) ? 0 : (i < SD_REF_STEPS / 2) ? +1 : -1;
+	}
+
+	for (int i = 0; i < SD_ADC_INPUTS; i++) {
+		offsetQ8[i] = SD_FULL_SCALE << 8;
+		offsetSum[i] = 0;
+		sdStats.offset[i] = SD_FULL_SCALE;
+	}
+
+	// adc round robin over inputs 0 to 3 into the fifo, one sample per dreq
+	adc_init ();
+	for (int i = 0; i < SD_ADC_INPUTS; i++) {
+		adc_gpio_init (26 + i);
+	}
+	adc_select_input (0);
+	adc_set_round_robin ((1 << SD_ADC_INPUTS) - 1);
+	adc_fifo_setup (true, true, 1, false, false);
+	adc_set_clkdiv (SD_ADC_CLKDIV);
+
+	// two dma channels, each restarts the other when its block is full
+	for (int i = 0; i < 2; i++) {
+		dmaChan[i] = dma_claim_unused_channel (true);
+		blockReady[i] = false;
+	}
+	for (int i = 0; i < 2; i++) {
+		dma_channel_config c = dma_channel_get_default_config (dmaChan[i]);
+		channel_config_set_transfer_data_size (&c, DMA_SIZE_16);
+		channel_config_set_read_increment (&c, false);
+		channel_config_set_write_increment (&c, true);
+		channel_config_set_dreq (&c, DREQ_ADC);
+		channel_config_set_chain_to (&c, dmaChan[i ^ 1]);
+		dma_channel_configure (dmaChan[i], &c, adcBlock[i], &adc_hw->fifo, SD_BLOCK_LEN, false);
+		dma_channel_set_irq1_enabled (dmaChan[i], true);
+	}
+	irq_set_exclusive_handler (DMA_IRQ_1, SdDmaIrq);
+	irq_set_enabled (DMA_IRQ_1, true);
+}
+
+
+//---------------------------------------------------------------------------------------------
+// SdReference -- call from the 40 kHz timer right after each sample is written, index is
+//                its sine[] entry. the first call starts the adc
+//
+
+void SdReference (uint8_t index)
+{
+	phaseRing[phaseSets++ % SD_PHASE_RING] = index;
+	if (sdStarted) {
+		return;
+	}
+	sdStarted = true;
+
+	// go, the first conversion is input 0 of set 0
+	dmaSet = 0;
+	adc_fifo_drain ();
+	dma_channel_start (dmaChan[0]);
+	adc_run (true);
+}
+
+
+//---------------------------------------------------------------------------------------------
+// SdDmaIrq -- a block is full, point its channel back at the start for next time
+//
+
+static void SdDmaIrq (void)
+{
+	for (int i = 0; i < 2; i++) {
+		if (dma_hw->ints1 & (1u << dmaChan[i])) {
+			dma_hw->ints1 = 1u << dmaChan[i];
+			dma_channel_set_write_addr (dmaChan[i], adcBlock[i], false);
+			if (blockReady[i]) {
+				sdStats.overruns++;
+			}
+			blockSet[i] = dmaSet;
+			dmaSet += SD_BLOCK_SETS;
+			blockReady[i] = true;
+		}
+	}
+}
+
+
+//---------------------------------------------------------------------------------------------
+// SdTask -- call from the core 1 loop, runs any blocks that are ready in order
+//
+
+void SdTask (void)
+{
+	while (blockReady[nextBlock]) {
+		uint32_t start = time_us_32 ();
+
+		SdRunBlock (adcBlock[nextBlock], blockSet[nextBlock]);
+		blockReady[nextBlock] = false;
+		nextBlock ^= 1;
+
+		uint32_t us = time_us_32 () - start;
+		if (us > sdStats.maxBlockUs) {
+			sdStats.maxBlockUs = us;
+		}
+		sdStats.blocks++;
+	}
+}
+
+
+//---------------------------------------------------------------------------------------------
+// SdRunBlock -- first is the number of the block's first set
+//
+
+static void SdRunBlock (const uint16_t *block, uint32_t first)
+{
+	int16_t offset[SD_ADC_INPUTS];
+	uint8_t trim = sdTrim;
+
+	if (configPending) {
+		critical_section_enter_blocking (&config_critsec);
+		SdBankSetGains (&bank, &sdConfig);
+		configPending = false;
+		critical_section_exit (&config_critsec);
+	}
+
+	for (int i = 0; i < SD_ADC_INPUTS; i++) {
+		offset[i] = offsetQ8[i] >> 8;
+	}
+
+	for (int n = 0; n < SD_BLOCK_SETS; n++) {
+		const uint16_t *set = &block[n * SD_ADC_INPUTS];
+		int16_t x[SD_ADC_INPUTS];
+
+		for (int i = 0; i < SD_ADC_INPUTS; i++) {
+			x[i] = (set[i] & 0x0fff) - offset[i];
+			offsetSum[i] += set[i] & 0x0fff;
+		}
+
+		// generator phase the synchro sees at this set
+		uint8_t phase = phaseRing[(first + n) % SD_PHASE_RING];
+		refBlock[n] = refSign[(phase + SD_REF_STEPS - trim) % SD_REF_STEPS];
+		for (int ch = 0; ch < SD_SYNCHROS; ch++) {
+			s1ms3Block[n * SD_SYNCHROS + ch] = x[sdInput[ch][0]];
+			s3ms2Block[n * SD_SYNCHROS + ch] = x[sdInput[ch][1]];
+		}
+	}
+
+	SdBankRun (&bank, refBlock, s1ms3Block, s3ms2Block, SD_BLOCK_SETS);
+
+	// move each offset an eighth of the way to the mean of the last 10 ms
+	offsetSets += SD_BLOCK_SETS;
+	if (offsetSets >= SD_OFFSET_SETS) {
+		for (int i = 0; i < SD_ADC_INPUTS; i++) {
+			int32_t meanQ8 = (int32_t)(((int64_t)offsetSum[i] << 8) / (int32_t)offsetSets);
+			offsetQ8[i] += (meanQ8 - offsetQ8[i]) >> 3;
+			offsetSum[i] = 0;
+			sdStats.offset[i] = offsetQ8[i] >> 8;
+		}
+		offsetSets = 0;
+	}
+
+	for (int ch = 0; ch < SD_SYNCHROS; ch++) {
+		sdAngle[ch] = bank.theta[ch];
+		sdVel[ch] = bank.vel[ch];
+		sdLot[ch] = bank.lot[ch];
+	}
+}
+
+
+//---------------------------------------------------------------------------------------------
+// SdAngle -- shaft angle at the end of the last block, 2^32 per turn
+//
+
+uint32_t SdAngle (uint8_t synchro)
+{
+	return (synchro < SD_SYNCHROS) ? sdAngle[synchro] : 0;
+}
+
+
+//---------------------------------------------------------------------------------------------
+// SdVelocity -- degrees per second
+//
+
+float SdVelocity (uint8_t synchro)
+{
+	if (synchro >= SD_SYNCHROS) {
+		return 0;
+	}
+	return sdVel[synchro] * (SD_SAMPLE_HZ * 360.0f / (256.0f * 4294967296.0f));
+}
+
+
+//---------------------------------------------------------------------------------------------
+// SdLossOfTracking
+//
+
+bool SdLossOfTracking (uint8_t synchro)
+{
+	return (synchro < SD_SYNCHROS) ? sdLot[synchro] : true;
+}
+
+
+//---------------------------------------------------------------------------------------------
+// SdSetLoop / SdGetLoop -- closed loop bandwidth in Hz and damping
+//
+// the bandwidth has to stay well under the 400 Hz carrier, out of range values are ignored
+//
+
+void SdSetLoop (float bandwidthHz, float damping)
+{
+	if (!(bandwidthHz >= 1.0f && bandwidthHz <= 200.0f) || !(damping >= 0.1f && damping <= 5.0f)) {
+		return;
+	}
+
+	critical_section_enter_blocking (&config_critsec);
+	sdConfig.bandwidthHz = bandwidthHz;
+	sdConfig.damping = damping;
+	configPending = true;
+	critical_section_exit (&config_critsec);
+}
+
+void SdGetLoop (SdLoopConfig *config)
+{
+	critical_section_enter_blocking (&config_critsec);
+	*config = sdConfig;
+	critical_section_exit (&config_critsec);
+}
+
+
+//---------------------------------------------------------------------------------------------
+// SdSetTrim / SdTrim -- reference lag in 25 us steps, 0 to 99
+//
+
+void SdSetTrim (uint8_t steps)
+{
+	sdTrim = steps % SD_REF_STEPS;
+}
+
+uint8_t SdTrim (void)
+{
+	return sdTrim;
+}
+
+
+//---------------------------------------------------------------------------------------------
+// SdGetStats
+//
+
+void SdGetStats (SdStats *stats)
+{
+	*stats = sdStats;
+}
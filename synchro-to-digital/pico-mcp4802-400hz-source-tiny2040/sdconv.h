@@ -0,0 +1,79 @@
+//---------------------------------------------------------------------------------------------
+// sdconv.h
+//
+// on board synchro to digital converter, replaces the DI-2108 and convert.py
+//
+// the adc samples its four inputs round robin at 160 kSPS, 40 kSPS per input, the same
+// rate convert.py asks of the DI-2108. two chained dma channels fill 1 ms blocks in turn
+// and SdTask runs the tracking loop in sdloop.cpp over each block as it completes.
+//
+// inputs, each biased to mid scale. synchro 0 keeps the order convert.py expects, synchro 1
+// uses the two inputs the loop no longer needs. sdInput in sdconv.cpp has the map:
+//    ADC0 / GP26    synchro 1 Vs3-Vs2    (was Ch1 Vr1-Vr2)
+//    ADC1 / GP27    synchro 0 Vs1-Vs3    Ch2
+//    ADC2 / GP28    synchro 0 Vs3-Vs2    Ch3
+//    ADC3 / GP29    synchro 1 Vs1-Vs3    (was Ch4 Vs2-Vs1)
+//
+// the synchros share the reference and are run together through an SdBank, each block is
+// one SdBankRun call. the four adc inputs are what limits the count to two, sdbench in
+// ../linux-host shows what the loop itself could run.
+//
+// the inputs are sampled 6.25 us apart instead of together, which is 0.9 degrees of the
+// 400 Hz carrier between neighbours and small next to the loop's own lag.
+//
+// demodulation:
+//
+// the reference is our own sine[] from refgen.cpp so the loop demodulates against the
+// generator's phase instead of the sign of Ch1. the 40 kHz timer calls SdReference with the
+// sine[] entry of every sample it writes to the dac, the first call starts the adc. the adc
+// and the timer both run off the crystal so sample set n is the nth sample written from
+// then on, whatever the generator's frequency.
+//
+// the trim is how many hundredths of a cycle (3.6 degrees) the reference at the synchro
+// lags the dac, a set written with entry p is demodulated with the sign of
+// sine[(p - trim) % 100]. a trim of 50 flips the reference, which is the Ch1 inversion
+// convert.py does. at 400 Hz a step is 25 us.
+//
+// at 60 Hz the demodulated error has its ripple at 120 Hz, set the loop's bandwidth down to
+// 10 Hz or so with SdSetLoop.
+//
+// outputs:
+//
+// SdAngle, SdVelocity and SdLossOfTracking are updated for each synchro at the end of every
+// block. the loop's bandwidth and damping can be changed while it runs with SdSetLoop, see
+// sdloop.h, every synchro gets the same.
+//
+// SdInit, SdTask and the dma interrupt all belong to core 1, SdReference to the 40 kHz timer
+// on core 1. everything else may be called from either core.
+//
+
+#ifndef _SDCONV_H_
+#define _SDCONV_H_
+
+#define SD_ADC_INPUTS  4
+#define SD_SYNCHROS    2
+#define SD_SAMPLE_HZ   40000                    // per input
+#define SD_BLOCK_SETS  (SD_SAMPLE_HZ / 1000)    // sets of four samples per dma block
+#define SD_REF_STEPS   100                      // sine[] entries per reference cycle
+#define SD_TRIM_DEFAULT 50                      // Ch1 is Vr1-Vr2, the loop wants Vr2-Vr1
+
+typedef struct {
+	uint32_t blocks;      // blocks run through the loop
+	uint32_t overruns;    // blocks the dma refilled before SdTask got to them
+	uint32_t maxBlockUs;  // longest time spent on one block
+	int16_t  offset[SD_ADC_INPUTS];  // dc offset being removed, adc counts
+} SdStats;
+
+void     SdInit     (void);
+void     SdReference (uint8_t index);
+void     SdTask     (void);
+uint32_t SdAngle    (uint8_t synchro);
+float    SdVelocity (uint8_t synchro);
+bool     SdLossOfTracking (uint8_t synchro);
+void     SdSetLoop  (float bandwidthHz, float damping);
+void     SdGetLoop  (SdLoopConfig *config);
+void     SdSetTrim  (uint8_t steps);
+uint8_t  SdTrim     (void);
+void     SdGetStats (SdStats *stats);
+
+#endif
@@ -0,0 +1,303 @@
+//---------------------------------------------------------------------------------------------
+// sdloop.cpp
+//
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <math.h>
+
+#include "sdloop.h"
+
+
+//---------------------------------------------------------------------------------------------
+// defines
+//
+
+// 1/sqrt(3) in Q16, cosin = (2 * s3ms2 + s1ms3) / sqrt(3)
+#define INV_SQRT3_Q16 37837
+
+// err and level low pass, 256 samples is 6.4 ms at 40 kHz, a few carrier cycles
+#define SD_LP_SHIFT 8
+
+// theta counts per radian
+#define SD_COUNTS_PER_RAD (4294967296.0 / (2.0 * M_PI))
+
+
+//---------------------------------------------------------------------------------------------
+// globals
+//
+
+// sine in Q15, cos is a quarter turn further on
+static int16_t sdSine[SD_SINE_SIZE];
+static bool sdSineReady = false;
+
+
+//---------------------------------------------------------------------------------------------
+// SdLoopDefaults
+//
+
+void SdLoopDefaults (SdLoopConfig *config, float sampleHz)
+{
+	config->bandwidthHz = SD_BANDWIDTH_DEFAULT;
+	config->damping = SD_DAMPING_DEFAULT;
+	config->amplitude = SD_AMPLITUDE_DEFAULT;
+	config->sampleHz = sampleHz;
+	config->lotDegrees = SD_LOT_DEFAULT;
+}
+
+
+//---------------------------------------------------------------------------------------------
+// SineInit -- fill in the sine table the first time a loop or bank is set up
+//
+
+static void SineInit (void)
+{
+	if (!sdSineReady) {
+		for (int i = 0; i < SD_SINE_SIZE; i++) {
+			sdSine[i] = (int16_t)lroundf (32767.0f * sinf (i * 2.0f * (float)M_PI / SD_SINE_SIZE));
+		}
+		sdSineReady = true;
+	}
+}
+
+
+//---------------------------------------------------------------------------------------------
+// SdLoopInit
+//
+
+void SdLoopInit (SdLoop *loop, const SdLoopConfig *config)
+{
+	SineInit ();
+
+	loop->theta = 0;
+	loop->vel = 0;
+	loop->err = 0;
+	loop->level = 0;
+	loop->lot = true;
+	SdLoopSetGains (loop, config);
+}
+
+
+//---------------------------------------------------------------------------------------------
+// Gains -- kp, ki and the loss of tracking limits for a config
+//
+
+static void Gains (const SdLoopConfig *config, int32_t *kp, int32_t *ki, int32_t *lotTan, int32_t *minLevel)
+{
+	double z = config->damping;
+	double t = 1.0 / config->sampleHz;
+
+	// natural frequency for the -3 dB bandwidth of a type II loop
+	double a = 1.0 + 2.0 * z * z;
+	double wn = 2.0 * M_PI * config->bandwidthHz / sqrt (a + sqrt (a * a + 1.0));
+
+	// demod counts per radian of error for small errors, the square wave demodulator
+	// averages the sine reference to 2/pi of its peak
+	double kd = config->amplitude * 32767.0 * 2.0 / M_PI;
+
+	// theta += kp e t, vel += ki e t^2, in theta counts
+	*kp = (int32_t)lround (2.0 * z * wn / kd * t * SD_COUNTS_PER_RAD * 65536.0);
+	*ki = (int32_t)lround (wn * wn / kd * t * t * SD_COUNTS_PER_RAD * 256.0 * 16777216.0);
+
+	// level is the in phase term low passed, the same scale as err
+	*lotTan = (int32_t)lround (tan (config->lotDegrees * M_PI / 180.0) * 256.0);
+	*minLevel = (int32_t)(kd / 4.0);
+}
+
+
+//---------------------------------------------------------------------------------------------
+// Detect -- scott t transform and the error and in phase terms against theta, not yet
+//           demodulated. full scale is 2^26
+//
+
+static inline void Detect (uint32_t theta, int32_t s1ms3, int32_t s3ms2, int32_t *delta, int32_t *inphase)
+{
+	// scott t transform, +/-2048 in
+	int32_t sinin = s1ms3;
+	int32_t cosin = ((2 * s3ms2 + s1ms3) * INV_SQRT3_Q16) >> 16;
+
+	// feedback angle rounded to the nearest table entry
+	uint32_t index = (theta + (1u << (31 - SD_SINE_BITS))) >> (32 - SD_SINE_BITS);
+	int32_t sinth = sdSine[index];
+	int32_t costh = sdSine[(index + SD_SINE_SIZE / 4) & (SD_SINE_SIZE - 1)];
+
+	*delta = sinin * costh - cosin * sinth;
+	*inphase = sinin * sinth + cosin * costh;
+}
+
+
+//---------------------------------------------------------------------------------------------
+// Track -- loss of tracking flag from the low passed error and level, err / level is the
+//          tangent of the tracking error
+//
+
+static inline bool Track (bool lot, int32_t err, int32_t level, int32_t lotTan, int32_t minLevel)
+{
+	if (err < 0) {
+		err = -err;
+	}
+	int32_t limit = (int32_t)(((int64_t)level * lotTan) >> 8);
+	if ((level < minLevel) || (err > limit)) {
+		return true;
+	} else if (err < limit / 2) {
+		return false;
+	}
+	return lot;
+}
+
+
+//---------------------------------------------------------------------------------------------
+// SdLoopSetGains -- new bandwidth, damping or amplitude, the angle and velocity are kept
+//
+
+void SdLoopSetGains (SdLoop *loop, const SdLoopConfig *config)
+{
+	Gains (config, &loop->kp, &loop->ki, &loop->lotTan, &loop->minLevel);
+	loop->sampleHz = config->sampleHz;
+}
+
+
+//---------------------------------------------------------------------------------------------
+// SdLoopStep -- one sample of the stator differences
+//
+
+void SdLoopStep (SdLoop *loop, int8_t refsq, int16_t s1ms3, int16_t s3ms2)
+{
+	int32_t delta, inphase;
+
+	// error and in phase terms, demodulated
+	Detect (loop->theta, s1ms3, s3ms2, &delta, &inphase);
+	delta *= refsq;
+	inphase *= refsq;
+
+	// pi compensator and integrator
+	loop->vel += (int32_t)(((int64_t)delta * loop->ki) >> 24);
+	loop->theta += (uint32_t)((loop->vel >> 8) + (int32_t)(((int64_t)delta * loop->kp) >> 16));
+
+	// loss of tracking
+	loop->err += (delta - loop->err) >> SD_LP_SHIFT;
+	loop->level += (inphase - loop->level) >> SD_LP_SHIFT;
+	loop->lot = Track (loop->lot, loop->err, loop->level, loop->lotTan, loop->minLevel);
+}
+
+
+//---------------------------------------------------------------------------------------------
+// SdBankInit
+//
+
+void SdBankInit (SdBank *bank, int count, const SdLoopConfig *config)
+{
+	SineInit ();
+
+	bank->count = (count < 1) ? 1 : (count > SD_BANK_MAX) ? SD_BANK_MAX : count;
+	for (int ch = 0; ch < SD_BANK_MAX; ch++) {
+		bank->theta[ch] = 0;
+		bank->vel[ch] = 0;
+		bank->err[ch] = 0;
+		bank->level[ch] = 0;
+		bank->lot[ch] = true;
+	}
+	SdBankSetGains (bank, config);
+}
+
+
+//---------------------------------------------------------------------------------------------
+// SdBankSetGains -- every channel gets the same gains
+//
+
+void SdBankSetGains (SdBank *bank, const SdLoopConfig *config)
+{
+	Gains (config, &bank->kp, &bank->ki, &bank->lotTan, &bank->minLevel);
+	bank->sampleHz = config->sampleHz;
+}
+
+
+//---------------------------------------------------------------------------------------------
+// SdBankRun -- sets of samples for every channel, s1ms3[n * count + ch] is channel ch in
+//              set n, refsq[n] is the reference for set n
+//
+// the same loop as SdLoopStep but the reference and gains are loaded once per set instead
+// of once per channel, the channel state sits in arrays the inner loop walks in order, and
+// the loss of tracking test runs once per call. its filters are 6.4 ms long so a 1 ms block
+// loses nothing.
+//
+
+void SdBankRun (SdBank *bank, const int8_t *refsq, const int16_t *s1ms3, const int16_t *s3ms2, int sets)
+{
+	const int count = bank->count;
+	const int32_t kp = bank->kp;
+	const int32_t ki = bank->ki;
+	uint32_t *theta = bank->theta;
+	int32_t *vel = bank->vel;
+	int32_t *err = bank->err;
+	int32_t *level = bank->level;
+
+	for (int n = 0; n < sets; n++) {
+		const int32_t r = refsq[n];
+		const int16_t *x1 = &s1ms3[n * count];
+		const int16_t *x3 = &s3ms2[n * count];
+
+		for (int ch = 0; ch < count; ch++) {
+			int32_t delta, inphase;
+
+			Detect (theta[ch], x1[ch], x3[ch], &delta, &inphase);
+			delta *= r;
+			inphase *= r;
+
+			vel[ch] += (int32_t)(((int64_t)delta * ki) >> 24);
+			theta[ch] += (uint32_t)((vel[ch] >> 8) + (int32_t)(((int64_t)delta * kp) >> 16));
+			err[ch] += (delta - err[ch]) >> SD_LP_SHIFT;
+			level[ch] += (inphase - level[ch]) >> SD_LP_SHIFT;
+		}
+	}
+
+	for (int ch = 0; ch < count; ch++) {
+		bank->lot[ch] = Track (bank->lot[ch], err[ch], level[ch], bank->lotTan, bank->minLevel);
+	}
+}
+
+
+//---------------------------------------------------------------------------------------------
+// SdBankDegrees / SdBankDps -- angle of a channel, -180 to +180, and its velocity in
+//                              degrees per second
+//
+
+float SdBankDegrees (const SdBank *bank, int ch)
+{
+	return (int32_t)bank->theta[ch] * (180.0f / 2147483648.0f);
+}
+
+float SdBankDps (const SdBank *bank, int ch)
+{
+	return bank->vel[ch] * (bank->sampleHz * 360.0f / (256.0f * 4294967296.0f));
+}
+
+
+//---------------------------------------------------------------------------------------------
+// SdLoopDegrees -- -180 to +180
+//
+
+float SdLoopDegrees (const SdLoop *loop)
+{
+	return (int32_t)loop->theta * (180.0f / 2147483648.0f);
+}
+
+
+//---------------------------------------------------------------------------------------------
+// SdLoopDps -- velocity in degrees per second
+//
+
+float SdLoopDps (const SdLoop *loop)
+{
+	return loop->vel * (loop->sampleHz * 360.0f / (256.0f * 4294967296.0f));
+}
+
+
+//---------------------------------------------------------------------------------------------
+// SdLoopError -- tracking error in degrees from the low passed error and in phase terms
+//
+
+float SdLoopError (const SdLoop *loop)
+{
+	return atan2f ((float)loop->err, (float)loop->level) * (180.0f / (float)M_PI);
+}
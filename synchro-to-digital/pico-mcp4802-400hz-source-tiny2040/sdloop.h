@@ -0,0 +1,107 @@
+//---------------------------------------------------------------------------------------------
+// sdloop.h
+//
+// synchro to digital tracking loop in fixed point, the error term from convert.py and
+// model.m feeding a type II loop
+//
+//    sinin = s1ms3
+//    cosin = 2/sqrt(3) * (s3ms2 + 0.5 * s1ms3)
+//    delta = sinin * cos (theta) - cosin * sin (theta)
+//    demod = refsq * delta
+//    vel   = vel + ki * demod
+//    theta = theta + vel + kp * demod
+//
+// convert.py's loop is the kp term alone, a pure integrator that lags a turning shaft by
+// velocity / gain. the ki term integrates that lag away, so a constant velocity tracks
+// with no steady state error and vel is the shaft's angular velocity.
+//
+// kp and ki come from the closed loop -3 dB bandwidth and damping in SdLoopConfig. the
+// detector gain depends on the stator amplitude, so the gains are worked out for the
+// nominal amplitude in the config. a smaller signal lowers the bandwidth and damping.
+//
+// loss of tracking is flagged when the low passed error is more than lotDegrees, or when
+// the in phase level falls below a quarter of nominal, which also covers a lost signal.
+// the flag clears when the error is back under half the limit.
+//
+// inputs are signed adc counts with the dc offset removed, full scale is +/-2048. s2ms1 is
+// not needed. refsq is the sign of Vr2-Vr1, -1, 0 or +1. theta is 2^32 per turn so it wraps
+// by itself, read it as an int32_t for -180 to +180 degrees. vel is in 1/256 theta counts
+// per sample.
+//
+// SdBank runs the same loop for several synchros that share one reference, a block of sample
+// sets at a time with the channel state in arrays, see SdBankRun. it is the cheaper way to
+// run more than one channel.
+//
+// nothing in here needs the pico sdk so the loop also builds on the host.
+//
+
+#ifndef _SDLOOP_H_
+#define _SDLOOP_H_
+
+#define SD_FULL_SCALE 2048
+
+// sine table used for the feedback angle, 4096 entries is 0.09 degrees per step
+#define SD_SINE_BITS 12
+#define SD_SINE_SIZE (1 << SD_SINE_BITS)
+
+// config defaults, close to the bandwidth of convert.py's 1/64 gain
+#define SD_BANDWIDTH_DEFAULT 60.0f      // Hz
+#define SD_DAMPING_DEFAULT   0.707f
+#define SD_AMPLITUDE_DEFAULT 1800.0f    // adc counts peak
+#define SD_LOT_DEFAULT       15.0f      // degrees
+
+typedef struct {
+	float bandwidthHz;    // closed loop -3 dB bandwidth
+	float damping;
+	float amplitude;      // nominal stator difference amplitude, adc counts peak
+	float sampleHz;       // SdLoopStep calls per second
+	float lotDegrees;     // tracking error that sets the loss of tracking flag
+} SdLoopConfig;
+
+typedef struct {
+	uint32_t theta;       // shaft angle, 2^32 per turn
+	int32_t  vel;         // velocity, 1/256 theta counts per sample
+	int32_t  kp;          // Q16 theta counts per demod count
+	int32_t  ki;          // Q24 vel counts per demod count
+	int32_t  err;         // demod low passed
+	int32_t  level;       // in phase level low passed
+	int32_t  lotTan;      // Q8 tangent of lotDegrees
+	int32_t  minLevel;    // level below which the signal is lost
+	bool     lot;         // loss of tracking
+	float    sampleHz;
+} SdLoop;
+
+// channels in an SdBank, the host tools build with more
+#ifndef SD_BANK_MAX
+#define SD_BANK_MAX 4
+#endif
+
+typedef struct {
+	int      count;
+	uint32_t theta[SD_BANK_MAX];
+	int32_t  vel[SD_BANK_MAX];
+	int32_t  err[SD_BANK_MAX];
+	int32_t  level[SD_BANK_MAX];
+	bool     lot[SD_BANK_MAX];
+	int32_t  kp;          // the rest as in SdLoop, shared by every channel
+	int32_t  ki;
+	int32_t  lotTan;
+	int32_t  minLevel;
+	float    sampleHz;
+} SdBank;
+
+void  SdLoopDefaults (SdLoopConfig *config, float sampleHz);
+void  SdLoopInit     (SdLoop *loop, const SdLoopConfig *config);
+void  SdLoopSetGains (SdLoop *loop, const SdLoopConfig *config);
+void  SdLoopStep     (SdLoop *loop, int8_t refsq, int16_t s1ms3, int16_t s3ms2);
+float SdLoopDegrees  (const SdLoop *loop);
+float SdLoopDps      (const SdLoop *loop);
+float SdLoopError    (const SdLoop *loop);
+
+void  SdBankInit     (SdBank *bank, int count, const SdLoopConfig *config);
+void  SdBankSetGains (SdBank *bank, const SdLoopConfig *config);
+void  SdBankRun      (SdBank *bank, const int8_t *refsq, const int16_t *s1ms3, const int16_t *s3ms2, int sets);
+float SdBankDegrees  (const SdBank *bank, int ch);
+float SdBankDps      (const SdBank *bank, int ch);
+
+#endif
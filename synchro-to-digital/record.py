@@ -0,0 +1,134 @@
+# Records the DI-2108 to a capture file for sdreplay and sdbatch, see lib/capture/capture.h
+#
+# usage:
+#     python3 record.py out.cap [seconds]              record from the DAQ, ctrl-c to stop
+#     python3 record.py --raw in.bin out.cap [rate]    wrap an old <hhhh capture
+#
+# the DAQ is set up the way convert.py sets it up, channels 0 to 3 at 40 ksps each, and
+# the connections are the same:
+#
+# Ch1 is Vr1-Vr2 (red/wht - blk/wht)
+# Ch2 is Vs1-Vs3 (ylw - blu)
+# Ch3 is Vs3-Vs2 (blu - blk)
+# Ch4 is Vs2-Vs1 (blk - ylw)
+#
+# the DI-2108 reads +/-10 V full scale, 10/32768 volts per count.
+
+# imports
+
+import time
+import sys
+import struct
+
+#----------------------------------------
+# constants
+
+DATAQ_SER_PORT = '/dev/ttyACM0' # DI-2108 serial port
+SAMPLE_RATE    = 40000          # per channel
+VOLTS_PER_LSB  = 10.0 / 32768.0
+CHANNELS       = ['Vr1-Vr2', 'Vs1-Vs3', 'Vs3-Vs2', 'Vs2-Vs1']
+
+#----------------------------------------
+# capture file, header then one entry per channel, the sets count is patched in at the end
+
+def WriteHeader (f, rate, sets, startUs):
+    f.write (struct.pack ("<4sHHIIQq", b"SCAP", 1, len(CHANNELS), rate, 0, sets, startUs))
+    for name in CHANNELS:
+        f.write (struct.pack ("<16sffII", name.encode(), VOLTS_PER_LSB, 0.0, 0, 0))
+
+#----------------------------------------
+# function to write command to dataq then wait up until the timeout
+# for the command string to be echoed back to the hose
+
+def WriteCommandWait (serial, cmd, timeout):
+    serial.write(cmd)
+    start = time.time ()
+    s = b"";
+    while not (cmd in s) and time.time () - start < timeout:
+        if (serial.in_waiting > 0):
+            s = s + serial.read (1)
+
+#----------------------------------------
+# wrap an existing raw capture
+
+if len(sys.argv) >= 4 and sys.argv[1] == '--raw':
+    rate = int(sys.argv[4]) if len(sys.argv) >= 5 else SAMPLE_RATE
+    with open (sys.argv[2], 'rb') as fin, open (sys.argv[3], 'wb') as fout:
+        WriteHeader (fout, rate, 0, 0)
+        sets = 0
+        while True:
+            data = fin.read (1 << 20)
+            if not data:
+                break
+            fout.write (data)
+            sets = sets + len(data) // 8
+        fout.seek (0)
+        WriteHeader (fout, rate, sets, 0)
+    print ('{:d} sets'.format (sets))
+    sys.exit (0)
+
+if len(sys.argv) < 2:
+    print ('usage: record.py out.cap [seconds] | record.py --raw in.bin out.cap [rate]')
+    sys.exit (2)
+
+seconds = float(sys.argv[2]) if len(sys.argv) >= 3 else 0
+
+import serial
+
+#----------------------------------------
+# configure dataq to capture channels 0 to 3 at 40 ksps each
+
+serDataq = serial.Serial (port = DATAQ_SER_PORT, timeout=0.5)
+
+WriteCommandWait (serDataq, b"stop\r", 0.25)      # stop in case device was left scanning
+WriteCommandWait (serDataq, b"reset\r", 0.25)     # reset in case of any errors
+WriteCommandWait (serDataq, b"encode 0\r", 0.25)  # set up the device for binary mode
+WriteCommandWait (serDataq, b"slist 0 0\r", 0.25) # scan list position 0 channel 0
+WriteCommandWait (serDataq, b"slist 1 1\r", 0.25) # scan list position 1 channel 1
+WriteCommandWait (serDataq, b"slist 2 2\r", 0.25) # scan list position 2 channel 2
+WriteCommandWait (serDataq, b"slist 3 3\r", 0.25) # scan list position 3 channel 3
+
+WriteCommandWait (serDataq, b"filter 0 0\r", 0.25)
+WriteCommandWait (serDataq, b"filter 1 0\r", 0.25)
+WriteCommandWait (serDataq, b"filter 2 0\r", 0.25)
+WriteCommandWait (serDataq, b"filter 3 0\r", 0.25)
+
+WriteCommandWait (serDataq, b"srate 6000\r", 0.25)
+WriteCommandWait (serDataq, b"dec 1\r", 0.25)
+WriteCommandWait (serDataq, b"deca 1\r", 0.25)
+WriteCommandWait (serDataq, b"ps 0\r", 0.25)
+
+print ('done with config ... recording')
+
+fout = open (sys.argv[1], 'wb')
+sets = 0
+pending = b""
+
+try:
+    # start data acquisition
+    serDataq.reset_input_buffer ()
+    serDataq.write (b"start 0\r")
+    startUs = int(time.time () * 1e6)
+    WriteHeader (fout, SAMPLE_RATE, 0, startUs)
+
+    # write whole sets of 8 bytes as they arrive
+    while seconds == 0 or sets < seconds * SAMPLE_RATE:
+        pending = pending + serDataq.read (max (8, serDataq.in_waiting))
+        whole = len(pending) - len(pending) % 8
+        fout.write (pending[:whole])
+        sets = sets + whole // 8
+        pending = pending[whole:]
+
+except KeyboardInterrupt:
+    pass
+
+print ("stopping")
+serDataq.write(b"stop\r")
+time.sleep(0.5)
+serDataq.write(b"reset\r")
+time.sleep(0.5)
+
+fout.seek (0)
+WriteHeader (fout, SAMPLE_RATE, sets, startUs)
+fout.close ()
+print ('{:d} sets, {:.1f} seconds'.format (sets, sets / SAMPLE_RATE))